@@ -68,6 +68,9 @@ static inline int32_t ofs_update_block(container_handle_t *ct, void *buf, uint32
     ASSERT(buf != NULL);
     ASSERT(size != 0);
 
+    OFS_COUNT(&ct->counters, OFS_CNT_BLOCK_WRITE, 1);
+    OFS_COUNT(&ct->counters, OFS_CNT_BLOCK_WRITE_BYTES, size);
+
     return os_disk_pwrite(ct->disk_hnd, buf, size, start_lba + vbn * ct->sb.sectors_per_block);
 }
 
@@ -77,6 +80,9 @@ static inline int32_t ofs_read_block(container_handle_t *ct, void *buf, uint32_t
     ASSERT(buf != NULL);
     ASSERT(size != 0);
 
+    OFS_COUNT(&ct->counters, OFS_CNT_BLOCK_READ, 1);
+    OFS_COUNT(&ct->counters, OFS_CNT_BLOCK_READ_BYTES, size);
+
     return os_disk_pread(ct->disk_hnd, buf, size, start_lba + vbn * ct->sb.sectors_per_block);
 }
 
@@ -95,6 +101,19 @@ static inline int32_t ofs_init_super_block(container_handle_t *ct)
     return ofs_update_block_pingpong_init(ct, &ct->sb.head, SUPER_BLOCK_VBN);
 }
 
+// write the blocks to the system, and to the device if the durability requires
+static inline int32_t ofs_flush_disk(container_handle_t *ct)
+{
+    ASSERT(ct != NULL);
+
+    if (ct->durability == OFS_DURABILITY_NONE)
+    {
+        return os_disk_flush(ct->disk_hnd);
+    }
+
+    return os_disk_sync(ct->disk_hnd);
+}
+
 
 
 static inline int32_t ofs_update_sectors(container_handle_t *ct, void *buf, uint32_t size, uint64_t start_lba)
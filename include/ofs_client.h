@@ -0,0 +1,87 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_CLIENT.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_CLIENT_H__
+#define __OFS_CLIENT_H__
+
+#include "ofs_proto.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct ofs_client ofs_client_t;
+
+/* called for every operation in the reply frame, data is valid only in the call */
+typedef void (*ofs_client_cb_t)(void *para, uint64_t seq, uint32_t index,
+    int32_t ret, const uint8_t *data, uint32_t len);
+
+/* called for every pair in the scan reply */
+typedef int32_t (*ofs_scan_cb_t)(void *para, const uint8_t *key, uint16_t key_len,
+    const uint8_t *value, uint16_t value_len);
+
+extern int32_t ofs_client_connect(const char *host, uint16_t port, ofs_client_t **client);
+extern void ofs_client_disconnect(ofs_client_t *client);
+
+/*
+ * pipelined and batched operations:
+ * the operations added are sent in one frame by ofs_client_flush, which
+ * returns the seq of the frame without waiting for the reply. many frames
+ * can be flushed before ofs_client_wait gets the replies in order.
+ */
+extern int32_t ofs_client_add_op(ofs_client_t *client, uint8_t opcode, uint8_t flags,
+    uint64_t handle, const void *key, uint16_t key_len, const void *value, uint32_t value_len);
+extern int32_t ofs_client_flush(ofs_client_t *client, uint64_t *seq);
+extern int32_t ofs_client_wait(ofs_client_t *client, uint64_t seq, ofs_client_cb_t cb, void *para);
+
+/* synchronous operations, one round trip each */
+extern int32_t ofs_client_open(ofs_client_t *client, const char *ct_name, uint64_t objid,
+    uint8_t flags, uint64_t *handle);
+extern int32_t ofs_client_close(ofs_client_t *client, uint64_t handle);
+extern int32_t ofs_client_get(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, void *value, uint32_t value_size);
+extern int32_t ofs_client_put(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len);
+extern int32_t ofs_client_del(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len);
+extern int32_t ofs_client_scan(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, uint32_t max_pairs, ofs_scan_cb_t cb, void *para);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
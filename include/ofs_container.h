@@ -45,18 +45,48 @@ extern "C" {
 #define OFS_NAME_SIZE     256
 
 #define FLAG_DIRTY       0x00000001     // dirty
+#define FLAG_READONLY    0x00000002     // the opened snapshot or read view, no modification
 
 #define MIN_BLOCKS_NUM   10
 
+// when the modifications reach the device
+typedef enum ofs_durability
+{
+    OFS_DURABILITY_NONE = 0,      // left to the os write back, a crash may tear the checkpoint
+    OFS_DURABILITY_CHECKPOINT,    // the blocks are synced before the super block of the checkpoint
+    OFS_DURABILITY_COMMIT,        // and every modification waits for the sync of its redo log
+
+    OFS_DURABILITY_BUTT
+} ofs_durability_t;
+
 struct container_handle
 {
     char name[OFS_NAME_SIZE];        // ct name
 
     void *disk_hnd;                       // file handle
+    ofs_log_t *log;                       // redo log
+    uint32_t durability;                  // ofs_durability_t
     ofs_super_block_t sb;               // super block
     uint32_t flags;                       
 
     object_handle_t *id_obj;
+    object_handle_t *snap_obj;            // the snapshots and their dead lists
+    uint64_t last_snapshot;               // the newest snapshot, or OFS_SNAPSHOT_NONE
+
+    uint64_t commit_seq;                  // the checkpoints written since opened
+    uint64_t commit_objid_inode_no;       // the root of $OBJID in the last checkpoint
+    os_rwlock view_lock;                  // the read views begin on the published checkpoint
+    uint32_t view_cnt;                    // the read views on it, under g_container_list_rwlock
+    ofs_pending_block_t *pending;         // the committed blocks freed, but not reusable yet
+    uint32_t pending_num;
+    uint32_t pending_max;
+    os_rwlock pending_lock;
+
+    container_handle_t *parent;           // the container of the read view
+    uint64_t view_seq;                    // the checkpoint the read view reads
+
+    os_rwlock op_lock;                    // the modifications hold it shared, the checkpoint exclusive
+    ofs_txn_group_t txn_group;
     
     space_manager_t sm;       // space manager
     space_manager_t bsm;      // base space manager
@@ -66,11 +96,25 @@ struct container_handle
 
     avl_tree_t metadata_cache;              // cache
     os_rwlock metadata_cache_lock;          // lock
+
+    // the checkpoint only visits the objects and blocks modified since the last one
+    list_head_t dirty_objs;
+    list_head_t dirty_caches;
+    uint32_t dirty_obj_num;
+    uint32_t dirty_cache_num;
+    os_rwlock dirty_lock;
+
+    // the cached blocks pinned by the value readers
+    list_head_t pinned_caches;
+    uint32_t pinned_cache_num;
+    os_rwlock pin_lock;
     
     avl_node_t entry;
     
     uint32_t ref_cnt;
     os_rwlock ct_lock;             // lock
+
+    ofs_counters_t counters;
 };
 
 int32_t ofs_init_system(void);
@@ -84,8 +128,15 @@ int32_t ofs_walk_all_opened_container(container_cb_t cb, void *para);
 int32_t ofs_open_container(const char *ct_name, container_handle_t **ct);
 int32_t ofs_create_container(const char *ct_name, uint64_t total_sectors, container_handle_t **ct);
 int32_t ofs_close_container(container_handle_t *ct);
+int32_t ofs_set_durability(container_handle_t *ct, uint32_t durability);
 container_handle_t *ofs_get_container_handle(const char *ct_name);
 
+/* for internal only */
+uint64_t get_oldest_read_view(container_handle_t *ct);
+void hold_container(container_handle_t *ct);
+int32_t commit_container_nolock(container_handle_t *ct);
+int32_t get_version_name(char *name, const char *ct_name, char sep, uint64_t no);
+
 
 #ifdef __cplusplus
 }
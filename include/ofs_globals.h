@@ -82,6 +82,10 @@ enum
     PID_TOOLS = 18,
     PID_UTILS = 19,
     PID_EXTENT_MAP = 20,
+    PID_STATS = 21,
+    PID_LOG = 22,
+    PID_SNAPSHOT = 23,
+    PID_TXN = 24,
 
     PID_BUTT
 };
@@ -139,6 +143,7 @@ typedef enum error_code
     INDEX_ERR_IS_OPENED,
     INDEX_ERR_NOT_OPENED,
     INDEX_ERR_OBJ_ID_INVALID,
+    INDEX_ERR_READ_ONLY,
 
     
     INDEX_ERR_BUTT
@@ -54,10 +54,14 @@ typedef struct object_info object_info_t;
 typedef struct object_handle object_handle_t;
 typedef struct container_handle container_handle_t;
 
+#include "ofs_stats.h"
 #include "ofs_metadata_cache.h"
 #include "ofs_space_manager.h"
 #include "ofs_tree.h"
 #include "ofs_object.h"
+#include "ofs_log.h"
+#include "ofs_snapshot.h"
+#include "ofs_txn.h"
 #include "ofs_container.h"
 #include "ofs_block.h"
 #include "ofs_tools_if.h"
@@ -66,6 +70,31 @@ typedef struct container_handle container_handle_t;
 int32_t ofs_open_container(const char *ct_name, container_handle_t **ct);
 int32_t ofs_create_container(const char *ct_name, uint64_t total_sectors, container_handle_t **ct);
 int32_t ofs_close_container(container_handle_t *ct);
+int32_t ofs_commit_container(container_handle_t *ct);
+int32_t ofs_sync_container(container_handle_t *ct);
+int32_t ofs_set_durability(container_handle_t *ct, uint32_t durability);
+
+// snapshot API, the snapshot is closed by ofs_close_container
+int32_t ofs_create_snapshot(container_handle_t *ct, uint64_t *snapshot_no);
+int32_t ofs_delete_snapshot(container_handle_t *ct, uint64_t snapshot_no);
+int32_t ofs_open_snapshot(container_handle_t *ct, uint64_t snapshot_no, container_handle_t **snap_ct);
+int32_t ofs_walk_snapshots(container_handle_t *ct, snapshot_cb_t cb, void *para);
+int32_t ofs_diff_snapshots(container_handle_t *ct, uint64_t objid, uint64_t old_no, uint64_t new_no,
+    snapshot_diff_cb_t cb, void *para);
+
+// read view API, the lookups and scans on the view are not blocked by the writers
+int32_t ofs_begin_read_view(container_handle_t *ct, container_handle_t **view);
+int32_t ofs_end_read_view(container_handle_t *view);
+
+// transaction API, the write set is applied atomically by the commit
+int32_t ofs_txn_begin(container_handle_t *ct, ofs_txn_t **txn);
+int32_t ofs_txn_insert(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len);
+int32_t ofs_txn_update(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len);
+int32_t ofs_txn_remove(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len);
+int32_t ofs_txn_commit(ofs_txn_t *txn);
+void ofs_txn_abort(ofs_txn_t *txn);
 
 // space manager API
 void ofs_init_sm(space_manager_t *sm, object_handle_t *obj, uint64_t first_free_block, uint64_t total_free_blocks);
@@ -87,7 +116,11 @@ int32_t index_search_key(object_handle_t *obj, const void *key, uint16_t key_len
 int32_t index_remove_key(object_handle_t *obj, const void *key, uint16_t key_len);
 int32_t index_insert_key(object_handle_t *obj, const void *key, uint16_t key_len, const void *value, uint16_t value_len);
 int32_t index_update_value(object_handle_t * tree, const void * key, uint16_t key_len, const void *value, uint16_t value_len);
+int32_t index_upsert_key(object_handle_t *obj, const void *key, uint16_t key_len, const void *value, uint16_t value_len);
 int32_t index_walk_all(object_handle_t *obj, bool_t reverse, uint8_t flags, void *para, tree_walk_cb_t cb);
+int32_t index_get_pinned(object_handle_t *obj, const void *key, uint16_t key_len, ofs_pinned_value_t *pinned);
+void index_release_pinned(ofs_pinned_value_t *pinned);
+int32_t index_get_into(object_handle_t *obj, const void *key, uint16_t key_len, void *buf, uint32_t buf_size);
 
 // cache API
 
@@ -55,6 +55,7 @@ extern "C" {
 /* flags */
 #define FLAG_SYSTEM        0x8000 /* 1: system attr  0: non-system attr */
 #define FLAG_TABLE         0x4000 /* 1: table        0: data stream */
+#define FLAG_BPLUS_TREE    0x2000 /* 1: b+ tree      0: b tree, only for table */
 
 #define BLOCK_SIZE            (4 * 1024)
 #define INODE_SIZE            (4 * 1024)
@@ -65,6 +66,7 @@ extern "C" {
 #define BASE_OBJ_NAME             "$BASE"
 #define SPACE_OBJ_NAME            "$SPACE"
 #define OBJID_OBJ_NAME            "$OBJID"
+#define SNAPSHOT_OBJ_NAME         "$SNAPSHOT"
 
 #define SUPER_BLOCK_VBN        0
 #define BASE_OBJ_INODE         1
@@ -73,6 +75,7 @@ extern "C" {
 #define BASE_OBJ_ID               0ULL
 #define SPACE_OBJ_ID              1ULL
 #define OBJID_OBJ_ID              2ULL
+#define SNAPSHOT_OBJ_ID           3ULL
 #define SPECIAL_OBJ_ID            10ULL  // The inode_no is recorded in super block if objid < SPECIAL_OBJ_ID
 #define RESERVED_OBJ_ID           128ULL
 
@@ -121,8 +124,12 @@ typedef struct ifs_super_block
     
     uint64_t base_blk;
     
-    uint64_t snapshot_no;
-    uint8_t aucReserved2[PRV_AREA_SIZE - 64 + 20];    // Reserved bytes
+    uint64_t snapshot_no;               /* the epoch of the blocks written now */
+    uint64_t log_lsn;                   /* the redo log before this lsn is in the checkpoint */
+    
+    uint64_t snapshot_id;
+    uint64_t snapshot_inode_no;         /* 0: no snapshot was taken */
+    uint8_t aucReserved2[PRV_AREA_SIZE - 64 + 20 - 8 - 16];    // Reserved bytes
     uint8_t aucReserved[160];            
     uint32_t flags;                     /* flags */
     uint16_t version;                   /* version */
@@ -150,7 +157,8 @@ typedef struct index_block
 
     uint16_t first_entry_off;       // Byte offset to first index_entry_t
     uint8_t node_type;              // The ucFlags of current ct block
-    uint8_t padding[5];             // Reserved/align to 8-byte boundary
+    uint32_t birth;                 // the snapshot_no of the super block when written
+    uint8_t padding[1];             // Reserved/align to 8-byte boundary
 
     index_entry_t begin_entry;
     //index_entry_t entries;
@@ -192,7 +200,7 @@ typedef struct inode_record
     uint64_t mtime;
 
     /* 96 */
-    uint64_t snapshot_no;
+    uint64_t snapshot_no;        // the snapshot_no of the super block when written
 
     /* 104 */
     uint16_t name_size;
@@ -0,0 +1,119 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_LOG.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_LOG_H__
+#define __OFS_LOG_H__
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * redo log of the logical modifications on the user objects. the records are
+ * appended to the "<container name>.redo" file in lsn order, sync the log to
+ * make the modifications durable without a checkpoint. the checkpoint records
+ * its lsn in the super block, and renames the file to "<container name>.redo.old",
+ * which is dropped when the checkpoint is on disk. the records after the lsn
+ * in both files are replayed when the container is opened.
+ */
+#define OFS_LOG_SUFFIX          ".redo"
+#define OFS_LOG_OLD_SUFFIX      ".redo.old"
+#define OFS_LOG_MAGIC           0x474F4C52   // "RLOG"
+#define OFS_LOG_BUF_SIZE        (1024 * 1024)
+
+typedef enum ofs_log_op
+{
+    OFS_LOG_CREATE_OBJ = 1,     // value: object flags
+    OFS_LOG_INSERT_KEY,         // key, value
+    OFS_LOG_REMOVE_KEY,         // key
+    OFS_LOG_TXN_BEGIN,          // value: number of the records of the transaction after it
+
+    OFS_LOG_OP_BUTT
+} ofs_log_op_t;
+
+#pragma pack(1)
+
+typedef struct ofs_log_record
+{
+    uint32_t magic;
+    uint32_t crc;               // crc32 of the record after this field
+    uint64_t lsn;
+    uint64_t objid;
+    uint16_t key_len;
+    uint16_t value_len;
+    uint8_t op;
+    uint8_t padding[3];
+
+    //uint8_t key[];
+    //uint8_t value[];
+} ofs_log_record_t;
+
+#pragma pack()
+
+typedef struct ofs_log ofs_log_t;
+
+// one record of the batch appended together
+typedef struct ofs_log_entry
+{
+    uint8_t op;
+    uint64_t objid;
+    const void *key;
+    const void *value;
+    uint16_t key_len;
+    uint16_t value_len;
+} ofs_log_entry_t;
+
+#define OFS_LOG_RECORD_SIZE(key_len, value_len)  (sizeof(ofs_log_record_t) + (key_len) + (value_len))
+
+int32_t ofs_log_create(container_handle_t *ct);
+int32_t ofs_log_open(container_handle_t *ct);
+void ofs_log_close(container_handle_t *ct);
+
+int32_t ofs_log_append(container_handle_t *ct, uint8_t op, uint64_t objid,
+    const void *key, uint16_t key_len, const void *value, uint16_t value_len);
+int32_t ofs_log_append_batch(container_handle_t *ct, const ofs_log_entry_t *entries, uint32_t num);
+uint64_t ofs_log_last_lsn(container_handle_t *ct);
+int32_t ofs_log_sync(container_handle_t *ct, uint64_t lsn);
+int32_t ofs_log_commit(container_handle_t *ct);
+
+void ofs_log_checkpoint(container_handle_t *ct);
+int32_t ofs_log_truncate(container_handle_t *ct);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
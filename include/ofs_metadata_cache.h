@@ -58,11 +58,37 @@ typedef enum cache_status
 #define SET_CACHE_CLEAN(cache)  ((cache)->state = CLEAN)
 #define SET_CACHE_EMPTY(cache)  ((cache)->state = EMPTY)
 #define SET_CACHE_FLUSH(cache)  ((cache)->state |= STATUS_FLUSH)
+#define CLEAR_CACHE_FLUSH(cache) ((cache)->state &= ~STATUS_FLUSH)
 #define CACHE_DIRTY(cache)      (((cache)->state & STATUS_MASK) == DIRTY)
 #define CACHE_CLEAN(cache)      ((cache)->state == CLEAN)
 #define CACHE_EMPTY(cache)      ((cache)->state == EMPTY)
 #define CACHE_FLUSH(cache)      ((cache)->state & STATUS_FLUSH)
 
+/* child links of one node block, hashed by the entry position */
+#define CACHE_LINK_SHIFT        6
+#define CACHE_LINK_NUM          (1 << CACHE_LINK_SHIFT)
+#define CACHE_LINK_SLOT(pos)    ((uint32_t)((uint32_t)(pos) * 0x9E3779B1U) >> (32 - CACHE_LINK_SHIFT))
+
+typedef struct ofs_cache_link
+{
+    uint32_t pos;                // position of the entry in parent block
+    ofs_block_cache_t *cache;    // the child block cache
+} ofs_cache_link_t;
+
+/*
+ * a block buffer pinned by the readers of the values in it.
+ * the writers never change a pinned buffer, they give the cache a copy first,
+ * the buffer is freed when the last pin is released.
+ */
+typedef struct ofs_pinned_block
+{
+    void *buf;                   // the block buffer, or a copy of a value in the root
+    uint32_t ref_cnt;            // the pins
+    ofs_block_cache_t *cache;    // the cache using the buffer, NULL when detached
+    object_info_t *obj_info;     // the object of the cache
+    container_handle_t *ct;
+    list_head_t entry;           // in the pinned list of the container when attached
+} ofs_pinned_block_t;
 
 struct ofs_block_cache
 {
@@ -71,6 +97,14 @@ struct ofs_block_cache
 	block_head_t *ib;
 	avl_node_t obj_entry; // recorded in object info
 	avl_node_t fs_entry;  // recorded in container handle
+
+	ofs_cache_link_t *links;   // child caches, only for node block
+	ofs_block_cache_t *parent; // the cache which links to this cache
+	uint32_t parent_slot;      // slot in parent's links
+
+	list_head_t dirty_entry;   // in the dirty list of the container when dirty
+
+	ofs_pinned_block_t *pinned; // the pins on ib
 };
 
 int32_t index_block_read(object_handle_t *obj, uint64_t vbn, uint32_t blk_id);
@@ -90,9 +124,24 @@ int32_t release_container_all_cache(container_handle_t *ct);
 int32_t flush_container_cache(container_handle_t *ct);
 
 int32_t commit_container_modification(container_handle_t *ct);
+int32_t commit_container_modification_nolock(container_handle_t *ct);
 
 void free_obj_cache(object_info_t *obj_info, ofs_block_cache_t *cache);
 
+void set_cache_dirty(object_info_t *obj_info, ofs_block_cache_t *cache);
+void remove_dirty_object(object_info_t *obj_info);
+
+ofs_block_cache_t *get_child_cache(ofs_block_cache_t *parent, uint32_t pos, uint64_t vbn);
+void link_child_cache(ofs_block_cache_t *parent, uint32_t pos, ofs_block_cache_t *child);
+void invalidate_child_caches(ofs_block_cache_t *parent);
+void move_child_caches(ofs_block_cache_t *dst, ofs_block_cache_t *src);
+void unlink_cache(ofs_block_cache_t *cache);
+
+ofs_pinned_block_t *pin_cache(object_info_t *obj_info, ofs_block_cache_t *cache);
+ofs_pinned_block_t *pin_copy(container_handle_t *ct, const void *data, uint32_t size);
+void unpin_block(ofs_pinned_block_t *pb);
+int32_t unshare_pinned_caches(object_info_t *obj_info);
+
 
 #ifdef	__cplusplus
 }
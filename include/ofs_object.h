@@ -45,7 +45,8 @@ extern "C" {
 #define OBJID_IS_INVALID(id)          ((id) == INVALID_OBJID)
 
 #define SET_INODE_CLEAN(obj_info)      SET_CACHE_CLEAN((obj_info)->inode_cache)
-#define SET_INODE_DIRTY(obj_info)      SET_CACHE_DIRTY((obj_info)->inode_cache)
+#define SET_INODE_DIRTY(obj_info)      set_cache_dirty(obj_info, (obj_info)->inode_cache)
+#define SET_ROOT_DIRTY(obj_info)       set_cache_dirty(obj_info, &(obj_info)->root_cache)
 #define INODE_DIRTY(obj_info)          CACHE_DIRTY((obj_info)->inode_cache)
 
 
@@ -73,13 +74,17 @@ struct object_info
     os_rwlock    obj_hnd_lock;        // lock the obj_hnd_list operation
 
     ofs_block_cache_t root_cache;
+    list_head_t dirty_entry;           // in the dirty list of the container when the root moved
     
     avl_tree_t caches;            // record all new block data
     os_rwlock caches_lock;
     
     uint32_t ref_cnt;
+    uint64_t modify_seq;          // increased on every tree modification
     
     os_rwlock obj_lock;
+
+    ofs_counters_t counters;
 };
 
 struct object_handle
@@ -95,6 +100,7 @@ struct object_handle
     ofs_block_cache_t *cache;
     uint64_t position;
     index_entry_t *ie;        
+    uint64_t hint_seq;         // the leaf in stack is valid for insert if equal to modify_seq
 
     list_head_t entry;
 };
@@ -107,6 +113,9 @@ int32_t create_object_at_inode(container_handle_t *ct, uint64_t objid, uint64_t
     uint16_t flags, object_handle_t **obj_out);
 object_info_t *ofs_get_object_info(container_handle_t *ct, uint64_t objid);
 object_handle_t *ofs_get_object_handle(container_handle_t *ct, uint64_t objid);
+int32_t ofs_create_object_nolock(container_handle_t *ct, uint64_t objid, uint16_t flags, object_handle_t **obj_out);
+int32_t ofs_open_object_nolock(container_handle_t *ct, uint64_t objid, uint32_t open_flags, object_handle_t **obj_out);
+int32_t ofs_close_object_nolock(object_handle_t *obj);
 
 
 // object API
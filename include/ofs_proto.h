@@ -0,0 +1,134 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_PROTO.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_PROTO_H__
+#define __OFS_PROTO_H__
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * binary kv protocol, all the fields are in host byte order(little endian)
+ *
+ * request:  ofs_proto_head_t + ops_num * (ofs_proto_op_t + key + value)
+ * reply:    ofs_proto_head_t + ops_num * (ofs_proto_result_t + data)
+ *
+ * the requests can be pipelined, the reply has the same seq as the request.
+ * the reply is not larger than OFS_PROTO_MAX_FRAME, the scans in the frame
+ * return fewer pairs when it is full.
+ * the text command line is still accepted if the first byte is not 0xA5.
+ */
+#define OFS_PROTO_MAGIC        0x5AA5       /* the first byte on wire is 0xA5 */
+#define OFS_PROTO_MAX_FRAME    (4 * 1024 * 1024)
+#define OFS_PROTO_MAX_OPS      1024
+
+/* opcode */
+enum
+{
+    OFS_OP_OPEN = 1,   /* key: container name, value: objid(8 bytes) [+ object flags(2 bytes)], 
+                          handle: sectors if create container, reply data: handle(8 bytes) */
+    OFS_OP_CLOSE,      /* handle */
+    OFS_OP_GET,        /* handle, key, reply data: value */
+    OFS_OP_PUT,        /* handle, key, value, replace the old value */
+    OFS_OP_DEL,        /* handle, key */
+    OFS_OP_SCAN,       /* handle, start key(can be empty), value_len: max pairs, no value, 
+                          reply data: pairs_num * (ofs_proto_kv_t + key + value) */
+
+    OFS_OP_BUTT
+};
+
+/* flags of OFS_OP_OPEN */
+#define OFS_OPEN_CREATE        0x01   /* create the container and object if not exist */
+
+#define OFS_PROTO_DEFAULT_SECTORS   (1024 * 1024)
+#define OFS_PROTO_DEFAULT_FLAGS     (FLAG_TABLE | CR_ANSI_STRING | (CR_ANSI_STRING << 4))
+
+enum ofs_proto_error_code
+{
+    OFS_PROTO_ERR_START = 500000,
+    OFS_PROTO_ERR_FRAME,          /* the frame is broken */
+    OFS_PROTO_ERR_OPCODE,
+    OFS_PROTO_ERR_HANDLE,
+    OFS_PROTO_ERR_HANDLE_FULL,
+    OFS_PROTO_ERR_MALLOC,
+    OFS_PROTO_ERR_CONNECT,
+    OFS_PROTO_ERR_SEND,
+    OFS_PROTO_ERR_RECV,
+    OFS_PROTO_ERR_PARAMETER,
+    OFS_PROTO_ERR_REPLY_FULL,     /* the reply does not fit in the frame */
+    
+    OFS_PROTO_ERR_BUTT
+};
+
+#pragma pack(1) /* aligned by 1 byte */
+
+typedef struct ofs_proto_head
+{
+    uint16_t magic;          /* OFS_PROTO_MAGIC */
+    uint16_t ops_num;        /* operations in this frame */
+    uint32_t len;            /* bytes following this head */
+    uint64_t seq;            /* the reply has the same seq */
+} ofs_proto_head_t;
+
+typedef struct ofs_proto_op
+{
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t key_len;
+    uint32_t value_len;
+    uint64_t handle;         /* returned by OFS_OP_OPEN */
+} ofs_proto_op_t;
+
+typedef struct ofs_proto_result
+{
+    int32_t ret;
+    uint32_t len;            /* bytes of data following */
+} ofs_proto_result_t;
+
+typedef struct ofs_proto_kv
+{
+    uint16_t key_len;
+    uint16_t value_len;
+} ofs_proto_kv_t;
+
+#pragma pack()  // Resume to default for performance
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SERVER.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_SERVER_H__
+#define __OFS_SERVER_H__
+
+#include <event2/buffer.h>
+
+#include "ofs_proto.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SESSION_IDLE_MS      60000  /* close the objects not used for a while */
+#define SESSION_COMMIT_MS    5000   /* commit the modification in background */
+
+#define PROTO_MAX_HANDLES   64
+
+typedef struct proto_handle
+{
+    object_handle_t *obj;      // opened by session_open
+} proto_handle_t;
+
+// the objects opened by one connection
+typedef struct proto_handles
+{
+    proto_handle_t hnds[PROTO_MAX_HANDLES];
+} proto_handles_t;
+
+/*
+ * the objects opened by the server are kept in the session table, so the
+ * commands of all the connections use the opened objects with warm cache.
+ * the modification is committed in background, and the objects not used
+ * for a while are closed.
+ */
+extern int32_t session_init(uint32_t idle_ms, uint32_t commit_ms);
+extern void session_exit(void);
+extern int32_t session_open(const char *ct_name, uint64_t objid, uint8_t open_flags,
+    uint64_t sectors, uint16_t obj_flags, object_handle_t **obj);
+extern void session_close(object_handle_t *obj);
+
+extern int32_t proto_exec_frame(proto_handles_t *handles, const uint8_t *frame,
+    uint32_t len, struct evbuffer *out);
+extern void proto_close_handles(proto_handles_t *handles);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SNAPSHOT.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_SNAPSHOT_H__
+#define __OFS_SNAPSHOT_H__
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * snapshot of the container: the super block's snapshot_no is the epoch, every
+ * block records the epoch it is written in as its birth. taking snapshot n
+ * checkpoints the container and records the root of $OBJID as it is, then
+ * the epoch goes to n + 1. nothing is copied, the blocks born before n + 1
+ * are shared with the snapshot until they are modified.
+ *
+ * the block freed by the container is released by the next checkpoint if it is
+ * born after the newest snapshot, or else it is kept in the dead list of the
+ * current epoch.
+ * the dead list of snapshot n has the blocks freed in epoch n, the one of the
+ * container has the blocks freed after the newest snapshot. deleting snapshot
+ * n frees the blocks in the next dead list born after the previous snapshot,
+ * and moves its own dead list to the next one.
+ *
+ * the records and the dead lists are both in $SNAPSHOT:
+ *   'S' + snapshot_no              -> ofs_snapshot_record_t
+ *   'D' + epoch + vbn              -> birth
+ */
+#define OFS_SNAPSHOT_NONE       ((uint64_t)-1)
+#define OFS_SNAPSHOT_KEY        'S'
+#define OFS_DEADLIST_KEY        'D'
+#define OFS_SNAPSHOT_MAX        0xFFFFFFFFULL   // the birth in the index block is 32 bits
+#define OFS_BIRTH_DIRTY         ((uint64_t)-1)  // the block is not written by any checkpoint
+
+#pragma pack(1)
+
+typedef struct ofs_snapshot_record
+{
+    uint64_t snapshot_no;
+    uint64_t objid_inode_no;    // the root of the objects in the snapshot
+    uint64_t log_lsn;           // the modifications logged up to it are in the snapshot
+} ofs_snapshot_record_t;
+
+#pragma pack()
+
+/*
+ * the committed block freed is still referred by the last checkpoint and the
+ * read views on it, so it is kept until the next checkpoint which no read view
+ * older than it refers
+ */
+typedef struct ofs_pending_block
+{
+    uint64_t vbn;
+    uint64_t commit_seq;        // the checkpoint it belongs to when freed
+} ofs_pending_block_t;
+
+typedef int32_t (*snapshot_cb_t)(void *para, const ofs_snapshot_record_t *snap);
+
+typedef enum ofs_diff_type
+{
+    OFS_DIFF_INSERT = 0,    // old_ie is NULL
+    OFS_DIFF_REMOVE,        // new_ie is NULL
+    OFS_DIFF_CHANGE,        // the same key with different values
+
+    OFS_DIFF_BUTT
+} ofs_diff_type_t;
+
+// the entries are only valid in the callback, stop the diff by returning non-zero
+typedef int32_t (*snapshot_diff_cb_t)(void *para, uint32_t type, index_entry_t *old_ie, index_entry_t *new_ie);
+
+int32_t ofs_create_snapshot(container_handle_t *ct, uint64_t *snapshot_no);
+int32_t ofs_delete_snapshot(container_handle_t *ct, uint64_t snapshot_no);
+int32_t ofs_open_snapshot(container_handle_t *ct, uint64_t snapshot_no, container_handle_t **snap_ct);
+int32_t ofs_walk_snapshots(container_handle_t *ct, snapshot_cb_t cb, void *para);
+int32_t ofs_get_snapshot(container_handle_t *ct, uint64_t snapshot_no, ofs_snapshot_record_t *snap);
+int32_t ofs_diff_snapshots(container_handle_t *ct, uint64_t objid, uint64_t old_no, uint64_t new_no,
+    snapshot_diff_cb_t cb, void *para);
+
+/* for internal only */
+int32_t open_snapshot_object(container_handle_t *ct);
+int32_t ofs_free_block_born(container_handle_t *ct, uint64_t objid, uint64_t vbn, uint64_t birth);
+int32_t ofs_free_block_later(container_handle_t *ct, uint64_t vbn);
+void release_pending_blocks(container_handle_t *ct, uint64_t oldest_view);
+void destroy_pending_blocks(container_handle_t *ct);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
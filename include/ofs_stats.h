@@ -0,0 +1,142 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_STATS.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_STATS_H__
+#define __OFS_STATS_H__
+
+#include "histogram.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// the latency histograms of the APIs and the I/Os, in nanoseconds
+typedef enum ofs_stat_id
+{
+    OFS_STAT_SEARCH_KEY = 0,
+    OFS_STAT_INSERT_KEY,
+    OFS_STAT_REMOVE_KEY,
+    OFS_STAT_UPDATE_VALUE,
+    OFS_STAT_BLOCK_READ_MISS,
+    OFS_STAT_FLUSH_CACHE,
+    OFS_STAT_ALLOC_SPACE,
+
+    OFS_STAT_NUM
+} ofs_stat_id_t;
+
+#ifdef __KERNEL__
+#define OFS_STAT_START()           0
+#define OFS_STAT_END(id, start)
+#else
+#define OFS_STAT_START()           os_get_ns_count()
+#define OFS_STAT_END(id, start)    ofs_stat_record(id, os_get_ns_count() - (start))
+#endif
+
+void ofs_stat_record(uint32_t id, uint64_t ns);
+const char *ofs_stat_name(uint32_t id);
+void ofs_stat_get(uint32_t id, histogram_t *hist);
+void ofs_stat_reset(void);
+
+// the counters of the containers and the objects, they are never reset
+typedef enum ofs_counter_id
+{
+    OFS_CNT_CACHE_HIT = 0,
+    OFS_CNT_CACHE_MISS,
+    OFS_CNT_SPLIT_IB,
+    OFS_CNT_REPARENT_ROOT,
+    OFS_CNT_COW_RELOCATE,        // clean blocks moved to new place by set_ib_dirty
+    OFS_CNT_LOCK_WAIT_NS,        // time waiting for the attr_lock
+    OFS_CNT_OBJ_NUM,             // the counters above are also kept per object
+
+    OFS_CNT_BLOCK_READ = OFS_CNT_OBJ_NUM,
+    OFS_CNT_BLOCK_READ_BYTES,
+    OFS_CNT_BLOCK_WRITE,
+    OFS_CNT_BLOCK_WRITE_BYTES,
+    OFS_CNT_ALLOC_BLOCKS,
+    OFS_CNT_FREE_BLOCKS,
+    OFS_CNT_CHECKPOINT,
+    OFS_CNT_CHECKPOINT_NS,
+    OFS_CNT_LOG_APPEND,
+    OFS_CNT_LOG_BYTES,
+    OFS_CNT_LOG_SYNC,
+    OFS_CNT_DEFER_FREE,          // blocks kept in the dead list for the snapshots
+    OFS_CNT_DIFF_SKIP,           // subtrees shared by the two trees and not read by the diff
+    OFS_CNT_TXN_COMMIT,
+    OFS_CNT_TXN_ABORT,           // aborted by the caller, or by the failed commit
+    OFS_CNT_PIN_UNSHARE,         // pinned blocks copied before they were modified
+
+    OFS_CNT_NUM
+} ofs_counter_id_t;
+
+#define OFS_CACHE_LINE_SIZE     64
+#define OFS_COUNTER_SLOTS       8
+
+// every slot is padded to whole cache lines, so the threads counting in
+// different slots do not bounce the same line
+#define OFS_COUNTER_SLOT_SIZE   (((OFS_CNT_NUM * 8 + OFS_CACHE_LINE_SIZE - 1) / OFS_CACHE_LINE_SIZE) \
+                                    * OFS_CACHE_LINE_SIZE / 8)
+
+typedef struct ofs_counters
+{
+    uint64_t slots[OFS_COUNTER_SLOTS][OFS_COUNTER_SLOT_SIZE];
+} ofs_counters_t;
+
+uint32_t ofs_thread_slot(void);
+const char *ofs_counter_name(uint32_t id);
+uint64_t ofs_counter_get(const ofs_counters_t *counters, uint32_t id);
+
+#ifdef __KERNEL__
+#define OFS_COUNT(counters, id, n)
+#else
+static inline void ofs_count(ofs_counters_t *counters, uint32_t id, uint64_t n)
+{
+    (void)atomic_add(&counters->slots[ofs_thread_slot()][id], n);
+}
+
+#define OFS_COUNT(counters, id, n)      ofs_count(counters, id, n)
+#endif
+
+// count on the object and its container
+#define OFS_COUNT_OBJ(obj_info, id, n)  do { \
+        OFS_COUNT(&(obj_info)->counters, id, n); \
+        OFS_COUNT(&(obj_info)->ct->counters, id, n); \
+    } while (0)
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
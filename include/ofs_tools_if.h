@@ -69,6 +69,13 @@ typedef struct ifs_tools_para
     os_rwlock rwlock;
 } ifs_tools_para_t;
 
+// how the commands open the object, the server keeps the objects opened
+typedef struct tools_object_ops
+{
+    int32_t (*open)(ifs_tools_para_t *para, object_handle_t **obj);
+    void (*close)(ifs_tools_para_t *para, object_handle_t *obj);
+} tools_object_ops_t;
+
 
 extern int do_verify_cmd(int argc, char *argv[], net_para_t *net);
 extern int do_fixup_cmd(int argc, char *argv[], net_para_t *net);
@@ -81,7 +88,14 @@ extern int do_delete_cmd(int argc, char *argv[], net_para_t *net);
 extern int do_insert_key_cmd(int argc, char *argv[], net_para_t *net);
 extern int do_remove_key_cmd(int argc, char *argv[], net_para_t *net);
 extern int do_performance_cmd(int argc, char *argv[], net_para_t *net);
+extern int do_stats_cmd(int argc, char *argv[], net_para_t *net);
+extern int do_lockstat_cmd(int argc, char *argv[], net_para_t *net);
+extern int do_analyze_cmd(int argc, char *argv[], net_para_t *net);
+extern int do_snapshot_cmd(int argc, char *argv[], net_para_t *net);
 extern void parse_all_para(int argc, char *argv[], ifs_tools_para_t *para);
+extern void tools_set_object_ops(const tools_object_ops_t *ops);
+extern int32_t tools_open_object(ifs_tools_para_t *para, object_handle_t **obj);
+extern void tools_close_object(ifs_tools_para_t *para, object_handle_t *obj);
 
 #ifdef	__cplusplus
 }
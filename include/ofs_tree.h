@@ -54,6 +54,16 @@ extern "C" {
 #define INDEX_ADD_BLOCK      0x40 /* add the block of the current key occupied */
 #define INDEX_WALK_MASK      0x1F
 
+/* percent of entries kept in the left block when appending to the rightmost block */
+#ifndef INDEX_SPLIT_APPEND_PERCENT
+#define INDEX_SPLIT_APPEND_PERCENT  90
+#endif
+
+/* percent of block used below which the block will be merged with its sibling */
+#ifndef INDEX_MERGE_PERCENT
+#define INDEX_MERGE_PERCENT         30
+#endif
+
 #define KEY_MAX_SIZE    256
 #define VALUE_MAX_SIZE  1024
 
@@ -87,11 +97,21 @@ extern "C" {
 
 typedef int32_t (*tree_walk_cb_t) (void *obj, void *para);
 
+// a value read in place, valid until index_release_pinned without any lock
+typedef struct ofs_pinned_value
+{
+    const uint8_t *value;
+    uint16_t value_len;
+    ofs_pinned_block_t *pb;
+} ofs_pinned_value_t;
+
 extern int32_t index_search_key_nolock(object_handle_t *tree, const void *key,
     uint16_t key_len, const void *value, uint16_t value_len);
 extern int32_t index_insert_key_nolock(object_handle_t * obj, const void * key,
     uint16_t key_len, const void *value, uint16_t value_len);
 extern int32_t index_remove_key_nolock(object_handle_t * obj, const void * key, uint16_t key_len);
+extern int32_t index_upsert_key_nolock(object_handle_t * obj, const void * key,
+    uint16_t key_len, const void *value, uint16_t value_len);
 
 
 extern int32_t walk_tree(object_handle_t *obj, uint8_t flags);
@@ -115,6 +135,15 @@ extern void init_ib(index_block_t * v_pstIB, uint8_t v_ucNodeType,
 extern int32_t search_key_internal(object_handle_t *tree, const void *key,
     uint16_t key_len, const void *value, uint16_t value_len);
 int32_t tree_remove_ie(object_handle_t *tree);
+int32_t tree_update_ie(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len);
+int32_t insert_key_internal(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len);
+int32_t remove_key_internal(object_handle_t *tree, const void *key, uint16_t key_len);
+int32_t update_value_internal(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len);
+int32_t upsert_key_internal(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len);
 
 
 // table/KV/index API
@@ -122,7 +151,11 @@ int32_t index_search_key(object_handle_t *obj, const void *key, uint16_t key_len
 int32_t index_remove_key(object_handle_t *obj, const void *key, uint16_t key_len);
 int32_t index_insert_key(object_handle_t *obj, const void *key, uint16_t key_len, const void *value, uint16_t value_len);
 int32_t index_update_value(object_handle_t * tree, const void * key, uint16_t key_len, const void *value, uint16_t value_len);
+int32_t index_upsert_key(object_handle_t *obj, const void *key, uint16_t key_len, const void *value, uint16_t value_len);
 int32_t index_walk_all(object_handle_t *obj, bool_t reverse, uint8_t flags, void *para, tree_walk_cb_t cb);
+int32_t index_get_pinned(object_handle_t *obj, const void *key, uint16_t key_len, ofs_pinned_value_t *pinned);
+void index_release_pinned(ofs_pinned_value_t *pinned);
+int32_t index_get_into(object_handle_t *obj, const void *key, uint16_t key_len, void *buf, uint32_t buf_size);
 
 #ifdef	__cplusplus
 }
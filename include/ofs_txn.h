@@ -0,0 +1,123 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_TXN.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#ifndef __OFS_TXN_H__
+#define __OFS_TXN_H__
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * transaction on the keys of the objects in one container. the insert, update
+ * and remove are kept in the private write set of the transaction, nobody sees
+ * them before the commit. the commit locks the objects in objid order, applies
+ * the write set to the trees and logs it as one batch, so the other threads
+ * and the replay see all of it or none. if a key is not in the state required,
+ * e.g. inserting the existing key, the keys applied are restored.
+ *
+ * the commit is durable by the redo log sync in OFS_DURABILITY_COMMIT mode, or
+ * else by the checkpoint. the transactions committed when the checkpoint
+ * starts share it, and the ones coming during it share the next one.
+ */
+typedef enum ofs_txn_op_type
+{
+    OFS_TXN_PUT = 0,
+    OFS_TXN_REMOVE,
+
+    OFS_TXN_OP_BUTT
+} ofs_txn_op_type_t;
+
+// the state of the key required before the transaction
+typedef enum ofs_txn_check
+{
+    OFS_TXN_CHECK_NONE = 0,
+    OFS_TXN_CHECK_ABSENT,
+    OFS_TXN_CHECK_PRESENT,
+
+    OFS_TXN_CHECK_BUTT
+} ofs_txn_check_t;
+
+typedef struct ofs_txn_op
+{
+    avl_node_t entry;               // ordered by objid and key
+    object_handle_t *obj;
+    uint8_t op;                     // ofs_txn_op_type_t
+    uint8_t check;                  // ofs_txn_check_t
+    bool_t applied;                 // the tree may be modified by it
+    index_entry_t *old_ie;          // the entry before the commit, for undo
+
+    index_entry_t ie;               // the key and value follow it
+} ofs_txn_op_t;
+
+typedef struct ofs_txn
+{
+    container_handle_t *ct;
+    avl_tree_t write_set;
+    uint32_t op_num;
+    uint32_t log_size;              // the size of the batch in the redo log
+} ofs_txn_t;
+
+// the transactions waiting for the group checkpoint
+typedef struct ofs_txn_group
+{
+    os_mutex_t lock;
+    os_cond_t cond;
+    uint64_t applied_seq;           // the transactions applied to the trees
+    uint64_t durable_seq;           // the transactions in the checkpoint on disk
+    uint64_t failed_seq;            // the transactions up to it got error in the checkpoint
+    int32_t error;
+    bool_t checkpointing;
+} ofs_txn_group_t;
+
+int32_t ofs_txn_begin(container_handle_t *ct, ofs_txn_t **txn);
+int32_t ofs_txn_insert(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len);
+int32_t ofs_txn_update(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len);
+int32_t ofs_txn_remove(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len);
+int32_t ofs_txn_commit(ofs_txn_t *txn);
+void ofs_txn_abort(ofs_txn_t *txn);
+
+/* for internal only */
+void init_txn_group(container_handle_t *ct);
+void destroy_txn_group(container_handle_t *ct);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
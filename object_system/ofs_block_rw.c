@@ -267,6 +267,7 @@ int32_t ofs_update_block_pingpong(container_handle_t *ct, block_head_t *blk, uin
     {
         LOG_ERROR("Update block data failed. ct(%p) blk(%p) size(%d) vbn(%lld) ret(%d)\n",
             ct, blk, blk->alloc_size, vbn, ret);
+        blk->seq_no--; // the retry rewrites the same copy, the other one stays valid
         return -BLOCK_ERR_WRITE;
     }
 
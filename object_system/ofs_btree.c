@@ -41,11 +41,34 @@ MODULE(PID_BTREE);
 #include "log.h"
 
 #define INDEX_GETTO_BEGIN  1
+#define INDEX_HINT_MISS    2
+
+// the node entries in b+ tree are separators only, all the kv are in leaves
+#define IS_BPLUS_TREE(tree)  ((tree)->obj_info->attr_record->flags & FLAG_BPLUS_TREE)
+#define IS_LEAF_IB(ib)       (!(IB(ib)->node_type & INDEX_BLOCK_LARGE))
+
+// the snapshot_no when the block was written, the dirty one is not written yet
+static uint64_t get_block_birth(object_handle_t *tree, ofs_block_cache_t *cache)
+{
+    if (CACHE_DIRTY(cache))
+    {
+        return OFS_BIRTH_DIRTY;
+    }
+
+    if (cache == &tree->obj_info->root_cache)
+    { // the inode may be dirty after the object is reopened
+        return CACHE_DIRTY(tree->obj_info->inode_cache) ? OFS_BIRTH_DIRTY
+            : tree->obj_info->inode->snapshot_no;
+    }
+
+    return IB(cache->ib)->birth;
+}
 
 // set the block from current block to root block as dirty
 static int32_t set_ib_dirty(object_handle_t *tree)
 {
     uint64_t new_vbn = 0;
+    uint64_t birth = 0;
     int32_t ret = 0;
     index_entry_t *ie = NULL;
     uint64_t old_vbn = 0;
@@ -55,6 +78,8 @@ static int32_t set_ib_dirty(object_handle_t *tree)
     ASSERT(tree != NULL);
     ASSERT(depth < TREE_MAX_DEPTH);
 
+    tree->obj_info->modify_seq++;
+
     do
     {
         if (!CACHE_DIRTY(tree->cache_stack[depth]))
@@ -69,6 +94,8 @@ static int32_t set_ib_dirty(object_handle_t *tree)
             
             // record old block
             old_vbn = tree->cache_stack[depth]->vbn;
+            birth = get_block_birth(tree, tree->cache_stack[depth]);
+            OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_COW_RELOCATE, 1);
             
             OS_RWLOCK_WRLOCK(&tree->obj_info->caches_lock);
             if (depth == 0)
@@ -94,9 +121,9 @@ static int32_t set_ib_dirty(object_handle_t *tree)
             return 0;
         }
 
-        SET_CACHE_DIRTY(tree->cache_stack[depth]);
+        set_cache_dirty(tree->obj_info, tree->cache_stack[depth]);
         vbn = new_vbn;
-        ret = OFS_FREE_BLOCK(tree->ct, tree->obj_info->objid, old_vbn);
+        ret = ofs_free_block_born(tree->ct, tree->obj_info->objid, old_vbn, birth);
         if (ret < 0)
         {
             LOG_ERROR("Free old block failed. ret(%d)\n", ret);
@@ -129,6 +156,7 @@ static void reset_cache_stack(object_handle_t *tree, uint8_t flags)
     ASSERT(tree != NULL);
     
     /* get to first entry */
+    tree->hint_seq = 0;
     tree->cache = &tree->obj_info->root_cache;
     tree->cache_stack[0] = tree->cache;
     tree->depth = 0;
@@ -150,6 +178,8 @@ static int32_t push_cache_stack(object_handle_t *tree, uint8_t flags)
 {
     uint64_t vbn = 0;
     int32_t ret = 0;
+    ofs_block_cache_t *parent = NULL;
+    ofs_block_cache_t *child = NULL;
 
     ASSERT(tree != NULL);
     
@@ -165,11 +195,23 @@ static int32_t push_cache_stack(object_handle_t *tree, uint8_t flags)
 
     LOG_DEBUG("Depth increase. depth(%d) vbn(%lld) pos(%d)\n", tree->depth, vbn, tree->position);
 
-    ret = index_block_read(tree, vbn, INDEX_MAGIC);
-    if (ret < 0)
+    parent = tree->cache;
+    child = get_child_cache(parent, (uint32_t)tree->position, vbn);
+    if (child != NULL)
+    { // the child block is linked in parent
+        tree->cache = child;
+        OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_CACHE_HIT, 1);
+    }
+    else
     {
-        LOG_ERROR("Read ct block failed. vbn(%lld) ret(%d)\n", vbn, ret);
-        return ret;
+        ret = index_block_read(tree, vbn, INDEX_MAGIC);
+        if (ret < 0)
+        {
+            LOG_ERROR("Read ct block failed. vbn(%lld) ret(%d)\n", vbn, ret);
+            return ret;
+        }
+
+        link_child_cache(parent, (uint32_t)tree->position, tree->cache);
     }
 
 	tree->position_stack[tree->depth] = tree->position;
@@ -355,7 +397,8 @@ static int32_t add_or_remove_ib(object_handle_t *tree, uint8_t flags)
         
     if (flags & INDEX_REMOVE_BLOCK)
     {
-        ret = OFS_FREE_BLOCK(tree->ct, tree->obj_info->objid, tree->cache->vbn);
+        ret = ofs_free_block_born(tree->ct, tree->obj_info->objid, tree->cache->vbn,
+            get_block_birth(tree, tree->cache));
         if (ret < 0)
         {
             LOG_ERROR("Free block failed. vbn(%lld) ret(%d)\n", tree->cache->vbn, ret);
@@ -381,57 +424,75 @@ static int32_t get_current_ie(object_handle_t *tree, uint8_t flags)
 {
     int32_t ret = 0;
 
-    while (tree->ie->flags & INDEX_ENTRY_NODE)
-    { /* Have children */
-        ret = push_cache_stack(tree, flags);
-        if (ret < 0)
-        { /* Push the information OS_S32o the history, and read new ct block */
-            LOG_ERROR("Go to child node failed. ret(%d)\n", ret);
-            return ret;
-        }
-    }
-
-    while (tree->ie->flags & (INDEX_ENTRY_END | INDEX_ENTRY_BEGIN))
-    { /* The Index END */
-        ret = add_or_remove_ib(tree, flags);
-        if (ret < 0)
-        {
-            LOG_ERROR("add_or_remove_ib failed. flags(%x) ret(%d)\n", flags, ret);
-            return ret;
+    for (;;)
+    {
+        while (tree->ie->flags & INDEX_ENTRY_NODE)
+        { /* Have children */
+            ret = push_cache_stack(tree, flags);
+            if (ret < 0)
+            { /* Push the information OS_S32o the history, and read new ct block */
+                LOG_ERROR("Go to child node failed. ret(%d)\n", ret);
+                return ret;
+            }
         }
 
-        if (flags & (INDEX_GET_LAST | INDEX_GET_PREV))
-        {
-            if (flags & INDEX_GET_LAST_ENTRY)
-            {
-                break;
-            }
-            
-            ret = get_prev_ie(tree);
+        while (tree->ie->flags & (INDEX_ENTRY_END | INDEX_ENTRY_BEGIN))
+        { /* The Index END */
+            ret = add_or_remove_ib(tree, flags);
             if (ret < 0)
             {
-                LOG_ERROR("Get prev entry failed. ret(%d)\n", ret);
+                LOG_ERROR("add_or_remove_ib failed. flags(%x) ret(%d)\n", flags, ret);
                 return ret;
             }
-            else if (ret == 0)
+
+            if (flags & (INDEX_GET_LAST | INDEX_GET_PREV))
             {
-                break;
+                if (flags & INDEX_GET_LAST_ENTRY)
+                {
+                    break;
+                }
+            
+                ret = get_prev_ie(tree);
+                if (ret < 0)
+                {
+                    LOG_ERROR("Get prev entry failed. ret(%d)\n", ret);
+                    return ret;
+                }
+                else if (ret == 0)
+                {
+                    break;
+                }
+            }
+
+            ret = pop_cache_stack(tree, flags);
+            if (ret < 0)
+            { /* Up to parent failed */
+                if (ret != -INDEX_ERR_ROOT)
+                {
+                    LOG_ERROR("Go to parent node failed. ret(%d)\n", ret);
+                }
+
+                return ret;
             }
         }
 
-        ret = pop_cache_stack(tree, flags);
-        if (ret < 0)
-        { /* Up to parent failed */
-            if (ret != -INDEX_ERR_ROOT)
+        if (!IS_BPLUS_TREE(tree) || !(tree->ie->flags & INDEX_ENTRY_NODE)
+            || (tree->ie->flags & (INDEX_ENTRY_END | INDEX_ENTRY_BEGIN)))
+        {
+            return 0;
+        }
+
+        // the separator in b+ tree has no value, go to the next child
+        if (!(flags & (INDEX_GET_LAST | INDEX_GET_PREV)))
+        {
+            ret = get_next_ie(tree);
+            if (ret < 0)
             {
-                LOG_ERROR("Go to parent node failed. ret(%d)\n", ret);
+                LOG_ERROR("Get next entry failed. ret(%d)\n", ret);
+                return ret;
             }
-
-            return ret;
         }
     }
-
-    return 0;
 }
 
 int32_t walk_tree(object_handle_t *tree, uint8_t flags)
@@ -441,6 +502,8 @@ int32_t walk_tree(object_handle_t *tree, uint8_t flags)
     ASSERT(tree != NULL);
     ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
 
+    tree->hint_seq = 0;
+
     if (flags & (INDEX_GET_FIRST | INDEX_GET_LAST))
     {   /* Get to the root's first entry */
         reset_cache_stack(tree, flags);
@@ -495,11 +558,15 @@ int32_t search_key_internal(object_handle_t *tree, const void *key,
             }
             
             if (ret == 0)
-            { // found
-                return 0;
-            }
+            {
+                if (!IS_BPLUS_TREE(tree) || !(tree->ie->flags & INDEX_ENTRY_NODE))
+                { // found
+                    return 0;
+                }
 
-            if (ret == -INDEX_ERR_COLLATE)
+                // the separator in b+ tree, the key is in the right child
+            }
+            else if (ret == -INDEX_ERR_COLLATE)
             {
                 LOG_ERROR("Collate rule is invalid. collate_rule(%d)\n", cr);
                 return ret;
@@ -531,6 +598,89 @@ int32_t search_key_internal(object_handle_t *tree, const void *key,
     return -INDEX_ERR_KEY_NOT_FOUND;
 }
 
+// whether all the entries in the stack are the end entries
+static bool_t is_rightmost_path(object_handle_t *tree)
+{
+    index_entry_t *ie = NULL;
+    uint8_t depth = 0;
+
+    for (depth = 0; depth < tree->depth; depth++)
+    {
+        ie = (index_entry_t *)((uint8_t *)tree->cache_stack[depth]->ib + tree->position_stack[depth]);
+        if (!(ie->flags & INDEX_ENTRY_END))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// search key in the leaf which the last insert stopped at
+static int32_t search_key_by_hint(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    uint16_t cr = tree->obj_info->attr_record->flags & CR_MASK;
+    index_entry_t *last_ie = NULL;
+    int32_t ret = 0;
+
+    if ((tree->hint_seq == 0) || (tree->hint_seq != tree->obj_info->modify_seq))
+    {
+        return INDEX_HINT_MISS;
+    }
+
+    tree->hint_seq = 0;
+
+    get_last_ie(tree);
+    if (tree->ie == GET_FIRST_IE(tree->cache->ib))
+    { // no entries in the leaf
+        return INDEX_HINT_MISS;
+    }
+
+    last_ie = GET_PREV_IE(tree->ie);
+    ret = collate_key(cr, last_ie, key, key_len, value, value_len);
+    if (ret == -INDEX_ERR_COLLATE)
+    {
+        LOG_ERROR("Collate rule is invalid. collate_rule(%d)\n", cr);
+        return ret;
+    }
+    
+    if (ret < 0)
+    { // larger than all the keys in the leaf, only the rightmost leaf can hold it
+        return is_rightmost_path(tree) ? -INDEX_ERR_KEY_NOT_FOUND : INDEX_HINT_MISS;
+    }
+
+    if (ret == 0)
+    { // found
+        tree->position -= last_ie->len;
+        tree->ie = last_ie;
+        return 0;
+    }
+
+    tree->position = IB(tree->cache->ib)->first_entry_off;
+    tree->ie = GET_FIRST_IE(tree->cache->ib);
+    ret = collate_key(cr, tree->ie, key, key_len, value, value_len);
+    if (ret > 0)
+    { // smaller than all the keys in the leaf
+        return INDEX_HINT_MISS;
+    }
+
+    // the key is between the first and the last key of the leaf
+    while (ret < 0)
+    {
+        ret = get_next_ie(tree);
+        if (ret < 0)
+        {
+            LOG_ERROR("Get next entry failed. ret(%d)\n", ret);
+            return ret;
+        }
+
+        ret = collate_key(cr, tree->ie, key, key_len, value, value_len);
+    }
+
+    return (ret == 0) ? 0 : -INDEX_ERR_KEY_NOT_FOUND;
+}
+
 // go to the near key
 static void get_to_near_key(object_handle_t *tree)
 {
@@ -538,6 +688,16 @@ static void get_to_near_key(object_handle_t *tree)
 
     ASSERT(tree != NULL);
 
+    if (IS_BPLUS_TREE(tree))
+    { // the near key must be in the leaves
+        if (tree->ie->flags & INDEX_ENTRY_END)
+        {
+            (void)get_current_ie(tree, INDEX_GET_CURRENT);
+        }
+
+        return;
+    }
+
     while ((tree->ie->flags & INDEX_ENTRY_END) != 0)
     {   /* The Index END */
         ret = pop_cache_stack(tree, 0);
@@ -580,6 +740,7 @@ int32_t index_search_key_nolock(object_handle_t *tree, const void *key,
 int32_t index_search_key(object_handle_t *tree, const void *key, uint16_t key_len)
 {
     int32_t ret = 0;
+    uint64_t start = 0;
 
     if ((tree == NULL) || (key == NULL) || (key_len == 0))
     {
@@ -587,21 +748,128 @@ int32_t index_search_key(object_handle_t *tree, const void *key, uint16_t key_le
         return -INDEX_ERR_PARAMETER;
     }
 
+    start = OFS_STAT_START();
+    OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
+    ret = index_search_key_nolock(tree, key, key_len, NULL, 0);
+    OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OFS_STAT_END(OFS_STAT_SEARCH_KEY, start);
+
+    return ret;
+}
+
+// pin the value of current entry, the root is in the inode block, which is
+// not pinned, its values are copied
+static int32_t pin_current_value(object_handle_t *tree, ofs_pinned_value_t *pinned)
+{
+    ofs_pinned_block_t *pb = NULL;
+    const uint8_t *value = GET_IE_VALUE(tree->ie);
+
+    if (tree->depth == 0)
+    {
+        pb = pin_copy(tree->ct, value, tree->ie->value_len);
+        if (pb != NULL)
+        {
+            value = pb->buf;
+        }
+    }
+    else
+    {
+        pb = pin_cache(tree->obj_info, tree->cache);
+    }
+
+    if (pb == NULL)
+    {
+        LOG_ERROR("Pin value failed. objid(%lld) vbn(%lld)\n", tree->obj_info->objid, tree->cache->vbn);
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    pinned->value = value;
+    pinned->value_len = tree->ie->value_len;
+    pinned->pb = pb;
+
+    return 0;
+}
+
+// the value is read without copy and without the lock, until it is released
+int32_t index_get_pinned(object_handle_t *tree, const void *key, uint16_t key_len,
+    ofs_pinned_value_t *pinned)
+{
+    int32_t ret = 0;
+    uint64_t start = 0;
+
+    if ((tree == NULL) || (key == NULL) || (key_len == 0) || (pinned == NULL))
+    {
+        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d) pinned(%p)\n",
+            tree, key, key_len, pinned);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    pinned->pb = NULL;
+    start = OFS_STAT_START();
+    OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
+    ret = index_search_key_nolock(tree, key, key_len, NULL, 0);
+    if (ret >= 0)
+    {
+        ret = pin_current_value(tree, pinned);
+    }
+    OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OFS_STAT_END(OFS_STAT_SEARCH_KEY, start);
+
+    return ret;
+}
+
+void index_release_pinned(ofs_pinned_value_t *pinned)
+{
+    if ((pinned == NULL) || (pinned->pb == NULL))
+    {
+        return;
+    }
+
+    unpin_block(pinned->pb);
+    pinned->pb = NULL;
+    pinned->value = NULL;
+    pinned->value_len = 0;
+}
+
+// copy the value into buf once, return the value size, the value is cut
+// if buf is smaller
+int32_t index_get_into(object_handle_t *tree, const void *key, uint16_t key_len,
+    void *buf, uint32_t buf_size)
+{
+    int32_t ret = 0;
+    uint64_t start = 0;
+
+    if ((tree == NULL) || (key == NULL) || (key_len == 0) || ((buf == NULL) && (buf_size != 0)))
+    {
+        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d) buf(%p)\n", tree, key, key_len, buf);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    start = OFS_STAT_START();
     OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
     ret = index_search_key_nolock(tree, key, key_len, NULL, 0);
+    if (ret >= 0)
+    {
+        ret = tree->ie->value_len;
+        memcpy(buf, GET_IE_VALUE(tree->ie), ((uint32_t)ret < buf_size) ? (uint32_t)ret : buf_size);
+    }
     OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OFS_STAT_END(OFS_STAT_SEARCH_KEY, start);
 
     return ret;
 }
 
-static index_entry_t *get_middle_ie(index_block_t *ib)
+static index_entry_t *get_middle_ie(index_block_t *ib, uint32_t percent)
 {
     index_entry_t *ie = NULL;
     uint32_t uiMidPos = 0;
 
     ASSERT(ib != NULL);
     
-    uiMidPos = (ib->head.real_size - sizeof(index_block_t)) >> 1;
+    uiMidPos = (ib->head.real_size - sizeof(index_block_t)) * percent / 100;
     ie = GET_FIRST_IE(ib);
     while (!(ie->flags & INDEX_ENTRY_END))
     {
@@ -616,6 +884,11 @@ static index_entry_t *get_middle_ie(index_block_t *ib)
         }
     }
 
+    if ((ie->flags & INDEX_ENTRY_END) && (ie != GET_FIRST_IE(ib)))
+    { // the end entry can not be moved to parent
+        ie = GET_PREV_IE(ie);
+    }
+
     return ie;
 }  
 
@@ -751,6 +1024,61 @@ static index_entry_t *dump_ie_del_vbn(index_entry_t *ie)
     return new_ie;
 }      
 
+// get the shortest key length which is larger than the left key
+static uint16_t get_separator_key_len(object_handle_t *tree,
+    index_entry_t *left_ie, index_entry_t *right_ie)
+{
+    uint16_t cr = tree->obj_info->attr_record->flags & CR_MASK;
+    uint16_t key_len = 0;
+
+    // only the string collated by char can be truncated by prefix
+    if ((left_ie == NULL) || (cr != CR_ANSI_STRING))
+    {
+        return right_ie->key_len;
+    }
+
+    for (key_len = 1; key_len < right_ie->key_len; key_len++)
+    {
+        if (collate_key(cr, left_ie, GET_IE_KEY(right_ie), key_len, NULL, 0) < 0)
+        {
+            break;
+        }
+    }
+
+    return key_len;
+}
+
+// make the separator with the key only, left_ie < separator <= ie
+static index_entry_t *dump_ie_separator(object_handle_t *tree,
+    index_entry_t *left_ie, index_entry_t *ie, uint64_t vbn)
+{
+    index_entry_t *new_ie = NULL;
+    uint16_t key_len = 0;
+    uint16_t size = 0;
+    
+    ASSERT(tree != NULL);
+    ASSERT(ie != NULL);
+
+    key_len = get_separator_key_len(tree, left_ie, ie);
+    size = sizeof(index_entry_t) + key_len + VBN_SIZE;
+
+    new_ie = (index_entry_t *)OS_MALLOC(size);
+    if (!new_ie)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", size);
+        return NULL;
+    }
+
+    memcpy(new_ie, ie, sizeof(index_entry_t) + key_len);
+    new_ie->len = size;
+    new_ie->key_len = key_len;
+    new_ie->value_len = 0;
+    new_ie->flags = INDEX_ENTRY_NODE;
+    SET_IE_VBN(new_ie, vbn);
+
+    return new_ie;
+}  
+
 // copy the last half entries
 void copy_ib_tail(index_block_t *dst_ib, index_block_t *src_ib, index_entry_t *mid_ie)
 {
@@ -773,6 +1101,15 @@ void copy_ib_tail(index_block_t *dst_ib, index_block_t *src_ib, index_entry_t *m
     return;
 }
 
+// copy the entries from the @ie to the end
+static void copy_ib_tail_from(index_block_t *dst_ib, index_block_t *src_ib, index_entry_t *ie)
+{
+    uint16_t prev_len = ie->prev_len;
+
+    copy_ib_tail(dst_ib, src_ib, GET_PREV_IE(ie));
+    ie->prev_len = prev_len;
+}
+
 // remove the last half entries
 static void cut_ib_tail(index_block_t *src_ib, index_entry_t *ie)
 {
@@ -807,11 +1144,32 @@ static index_entry_t *split_ib(object_handle_t *tree, index_entry_t *ie)
     ofs_block_cache_t *new_cache = NULL;
     int32_t pos = 0;         /* Insert iOffset to the new indexHeader */
     int32_t ret = 0;
+    bool_t bplus_leaf = FALSE;
     
     ASSERT(tree != NULL);
     ASSERT(ie != NULL);
 
-    mid_ie = get_middle_ie(IB(tree->cache->ib));
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_SPLIT_IB, 1);
+
+    // the middle entry of b+ tree leaf is kept in the new block
+    bplus_leaf = (IS_BPLUS_TREE(tree) && IS_LEAF_IB(tree->cache->ib)) ? TRUE : FALSE;
+
+    if ((tree->ie->flags & INDEX_ENTRY_END) && is_rightmost_path(tree))
+    { // appending, keep the left block nearly full
+        mid_ie = get_middle_ie(IB(tree->cache->ib), INDEX_SPLIT_APPEND_PERCENT);
+    }
+    else
+    {
+        mid_ie = get_middle_ie(IB(tree->cache->ib), 50);
+    }
+
+    if (bplus_leaf && (mid_ie == GET_FIRST_IE(tree->cache->ib)))
+    { // the old block can not be empty
+        mid_ie = GET_NEXT_IE(mid_ie);
+    }
+
+    // the entries will be moved, the child links are not valid
+    invalidate_child_caches(tree->cache);
 
     ret = alloc_obj_block_and_cache(tree->obj_info, &new_cache, INDEX_MAGIC);
     if (ret < 0)
@@ -822,15 +1180,25 @@ static index_entry_t *split_ib(object_handle_t *tree, index_entry_t *ie)
     
     new_ib = IB(new_cache->ib);
 
-    copy_ib_tail(new_ib, IB(tree->cache->ib), mid_ie);
-
     pos = (int32_t)((uint8_t *)mid_ie - (uint8_t *)tree->ie);
-    if (pos < 0)
-    {   /* Insert the entry OS_S32o newIB */
-        insert_ie(new_ib, ie, (index_entry_t *)(((uint8_t *)GET_FIRST_IE(new_ib) - pos) - mid_ie->len));
+    if (bplus_leaf)
+    {
+        copy_ib_tail_from(new_ib, IB(tree->cache->ib), mid_ie);
+        if (pos < 0)
+        {   /* Insert the entry OS_S32o newIB */
+            insert_ie(new_ib, ie, (index_entry_t *)((uint8_t *)GET_FIRST_IE(new_ib) - pos));
+        }
+    }
+    else
+    {
+        copy_ib_tail(new_ib, IB(tree->cache->ib), mid_ie);
+        if (pos < 0)
+        {   /* Insert the entry OS_S32o newIB */
+            insert_ie(new_ib, ie, (index_entry_t *)(((uint8_t *)GET_FIRST_IE(new_ib) - pos) - mid_ie->len));
+        }
     }
 
-    SET_CACHE_DIRTY(new_cache);
+    set_cache_dirty(tree->obj_info, new_cache);
 
     //LOG_DEBUG("Write new ct block success. vbn(%lld)\n", new_cache->vbn);
 
@@ -842,11 +1210,14 @@ static index_entry_t *split_ib(object_handle_t *tree, index_entry_t *ie)
     }
 
     // Cut block tail and whether insert the @pstIE OS_S32o the old ct block
-    new_ie = dump_ie_add_vbn(mid_ie, tree->cache->vbn);
-    if (new_ie == NULL)
+    if (!bplus_leaf)
     {
-        LOG_ERROR("dump_ie_add_vbn failed. vbn(%lld)\n", tree->cache->vbn);
-        return NULL;
+        new_ie = dump_ie_add_vbn(mid_ie, tree->cache->vbn);
+        if (new_ie == NULL)
+        {
+            LOG_ERROR("dump_ie_add_vbn failed. vbn(%lld)\n", tree->cache->vbn);
+            return NULL;
+        }
     }
 
     cut_ib_tail(IB(tree->cache->ib), mid_ie);
@@ -856,6 +1227,17 @@ static index_entry_t *split_ib(object_handle_t *tree, index_entry_t *ie)
         insert_ie(IB(tree->cache->ib), ie, tree->ie);
     }
 
+    if (bplus_leaf)
+    { // the separator only needs to split the last key of old block and the first key of new block
+        new_ie = dump_ie_separator(tree, GET_PREV_IE(ib_get_last_ie(IB(tree->cache->ib))),
+            GET_FIRST_IE(new_ib), tree->cache->vbn);
+        if (new_ie == NULL)
+        {
+            LOG_ERROR("dump_ie_separator failed. vbn(%lld)\n", tree->cache->vbn);
+            return NULL;
+        }
+    }
+
     if (pop_cache_stack(tree, 0) < 0)
     {
         LOG_ERROR("Go to parent node failed. vbn(%lld)\n", tree->cache->vbn);
@@ -888,6 +1270,8 @@ static int32_t reparent_root(object_handle_t * tree)
         return -INDEX_ERR_MAX_DEPTH;
     }
 
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_REPARENT_ROOT, 1);
+
     old_ib = IB(tree->cache->ib);
     alloc_size = old_ib->head.alloc_size;
     
@@ -903,10 +1287,13 @@ static int32_t reparent_root(object_handle_t * tree)
     memcpy(new_ib, old_ib, old_ib->head.real_size);
     new_ib->head.alloc_size = tree->obj_info->ct->sb.block_size;
 
-    SET_CACHE_DIRTY(new_cache);
+    set_cache_dirty(tree->obj_info, new_cache);
 
     //LOG_DEBUG("Write new ct block success. vbn(%lld)\n", new_cache->vbn);
 
+    // all the children are in the new block now
+    move_child_caches(new_cache, tree->cache);
+
     init_ib(old_ib, INDEX_BLOCK_LARGE, alloc_size);
     ie = GET_FIRST_IE(old_ib);
     SET_IE_VBN(ie, new_cache->vbn);
@@ -930,14 +1317,40 @@ static int32_t reparent_root(object_handle_t * tree)
     return 0;
 }    
 
-static int32_t tree_insert_ie(object_handle_t *tree, index_entry_t **new_ie)
+// the pinned blocks are copied before they are changed, the cursor follows
+// the copy of its block
+static int32_t unshare_tree_caches(object_handle_t *tree)
 {
-    uint32_t new_size = 0;
-    index_entry_t *ie = NULL;
-    
-    ASSERT(tree != NULL);
-    ASSERT(new_ie != NULL);
-    ASSERT(*new_ie != NULL);
+    uint32_t offset = (uint32_t)((uint8_t *)tree->ie - (uint8_t *)tree->cache->ib);
+    int32_t ret = 0;
+
+    ret = unshare_pinned_caches(tree->obj_info);
+    if (ret < 0)
+    {
+        LOG_ERROR("Unshare pinned caches failed. objid(%lld) ret(%d)\n", tree->obj_info->objid, ret);
+        return ret;
+    }
+
+    tree->ie = (index_entry_t *)((uint8_t *)tree->cache->ib + offset);
+
+    return 0;
+}
+
+static int32_t tree_insert_ie(object_handle_t *tree, index_entry_t **new_ie)
+{
+    uint32_t new_size = 0;
+    index_entry_t *ie = NULL;
+    int32_t ret = 0;
+    
+    ASSERT(tree != NULL);
+    ASSERT(new_ie != NULL);
+    ASSERT(*new_ie != NULL);
+
+    ret = unshare_tree_caches(tree);
+    if (ret < 0)
+    {
+        return ret;
+    }
 
     ie = *new_ie;
     
@@ -973,6 +1386,414 @@ static int32_t tree_insert_ie(object_handle_t *tree, index_entry_t **new_ie)
     }
 }
 
+#define IB_UNDERFLOW(ib)   ((uint64_t)(ib)->real_size * 100 < (uint64_t)(ib)->alloc_size * INDEX_MERGE_PERCENT)
+
+// get the child block which the entry at pos of parent block point to
+static int32_t get_child_ib(object_handle_t *tree, ofs_block_cache_t *parent,
+    uint32_t pos, ofs_block_cache_t **cache)
+{
+    index_entry_t *ie = (index_entry_t *)((uint8_t *)parent->ib + pos);
+    uint64_t vbn = GET_IE_VBN(ie);
+    ofs_block_cache_t *child = NULL;
+    int32_t ret = 0;
+
+    child = get_child_cache(parent, pos, vbn);
+    if (child != NULL)
+    {
+        *cache = child;
+        return 0;
+    }
+
+    ret = index_block_read2(tree->obj_info, vbn, INDEX_MAGIC, &child);
+    if (ret < 0)
+    {
+        LOG_ERROR("Read ct block failed. vbn(%lld) ret(%d)\n", vbn, ret);
+        return ret;
+    }
+
+    link_child_cache(parent, pos, child);
+    *cache = child;
+
+    return 0;
+}
+
+// set the child block and the blocks from parent to root as dirty
+static int32_t set_child_ib_dirty(object_handle_t *tree, uint8_t depth,
+    uint32_t pos, ofs_block_cache_t *cache)
+{
+    tree->position_stack[depth] = pos;
+    tree->depth = depth + 1;
+    tree->cache_stack[tree->depth] = cache;
+    tree->cache = cache;
+    tree->position = IB(cache->ib)->first_entry_off;
+    tree->ie = GET_FIRST_IE(cache->ib);
+
+    return set_ib_dirty(tree);
+}
+
+// append the separator entry and all entries of src block to dst block,
+// the separator of b+ tree leaves is NULL
+static void join_ib(index_block_t *dst_ib, index_entry_t *sep_ie, index_block_t *src_ib)
+{
+    index_entry_t *ie = ib_get_last_ie(dst_ib);
+    uint64_t vbn = 0;
+    uint16_t prev_len = ie->prev_len;
+    uint16_t sep_len = 0;
+    uint32_t src_len = src_ib->head.real_size - src_ib->first_entry_off;
+
+    if (sep_ie == NULL)
+    {
+        dst_ib->head.real_size += src_len - ie->len;
+        memcpy(ie, GET_FIRST_IE(src_ib), src_len);
+        ie->prev_len = prev_len;
+        return;
+    }
+
+    sep_len = sep_ie->len;
+
+    if (dst_ib->node_type & INDEX_BLOCK_LARGE)
+    { // the separator point to the last child of dst block
+        vbn = GET_IE_VBN(ie);
+    }
+    else
+    { // the separator in leaf has no vbn
+        sep_len -= VBN_SIZE;
+    }
+
+    dst_ib->head.real_size += sep_len + src_len - ie->len;
+
+    memcpy(ie, sep_ie, sep_len);
+    ie->len = sep_len;
+    ie->prev_len = prev_len;
+    if (dst_ib->node_type & INDEX_BLOCK_LARGE)
+    {
+        SET_IE_VBN(ie, vbn);
+    }
+    else
+    {
+        ie->flags &= ~INDEX_ENTRY_NODE;
+    }
+
+    memcpy(GET_NEXT_IE(ie), GET_FIRST_IE(src_ib), src_len);
+    GET_NEXT_IE(ie)->prev_len = sep_len;
+}
+
+// get the size of dst block after join_ib
+static uint32_t get_joined_size(index_block_t *dst_ib, index_entry_t *sep_ie, index_block_t *src_ib)
+{
+    uint32_t size = dst_ib->head.real_size - ib_get_last_ie(dst_ib)->len
+        + src_ib->head.real_size - src_ib->first_entry_off;
+
+    if (sep_ie == NULL)
+    {
+        return size;
+    }
+
+    size += sep_ie->len;
+    if (!(dst_ib->node_type & INDEX_BLOCK_LARGE))
+    {
+        size -= VBN_SIZE;
+    }
+
+    return size;
+}
+
+static int32_t free_child_ib(object_handle_t *tree, ofs_block_cache_t *cache)
+{
+    int32_t ret = 0;
+
+    ret = ofs_free_block_born(tree->ct, tree->obj_info->objid, cache->vbn, get_block_birth(tree, cache));
+    if (ret < 0)
+    {
+        LOG_ERROR("Free block failed. vbn(%lld) ret(%d)\n", cache->vbn, ret);
+        return ret;
+    }
+
+    SET_CACHE_EMPTY(cache);
+    free_obj_cache(tree->obj_info, cache);
+
+    return 0;
+}
+
+// merge the right block into the left block, return 1 if merged
+static int32_t merge_ib(object_handle_t *tree, uint8_t depth, uint32_t sep_pos,
+    ofs_block_cache_t *left, ofs_block_cache_t *right)
+{
+    ofs_block_cache_t *parent = tree->cache_stack[depth];
+    index_entry_t *sep_ie = (index_entry_t *)((uint8_t *)parent->ib + sep_pos);
+    index_entry_t *join_ie = sep_ie;
+    int32_t ret = 0;
+
+    if (IS_BPLUS_TREE(tree) && IS_LEAF_IB(left->ib))
+    { // the separator is not a kv
+        join_ie = NULL;
+    }
+
+    if (get_joined_size(IB(left->ib), join_ie, IB(right->ib)) > left->ib->alloc_size)
+    {
+        return 0;
+    }
+
+    join_ib(IB(left->ib), join_ie, IB(right->ib));
+
+    // the entry pointed to right block point to the left block now
+    remove_ie(IB(parent->ib), sep_ie);
+    SET_IE_VBN(sep_ie, left->vbn);
+
+    ret = free_child_ib(tree, right);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ret = set_child_ib_dirty(tree, depth, sep_pos, left);
+    if (ret < 0)
+    {
+        LOG_ERROR("Set ct block dirty failed. tree(%p) ret(%d)\n", tree, ret);
+        return ret;
+    }
+
+    return 1;
+}
+
+// move entries between the left and right block, return 1 if moved
+static int32_t redistribute_ib(object_handle_t *tree, uint8_t depth, uint32_t sep_pos,
+    ofs_block_cache_t *left, ofs_block_cache_t *right)
+{
+    ofs_block_cache_t *parent = tree->cache_stack[depth];
+    index_entry_t *sep_ie = (index_entry_t *)((uint8_t *)parent->ib + sep_pos);
+    index_entry_t *join_ie = sep_ie;
+    index_block_t *ib = NULL;
+    index_entry_t *mid_ie = NULL;
+    index_entry_t *new_ie = NULL;
+    uint32_t size = 0;
+    uint32_t mid_off = 0;
+    uint32_t right_size = 0;
+    uint32_t alloc_size = left->ib->alloc_size;
+    bool_t bplus_leaf = FALSE;
+    int32_t ret = 0;
+
+    if (IS_BPLUS_TREE(tree) && IS_LEAF_IB(left->ib))
+    { // the separator is not a kv, the middle entry is kept in right block
+        bplus_leaf = TRUE;
+        join_ie = NULL;
+    }
+
+    size = get_joined_size(IB(left->ib), join_ie, IB(right->ib));
+
+    ib = (index_block_t *)OS_MALLOC(size);
+    if (ib == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", size);
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    memcpy(ib, left->ib, left->ib->real_size);
+    ib->head.alloc_size = size;
+    join_ib(ib, join_ie, IB(right->ib));
+
+    mid_ie = get_middle_ie(ib, 50);
+    mid_off = (uint32_t)((uint8_t *)mid_ie - (uint8_t *)ib);
+    if (bplus_leaf)
+    {
+        new_ie = dump_ie_separator(tree, ((mid_ie->flags & INDEX_ENTRY_END) || (mid_ie == GET_FIRST_IE(ib)))
+            ? NULL : GET_PREV_IE(mid_ie), mid_ie, left->vbn);
+        right_size = size - mid_off + ib->first_entry_off;
+    }
+    else
+    {
+        new_ie = dump_ie_add_vbn(mid_ie, left->vbn);
+        right_size = size - mid_off - mid_ie->len + ib->first_entry_off;
+    }
+
+    if (new_ie == NULL)
+    {
+        LOG_ERROR("dump_ie_add_vbn failed. vbn(%lld)\n", left->vbn);
+        OS_FREE(ib);
+        return -INDEX_ERR_ADD_VBN;
+    }
+
+    if ((mid_ie->flags & INDEX_ENTRY_END) || (mid_ie == GET_FIRST_IE(ib))
+        || (mid_off + ib_get_last_ie(ib)->len > alloc_size) || (right_size > alloc_size)
+        || (parent->ib->real_size - sep_ie->len + new_ie->len > parent->ib->alloc_size))
+    { // the blocks or parent block have no space
+        OS_FREE(new_ie);
+        OS_FREE(ib);
+        return 0;
+    }
+
+    ib->head.alloc_size = alloc_size;
+    if (bplus_leaf)
+    {
+        copy_ib_tail_from(IB(right->ib), ib, mid_ie);
+    }
+    else
+    {
+        copy_ib_tail(IB(right->ib), ib, mid_ie);
+    }
+    
+    cut_ib_tail(ib, mid_ie);
+    memcpy(left->ib, ib, ib->head.real_size);
+    OS_FREE(ib);
+
+    // the entries moved, the child links are not valid
+    invalidate_child_caches(left);
+    invalidate_child_caches(right);
+
+    // replace the separator in parent
+    remove_ie(IB(parent->ib), sep_ie);
+    insert_ie(IB(parent->ib), new_ie, sep_ie);
+    OS_FREE(new_ie);
+
+    ret = set_child_ib_dirty(tree, depth, sep_pos, left);
+    if (ret < 0)
+    {
+        LOG_ERROR("Set ct block dirty failed. tree(%p) ret(%d)\n", tree, ret);
+        return ret;
+    }
+
+    ret = set_child_ib_dirty(tree, depth, sep_pos + sep_ie->len, right);
+    if (ret < 0)
+    {
+        LOG_ERROR("Set ct block dirty failed. tree(%p) ret(%d)\n", tree, ret);
+        return ret;
+    }
+
+    return 1;
+}
+
+// the root has only one child, move the child into root
+static int32_t collapse_root(object_handle_t *tree)
+{
+    ofs_block_cache_t *root = tree->cache_stack[0];
+    ofs_block_cache_t *child = NULL;
+    uint32_t alloc_size = root->ib->alloc_size;
+    int32_t ret = 0;
+
+    if (!(GET_FIRST_IE(root->ib)->flags & INDEX_ENTRY_END)
+        || !(IB(root->ib)->node_type & INDEX_BLOCK_LARGE))
+    {
+        return 0;
+    }
+
+    ret = get_child_ib(tree, root, IB(root->ib)->first_entry_off, &child);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    // keep some free space in root, avoid reparent on next insert
+    if ((uint64_t)child->ib->real_size * 100 > (uint64_t)alloc_size * (100 - INDEX_MERGE_PERCENT))
+    {
+        return 0;
+    }
+
+    memcpy(root->ib, child->ib, child->ib->real_size);
+    root->ib->alloc_size = alloc_size;
+    move_child_caches(root, child);
+
+    ret = free_child_ib(tree, child);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    LOG_INFO("The max depth changed. oldMaxDepth(%d) newMaxDepth(%d)\n",
+        tree->max_depth, tree->max_depth ? (tree->max_depth - 1) : 0);
+    if (tree->max_depth)
+    {
+        tree->max_depth--;
+    }
+
+    reset_cache_stack(tree, 0);
+
+    return set_ib_dirty(tree);
+}
+
+// merge or redistribute the current block with its sibling when it is underflow
+// return 1 if the current block is merged or redistributed
+static int32_t rebalance_ib(object_handle_t *tree)
+{
+    ofs_block_cache_t *parent = NULL;
+    ofs_block_cache_t *left = NULL;
+    ofs_block_cache_t *right = NULL;
+    index_entry_t *ie = NULL;
+    uint32_t sep_pos = 0;
+    uint8_t depth = 0;
+    int32_t merged = 0;
+    int32_t ret = 0;
+
+    if ((tree->depth == 0) || !IB_UNDERFLOW(tree->cache->ib))
+    {
+        return 0;
+    }
+
+    do
+    {
+        depth = tree->depth - 1;
+        parent = tree->cache_stack[depth];
+        ie = (index_entry_t *)((uint8_t *)parent->ib + tree->position_stack[depth]);
+
+        if (ie != GET_FIRST_IE(parent->ib))
+        { // merge with left sibling
+            sep_pos = (uint32_t)tree->position_stack[depth] - ie->prev_len;
+            right = tree->cache;
+            ret = get_child_ib(tree, parent, sep_pos, &left);
+        }
+        else if (!(ie->flags & INDEX_ENTRY_END))
+        { // merge with right sibling
+            sep_pos = (uint32_t)tree->position_stack[depth];
+            left = tree->cache;
+            ret = get_child_ib(tree, parent, sep_pos + ie->len, &right);
+        }
+        else
+        { // no sibling
+            return merged;
+        }
+
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        ret = merge_ib(tree, depth, sep_pos, left, right);
+        if (ret < 0)
+        {
+            LOG_ERROR("Merge block failed. vbn(%lld) ret(%d)\n", left->vbn, ret);
+            return ret;
+        }
+
+        if (ret == 0)
+        { // the parent entries number not changed
+            ret = redistribute_ib(tree, depth, sep_pos, left, right);
+            if (ret < 0)
+            {
+                LOG_ERROR("Redistribute block failed. vbn(%lld) ret(%d)\n", left->vbn, ret);
+                return ret;
+            }
+
+            return (ret | merged);
+        }
+
+        // the parent lost one entry
+        merged = 1;
+        tree->depth = depth;
+        tree->cache = parent;
+    } while ((depth != 0) && IB_UNDERFLOW(parent->ib));
+
+    if (depth == 0)
+    {
+        ret = collapse_root(tree);
+        if (ret < 0)
+        {
+            LOG_ERROR("Collapse root failed. ret(%d)\n", ret);
+            return ret;
+        }
+    }
+
+    return 1;
+}
+
 int32_t check_removed_ib(object_handle_t * tree)
 {
     int32_t ret = 0;
@@ -990,7 +1811,8 @@ int32_t check_removed_ib(object_handle_t * tree)
 
     for (;;)
     {
-        ret = OFS_FREE_BLOCK(tree->ct, tree->obj_info->objid, tree->cache->vbn);
+        ret = ofs_free_block_born(tree->ct, tree->obj_info->objid, tree->cache->vbn,
+            get_block_birth(tree, tree->cache));
         if (ret < 0)
         {
             LOG_ERROR("Free block failed. ret(%d)\n", ret);
@@ -1019,6 +1841,7 @@ int32_t check_removed_ib(object_handle_t * tree)
         // there are no entries in this node
         if (tree->depth == 0)
         {   /* root node */
+            invalidate_child_caches(tree->cache);
             make_ib_small(IB(tree->cache->ib));
             return set_ib_dirty(tree);
         }
@@ -1027,6 +1850,46 @@ int32_t check_removed_ib(object_handle_t * tree)
     return 1;
 }
 
+// remove the separator which point to the removed child block
+static int32_t remove_separator(object_handle_t *tree)
+{
+    index_entry_t *prev_ie = NULL;
+    int32_t ret = 0;
+
+    if (tree->ie->flags & INDEX_ENTRY_END)
+    { // the end entry point to the previous child now
+        prev_ie = GET_PREV_IE(tree->ie);
+        SET_IE_VBN(tree->ie, GET_IE_VBN(prev_ie));
+        tree->position -= prev_ie->len;
+        tree->ie = prev_ie;
+    }
+
+    remove_ie(IB(tree->cache->ib), tree->ie);
+    ret = set_ib_dirty(tree);
+    if (ret < 0)
+    {
+        LOG_ERROR("Set ct block dirty failed. tree(%p) ret(%d)\n", tree, ret);
+        return ret;
+    }
+
+    if (tree->depth == 0)
+    {
+        ret = collapse_root(tree);
+    }
+    else
+    {
+        ret = rebalance_ib(tree);
+    }
+    
+    if (ret < 0)
+    {
+        LOG_ERROR("Rebalance block failed. ret(%d)\n", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
 int32_t remove_leaf(object_handle_t *tree)
 {
     index_entry_t *ie = NULL;
@@ -1044,6 +1907,17 @@ int32_t remove_leaf(object_handle_t *tree)
         return ret;
     }
 
+    ret = rebalance_ib(tree);
+    if (ret < 0)
+    {
+        LOG_ERROR("Rebalance block failed. ret(%d)\n", ret);
+        return ret;
+    }
+    else if (ret > 0)
+    { // the block is merged or redistributed with sibling
+        return 0;
+    }
+
     ret = check_removed_ib(tree);
     if (ret < 0)
     {
@@ -1055,6 +1929,11 @@ int32_t remove_leaf(object_handle_t *tree)
         return 0;
     }
 
+    if (IS_BPLUS_TREE(tree))
+    { // the separator is not a kv, no need to insert it into leaf
+        return remove_separator(tree);
+    }
+
     if ((tree->ie->flags & INDEX_ENTRY_END))
     {   /* It is the end key, change the ullVBN link and take out the entry */
         prev_ie = GET_PREV_IE(tree->ie);
@@ -1104,6 +1983,7 @@ int32_t remove_leaf(object_handle_t *tree)
 int32_t remove_node(object_handle_t *tree)
 {
     index_entry_t *succ_ie = NULL;        /* The successor entry */
+    index_entry_t *key_ie = NULL;
     uint16_t len = 0;
     uint8_t depth = 0;
     uint64_t vbn = 0;
@@ -1157,16 +2037,46 @@ int32_t remove_node(object_handle_t *tree)
         return ret;
     }
 
+    // the successor may be larger than the old entry and split the node,
+    // then the cursor is not on it any more, keep its key to find it again
+    if (tree->cache->ib->real_size + succ_ie->len > tree->cache->ib->alloc_size)
+    {
+        key_ie = (index_entry_t *)OS_MALLOC(succ_ie->len);
+        if (key_ie == NULL)
+        {
+            LOG_ERROR("Allocate memory failed. size(%d)\n", succ_ie->len);
+            OS_FREE(succ_ie);
+            return -INDEX_ERR_ALLOCATE_MEMORY;
+        }
+
+        memcpy(key_ie, succ_ie, succ_ie->len);
+    }
+
     /* insert the new entry */
     ret = tree_insert_ie(tree, &succ_ie);
+    OS_FREE(succ_ie);
     if (ret < 0)
     {  
         LOG_ERROR("Insert entry failed. ret(%d)\n", ret);
-        OS_FREE(succ_ie);
+        if (key_ie != NULL)
+        {
+            OS_FREE(key_ie);
+        }
+        
         return ret;
     }
-    
-    OS_FREE(succ_ie);
+
+    if (key_ie != NULL)
+    { // the node is split, search the new separator from the root
+        ret = search_key_internal(tree, GET_IE_KEY(key_ie), key_ie->key_len,
+            GET_IE_VALUE(key_ie), key_ie->value_len);
+        OS_FREE(key_ie);
+        if (ret < 0)
+        {
+            LOG_ERROR("Search the successor entry failed. ret(%d)\n", ret);
+            return ret;
+        }
+    }
 
     /* get the next entry */
     ret = walk_tree(tree, 0);
@@ -1182,12 +2092,20 @@ int32_t remove_node(object_handle_t *tree)
 
 int32_t tree_remove_ie(object_handle_t *tree)
 {
+    int32_t ret = 0;
+    
     if (tree->ie->flags & (INDEX_ENTRY_END | INDEX_ENTRY_BEGIN))
     {
         LOG_ERROR("You can not remove begin or end entry. flags(0x%x)\n", tree->ie->flags);
         return -INDEX_ERR_END_ENTRY;
     }
 
+    ret = unshare_tree_caches(tree);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
     if (tree->ie->flags & INDEX_ENTRY_NODE)
     {
         return (remove_node(tree));
@@ -1196,7 +2114,92 @@ int32_t tree_remove_ie(object_handle_t *tree)
     return (remove_leaf(tree));
 }
 
-int32_t index_remove_key_nolock(object_handle_t *tree, const void *key, uint16_t key_len)
+/*
+ * replace the key and value of current entry in its block after one search,
+ * the new key must keep the order of the entry in the tree. the shrunk block
+ * is not merged here, it is done by the next removal in it
+ */
+int32_t tree_update_ie(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    index_entry_t *ie = NULL;
+    block_head_t *ib = NULL;
+    uint16_t vbn_size = 0;
+    uint16_t new_len = 0;
+    uint64_t vbn = 0;
+    int32_t ret = 0;
+
+    if (tree->ie->flags & (INDEX_ENTRY_END | INDEX_ENTRY_BEGIN))
+    {
+        LOG_ERROR("You can not update begin or end entry. flags(0x%x)\n", tree->ie->flags);
+        return -INDEX_ERR_END_ENTRY;
+    }
+
+    ret = unshare_tree_caches(tree);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ie = tree->ie;
+    ib = tree->cache->ib;
+
+    if (ie->flags & INDEX_ENTRY_NODE)
+    {
+        vbn_size = VBN_SIZE;
+    }
+
+    new_len = sizeof(index_entry_t) + key_len + value_len + vbn_size;
+    if (ib->real_size - ie->len + new_len > ib->alloc_size)
+    { // no room in the block, move the entry by splitting
+        ret = tree_remove_ie(tree);
+        if (ret < 0)
+        {
+            LOG_ERROR("Remove key failed. ret(%d)\n", ret);
+            return ret;
+        }
+        
+        return insert_key_internal(tree, key, key_len, value, value_len);
+    }
+
+    ret = set_ib_dirty(tree);
+    if (ret < 0)
+    {
+        LOG_ERROR("Set ct block dirty failed. tree(%p) ret(%d)\n", tree, ret);
+        return ret;
+    }
+
+    if (vbn_size != 0)
+    {
+        vbn = GET_IE_VBN(ie);
+    }
+
+    if (new_len != ie->len)
+    {
+        memmove((uint8_t *)ie + new_len, GET_NEXT_IE(ie), get_entries_length(GET_NEXT_IE(ie)));
+        ib->real_size = ib->real_size - ie->len + new_len;
+        ie->len = new_len;
+        GET_NEXT_IE(ie)->prev_len = new_len;
+    }
+
+    ie->key_len = key_len;
+    ie->value_len = value_len;
+    memcpy(GET_IE_KEY(ie), key, key_len);
+    if ((value != NULL) && (value_len != 0))
+    {
+        memcpy(GET_IE_VALUE(ie), value, value_len);
+    }
+
+    if (vbn_size != 0)
+    {
+        SET_IE_VBN(ie, vbn);
+    }
+
+    return 0;
+}
+
+// remove the key without the redo log
+int32_t remove_key_internal(object_handle_t *tree, const void *key, uint16_t key_len)
 {
     int32_t ret = 0;
 
@@ -1208,6 +2211,12 @@ int32_t index_remove_key_nolock(object_handle_t *tree, const void *key, uint16_t
 
     ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
 
+    if (tree->ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", tree->ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
     ret = search_key_internal(tree, key, key_len, NULL, 0);
     if (ret < 0)
     {
@@ -1219,8 +2228,26 @@ int32_t index_remove_key_nolock(object_handle_t *tree, const void *key, uint16_t
     if (ret < 0)
     {
         LOG_ERROR("Remove key failed. ret(%d)\n", ret);
+    }
+
+    return ret;
+}
+
+int32_t index_remove_key_nolock(object_handle_t *tree, const void *key, uint16_t key_len)
+{
+    int32_t ret = 0;
+
+    ret = remove_key_internal(tree, key, key_len);
+    if (ret < 0)
+    {
         return ret;
     }
+
+    // the system objects are rebuilt by replaying the user modifications
+    if (tree->obj_info->objid >= RESERVED_OBJ_ID)
+    {
+        ret = ofs_log_append(tree->ct, OFS_LOG_REMOVE_KEY, tree->obj_info->objid, key, key_len, NULL, 0);
+    }
    
     return ret;
 }
@@ -1228,6 +2255,7 @@ int32_t index_remove_key_nolock(object_handle_t *tree, const void *key, uint16_t
 int32_t index_remove_key(object_handle_t *tree, const void *key, uint16_t key_len)
 {
     int32_t ret = 0;
+    uint64_t start = 0;
 
     if ((tree == NULL) || (key == NULL) || (key_len == 0))
     {
@@ -1235,41 +2263,31 @@ int32_t index_remove_key(object_handle_t *tree, const void *key, uint16_t key_le
         return -INDEX_ERR_PARAMETER;
     }
 
+    start = OFS_STAT_START();
+    OS_RWLOCK_RDLOCK(&tree->ct->op_lock);
     OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
     ret = index_remove_key_nolock(tree, key, key_len);
     OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OS_RWLOCK_RDUNLOCK(&tree->ct->op_lock);
+    if (ret >= 0)
+    {
+        ret = ofs_log_commit(tree->ct);
+    }
+
+    OFS_STAT_END(OFS_STAT_REMOVE_KEY, start);
 
     return ret;
 }
 
-// value can be NULL, or value_len can be 0
-int32_t index_insert_key_nolock(object_handle_t *tree, const void *key,
+// insert the new entry before the entry where the search stopped
+static int32_t insert_at_cursor(object_handle_t *tree, const void *key,
     uint16_t key_len, const void *value, uint16_t value_len)
 {
     index_entry_t *ie = NULL;
     uint16_t len = 0;
     int32_t ret = 0;
 
-    if ((tree == NULL) || (key == NULL) || (key_len == 0))
-    {
-        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d)\n", tree, key, key_len);
-        return -INDEX_ERR_PARAMETER;
-    }
-
-    ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
-
-    ret = search_key_internal(tree, key, key_len, value, value_len);
-    if (ret >= 0)
-    {
-        return -INDEX_ERR_KEY_EXIST;
-    }
-    
-    if (ret != -INDEX_ERR_KEY_NOT_FOUND)
-    {
-        LOG_ERROR("Search key failed. objid(%lld) ret(%d)\n", tree->obj_info->objid, ret);
-        return ret;
-    }
-
     len = sizeof(index_entry_t) + key_len + value_len;
 
     ie = (index_entry_t *)OS_MALLOC(len);
@@ -1299,6 +2317,71 @@ int32_t index_insert_key_nolock(object_handle_t *tree, const void *key,
     
     OS_FREE(ie);
 
+    if (!(IB(tree->cache->ib)->node_type & INDEX_BLOCK_LARGE))
+    { // the handle stopped at leaf, try it first on next insert
+        tree->hint_seq = tree->obj_info->modify_seq;
+    }
+
+    return 0;
+}
+
+// insert the key without the redo log, value can be NULL, or value_len can be 0
+int32_t insert_key_internal(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    int32_t ret = 0;
+
+    if ((tree == NULL) || (key == NULL) || (key_len == 0))
+    {
+        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d)\n", tree, key, key_len);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
+
+    if (tree->ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", tree->ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    ret = search_key_by_hint(tree, key, key_len, value, value_len);
+    if (ret == INDEX_HINT_MISS)
+    {
+        ret = search_key_internal(tree, key, key_len, value, value_len);
+    }
+    
+    if (ret >= 0)
+    {
+        return -INDEX_ERR_KEY_EXIST;
+    }
+    
+    if (ret != -INDEX_ERR_KEY_NOT_FOUND)
+    {
+        LOG_ERROR("Search key failed. objid(%lld) ret(%d)\n", tree->obj_info->objid, ret);
+        return ret;
+    }
+
+    return insert_at_cursor(tree, key, key_len, value, value_len);
+}
+
+// value can be NULL, or value_len can be 0
+int32_t index_insert_key_nolock(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    int32_t ret = 0;
+
+    ret = insert_key_internal(tree, key, key_len, value, value_len);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (tree->obj_info->objid >= RESERVED_OBJ_ID)
+    {
+        ret = ofs_log_append(tree->ct, OFS_LOG_INSERT_KEY, tree->obj_info->objid, key, key_len, value, value_len);
+    }
+
     return ret;
 }
 
@@ -1306,6 +2389,7 @@ int32_t index_insert_key(object_handle_t *tree, const void *key,
     uint16_t key_len, const void *value, uint16_t value_len)
 {
     int32_t ret = 0;
+    uint64_t start = 0;
 
     if ((tree == NULL) || (key == NULL) || (key_len == 0))
     {
@@ -1313,14 +2397,60 @@ int32_t index_insert_key(object_handle_t *tree, const void *key,
         return -INDEX_ERR_PARAMETER;
     }
 
+    start = OFS_STAT_START();
+    OS_RWLOCK_RDLOCK(&tree->ct->op_lock);
     OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
     ret = index_insert_key_nolock(tree, key, key_len, value, value_len);
     OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OS_RWLOCK_RDUNLOCK(&tree->ct->op_lock);
+    if (ret >= 0)
+    {
+        ret = ofs_log_commit(tree->ct);
+    }
+
+    OFS_STAT_END(OFS_STAT_INSERT_KEY, start);
 
     return ret;
 }
 
-int32_t index_update_value(object_handle_t *tree, const void *key,
+// update the value of the existing key without the redo log
+int32_t update_value_internal(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    int32_t ret = 0;
+
+    if ((tree == NULL) || (key == NULL) || (key_len == 0))
+    {
+        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d)\n", tree, key, key_len);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
+
+    if (tree->ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", tree->ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    ret = search_key_internal(tree, key, key_len, NULL, 0);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if ((tree->ie->value_len == value_len)
+        && ((value_len == 0) || (memcmp(GET_IE_VALUE(tree->ie), value, value_len) == 0)))
+    { // nothing changed
+        return 0;
+    }
+
+    return tree_update_ie(tree, key, key_len, value, value_len);
+}
+
+// insert the key, or update its value if it exists, without the redo log
+int32_t upsert_key_internal(object_handle_t *tree, const void *key,
     uint16_t key_len, const void *value, uint16_t value_len)
 {
     int32_t ret = 0;
@@ -1333,14 +2463,87 @@ int32_t index_update_value(object_handle_t *tree, const void *key,
 
     ASSERT(tree->obj_info->attr_record->flags & FLAG_TABLE);
 
+    if (tree->ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", tree->ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    ret = search_key_by_hint(tree, key, key_len, value, value_len);
+    if (ret == INDEX_HINT_MISS)
+    {
+        ret = search_key_internal(tree, key, key_len, value, value_len);
+    }
+    
+    if (ret >= 0)
+    {
+        return tree_update_ie(tree, key, key_len, value, value_len);
+    }
+    
+    if (ret != -INDEX_ERR_KEY_NOT_FOUND)
+    {
+        LOG_ERROR("Search key failed. objid(%lld) ret(%d)\n", tree->obj_info->objid, ret);
+        return ret;
+    }
+
+    return insert_at_cursor(tree, key, key_len, value, value_len);
+}
+
+// the replay of the insertion also updates the existing key
+int32_t index_upsert_key_nolock(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    int32_t ret = 0;
+
+    ret = upsert_key_internal(tree, key, key_len, value, value_len);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (tree->obj_info->objid >= RESERVED_OBJ_ID)
+    {
+        ret = ofs_log_append(tree->ct, OFS_LOG_INSERT_KEY, tree->obj_info->objid, key, key_len, value, value_len);
+    }
+
+    return ret;
+}
+
+int32_t index_upsert_key(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    int32_t ret = 0;
+    uint64_t start = 0;
+
+    if ((tree == NULL) || (key == NULL) || (key_len == 0))
+    {
+        LOG_ERROR("Invalid parameter. tree(%p) key(%p) key_len(%d)\n", tree, key, key_len);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    start = OFS_STAT_START();
+    OS_RWLOCK_RDLOCK(&tree->ct->op_lock);
     OS_RWLOCK_WRLOCK(&tree->obj_info->attr_lock);
-    ret = index_remove_key_nolock(tree, key, key_len);
-    ret = index_insert_key_nolock(tree, key, key_len, value, value_len);
+    OFS_COUNT_OBJ(tree->obj_info, OFS_CNT_LOCK_WAIT_NS, os_get_ns_count() - start);
+    ret = index_upsert_key_nolock(tree, key, key_len, value, value_len);
     OS_RWLOCK_WRUNLOCK(&tree->obj_info->attr_lock);
+    OS_RWLOCK_RDUNLOCK(&tree->ct->op_lock);
+    if (ret >= 0)
+    {
+        ret = ofs_log_commit(tree->ct);
+    }
+
+    OFS_STAT_END(OFS_STAT_UPDATE_VALUE, start);
 
     return ret;
 }
 
+int32_t index_update_value(object_handle_t *tree, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    return index_upsert_key(tree, key, key_len, value, value_len);
+}
+
 
 int64_t index_get_total_key(object_handle_t *tree)
 {
@@ -1427,13 +2630,18 @@ int32_t index_walk_all(object_handle_t *tree, bool_t reverse, uint8_t flags,
 }
 
 EXPORT_SYMBOL(index_search_key);
+EXPORT_SYMBOL(index_get_pinned);
+EXPORT_SYMBOL(index_release_pinned);
+EXPORT_SYMBOL(index_get_into);
 EXPORT_SYMBOL(walk_tree);
 EXPORT_SYMBOL(index_insert_key);
 EXPORT_SYMBOL(index_remove_key);
+EXPORT_SYMBOL(index_upsert_key);
 EXPORT_SYMBOL(index_walk_all);
 
 EXPORT_SYMBOL(index_search_key_nolock);
 EXPORT_SYMBOL(index_insert_key_nolock);
 EXPORT_SYMBOL(index_remove_key_nolock);
+EXPORT_SYMBOL(index_upsert_key_nolock);
 
 
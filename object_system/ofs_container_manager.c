@@ -165,6 +165,17 @@ int32_t init_container_resource(container_handle_t **ct, const char *ct_name)
     OS_RWLOCK_INIT(&tmp_ct->ct_lock);
     OS_RWLOCK_INIT(&tmp_ct->metadata_cache_lock);
     tmp_ct->ref_cnt = 1;
+    tmp_ct->durability = OFS_DURABILITY_CHECKPOINT;
+    tmp_ct->last_snapshot = OFS_SNAPSHOT_NONE;
+    OS_RWLOCK_INIT(&tmp_ct->pending_lock);
+    OS_RWLOCK_INIT(&tmp_ct->view_lock);
+    OS_RWLOCK_INIT_WRITER_FIRST(&tmp_ct->op_lock); // the checkpoint is not starved by the writers
+    OS_RWLOCK_INIT(&tmp_ct->dirty_lock);
+    list_init_head(&tmp_ct->dirty_objs);
+    list_init_head(&tmp_ct->dirty_caches);
+    OS_RWLOCK_INIT(&tmp_ct->pin_lock);
+    list_init_head(&tmp_ct->pinned_caches);
+    init_txn_group(tmp_ct);
     avl_create(&tmp_ct->obj_info_list, (int (*)(const void *, const void*))compare_object1, sizeof(object_info_t),
         OS_OFFSET(object_info_t, entry));
     avl_create(&tmp_ct->metadata_cache, (int (*)(const void *, const void*))compare_cache1, sizeof(ofs_block_cache_t),
@@ -182,6 +193,13 @@ void destroy_container_resource(container_handle_t *ct)
     avl_destroy(&ct->metadata_cache);
     OS_RWLOCK_DESTROY(&ct->ct_lock);
     OS_RWLOCK_DESTROY(&ct->metadata_cache_lock);
+    destroy_pending_blocks(ct);
+    OS_RWLOCK_DESTROY(&ct->pending_lock);
+    OS_RWLOCK_DESTROY(&ct->view_lock);
+    OS_RWLOCK_DESTROY(&ct->op_lock);
+    OS_RWLOCK_DESTROY(&ct->dirty_lock);
+    OS_RWLOCK_DESTROY(&ct->pin_lock);
+    destroy_txn_group(ct);
     avl_remove(g_container_list, ct);
 
     OS_FREE(ct);
@@ -285,6 +303,15 @@ int32_t open_system_objects(container_handle_t *ct)
     }
 
     ct->id_obj = obj;
+    ct->commit_objid_inode_no = ct->sb.objid_inode_no;
+
+    /* open $SNAPSHOT object */
+    ret = open_snapshot_object(ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open snapshot object failed. ct_name(%s) ret(%d)\n", ct->name, ret);
+        return ret;
+    }
 
     return 0;
 }
@@ -410,6 +437,14 @@ int32_t ofs_create_container_nolock(const char *ct_name, uint64_t total_sectors,
         return ret;
     }
 
+    ret = ofs_log_create(tmp_ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Create redo log failed. ct_name(%s) ret(%d)\n", ct_name, ret);
+        close_container(tmp_ct);
+        return ret;
+    }
+
     ret = ofs_init_super_block(tmp_ct);
     if (ret < 0)
     {
@@ -528,6 +563,15 @@ int32_t ofs_open_nolock(const char *ct_name, container_handle_t **ct)
         return ret;
     }
 
+    /* redo the modifications after the last checkpoint */
+    ret = ofs_log_open(tmp_ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open redo log failed. ct_name(%s) ret(%d)\n", ct_name, ret);
+        close_container(tmp_ct);
+        return ret;
+    }
+
     *ct = tmp_ct;
     
     LOG_INFO("Open the ct success. ct_name(%s) ct(%p)\n", ct_name, ct);
@@ -560,15 +604,30 @@ void close_container(container_handle_t *ct)
         ct->id_obj = NULL;
     }
 
+    if (ct->snap_obj != NULL)
+    {
+        close_object(ct->snap_obj->obj_info);
+        ct->snap_obj = NULL;
+    }
+
+    // the read views hold the container, none is left now
+    release_pending_blocks(ct, OFS_SNAPSHOT_NONE);
+
     ofs_destroy_sm(&ct->sm);
     ofs_destroy_sm(&ct->bsm);
 
-    commit_container_modification(ct);
+    // nothing to commit if the disk is not opened
+    if (!(ct->flags & FLAG_READONLY) && (ct->disk_hnd != NULL))
+    {
+        commit_container_modification(ct);
+    }
     
     release_container_all_cache(ct);
     
     if (ct->disk_hnd != NULL)
-    {
+    { // the log is dropped only after the checkpoint is written
+        (void) ofs_flush_disk(ct);
+        ofs_log_close(ct);
         (void) os_disk_close(ct->disk_hnd);
         ct->disk_hnd = NULL;
     }
@@ -580,6 +639,8 @@ void close_container(container_handle_t *ct)
 
 int32_t ofs_close_nolock(container_handle_t *ct)
 {
+    container_handle_t *parent = NULL;
+
     if (ct == NULL)
     {   /* Not allocated yet */
         LOG_ERROR("Invalid parameter. ct(%p)\n", ct);
@@ -600,10 +661,17 @@ int32_t ofs_close_nolock(container_handle_t *ct)
         return 0;
     }
     
+    parent = ct->parent;
     close_container(ct);
 
     LOG_INFO("Close the ct success. ct(%p)\n", ct);
 
+    if (parent != NULL)
+    { // the read view holds its container
+        parent->view_cnt--;
+        (void)ofs_close_nolock(parent);
+    }
+
     return 0;
 }     
 
@@ -618,6 +686,304 @@ int32_t ofs_close_container(container_handle_t *ct)
     return ret;
 }     
 
+// take one more reference of the opened container, dropped by ofs_close_container
+void hold_container(container_handle_t *ct)
+{
+    OS_RWLOCK_WRLOCK(&g_container_list_rwlock);
+    ct->ref_cnt++;
+    OS_RWLOCK_WRUNLOCK(&g_container_list_rwlock);
+}
+
+// the caller holds the op_lock exclusively
+int32_t commit_container_nolock(container_handle_t *ct)
+{
+    int32_t ret = 0;
+
+    ret = commit_container_modification_nolock(ct);
+    if (ret >= 0)
+    { // the redo log is not needed by the checkpoint
+        ret = ofs_log_truncate(ct);
+    }
+
+    LOG_DEBUG("Commit the ct. ct(%p) name(%s) ret(%d)\n", ct, ct->name, ret);
+
+    return ret;
+}
+
+// write all the modification of the opened container to disk, the writers
+// wait until the commit finished
+int32_t ofs_commit_container(container_handle_t *ct)
+{
+    int32_t ret = 0;
+
+    if (ct == NULL)
+    {
+        LOG_ERROR("Invalid parameter. ct(%p)\n", ct);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    OS_RWLOCK_WRLOCK(&ct->op_lock);
+    ret = commit_container_nolock(ct);
+    OS_RWLOCK_WRUNLOCK(&ct->op_lock);
+
+    return ret;
+}
+
+// make the modifications of the container durable by syncing the redo log,
+// the concurrent callers share one sync. much cheaper than the commit
+int32_t ofs_sync_container(container_handle_t *ct)
+{
+    int32_t ret = 0;
+
+    if (ct == NULL)
+    {
+        LOG_ERROR("Invalid parameter. ct(%p)\n", ct);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ret = ofs_log_sync(ct, ofs_log_last_lsn(ct));
+
+    LOG_DEBUG("Sync the ct. ct(%p) name(%s) ret(%d)\n", ct, ct->name, ret);
+
+    return ret;
+}
+
+int32_t ofs_set_durability(container_handle_t *ct, uint32_t durability)
+{
+    if ((ct == NULL) || (durability >= OFS_DURABILITY_BUTT))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) durability(%d)\n", ct, durability);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ct->durability = durability;
+
+    return 0;
+}
+
+// the name "ct_name<sep>no" of a read only version of ct, the too long names
+// are refused, a truncated one may be the name of another version
+int32_t get_version_name(char *name, const char *ct_name, char sep, uint64_t no)
+{
+    char digits[24];
+    uint64_t left = no;
+    uint32_t num = 0;
+    uint32_t len = 0;
+
+    do
+    {
+        digits[num++] = (char)('0' + left % 10);
+        left /= 10;
+    } while (left != 0);
+
+    len = (uint32_t)strlen(ct_name);
+    if (len + 1 + num >= OFS_NAME_SIZE)
+    {
+        LOG_ERROR("The name is too long. ct_name(%s) no(%lld)\n", ct_name, no);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    memcpy(name, ct_name, len);
+    name[len++] = sep;
+    while (num != 0)
+    {
+        name[len++] = digits[--num];
+    }
+
+    name[len] = 0;
+
+    return 0;
+}
+
+// open the version of ct whose $OBJID root is objid_inode_no as the read only
+// container, it shares the disk with ct and has no space manager or log
+static int32_t open_readonly_nolock(container_handle_t *ct, const char *name, uint64_t objid_inode_no,
+    uint64_t snapshot_no, container_handle_t **ro_ct)
+{
+    container_handle_t *tmp_ct = NULL;
+    object_handle_t *obj = NULL;
+    avl_index_t where = 0;
+    int32_t ret = 0;
+
+    tmp_ct = avl_find(g_container_list, (avl_find_fn_t)compare_container2, name, &where);
+    if (tmp_ct)
+    {
+        tmp_ct->ref_cnt++;
+        *ro_ct = tmp_ct;
+        return 0;
+    }
+
+    ret = init_container_resource(&tmp_ct, name);
+    if (ret < 0)
+    {
+        LOG_ERROR("Init ct resource failed. ct_name(%s) ret(%d)\n", name, ret);
+        return ret;
+    }
+
+    tmp_ct->flags |= FLAG_READONLY;
+    memcpy(&tmp_ct->sb, &ct->sb, sizeof(ofs_super_block_t));
+    tmp_ct->sb.objid_inode_no = objid_inode_no;
+    tmp_ct->sb.snapshot_no = snapshot_no;
+
+    ret = os_disk_open(&tmp_ct->disk_hnd, ct->name);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open disk failed. ct_name(%s) ret(%d)\n", name, ret);
+        close_container(tmp_ct);
+        return ret;
+    }
+
+    ret = open_object(tmp_ct, tmp_ct->sb.objid_id, objid_inode_no, &obj);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open objid object failed. ct_name(%s) ret(%d)\n", name, ret);
+        close_container(tmp_ct);
+        return ret;
+    }
+
+    tmp_ct->id_obj = obj;
+    *ro_ct = tmp_ct;
+
+    LOG_INFO("Open the read only ct success. ct_name(%s) objid_inode_no(%lld)\n", name, objid_inode_no);
+
+    return 0;
+}
+
+// open the snapshot as the read only container named "ct_name@snapshot_no"
+int32_t ofs_open_snapshot(container_handle_t *ct, uint64_t snapshot_no, container_handle_t **snap_ct)
+{
+    char name[OFS_NAME_SIZE];
+    ofs_snapshot_record_t snap;
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (snap_ct == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) snap_ct(%p)\n", ct, snap_ct);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ret = ofs_get_snapshot(ct, snapshot_no, &snap);
+    if (ret < 0)
+    {
+        LOG_ERROR("The snapshot not found. ct_name(%s) snapshot_no(%lld) ret(%d)\n", ct->name, snapshot_no, ret);
+        return ret;
+    }
+
+    ret = get_version_name(name, ct->name, '@', snapshot_no);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    OS_RWLOCK_WRLOCK(&g_container_list_rwlock);
+    ret = open_readonly_nolock(ct, name, snap.objid_inode_no, snap.snapshot_no, snap_ct);
+    OS_RWLOCK_WRUNLOCK(&g_container_list_rwlock);
+
+    return ret;
+}
+
+/*
+ * the read view is the read only container named "ct_name#commit_seq" on the
+ * last checkpoint. the writers never touch its caches and locks, and the
+ * blocks it refers are not reused until it is ended. it holds a reference of
+ * ct, end it by ofs_end_read_view
+ */
+int32_t ofs_begin_read_view(container_handle_t *ct, container_handle_t **view)
+{
+    char name[OFS_NAME_SIZE];
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (view == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) view(%p)\n", ct, view);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    if (ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct_name(%s)\n", ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    // the blocks of the published checkpoint are not being released now
+    OS_RWLOCK_WRLOCK(&ct->view_lock);
+    if (ct->commit_objid_inode_no == 0)
+    {
+        OS_RWLOCK_WRUNLOCK(&ct->view_lock);
+        LOG_ERROR("The ct is not committed. ct_name(%s)\n", ct->name);
+        return -INDEX_ERR_NO_CONTENT;
+    }
+
+    ret = get_version_name(name, ct->name, '#', ct->commit_seq);
+    if (ret < 0)
+    {
+        OS_RWLOCK_WRUNLOCK(&ct->view_lock);
+        return ret;
+    }
+
+    OS_RWLOCK_WRLOCK(&g_container_list_rwlock);
+    ret = open_readonly_nolock(ct, name, ct->commit_objid_inode_no, ct->sb.snapshot_no, view);
+    if ((ret >= 0) && ((*view)->parent == NULL))
+    {
+        (*view)->parent = ct;
+        (*view)->view_seq = ct->commit_seq;
+        ct->view_cnt++;
+        ct->ref_cnt++;
+    }
+    OS_RWLOCK_WRUNLOCK(&g_container_list_rwlock);
+    OS_RWLOCK_WRUNLOCK(&ct->view_lock);
+
+    return ret;
+}
+
+int32_t ofs_end_read_view(container_handle_t *view)
+{
+    if ((view == NULL) || (view->parent == NULL))
+    {
+        LOG_ERROR("Invalid parameter. view(%p)\n", view);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    return ofs_close_container(view);
+}
+
+typedef struct oldest_view_para
+{
+    container_handle_t *ct;
+    uint64_t view_seq;
+} oldest_view_para_t;
+
+static int32_t get_older_view(oldest_view_para_t *para, container_handle_t *view)
+{
+    if ((view->parent == para->ct) && (view->view_seq < para->view_seq))
+    {
+        para->view_seq = view->view_seq;
+    }
+
+    return 0;
+}
+
+// the checkpoint the oldest read view of ct reads, the caller holds the
+// view_lock of ct so that no read view begins meanwhile. the ct opening or
+// closing has no read view, and the list lock its caller holds is not taken
+uint64_t get_oldest_read_view(container_handle_t *ct)
+{
+    oldest_view_para_t para;
+
+    para.ct = ct;
+    para.view_seq = OFS_SNAPSHOT_NONE;
+    if (ct->view_cnt == 0)
+    {
+        return para.view_seq;
+    }
+
+    OS_RWLOCK_WRLOCK(&g_container_list_rwlock);
+    (void)avl_walk_all(g_container_list, (avl_walk_cb_t)get_older_view, &para);
+    OS_RWLOCK_WRUNLOCK(&g_container_list_rwlock);
+
+    return para.view_seq;
+}
+
 container_handle_t *ofs_get_container_handle(const char *ct_name)
 {
     container_handle_t *ct = NULL;
@@ -639,5 +1005,11 @@ container_handle_t *ofs_get_container_handle(const char *ct_name)
 EXPORT_SYMBOL(ofs_create_container);
 EXPORT_SYMBOL(ofs_open_container);
 EXPORT_SYMBOL(ofs_close_container);
+EXPORT_SYMBOL(ofs_commit_container);
+EXPORT_SYMBOL(ofs_sync_container);
+EXPORT_SYMBOL(ofs_set_durability);
+EXPORT_SYMBOL(ofs_open_snapshot);
+EXPORT_SYMBOL(ofs_begin_read_view);
+EXPORT_SYMBOL(ofs_end_read_view);
 
 
@@ -18,4 +18,906 @@
  *
  * CDDL HEADER END
  */
+/*******************************************************************************
 
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_LOG.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_LOG);
+#include "log.h"
+
+struct ofs_log
+{
+    void *file_hnd;
+    os_mutex_t lock;
+    os_cond_t cond;             // wake up the threads waiting for the writer
+
+    uint8_t *buf;               // the records not written to the file yet
+    uint8_t *write_buf;         // the records being written by the writer
+    uint32_t buf_len;
+    uint64_t file_size;
+
+    uint64_t next_lsn;
+    uint64_t written_lsn;       // the records up to it are in the file
+    uint64_t synced_lsn;        // the records up to it are on the device
+
+    bool_t writing;             // only one thread writes the file at a time
+    bool_t replaying;           // the replayed modifications are not logged again
+    int32_t error;              // the first write error, the log is broken until truncated
+
+    bool_t old_pending;         // the old segment is not dropped yet
+    uint64_t old_lsn;           // the last lsn in the old segment
+};
+
+static void log_get_path(container_handle_t *ct, const char *suffix, char *path, uint32_t size)
+{
+    OS_SNPRINTF(path, size, "%s%s", ct->name, suffix);
+}
+
+static void free_log(ofs_log_t *log)
+{
+    if (log->buf)
+    {
+        OS_FREE(log->buf);
+    }
+
+    if (log->write_buf)
+    {
+        OS_FREE(log->write_buf);
+    }
+
+    OS_COND_DESTROY(&log->cond);
+    OS_MUTEX_DESTROY(&log->lock);
+    OS_FREE(log);
+}
+
+static ofs_log_t *alloc_log(container_handle_t *ct)
+{
+    ofs_log_t *log = NULL;
+
+    log = OS_MALLOC(sizeof(ofs_log_t));
+    if (log == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_log_t));
+        return NULL;
+    }
+
+    memset(log, 0, sizeof(ofs_log_t));
+    OS_MUTEX_INIT(&log->lock);
+    OS_COND_INIT(&log->cond);
+
+    log->buf = OS_MALLOC(OFS_LOG_BUF_SIZE);
+    log->write_buf = OS_MALLOC(OFS_LOG_BUF_SIZE);
+    if ((log->buf == NULL) || (log->write_buf == NULL))
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", OFS_LOG_BUF_SIZE);
+        free_log(log);
+        return NULL;
+    }
+
+    log->next_lsn = ct->sb.log_lsn + 1;
+    log->written_lsn = ct->sb.log_lsn;
+    log->synced_lsn = ct->sb.log_lsn;
+
+    return log;
+}
+
+/*
+ * write the records up to lsn to the file, and sync the file if required.
+ * the caller holds the lock. the writer takes all the records appended so far,
+ * so the threads coming during one sync are served by the next sync together.
+ */
+static int32_t log_write(container_handle_t *ct, ofs_log_t *log, uint64_t lsn, bool_t sync)
+{
+    uint8_t *buf = NULL;
+    uint32_t len = 0;
+    uint64_t offset = 0;
+    uint64_t target = 0;
+    int32_t ret = 0;
+
+    while ((log->error == 0) && ((sync ? log->synced_lsn : log->written_lsn) < lsn))
+    {
+        if (log->writing)
+        {
+            OS_COND_WAIT(&log->cond, &log->lock);
+            continue;
+        }
+
+        log->writing = TRUE;
+        buf = log->buf;
+        len = log->buf_len;
+        log->buf = log->write_buf;
+        log->write_buf = buf;
+        log->buf_len = 0;
+        offset = log->file_size;
+        target = log->next_lsn - 1;
+        OS_MUTEX_UNLOCK(&log->lock);
+
+        ret = 0;
+        if ((len != 0) && (os_file_pwrite(log->file_hnd, buf, len, offset) != (int32_t)len))
+        {
+            ret = -FILE_IO_ERR_WRITE;
+        }
+
+        if ((ret == 0) && sync)
+        { // without durability the records only need to survive the crash of the process
+            ret = (ct->durability == OFS_DURABILITY_NONE)
+                ? os_file_flush(log->file_hnd) : os_file_sync(log->file_hnd);
+            OFS_COUNT(&ct->counters, OFS_CNT_LOG_SYNC, 1);
+        }
+
+        OS_MUTEX_LOCK(&log->lock);
+        log->writing = FALSE;
+        if (ret < 0)
+        {
+            LOG_ERROR("Write the redo log failed. ct(%s) offset(%lld) len(%d) ret(%d)\n",
+                ct->name, offset, len, ret);
+            log->error = ret;
+        }
+        else
+        {
+            log->file_size += len;
+            log->written_lsn = target;
+            if (sync)
+            {
+                log->synced_lsn = target;
+            }
+        }
+
+        OS_COND_BROADCAST(&log->cond);
+    }
+
+    return log->error;
+}
+
+// make room for len bytes in the buffer, the caller holds the lock
+static int32_t log_reserve(container_handle_t *ct, ofs_log_t *log, uint32_t len)
+{
+    int32_t ret = 0;
+
+    // the buffer is full, write it out without sync
+    while ((ret == 0) && (log->buf_len + len > OFS_LOG_BUF_SIZE))
+    {
+        ret = log_write(ct, log, log->next_lsn - 1, FALSE);
+    }
+
+    return ret;
+}
+
+// the caller holds the lock and has reserved the room
+static uint32_t log_fill_record(ofs_log_t *log, uint8_t op, uint64_t objid,
+    const void *key, uint16_t key_len, const void *value, uint16_t value_len)
+{
+    ofs_log_record_t *rec = (ofs_log_record_t *)(log->buf + log->buf_len);
+    uint32_t len = OFS_LOG_RECORD_SIZE(key_len, value_len);
+
+    memset(rec, 0, sizeof(ofs_log_record_t));
+    rec->magic = OFS_LOG_MAGIC;
+    rec->lsn = log->next_lsn++;
+    rec->objid = objid;
+    rec->key_len = key_len;
+    rec->value_len = value_len;
+    rec->op = op;
+    if (key_len != 0)
+    {
+        memcpy(rec + 1, key, key_len);
+    }
+
+    if (value_len != 0)
+    {
+        memcpy((uint8_t *)(rec + 1) + key_len, value, value_len);
+    }
+
+    rec->crc = os_crc32(0, &rec->lsn, len - OS_OFFSET(ofs_log_record_t, lsn));
+    log->buf_len += len;
+
+    return len;
+}
+
+int32_t ofs_log_append(container_handle_t *ct, uint8_t op, uint64_t objid,
+    const void *key, uint16_t key_len, const void *value, uint16_t value_len)
+{
+    ofs_log_t *log = ct->log;
+    uint32_t len = OFS_LOG_RECORD_SIZE(key_len, value_len);
+    int32_t ret = 0;
+
+    if ((log == NULL) || log->replaying)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+    ret = log_reserve(ct, log, len);
+    if (ret < 0)
+    {
+        OS_MUTEX_UNLOCK(&log->lock);
+        LOG_ERROR("Append the redo log failed. ct(%s) objid(%lld) op(%d) ret(%d)\n", ct->name, objid, op, ret);
+        return ret;
+    }
+
+    (void)log_fill_record(log, op, objid, key, key_len, value, value_len);
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    OFS_COUNT(&ct->counters, OFS_CNT_LOG_APPEND, 1);
+    OFS_COUNT(&ct->counters, OFS_CNT_LOG_BYTES, len);
+
+    return 0;
+}
+
+// append the records after one OFS_LOG_TXN_BEGIN record without any other
+// record between them, the replay applies all of them or none
+int32_t ofs_log_append_batch(container_handle_t *ct, const ofs_log_entry_t *entries, uint32_t num)
+{
+    ofs_log_t *log = ct->log;
+    uint32_t len = OFS_LOG_RECORD_SIZE(0, sizeof(uint32_t));
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    if ((log == NULL) || log->replaying)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        len += OFS_LOG_RECORD_SIZE(entries[i].key_len, entries[i].value_len);
+    }
+
+    if (len > OFS_LOG_BUF_SIZE)
+    {
+        LOG_ERROR("The batch is too large. ct(%s) num(%d) len(%d)\n", ct->name, num, len);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+    ret = log_reserve(ct, log, len);
+    if (ret < 0)
+    {
+        OS_MUTEX_UNLOCK(&log->lock);
+        LOG_ERROR("Append the redo log failed. ct(%s) num(%d) ret(%d)\n", ct->name, num, ret);
+        return ret;
+    }
+
+    (void)log_fill_record(log, OFS_LOG_TXN_BEGIN, 0, NULL, 0, &num, sizeof(uint32_t));
+    for (i = 0; i < num; i++)
+    {
+        (void)log_fill_record(log, entries[i].op, entries[i].objid, entries[i].key, entries[i].key_len,
+            entries[i].value, entries[i].value_len);
+    }
+
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    OFS_COUNT(&ct->counters, OFS_CNT_LOG_APPEND, num + 1);
+    OFS_COUNT(&ct->counters, OFS_CNT_LOG_BYTES, len);
+
+    return 0;
+}
+
+uint64_t ofs_log_last_lsn(container_handle_t *ct)
+{
+    ofs_log_t *log = ct->log;
+    uint64_t lsn = 0;
+
+    if (log == NULL)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+    lsn = log->next_lsn - 1;
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    return lsn;
+}
+
+// make the records up to lsn durable
+int32_t ofs_log_sync(container_handle_t *ct, uint64_t lsn)
+{
+    ofs_log_t *log = ct->log;
+    int32_t ret = 0;
+
+    if (log == NULL)
+    {
+        return 0;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+    ret = log_write(ct, log, lsn, TRUE);
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    return ret;
+}
+
+// the commit of a modification returns after its record is durable in commit mode,
+// the concurrent commits share one sync
+int32_t ofs_log_commit(container_handle_t *ct)
+{
+    if ((ct->log == NULL) || (ct->durability != OFS_DURABILITY_COMMIT))
+    {
+        return 0;
+    }
+
+    return ofs_log_sync(ct, ofs_log_last_lsn(ct));
+}
+
+// rename the current segment to the old one, and append to a new segment.
+// the caller holds the lock, and nobody is writing the file
+static int32_t log_rotate(container_handle_t *ct, ofs_log_t *log)
+{
+    char path[OFS_NAME_SIZE + sizeof(OFS_LOG_OLD_SUFFIX)];
+    char old_path[OFS_NAME_SIZE + sizeof(OFS_LOG_OLD_SUFFIX)];
+    int32_t ret = 0;
+
+    log_get_path(ct, OFS_LOG_SUFFIX, path, sizeof(path));
+    log_get_path(ct, OFS_LOG_OLD_SUFFIX, old_path, sizeof(old_path));
+
+    // the file is closed before it is renamed, for windows
+    (void)os_file_close(log->file_hnd);
+    log->file_hnd = NULL;
+
+    ret = os_file_rename(path, old_path);
+    if (ret == 0)
+    {
+        ret = os_file_create(&log->file_hnd, path);
+        if (ret < 0)
+        { // keep appending to the old one
+            (void)os_file_rename(old_path, path);
+        }
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Rotate the redo log failed. ct(%s) ret(%d)\n", ct->name, ret);
+        if (os_file_open(&log->file_hnd, path) < 0)
+        {
+            log->file_hnd = NULL;
+            log->error = -FILE_IO_ERR_OPEN;
+        }
+
+        return ret;
+    }
+
+    log->old_pending = TRUE;
+    log->old_lsn = log->written_lsn;
+    log->file_size = 0;
+
+    return 0;
+}
+
+/*
+ * record the checkpoint lsn in the super block, called before the checkpoint
+ * writes the super block. the records up to it are synced to the current
+ * segment, which becomes the old segment, and the later records go to a new
+ * segment. the old segment is dropped by ofs_log_truncate when the checkpoint
+ * is on disk, so the log does not need a moment without modifications.
+ */
+void ofs_log_checkpoint(container_handle_t *ct)
+{
+    ofs_log_t *log = ct->log;
+    uint64_t lsn = 0;
+
+    if (log == NULL)
+    {
+        return;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+    lsn = log->next_lsn - 1;
+
+    // the old segment may be needed until the last checkpoint is on disk
+    if (!log->old_pending && (log->file_size + log->buf_len != 0))
+    {
+        (void)log_write(ct, log, lsn, TRUE);
+        while (log->writing)
+        {
+            OS_COND_WAIT(&log->cond, &log->lock);
+        }
+
+        // the records after written_lsn are still in the buffer
+        if ((log->error == 0) && (log_rotate(ct, log) == 0))
+        {
+            lsn = log->written_lsn;
+        }
+    }
+
+    if (ct->sb.log_lsn != lsn)
+    {
+        ct->sb.log_lsn = lsn;
+        ct->flags |= FLAG_DIRTY;
+    }
+    OS_MUTEX_UNLOCK(&log->lock);
+}
+
+// the old segment is in the checkpoint on disk, drop its records
+static int32_t log_drop_old(container_handle_t *ct, ofs_log_t *log)
+{
+    char old_path[OFS_NAME_SIZE + sizeof(OFS_LOG_OLD_SUFFIX)];
+    void *hnd = NULL;
+    int32_t ret = 0;
+
+    log_get_path(ct, OFS_LOG_OLD_SUFFIX, old_path, sizeof(old_path));
+    ret = os_file_open(&hnd, old_path);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open the old redo log failed. path(%s) ret(%d)\n", old_path, ret);
+        return ret;
+    }
+
+    ret = os_file_resize(hnd, 0);
+    (void)os_file_close(hnd);
+    if (ret != 0)
+    {
+        LOG_ERROR("Drop the old redo log failed. path(%s) ret(%d)\n", old_path, ret);
+        return -FILE_IO_ERR_WRITE;
+    }
+
+    log->old_pending = FALSE;
+
+    return 0;
+}
+
+// drop the records in the checkpoint on disk, the old segment is dropped,
+// and so is the current one if all its records are in the checkpoint
+int32_t ofs_log_truncate(container_handle_t *ct)
+{
+    ofs_log_t *log = ct->log;
+    int32_t ret = 0;
+
+    // the super block with the log_lsn is not on disk, the failed checkpoint
+    // needs all the records
+    if ((log == NULL) || (ct->flags & FLAG_DIRTY))
+    {
+        return 0;
+    }
+
+    OS_MUTEX_LOCK(&log->lock);
+
+    while (log->writing)
+    {
+        OS_COND_WAIT(&log->cond, &log->lock);
+    }
+
+    if (log->old_pending && (log->old_lsn <= ct->sb.log_lsn))
+    {
+        ret = log_drop_old(ct, log);
+    }
+
+    if ((ret == 0) && (log->file_hnd != NULL) && (log->next_lsn - 1 == ct->sb.log_lsn))
+    {
+        log->buf_len = 0;
+        if (log->file_size != 0)
+        { // the stream may still buffer the old records
+            ret = os_file_flush(log->file_hnd);
+            if (ret == 0)
+            {
+                ret = os_file_resize(log->file_hnd, 0);
+            }
+        }
+
+        if (ret == 0)
+        {
+            log->file_size = 0;
+            log->written_lsn = ct->sb.log_lsn;
+            log->synced_lsn = ct->sb.log_lsn;
+            log->error = 0;
+        }
+        else
+        {
+            LOG_ERROR("Truncate the redo log failed. ct(%s) ret(%d)\n", ct->name, ret);
+            ret = -FILE_IO_ERR_WRITE;
+        }
+    }
+
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    return ret;
+}
+
+static int32_t replay_record(container_handle_t *ct, ofs_log_record_t *rec, object_handle_t **obj)
+{
+    uint8_t *key = (uint8_t *)(rec + 1);
+    uint8_t *value = key + rec->key_len;
+    uint16_t flags = 0;
+    int32_t ret = 0;
+
+    if ((*obj != NULL) && ((*obj)->obj_info->objid != rec->objid))
+    {
+        (void)ofs_close_object_nolock(*obj);
+        *obj = NULL;
+    }
+
+    if (rec->op == OFS_LOG_CREATE_OBJ)
+    {
+        if ((*obj != NULL) || (rec->value_len != sizeof(uint16_t)))
+        {
+            LOG_ERROR("The record is invalid. objid(%lld) lsn(%lld)\n", rec->objid, rec->lsn);
+            return -INDEX_ERR_FORMAT;
+        }
+
+        // the replay may run again on the partly replayed container
+        memcpy(&flags, value, sizeof(uint16_t));
+        ret = ofs_create_object_nolock(ct, rec->objid, flags, obj);
+        return (ret == -INDEX_ERR_OBJ_EXIST) ? 0 : ret;
+    }
+
+    if (*obj == NULL)
+    {
+        ret = ofs_open_object_nolock(ct, rec->objid, 0, obj);
+        if (ret < 0)
+        {
+            LOG_ERROR("Open obj failed. objid(%lld) lsn(%lld) ret(%d)\n", rec->objid, rec->lsn, ret);
+            return ret;
+        }
+    }
+
+    switch (rec->op)
+    {
+        case OFS_LOG_INSERT_KEY:
+        {
+            ret = index_upsert_key_nolock(*obj, key, rec->key_len, value, rec->value_len);
+
+            break;
+        }
+
+        case OFS_LOG_REMOVE_KEY:
+        {
+            ret = index_remove_key_nolock(*obj, key, rec->key_len);
+            if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+            {
+                ret = 0;
+            }
+
+            break;
+        }
+
+        default:
+        {
+            LOG_ERROR("The op is invalid. objid(%lld) lsn(%lld) op(%d)\n", rec->objid, rec->lsn, rec->op);
+            ret = -INDEX_ERR_FORMAT;
+            break;
+        }
+    }
+
+    return ret;
+}
+
+// the length of the intact record at offset, or 0
+static uint32_t log_record_len(uint8_t *buf, uint64_t offset, uint64_t size)
+{
+    ofs_log_record_t *rec = (ofs_log_record_t *)(buf + offset);
+    uint32_t len = 0;
+
+    if (offset + sizeof(ofs_log_record_t) > size)
+    {
+        return 0;
+    }
+
+    len = OFS_LOG_RECORD_SIZE(rec->key_len, rec->value_len);
+    if ((rec->magic != OFS_LOG_MAGIC) || (offset + len > size)
+        || (rec->crc != os_crc32(0, &rec->lsn, len - OS_OFFSET(ofs_log_record_t, lsn))))
+    {
+        return 0;
+    }
+
+    return len;
+}
+
+// all the records of the transaction begun by rec reached the file
+static bool_t log_txn_intact(uint8_t *buf, uint64_t offset, uint64_t size, ofs_log_record_t *rec)
+{
+    ofs_log_record_t *next = NULL;
+    uint64_t lsn = rec->lsn;
+    uint32_t num = 0;
+    uint32_t len = 0;
+    uint32_t i = 0;
+
+    if (rec->value_len != sizeof(uint32_t))
+    {
+        return FALSE;
+    }
+
+    memcpy(&num, (uint8_t *)(rec + 1) + rec->key_len, sizeof(uint32_t));
+    offset += OFS_LOG_RECORD_SIZE(rec->key_len, rec->value_len);
+
+    for (i = 0; i < num; i++)
+    {
+        len = log_record_len(buf, offset, size);
+        next = (ofs_log_record_t *)(buf + offset);
+        if ((len == 0) || (next->lsn != ++lsn))
+        {
+            return FALSE;
+        }
+
+        offset += len;
+    }
+
+    return TRUE;
+}
+
+/*
+ * apply the records after the checkpoint in the file to the container. the
+ * file is read in windows of OFS_LOG_BUF_SIZE bytes, no record or transaction
+ * is larger than it. a torn or corrupted record ends the file, the records
+ * after it were never synced, so does the transaction not wholly in the file.
+ */
+static int32_t log_replay_file(container_handle_t *ct, ofs_log_t *log, void *hnd,
+    int64_t size, object_handle_t **obj, uint32_t *records)
+{
+    ofs_log_record_t *rec = NULL;
+    uint8_t *buf = log->write_buf;  // not used until the replay is finished
+    uint64_t start = 0;             // the file offset of the window
+    uint32_t win = 0;               // the bytes in the window
+    uint64_t offset = 0;            // the file offset of the record
+    uint32_t len = 0;
+    bool_t intact = FALSE;
+    int32_t ret = 0;
+
+    while (offset < (uint64_t)size)
+    {
+        len = log_record_len(buf, offset - start, win);
+        rec = (ofs_log_record_t *)(buf + (offset - start));
+        intact = (len != 0) ? TRUE : FALSE;
+        if (intact && (rec->lsn == log->next_lsn) && (rec->op == OFS_LOG_TXN_BEGIN))
+        {
+            intact = log_txn_intact(buf, offset - start, win, rec);
+        }
+
+        if (!intact)
+        {
+            if ((offset == start) && (win != 0))
+            { // the window begins with it, it is broken
+                break;
+            }
+
+            // the record may be cut by the end of the window
+            start = offset;
+            win = OFS_LOG_BUF_SIZE;
+            if ((uint64_t)size - offset < win)
+            {
+                win = (uint32_t)((uint64_t)size - offset);
+            }
+
+            if (os_file_pread(hnd, buf, win, start) != (int32_t)win)
+            {
+                LOG_ERROR("Read the redo log failed. ct(%s) offset(%lld) len(%d)\n", ct->name, start, win);
+                return -FILE_IO_ERR_READ;
+            }
+
+            continue;
+        }
+
+        if (rec->lsn > ct->sb.log_lsn)
+        { // the records in the checkpoint are skipped
+            if (rec->lsn != log->next_lsn)
+            {
+                break;
+            }
+
+            if (rec->op != OFS_LOG_TXN_BEGIN)
+            {
+                ret = replay_record(ct, rec, obj);
+                if (ret < 0)
+                {
+                    LOG_ERROR("Replay the record failed. ct(%s) lsn(%lld) ret(%d)\n", ct->name, rec->lsn, ret);
+                    return ret;
+                }
+
+                (*records)++;
+            }
+
+            log->next_lsn++;
+        }
+
+        offset += len;
+    }
+
+    return 0;
+}
+
+/*
+ * apply the records after the checkpoint in the old segment and then in the
+ * current one. all the records are idempotent, so they can be applied again
+ * after a failed replay.
+ */
+static int32_t log_replay(container_handle_t *ct, ofs_log_t *log)
+{
+    char old_path[OFS_NAME_SIZE + sizeof(OFS_LOG_OLD_SUFFIX)];
+    object_handle_t *obj = NULL;
+    void *old_hnd = NULL;
+    int64_t old_size = 0;
+    int64_t size = 0;
+    uint32_t records = 0;
+    int32_t ret = 0;
+
+    size = os_file_get_size(log->file_hnd);
+    if (size < 0)
+    {
+        return (int32_t)size;
+    }
+
+    log_get_path(ct, OFS_LOG_OLD_SUFFIX, old_path, sizeof(old_path));
+    if (os_file_exist(old_path) == 0)
+    {
+        ret = os_file_open(&old_hnd, old_path);
+        if (ret < 0)
+        {
+            LOG_ERROR("Open the old redo log failed. path(%s) ret(%d)\n", old_path, ret);
+            return ret;
+        }
+
+        old_size = os_file_get_size(old_hnd);
+    }
+
+    if ((old_size == 0) && (size == 0))
+    {
+        if (old_hnd != NULL)
+        {
+            (void)os_file_close(old_hnd);
+        }
+
+        return 0;
+    }
+
+    log->replaying = TRUE;
+
+    if (old_size < 0)
+    {
+        ret = (int32_t)old_size;
+    }
+    else if (old_size > 0)
+    {
+        ret = log_replay_file(ct, log, old_hnd, old_size, &obj, &records);
+    }
+
+    if ((ret >= 0) && (size > 0))
+    {
+        ret = log_replay_file(ct, log, log->file_hnd, size, &obj, &records);
+    }
+
+    if (obj != NULL)
+    {
+        (void)ofs_close_object_nolock(obj);
+    }
+
+    if (old_hnd != NULL)
+    {
+        (void)os_file_close(old_hnd);
+    }
+
+    log->replaying = FALSE;
+    log->written_lsn = log->next_lsn - 1;
+    log->synced_lsn = log->next_lsn - 1;
+
+    // dropped with the garbage tail by the checkpoint
+    log->file_size = (uint64_t)size;
+    log->old_pending = (old_size > 0) ? TRUE : FALSE;
+    log->old_lsn = log->next_lsn - 1;
+
+    LOG_INFO("Replay the redo log. ct(%s) size(%lld) old_size(%lld) records(%d) last_lsn(%lld) ret(%d)\n",
+        ct->name, size, old_size, records, log->next_lsn - 1, ret);
+
+    return ret;
+}
+
+int32_t ofs_log_create(container_handle_t *ct)
+{
+    char path[OFS_NAME_SIZE + sizeof(OFS_LOG_OLD_SUFFIX)];
+    ofs_log_t *log = NULL;
+    int32_t ret = 0;
+
+    log = alloc_log(ct);
+    if (log == NULL)
+    {
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    // the log of the old container with the same name is dropped
+    log_get_path(ct, OFS_LOG_OLD_SUFFIX, path, sizeof(path));
+    if (os_file_exist(path) == 0)
+    {
+        log->old_pending = TRUE;
+        ret = log_drop_old(ct, log);
+        if (ret < 0)
+        {
+            free_log(log);
+            return ret;
+        }
+    }
+
+    log_get_path(ct, OFS_LOG_SUFFIX, path, sizeof(path));
+    ret = os_file_create(&log->file_hnd, path);
+    if (ret < 0)
+    {
+        LOG_ERROR("Create the redo log failed. path(%s) ret(%d)\n", path, ret);
+        free_log(log);
+        return ret;
+    }
+
+    ct->log = log;
+
+    return 0;
+}
+
+int32_t ofs_log_open(container_handle_t *ct)
+{
+    char path[OFS_NAME_SIZE + sizeof(OFS_LOG_SUFFIX)];
+    ofs_log_t *log = NULL;
+    int32_t ret = 0;
+
+    log = alloc_log(ct);
+    if (log == NULL)
+    {
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    log_get_path(ct, OFS_LOG_SUFFIX, path, sizeof(path));
+    ret = os_file_open_or_create(&log->file_hnd, path);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open the redo log failed. path(%s) ret(%d)\n", path, ret);
+        free_log(log);
+        return ret;
+    }
+
+    ct->log = log;
+
+    ret = log_replay(ct, log);
+    if (ret < 0)
+    { // keep the whole log for the next open
+        (void)os_file_close(log->file_hnd);
+        free_log(log);
+        ct->log = NULL;
+        return ret;
+    }
+
+    if ((log->file_size == 0) && !log->old_pending)
+    {
+        return 0;
+    }
+
+    // checkpoint the replayed modifications, so the log can be dropped
+    ret = commit_container_modification(ct);
+    if (ret >= 0)
+    {
+        ret = ofs_log_truncate(ct);
+    }
+
+    return ret;
+}
+
+// the records not in the checkpoint are kept in the file for the next open
+void ofs_log_close(container_handle_t *ct)
+{
+    ofs_log_t *log = ct->log;
+
+    if (log == NULL)
+    {
+        return;
+    }
+
+    (void)ofs_log_truncate(ct);
+
+    OS_MUTEX_LOCK(&log->lock);
+    (void)log_write(ct, log, log->next_lsn - 1, TRUE);
+    OS_MUTEX_UNLOCK(&log->lock);
+
+    if (log->file_hnd != NULL)
+    {
+        (void)os_file_close(log->file_hnd);
+    }
+    free_log(log);
+    ct->log = NULL;
+}
@@ -82,6 +82,147 @@ void remove_obj_cache(object_info_t *obj_info, ofs_block_cache_t *cache)
 }
 
 
+// detach the cache from its parent's links
+static void detach_parent_cache(ofs_block_cache_t *cache)
+{
+    ofs_cache_link_t *link = NULL;
+
+    if (cache->parent == NULL)
+    {
+        return;
+    }
+
+    link = &cache->parent->links[cache->parent_slot];
+    if (link->cache == cache)
+    {
+        link->cache = NULL;
+    }
+
+    cache->parent = NULL;
+}
+
+// get the child cache linked at the position, the vbn must be the same
+ofs_block_cache_t *get_child_cache(ofs_block_cache_t *parent, uint32_t pos, uint64_t vbn)
+{
+    ofs_cache_link_t *link = NULL;
+
+    ASSERT(parent != NULL);
+
+    if (parent->links == NULL)
+    {
+        return NULL;
+    }
+
+    link = &parent->links[CACHE_LINK_SLOT(pos)];
+    if ((link->cache == NULL) || (link->pos != pos) || (link->cache->vbn != vbn))
+    {
+        return NULL;
+    }
+
+    return link->cache;
+}
+
+void link_child_cache(ofs_block_cache_t *parent, uint32_t pos, ofs_block_cache_t *child)
+{
+    ofs_cache_link_t *link = NULL;
+    uint32_t slot = CACHE_LINK_SLOT(pos);
+
+    ASSERT(parent != NULL);
+    ASSERT(child != NULL);
+
+    if (parent->links == NULL)
+    {
+        parent->links = OS_MALLOC(sizeof(ofs_cache_link_t) * CACHE_LINK_NUM);
+        if (parent->links == NULL)
+        { // the links is only a shortcut, ignore it
+            return;
+        }
+
+        memset(parent->links, 0, sizeof(ofs_cache_link_t) * CACHE_LINK_NUM);
+    }
+
+    link = &parent->links[slot];
+    if ((link->cache != NULL) && (link->cache != child))
+    {
+        link->cache->parent = NULL;
+    }
+
+    detach_parent_cache(child);
+
+    link->pos = pos;
+    link->cache = child;
+    child->parent = parent;
+    child->parent_slot = slot;
+}
+
+// the entries in parent moved, drop all the links
+void invalidate_child_caches(ofs_block_cache_t *parent)
+{
+    uint32_t i = 0;
+
+    ASSERT(parent != NULL);
+
+    if (parent->links == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < CACHE_LINK_NUM; i++)
+    {
+        if (parent->links[i].cache != NULL)
+        {
+            parent->links[i].cache->parent = NULL;
+            parent->links[i].cache = NULL;
+        }
+    }
+}
+
+// the entries in src had been copied to dst at the same position
+void move_child_caches(ofs_block_cache_t *dst, ofs_block_cache_t *src)
+{
+    uint32_t i = 0;
+
+    ASSERT(dst != NULL);
+    ASSERT(src != NULL);
+
+    invalidate_child_caches(dst);
+    if (dst->links != NULL)
+    {
+        OS_FREE(dst->links);
+    }
+
+    dst->links = src->links;
+    src->links = NULL;
+
+    if (dst->links == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < CACHE_LINK_NUM; i++)
+    {
+        if (dst->links[i].cache != NULL)
+        {
+            dst->links[i].cache->parent = dst;
+        }
+    }
+}
+
+// the cache will be freed, break all the links with it
+void unlink_cache(ofs_block_cache_t *cache)
+{
+    ASSERT(cache != NULL);
+
+    detach_parent_cache(cache);
+    invalidate_child_caches(cache);
+
+    if (cache->links != NULL)
+    {
+        OS_FREE(cache->links);
+        cache->links = NULL;
+    }
+}
+
 void change_obj_cache_vbn(object_info_t *obj_info, ofs_block_cache_t *cache, uint64_t new_vbn)
 {
     remove_obj_cache(obj_info, cache);
@@ -114,25 +255,266 @@ ofs_block_cache_t *alloc_obj_cache(object_info_t *obj_info, uint64_t vbn, uint32
 
     SET_CACHE_EMPTY(cache);
     cache->vbn = vbn;
+    cache->links = NULL;
+    cache->parent = NULL;
+    cache->parent_slot = 0;
+    list_init_head(&cache->dirty_entry);
+    cache->pinned = NULL;
     
     insert_obj_cache(obj_info, cache);
 
     return cache;
 }
 
-void free_obj_cache(object_info_t *obj_info, ofs_block_cache_t *cache)
+// an entry not in any list points to itself
+static void remove_dirty_cache(container_handle_t *ct, ofs_block_cache_t *cache)
 {
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    if (cache->dirty_entry.next != &cache->dirty_entry)
+    {
+        list_del(&cache->dirty_entry);
+        list_init_head(&cache->dirty_entry);
+        ct->dirty_cache_num--;
+    }
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
+}
+
+// the root block is recorded by its object, the others by themselves
+void set_cache_dirty(object_info_t *obj_info, ofs_block_cache_t *cache)
+{
+    container_handle_t *ct = NULL;
+
     ASSERT(obj_info != NULL);
     ASSERT(cache != NULL);
+
+    if (CACHE_DIRTY(cache))
+    {
+        return;
+    }
+
+    ct = obj_info->ct;
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    if (cache == &obj_info->root_cache)
+    {
+        if (obj_info->dirty_entry.next == &obj_info->dirty_entry)
+        {
+            list_add_tail(&ct->dirty_objs, &obj_info->dirty_entry);
+            ct->dirty_obj_num++;
+        }
+    }
+    else if (cache->dirty_entry.next == &cache->dirty_entry)
+    {
+        list_add_tail(&ct->dirty_caches, &cache->dirty_entry);
+        ct->dirty_cache_num++;
+    }
+
+    SET_CACHE_DIRTY(cache);
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
+}
+
+void remove_dirty_object(object_info_t *obj_info)
+{
+    container_handle_t *ct = NULL;
+
+    ASSERT(obj_info != NULL);
+
+    ct = obj_info->ct;
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    if (obj_info->dirty_entry.next != &obj_info->dirty_entry)
+    {
+        list_del(&obj_info->dirty_entry);
+        list_init_head(&obj_info->dirty_entry);
+        ct->dirty_obj_num--;
+    }
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
+}
+
+// pin the buffer of the cache, the caller holds the attr_lock of the object.
+// every pin holds the container, so that it is not closed before unpinned
+ofs_pinned_block_t *pin_cache(object_info_t *obj_info, ofs_block_cache_t *cache)
+{
+    container_handle_t *ct = NULL;
+    ofs_pinned_block_t *pb = NULL;
+
+    ASSERT(obj_info != NULL);
+    ASSERT(cache != NULL);
+
+    ct = obj_info->ct;
+    OS_RWLOCK_WRLOCK(&ct->pin_lock);
+    pb = cache->pinned;
+    if (pb == NULL)
+    {
+        pb = OS_MALLOC(sizeof(ofs_pinned_block_t));
+        if (pb == NULL)
+        {
+            OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+            LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_pinned_block_t));
+            return NULL;
+        }
+
+        pb->buf = cache->ib;
+        pb->ref_cnt = 0;
+        pb->cache = cache;
+        pb->obj_info = obj_info;
+        pb->ct = ct;
+        list_add_tail(&ct->pinned_caches, &pb->entry);
+        ct->pinned_cache_num++;
+        cache->pinned = pb;
+    }
+
+    pb->ref_cnt++;
+    OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+    hold_container(ct);
+
+    return pb;
+}
+
+// the data not in a block cache of its own is pinned by a private copy
+ofs_pinned_block_t *pin_copy(container_handle_t *ct, const void *data, uint32_t size)
+{
+    ofs_pinned_block_t *pb = NULL;
+
+    ASSERT(ct != NULL);
+
+    pb = OS_MALLOC(sizeof(ofs_pinned_block_t) + size);
+    if (pb == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_pinned_block_t) + size);
+        return NULL;
+    }
+
+    pb->buf = pb + 1;
+    memcpy(pb->buf, data, size);
+    pb->ref_cnt = 1;
+    pb->cache = NULL;
+    pb->obj_info = NULL;
+    pb->ct = ct;
+    list_init_head(&pb->entry);
+    hold_container(ct);
+
+    return pb;
+}
+
+// the pins are released without the attr_lock of the object
+void unpin_block(ofs_pinned_block_t *pb)
+{
+    container_handle_t *ct = NULL;
+
+    ASSERT(pb != NULL);
+    ASSERT(pb->ref_cnt != 0);
+
+    ct = pb->ct;
+    OS_RWLOCK_WRLOCK(&ct->pin_lock);
+    if (--pb->ref_cnt != 0)
+    {
+        OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+        (void)ofs_close_container(ct);
+        return;
+    }
+
+    if (pb->cache != NULL)
+    { // the cache keeps using the buffer
+        pb->cache->pinned = NULL;
+        list_del(&pb->entry);
+        ct->pinned_cache_num--;
+    }
+    else if (pb->buf != (void *)(pb + 1))
+    { // the buffer left by the cache
+        OS_FREE(pb->buf);
+    }
     
-    remove_obj_cache(obj_info, cache);
+    OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+    OS_FREE(pb);
+    (void)ofs_close_container(ct);
+}
+
+// leave the buffer to the pins, the caller holds the pin_lock
+static void detach_pinned_block(container_handle_t *ct, ofs_pinned_block_t *pb)
+{
+    pb->cache->pinned = NULL;
+    pb->cache = NULL;
+    pb->obj_info = NULL;
+    list_del(&pb->entry);
+    list_init_head(&pb->entry);
+    ct->pinned_cache_num--;
+}
+
+// give the pinned caches of the object a copy of their buffers before they
+// are modified, the caller holds the attr_lock of the object
+int32_t unshare_pinned_caches(object_info_t *obj_info)
+{
+    container_handle_t *ct = NULL;
+    ofs_pinned_block_t *pb = NULL;
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
+    block_head_t *ib = NULL;
+    int32_t ret = 0;
+
+    ASSERT(obj_info != NULL);
+
+    ct = obj_info->ct;
+    if (ct->pinned_cache_num == 0)
+    { // only the pins of this object matter, and nobody can add them now
+        return 0;
+    }
+    
+    OS_RWLOCK_WRLOCK(&ct->pin_lock);
+    list_for_each_safe(pos, n, &ct->pinned_caches)
+    {
+        pb = list_entry(pos, ofs_pinned_block_t, entry);
+        if (pb->obj_info != obj_info)
+        {
+            continue;
+        }
+
+        ib = OS_MALLOC(ct->sb.block_size);
+        if (ib == NULL)
+        {
+            LOG_ERROR("Allocate memory failed. size(%d)\n", ct->sb.block_size);
+            ret = -INDEX_ERR_ALLOCATE_MEMORY;
+            break;
+        }
+
+        memcpy(ib, pb->cache->ib, ct->sb.block_size);
+        pb->cache->ib = ib;
+        detach_pinned_block(ct, pb);
+        OFS_COUNT(&ct->counters, OFS_CNT_PIN_UNSHARE, 1);
+    }
+    OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+
+    return ret;
+}
+
+// the buffer of a freed cache is freed by the last pin
+static void free_cache_buffer(container_handle_t *ct, ofs_block_cache_t *cache)
+{
+    if (cache->pinned != NULL)
+    {
+        OS_RWLOCK_WRLOCK(&ct->pin_lock);
+        if (cache->pinned != NULL)
+        {
+            detach_pinned_block(ct, cache->pinned);
+            cache->ib = NULL;
+        }
+        OS_RWLOCK_WRUNLOCK(&ct->pin_lock);
+    }
     
     if (cache->ib)
     {
         OS_FREE(cache->ib);
         cache->ib = NULL;
     }
+}
+
+void free_obj_cache(object_info_t *obj_info, ofs_block_cache_t *cache)
+{
+    ASSERT(obj_info != NULL);
+    ASSERT(cache != NULL);
     
+    remove_obj_cache(obj_info, cache);
+    remove_dirty_cache(obj_info->ct, cache);
+    unlink_cache(cache);
+    free_cache_buffer(obj_info->ct, cache);
     OS_FREE(cache);
 
 }
@@ -208,13 +590,9 @@ void free_container_cache(container_handle_t *ct, ofs_block_cache_t *cache)
     }
 
     avl_remove(&ct->metadata_cache, cache);
-    
-    if (cache->ib)
-    {
-        OS_FREE(cache->ib);
-        cache->ib = NULL;
-    }
-    
+    remove_dirty_cache(ct, cache);
+    unlink_cache(cache);
+    free_cache_buffer(ct, cache);
     OS_FREE(cache);
 
 }
@@ -231,6 +609,16 @@ int32_t flush_container_dirty_cache(container_handle_t *ct, ofs_block_cache_t *c
         return 0;
     }
 
+    // the snapshots refer the blocks written before them
+    if (cache->ib->blk_id == INDEX_MAGIC)
+    {
+        IB(cache->ib)->birth = (uint32_t)ct->sb.snapshot_no;
+    }
+    else if (cache->ib->blk_id == INODE_MAGIC)
+    {
+        ((inode_record_t *)cache->ib)->snapshot_no = ct->sb.snapshot_no;
+    }
+
     ret = ofs_update_block_fixup(ct, cache->ib, cache->vbn);
     if (ret != (int32_t)cache->ib->alloc_size)
     {
@@ -254,15 +642,129 @@ int32_t flush_container_dirty_cache(container_handle_t *ct, ofs_block_cache_t *c
     return 0;
 }
 
+static int compare_dirty_cache(const void *a, const void *b)
+{
+    const ofs_block_cache_t *cache_a = *(ofs_block_cache_t * const *)a;
+    const ofs_block_cache_t *cache_b = *(ofs_block_cache_t * const *)b;
+
+    if (cache_a->vbn > cache_b->vbn)
+    {
+        return 1;
+    }
+
+    if (cache_a->vbn < cache_b->vbn)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+// write the dirty caches only, in vbn order to keep the writes sequential
+static int32_t flush_dirty_caches(container_handle_t *ct)
+{
+    ofs_block_cache_t **caches = NULL;
+    ofs_block_cache_t *cache = NULL;
+    list_head_t dirty;
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
+    uint32_t num = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    // take them away, the flushed caches of the closed objects are freed
+    list_init_head(&dirty);
+    OS_RWLOCK_WRLOCK(&ct->metadata_cache_lock);
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    list_for_each_safe(pos, n, &ct->dirty_caches)
+    {
+        list_del(pos);
+        list_add_tail(&dirty, pos);
+        num++;
+    }
+    ct->dirty_cache_num = 0;
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
+
+    if (num != 0)
+    {
+        caches = OS_MALLOC(sizeof(ofs_block_cache_t *) * num);
+        if (caches == NULL)
+        {
+            // no memory for sorting, write them in the order they became dirty
+            LOG_WARN("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_block_cache_t *) * num);
+        }
+    }
+
+    num = 0;
+    list_for_each_safe(pos, n, &dirty)
+    {
+        cache = list_entry(pos, ofs_block_cache_t, dirty_entry);
+        list_del(pos);
+        list_init_head(pos);
+        if (caches != NULL)
+        {
+            caches[num++] = cache;
+            continue;
+        }
+        
+        ret = flush_container_dirty_cache(ct, cache);
+        if (ret < 0)
+        {
+            list_add_head(&dirty, pos);
+            break;
+        }
+    }
+
+    if (caches != NULL)
+    {
+        qsort(caches, num, sizeof(ofs_block_cache_t *), compare_dirty_cache);
+
+        for (i = 0; i < num; i++)
+        {
+            ret = flush_container_dirty_cache(ct, caches[i]);
+            if (ret < 0)
+            {
+                break;
+            }
+        }
+
+        for (; i < num; i++)
+        {
+            list_add_tail(&dirty, &caches[i]->dirty_entry);
+        }
+
+        OS_FREE(caches);
+    }
+
+    // keep the unwritten ones for the next checkpoint
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    list_for_each_safe(pos, n, &dirty)
+    {
+        list_del(pos);
+        list_add_tail(&ct->dirty_caches, pos);
+        ct->dirty_cache_num++;
+    }
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
+    OS_RWLOCK_WRUNLOCK(&ct->metadata_cache_lock);
+
+    return ret;
+}
+
 int32_t flush_container_cache(container_handle_t *ct)
 {
     int32_t ret = 0;
+    uint64_t start = 0;
     
     ASSERT(ct != NULL);
 
-    OS_RWLOCK_WRLOCK(&ct->metadata_cache_lock);
-    avl_walk_all(&ct->metadata_cache, (avl_walk_cb_t)flush_container_dirty_cache, ct);
-    OS_RWLOCK_WRUNLOCK(&ct->metadata_cache_lock);
+    start = OFS_STAT_START();
+    ret = flush_dirty_caches(ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Flush the dirty caches failed, keep the old super block. ct(%p) ret(%d)\n", ct, ret);
+        OFS_STAT_END(OFS_STAT_FLUSH_CACHE, start);
+        return ret;
+    }
 
     if (ct->flags & FLAG_DIRTY)
     {
@@ -274,89 +776,137 @@ int32_t flush_container_cache(container_handle_t *ct)
         
         ct->sb.base_blk = ct->base_blk;
 
+        // the super block must not reach the device before the blocks it points to
+        if (ct->durability != OFS_DURABILITY_NONE)
+        {
+            ret = os_disk_sync(ct->disk_hnd);
+            if (ret < 0)
+            {
+                LOG_ERROR("Sync the blocks failed, keep the old super block. ct(%p) ret(%d)\n", ct, ret);
+                OFS_STAT_END(OFS_STAT_FLUSH_CACHE, start);
+                return ret;
+            }
+        }
+
+        // keep FLAG_DIRTY, the log_lsn in it is not durable
         ret = ofs_update_super_block(ct);
         if (ret < 0)
         {
             LOG_ERROR("Update super block failed. ct(%p) ret(%d)\n", ct, ret);
+            OFS_STAT_END(OFS_STAT_FLUSH_CACHE, start);
+            return ret;
         }
 
         ct->flags &= ~FLAG_DIRTY;
     }
 
+    OFS_STAT_END(OFS_STAT_FLUSH_CACHE, start);
+
 	return 0;
 }
 
-int32_t clean_obj_root_cache(container_handle_t *ct, object_info_t *obj_info)
+int32_t clean_all_obj_root_cache(container_handle_t *ct)
 {
+    object_info_t *obj_info = NULL;
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
+    
     ASSERT(ct != NULL);
-    ASSERT(obj_info != NULL);
 
-    if (CACHE_DIRTY(&obj_info->root_cache))
+    OS_RWLOCK_WRLOCK(&ct->dirty_lock);
+    list_for_each_safe(pos, n, &ct->dirty_objs)
     {
+        obj_info = list_entry(pos, object_info_t, dirty_entry);
         SET_CACHE_CLEAN(&obj_info->root_cache);
+        list_del(&obj_info->dirty_entry);
+        list_init_head(&obj_info->dirty_entry);
     }
-    
-    return 0;
-}
-
-int32_t clean_all_obj_root_cache(container_handle_t *ct)
-{
-    ASSERT(ct != NULL);
-
-    OS_RWLOCK_WRLOCK(&ct->ct_lock);
-    avl_walk_all(&ct->obj_info_list, (avl_walk_cb_t)clean_obj_root_cache, ct);
-    OS_RWLOCK_WRUNLOCK(&ct->ct_lock);
+    ct->dirty_obj_num = 0;
+    OS_RWLOCK_WRUNLOCK(&ct->dirty_lock);
 
     return 0;
 }
 
 void validate_obj_inode(object_info_t *obj_info);
 
-int32_t validate_one_user_object(void *para, object_info_t *obj_info)
+/*
+ * the modifications are stopped during the checkpoint, so the dirty objects
+ * are walked without dirty_lock, which validate_obj_inode takes itself.
+ * validating a user object may dirty the system objects, they are appended
+ * at the tail and validated later.
+ */
+static void validate_dirty_objects(container_handle_t *ct, bool_t system)
 {
-    ASSERT(obj_info != NULL);
+    object_info_t *obj_info = NULL;
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
 
-    if (obj_info->objid < RESERVED_OBJ_ID) // ignore the system object
+    list_for_each_safe(pos, n, &ct->dirty_objs)
     {
-        return 0;
+        obj_info = list_entry(pos, object_info_t, dirty_entry);
+        if ((obj_info->objid < RESERVED_OBJ_ID) == system)
+        {
+            validate_obj_inode(obj_info);
+        }
     }
-
-    validate_obj_inode(obj_info);
-    return 0;
 }
 
-
-int32_t validate_one_system_object(void *para, object_info_t *obj_info)
+// the caller holds the op_lock exclusively, or no one else uses the ct
+int32_t commit_container_modification_nolock(container_handle_t *ct)
 {
-    ASSERT(obj_info != NULL);
+    uint64_t start = os_get_ns_count();
+    int32_t ret = 0;
 
-    if (obj_info->objid >= RESERVED_OBJ_ID)  // ignore the user object
-    {
-        return -1; // break;
+    validate_dirty_objects(ct, FALSE);
+
+    // no read view begins on the last checkpoint once its blocks are released,
+    // the new ones wait for this checkpoint to be published
+    OS_RWLOCK_WRLOCK(&ct->view_lock);
+
+    // nothing is allocated after it, so the checkpoint does not reuse them.
+    // it may move the root of the space object, validate the system objects then
+    release_pending_blocks(ct, get_oldest_read_view(ct));
+    validate_dirty_objects(ct, TRUE);
+    ofs_log_checkpoint(ct);
+    ret = flush_container_cache(ct);
+    if (ret >= 0)
+    { // the checkpoint survives the crash of the process, or the system if required
+        ret = ofs_flush_disk(ct);
+        if (ret < 0)
+        { // write the super block again, the redo log is kept until then
+            ct->flags |= FLAG_DIRTY;
+        }
     }
 
-    validate_obj_inode(obj_info);
-    return 0;
-}
+    if (ret < 0)
+    { // the dirty ones are kept, and so is the redo log until a checkpoint is written
+        OS_RWLOCK_WRUNLOCK(&ct->view_lock);
+        LOG_ERROR("Write the checkpoint failed. ct(%s) ret(%d)\n", ct->name, ret);
+        return ret;
+    }
 
-int32_t validate_all_objects(container_handle_t *ct)
-{
-    ASSERT(ct != NULL);
-    
-    // validate all object
-    avl_walk_all(&ct->obj_info_list, (avl_walk_cb_t)validate_one_user_object, NULL);
-    avl_walk_all(&ct->obj_info_list, (avl_walk_cb_t)validate_one_system_object, NULL);
+    clean_all_obj_root_cache(ct);
 
-    return 0;
+    // the read views begun from now on read this checkpoint, it is on disk
+    ct->commit_objid_inode_no = ct->sb.objid_inode_no;
+    ct->commit_seq++;
+    OS_RWLOCK_WRUNLOCK(&ct->view_lock);
+
+    OFS_COUNT(&ct->counters, OFS_CNT_CHECKPOINT, 1);
+    OFS_COUNT(&ct->counters, OFS_CNT_CHECKPOINT_NS, os_get_ns_count() - start);
+
+	return 0;
 }
 
 int32_t commit_container_modification(container_handle_t *ct)
 {
-    validate_all_objects(ct);
-    flush_container_cache(ct);
-    clean_all_obj_root_cache(ct);
+    int32_t ret = 0;
 
-	return 0;
+    OS_RWLOCK_WRLOCK(&ct->op_lock);
+    ret = commit_container_modification_nolock(ct);
+    OS_RWLOCK_WRUNLOCK(&ct->op_lock);
+
+    return ret;
 }
 
 int32_t release_container_all_cache(container_handle_t *ct)
@@ -370,63 +920,105 @@ int32_t release_container_all_cache(container_handle_t *ct)
     return 0;
 }
 
-int32_t index_block_read2(object_info_t *obj_info, uint64_t vbn, uint32_t blk_id,
-    ofs_block_cache_t **cache_out)
+// look up the block in the caches, the caller holds the caches_lock of the object
+static ofs_block_cache_t *find_obj_cache(object_info_t *obj_info, uint64_t vbn)
 {
-    int32_t ret = 0;
     ofs_block_cache_t *cache = NULL;
+    container_handle_t *ct = obj_info->ct;
     avl_index_t where = 0;
-    container_handle_t *ct;
-
-    ASSERT(obj_info != NULL);
 
-    ct = obj_info->ct;
-    
-    OS_RWLOCK_WRLOCK(&obj_info->caches_lock);
     cache = avl_find(&obj_info->caches, (avl_find_fn_t)compare_cache2, &vbn, &where);
     if (cache) // block already in the obj cache
     {
-        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
-        *cache_out = cache;
-        return 0;
+        return cache;
     }
     
     OS_RWLOCK_RDLOCK(&ct->metadata_cache_lock);
     cache = avl_find(&ct->metadata_cache, (avl_find_fn_t)compare_cache2, &vbn, &where);
+    OS_RWLOCK_RDUNLOCK(&ct->metadata_cache_lock);
     if (cache) // block already in the container cache
     {
-        OS_RWLOCK_RDUNLOCK(&ct->metadata_cache_lock);
+        CLEAR_CACHE_FLUSH(cache);          // the object is opened again
         avl_add(&obj_info->caches, cache); // add to object
-        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+    }
+
+    return cache;
+}
+
+// the block is read without the caches_lock, so the readers of other blocks
+// are not blocked by the disk
+int32_t index_block_read2(object_info_t *obj_info, uint64_t vbn, uint32_t blk_id,
+    ofs_block_cache_t **cache_out)
+{
+    int32_t ret = 0;
+    ofs_block_cache_t *cache = NULL;
+    container_handle_t *ct;
+    block_head_t *ib = NULL;
+    uint64_t start = 0;
+
+    ASSERT(obj_info != NULL);
+
+    ct = obj_info->ct;
+    
+    OS_RWLOCK_WRLOCK(&obj_info->caches_lock);
+    cache = find_obj_cache(obj_info, vbn);
+    OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+    if (cache)
+    {
+        OFS_COUNT_OBJ(obj_info, OFS_CNT_CACHE_HIT, 1);
         *cache_out = cache;
         return 0;
     }
-    OS_RWLOCK_RDUNLOCK(&ct->metadata_cache_lock);
 
-    cache = alloc_obj_cache(obj_info, vbn, blk_id);
-    if (!cache)
+    start = OFS_STAT_START();
+    ib = OS_MALLOC(ct->sb.block_size);
+    if (!ib)
     {
-        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
-        LOG_ERROR("Allocate cache failed.\n");
+        LOG_ERROR("Allocate memory failed. size(%d)\n", ct->sb.block_size);
         *cache_out = NULL;
         return -INDEX_ERR_ALLOCATE_MEMORY;
     }
     
-    ret = ofs_read_block_fixup(obj_info->ct, cache->ib, vbn, blk_id, obj_info->ct->sb.block_size);
+    ret = ofs_read_block_fixup(ct, ib, vbn, blk_id, ct->sb.block_size);
     if (ret < 0)
     {   // Read the block
         LOG_ERROR("Read ct block failed. objid(%lld) vbn(%lld) size(%d) ret(%d)\n",
-            obj_info->objid, vbn, obj_info->ct->sb.block_size, ret);
-        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+            obj_info->objid, vbn, ct->sb.block_size, ret);
+        OS_FREE(ib);
         *cache_out = NULL;
         return ret;
     }
 
     LOG_DEBUG("Read ct block success. objid(%lld) vbn(%lld) size(%d)\n",
-        obj_info->objid, vbn, obj_info->ct->sb.block_size);
+        obj_info->objid, vbn, ct->sb.block_size);
+
+    OS_RWLOCK_WRLOCK(&obj_info->caches_lock);
+    cache = find_obj_cache(obj_info, vbn);
+    if (cache)
+    { // read by others meanwhile
+        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+        OS_FREE(ib);
+        OFS_COUNT_OBJ(obj_info, OFS_CNT_CACHE_HIT, 1);
+        *cache_out = cache;
+        return 0;
+    }
+
+    cache = alloc_obj_cache(obj_info, vbn, blk_id);
+    if (!cache)
+    {
+        OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+        LOG_ERROR("Allocate cache failed.\n");
+        OS_FREE(ib);
+        *cache_out = NULL;
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
 
+    OS_FREE(cache->ib);
+    cache->ib = ib;
     SET_CACHE_CLEAN(cache);
     OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+    OFS_STAT_END(OFS_STAT_BLOCK_READ_MISS, start);
+    OFS_COUNT_OBJ(obj_info, OFS_CNT_CACHE_MISS, 1);
 
     *cache_out = cache;
     return 0;
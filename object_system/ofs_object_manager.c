@@ -92,6 +92,8 @@ int32_t get_object_info(container_handle_t *ct, uint64_t objid, object_info_t **
     obj_info->objid = objid;
     
     list_init_head(&obj_info->obj_hnd_list);
+    list_init_head(&obj_info->dirty_entry);
+    list_init_head(&obj_info->root_cache.dirty_entry);
     OS_RWLOCK_INIT(&obj_info->obj_hnd_lock);
     
     OS_RWLOCK_INIT(&obj_info->attr_lock);
@@ -116,7 +118,9 @@ void put_object_info(object_info_t *obj_info)
     LOG_INFO("destroy object info start. objid(%lld)\n", obj_info->objid);
 
     avl_remove(&obj_info->ct->obj_info_list, obj_info);
+    remove_dirty_object(obj_info);
 
+    unlink_cache(&obj_info->root_cache);
     release_obj_all_cache(obj_info);
     avl_destroy(&obj_info->caches);
     
@@ -178,11 +182,33 @@ int32_t recover_obj_inode(object_info_t *obj_info, uint64_t inode_no)
     obj_info->inode_no = inode_no;
     strncpy(obj_info->name, obj_info->inode->name, obj_info->inode->name_size);
     init_attr(obj_info, inode_no);
-    SET_INODE_CLEAN(obj_info);
 
     return 0;
 }
 
+/*
+ * the inode_no is kept in a fixed size value of $OBJID and updated in its
+ * block, so the $OBJID blocks are relocated once in a checkpoint however
+ * many objects are validated. the shorter value written by the old version
+ * is resized there too
+ */
+static void update_objid_inode_no(container_handle_t *ct, uint64_t objid, uint64_t inode_no)
+{
+    uint8_t key_str[U64_MAX_SIZE];
+    uint16_t key_size;
+    int32_t ret;
+
+    key_size = os_u64_to_bstr(objid, key_str);
+
+    OS_RWLOCK_WRLOCK(&ct->id_obj->obj_info->attr_lock);
+    ret = update_value_internal(ct->id_obj, key_str, key_size, &inode_no, sizeof(inode_no));
+    OS_RWLOCK_WRUNLOCK(&ct->id_obj->obj_info->attr_lock);
+    if (ret < 0)
+    {
+        LOG_ERROR("Update the inode_no failed. objid(%lld) inode_no(%lld) ret(%d)\n", objid, inode_no, ret);
+    }
+}
+
 void validate_obj_inode(object_info_t *obj_info)
 {
     uint64_t new_vbn;
@@ -224,17 +250,16 @@ void validate_obj_inode(object_info_t *obj_info)
             break;
         }
             
-        default:
+        case SNAPSHOT_OBJ_ID:
         {
-            uint8_t key_str[U64_MAX_SIZE];
-            uint8_t value_str[U64_MAX_SIZE];
-            uint16_t key_size;
-            uint16_t value_size;
-            
-            key_size = os_u64_to_bstr(obj_info->objid, key_str);
-            value_size = os_u64_to_bstr(new_vbn, value_str);
+            sb->snapshot_inode_no = obj_info->inode_no;
+            obj_info->ct->flags |= FLAG_DIRTY;
+            break;
+        }
             
-            index_update_value(obj_info->ct->id_obj, key_str, key_size, value_str, value_size);
+        default:
+        {
+            update_objid_inode_no(obj_info->ct, obj_info->objid, new_vbn);
             break;
         }
     }
@@ -334,7 +359,7 @@ int32_t create_object_at_inode(container_handle_t *ct, uint64_t objid, uint64_t
     strncpy(obj_info->name, obj_info->inode->name, obj_info->inode->name_size);
     init_attr(obj_info, inode_no);
     SET_INODE_DIRTY(obj_info);
-    SET_CACHE_DIRTY(&obj_info->root_cache);
+    SET_ROOT_DIRTY(obj_info);
 
     LOG_DEBUG("Create inode success. obj_id(%lld) vbn(%lld)\n", objid, inode_no);
 
@@ -421,9 +446,40 @@ uint64_t get_objid(container_handle_t *ct)
     return 1;
 }
 
+// the committed inode is referred by the checkpoint, the snapshots and the
+// read views, it must be written to a new block
+static int32_t relocate_committed_inode(object_info_t *obj_info)
+{
+    container_handle_t *ct = obj_info->ct;
+    uint64_t old_vbn = obj_info->root_cache.vbn;
+    uint64_t new_vbn = 0;
+    int32_t ret = 0;
+
+    if (CACHE_DIRTY(&obj_info->root_cache) || CACHE_DIRTY(obj_info->inode_cache))
+    {
+        return 0;
+    }
+
+    ret = OFS_ALLOC_BLOCK(ct, obj_info->objid, &new_vbn);
+    if (ret < 0)
+    {
+        LOG_ERROR("Allocate new block failed. objid(%lld) ret(%d)\n", obj_info->objid, ret);
+        return ret;
+    }
+
+    OS_RWLOCK_WRLOCK(&obj_info->caches_lock);
+    obj_info->root_cache.vbn = new_vbn;
+    change_obj_cache_vbn(obj_info, obj_info->inode_cache, new_vbn);
+    OS_RWLOCK_WRUNLOCK(&obj_info->caches_lock);
+    SET_ROOT_DIRTY(obj_info);
+
+    return ofs_free_block_born(ct, obj_info->objid, old_vbn, obj_info->inode->snapshot_no);
+}
+
 int32_t ofs_set_object_name(object_handle_t *obj, char *name)
 {
     uint32_t name_size;
+    int32_t ret;
     
     ASSERT(obj != NULL);
     ASSERT(name != NULL);
@@ -434,6 +490,17 @@ int32_t ofs_set_object_name(object_handle_t *obj, char *name)
         return -INDEX_ERR_PARAMETER;
     }
 
+    if (obj->ct->flags & FLAG_READONLY)
+    {
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    ret = relocate_committed_inode(obj->obj_info);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
     strncpy(obj->obj_info->name, name, name_size);
     strncpy(obj->obj_info->inode->name, name, name_size);
     obj->obj_info->inode->name_size = name_size;
@@ -461,6 +528,12 @@ int32_t ofs_create_object_nolock(container_handle_t *ct, uint64_t objid, uint16_
         return -INDEX_ERR_OBJ_ID_INVALID;
     }
 
+    if (ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
     LOG_INFO("Create the obj start. objid(%lld)\n", objid);
 
     obj_info = avl_find(&ct->obj_info_list, (avl_find_fn_t)compare_object2, &objid, &where);
@@ -491,7 +564,7 @@ int32_t ofs_create_object_nolock(container_handle_t *ct, uint64_t objid, uint16_
     }
 
     ret = index_insert_key_nolock(ct->id_obj, &objid, os_u64_size(objid),
-        &obj->obj_info->inode_no, os_u64_size(obj->obj_info->inode_no));
+        &obj->obj_info->inode_no, sizeof(obj->obj_info->inode_no));
     if (ret < 0)
     {
         LOG_ERROR("Insert obj failed. obj(%p) objid(%lld) ret(%d)\n", obj, objid, ret);
@@ -499,6 +572,14 @@ int32_t ofs_create_object_nolock(container_handle_t *ct, uint64_t objid, uint16_
         close_object(obj->obj_info);
         return ret;
     }
+
+    ret = ofs_log_append(ct, OFS_LOG_CREATE_OBJ, objid, NULL, 0, &flags, sizeof(flags));
+    if (ret < 0)
+    {
+        LOG_ERROR("Log the obj creation failed. obj(%p) objid(%lld) ret(%d)\n", obj, objid, ret);
+        close_object(obj->obj_info);
+        return ret;
+    }
     
     LOG_INFO("Create the obj success. objid(%lld) obj(%p) ct_name(%s)\n", objid, obj, ct->name);
 
@@ -517,9 +598,23 @@ int32_t ofs_create_object(container_handle_t *ct, uint64_t objid, uint16_t flags
         return -INDEX_ERR_PARAMETER;
     }
     
+    OS_RWLOCK_RDLOCK(&ct->op_lock);
     OS_RWLOCK_WRLOCK(&ct->ct_lock);
     ret = ofs_create_object_nolock(ct, objid, flags, obj);
     OS_RWLOCK_WRUNLOCK(&ct->ct_lock);
+    OS_RWLOCK_RDUNLOCK(&ct->op_lock);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ret = ofs_log_commit(ct);
+    if (ret < 0)
+    { // the obj may be lost in the crash
+        LOG_ERROR("Commit the obj failed. ct(%s) objid(%lld) ret(%d)\n", ct->name, objid, ret);
+        (void)ofs_close_object(*obj);
+        *obj = NULL;
+    }
     
     return ret;
 }    
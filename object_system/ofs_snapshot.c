@@ -0,0 +1,679 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SNAPSHOT.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_SNAPSHOT);
+#include "log.h"
+
+#define SNAPSHOT_KEY_SIZE       (1 + 8)
+#define DEADLIST_KEY_SIZE       (1 + 8 + 8)
+#define DEADLIST_BATCH          256
+
+// the blocks of the space managers and the snapshots are not in any snapshot
+#define OBJ_IN_SNAPSHOT(objid)  (((objid) != BASE_OBJ_ID) && ((objid) != SPACE_OBJ_ID) \
+                                    && ((objid) != SNAPSHOT_OBJ_ID))
+
+typedef struct snapshot_neighbors
+{
+    uint64_t snapshot_no;
+    uint64_t prev;
+    uint64_t next;
+    bool_t found;
+} snapshot_neighbors_t;
+
+typedef struct deadlist_entry
+{
+    uint64_t vbn;
+    uint64_t birth;
+} deadlist_entry_t;
+
+// big endian, the binary collation sorts them as numbers
+static void put_be64(uint8_t *b, uint64_t v)
+{
+    int32_t i = 0;
+
+    for (i = 7; i >= 0; i--)
+    {
+        b[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static uint64_t get_be64(const uint8_t *b)
+{
+    uint64_t v = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        v = (v << 8) | b[i];
+    }
+
+    return v;
+}
+
+static void make_snapshot_key(uint8_t *key, uint64_t snapshot_no)
+{
+    key[0] = OFS_SNAPSHOT_KEY;
+    put_be64(key + 1, snapshot_no);
+}
+
+static void make_deadlist_key(uint8_t *key, uint64_t epoch, uint64_t vbn)
+{
+    key[0] = OFS_DEADLIST_KEY;
+    put_be64(key + 1, epoch);
+    put_be64(key + 9, vbn);
+}
+
+static bool_t is_snapshot_key(object_handle_t *obj)
+{
+    return (obj->ie->key_len == SNAPSHOT_KEY_SIZE) && (GET_IE_KEY(obj->ie)[0] == OFS_SNAPSHOT_KEY);
+}
+
+static bool_t is_deadlist_key(object_handle_t *obj, uint64_t epoch)
+{
+    return (obj->ie->key_len == DEADLIST_KEY_SIZE) && (GET_IE_KEY(obj->ie)[0] == OFS_DEADLIST_KEY)
+        && (get_be64(GET_IE_KEY(obj->ie) + 1) == epoch);
+}
+
+int32_t open_snapshot_object(container_handle_t *ct)
+{
+    object_handle_t *obj = NULL;
+    int32_t ret = 0;
+
+    ASSERT(ct != NULL);
+
+    ct->last_snapshot = OFS_SNAPSHOT_NONE;
+    if (ct->sb.snapshot_inode_no == 0)
+    { // the snapshot was never taken
+        return 0;
+    }
+
+    ret = open_object(ct, ct->sb.snapshot_id, ct->sb.snapshot_inode_no, &obj);
+    if (ret < 0)
+    {
+        LOG_ERROR("Open snapshot object failed. ct_name(%s) ret(%d)\n", ct->name, ret);
+        return ret;
+    }
+
+    ct->snap_obj = obj;
+
+    // the records are sorted before the dead lists, the newest one is the last
+    ret = walk_tree(obj, INDEX_GET_FIRST);
+    while ((ret == 0) && is_snapshot_key(obj))
+    {
+        ct->last_snapshot = get_be64(GET_IE_KEY(obj->ie) + 1);
+        ret = walk_tree(obj, 0);
+    }
+
+    return 0;
+}
+
+static int32_t create_snapshot_object(container_handle_t *ct)
+{
+    object_handle_t *obj = NULL;
+    int32_t ret = 0;
+
+    OS_RWLOCK_WRLOCK(&ct->ct_lock);
+    ret = create_object(ct, SNAPSHOT_OBJ_ID, FLAG_SYSTEM | FLAG_TABLE | CR_BINARY | (CR_BINARY << 4), &obj);
+    OS_RWLOCK_WRUNLOCK(&ct->ct_lock);
+    if (ret < 0)
+    {
+        LOG_ERROR("Create snapshot object failed. ct_name(%s) ret(%d)\n", ct->name, ret);
+        return ret;
+    }
+
+    ofs_set_object_name(obj, SNAPSHOT_OBJ_NAME);
+    ct->sb.snapshot_inode_no = obj->obj_info->inode_no;
+    ct->sb.snapshot_id = obj->obj_info->inode->objid;
+    ct->snap_obj = obj;
+    ct->flags |= FLAG_DIRTY;
+
+    return 0;
+}
+
+#define PENDING_BLOCKS_INIT     1024
+
+// keep the committed block until no checkpoint or read view refers it
+int32_t ofs_free_block_later(container_handle_t *ct, uint64_t vbn)
+{
+    ofs_pending_block_t *pending = NULL;
+    uint32_t max = 0;
+
+    OS_RWLOCK_WRLOCK(&ct->pending_lock);
+    if (ct->pending_num == ct->pending_max)
+    {
+        max = (ct->pending_max == 0) ? PENDING_BLOCKS_INIT : (ct->pending_max * 2);
+        pending = OS_MALLOC(sizeof(ofs_pending_block_t) * max);
+        if (pending == NULL)
+        {
+            OS_RWLOCK_WRUNLOCK(&ct->pending_lock);
+            LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)(sizeof(ofs_pending_block_t) * max));
+            return -INDEX_ERR_ALLOCATE_MEMORY;
+        }
+
+        if (ct->pending != NULL)
+        {
+            memcpy(pending, ct->pending, sizeof(ofs_pending_block_t) * ct->pending_num);
+            OS_FREE(ct->pending);
+        }
+
+        ct->pending = pending;
+        ct->pending_max = max;
+    }
+
+    ct->pending[ct->pending_num].vbn = vbn;
+    ct->pending[ct->pending_num].commit_seq = ct->commit_seq;
+    ct->pending_num++;
+    OS_RWLOCK_WRUNLOCK(&ct->pending_lock);
+
+    return 0;
+}
+
+// called by the checkpoint after all the blocks are allocated, the blocks
+// are reusable once the checkpoint is written
+void release_pending_blocks(container_handle_t *ct, uint64_t oldest_view)
+{
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    if (ct->sm.space_obj == NULL)
+    { // the read only or closing ct
+        return;
+    }
+
+    OS_RWLOCK_WRLOCK(&ct->pending_lock);
+
+    // the blocks are in the order of commit_seq
+    while ((i < ct->pending_num) && (ct->pending[i].commit_seq < oldest_view))
+    {
+        ret = OFS_FREE_BLOCK(ct, OBJID_OBJ_ID, ct->pending[i].vbn);
+        if (ret < 0)
+        {
+            LOG_ERROR("Free pending block failed. ct_name(%s) vbn(%lld) ret(%d)\n",
+                ct->name, ct->pending[i].vbn, ret);
+        }
+
+        i++;
+    }
+
+    if (i != 0)
+    {
+        memmove(ct->pending, ct->pending + i, sizeof(ofs_pending_block_t) * (ct->pending_num - i));
+        ct->pending_num -= i;
+    }
+
+    OS_RWLOCK_WRUNLOCK(&ct->pending_lock);
+}
+
+void destroy_pending_blocks(container_handle_t *ct)
+{
+    if (ct->pending != NULL)
+    {
+        OS_FREE(ct->pending);
+        ct->pending = NULL;
+    }
+
+    ct->pending_num = 0;
+    ct->pending_max = 0;
+}
+
+// free the block never committed now, keep the one the newest snapshot still
+// refers in the dead list, and the others until the next checkpoint
+int32_t ofs_free_block_born(container_handle_t *ct, uint64_t objid, uint64_t vbn, uint64_t birth)
+{
+    uint8_t key[DEADLIST_KEY_SIZE];
+    object_handle_t *obj = ct->snap_obj;
+    int32_t ret = 0;
+
+    if ((birth == OFS_BIRTH_DIRTY) || !OBJ_IN_SNAPSHOT(objid))
+    {
+        return OFS_FREE_BLOCK(ct, objid, vbn);
+    }
+
+    if ((ct->last_snapshot == OFS_SNAPSHOT_NONE) || (birth > ct->last_snapshot))
+    {
+        return ofs_free_block_later(ct, vbn);
+    }
+
+    make_deadlist_key(key, ct->sb.snapshot_no, vbn);
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    ret = index_insert_key_nolock(obj, key, DEADLIST_KEY_SIZE, &birth, sizeof(birth));
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+    if (ret < 0)
+    {
+        LOG_ERROR("Insert dead block failed. ct_name(%s) objid(%lld) vbn(%lld) birth(%lld) ret(%d)\n",
+            ct->name, objid, vbn, birth, ret);
+        return ret;
+    }
+
+    OFS_COUNT(&ct->counters, OFS_CNT_DEFER_FREE, 1);
+
+    return 0;
+}
+
+static int32_t walk_snapshots_nolock(object_handle_t *obj, snapshot_cb_t cb, void *para)
+{
+    ofs_snapshot_record_t snap;
+    int32_t ret = 0;
+
+    ret = walk_tree(obj, INDEX_GET_FIRST);
+    while ((ret == 0) && is_snapshot_key(obj))
+    {
+        memcpy(&snap, GET_IE_VALUE(obj->ie), sizeof(snap));
+        ret = cb(para, &snap);
+        if (ret != 0)
+        {
+            return (ret < 0) ? ret : 0;
+        }
+
+        ret = walk_tree(obj, 0);
+    }
+
+    return 0;
+}
+
+// the records are walked in snapshot_no order, stop if cb returns non-zero
+int32_t ofs_walk_snapshots(container_handle_t *ct, snapshot_cb_t cb, void *para)
+{
+    object_handle_t *obj = NULL;
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (cb == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) cb(%p)\n", ct, cb);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    obj = ct->snap_obj;
+    if (obj == NULL)
+    {
+        return 0;
+    }
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    ret = walk_snapshots_nolock(obj, cb, para);
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    return ret;
+}
+
+int32_t ofs_get_snapshot(container_handle_t *ct, uint64_t snapshot_no, ofs_snapshot_record_t *snap)
+{
+    uint8_t key[SNAPSHOT_KEY_SIZE];
+    object_handle_t *obj = NULL;
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (snap == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) snap(%p)\n", ct, snap);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    obj = ct->snap_obj;
+    if (obj == NULL)
+    {
+        return -INDEX_ERR_KEY_NOT_FOUND;
+    }
+
+    make_snapshot_key(key, snapshot_no);
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    ret = index_search_key_nolock(obj, key, SNAPSHOT_KEY_SIZE, NULL, 0);
+    if (ret >= 0)
+    {
+        memcpy(snap, GET_IE_VALUE(obj->ie), sizeof(ofs_snapshot_record_t));
+    }
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    return ret;
+}
+
+// the caller holds the op_lock exclusively
+static int32_t create_snapshot_nolock(container_handle_t *ct, uint64_t *snapshot_no)
+{
+    uint8_t key[SNAPSHOT_KEY_SIZE];
+    ofs_snapshot_record_t snap;
+    object_handle_t *obj = NULL;
+    int32_t ret = 0;
+
+    if (ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct_name(%s)\n", ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    if (ct->sb.snapshot_no >= OFS_SNAPSHOT_MAX)
+    {
+        LOG_ERROR("Too many snapshots. ct_name(%s) snapshot_no(%lld)\n", ct->name, ct->sb.snapshot_no);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    // all the blocks of the snapshot are written with the births up to the epoch
+    ret = commit_container_nolock(ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Commit the ct failed. ct_name(%s) ret(%d)\n", ct->name, ret);
+        return ret;
+    }
+
+    if (ct->snap_obj == NULL)
+    {
+        ret = create_snapshot_object(ct);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    memset(&snap, 0, sizeof(snap));
+    snap.snapshot_no = ct->sb.snapshot_no;
+    snap.objid_inode_no = ct->sb.objid_inode_no;
+    snap.log_lsn = ct->sb.log_lsn;
+    make_snapshot_key(key, snap.snapshot_no);
+
+    obj = ct->snap_obj;
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    ret = index_insert_key_nolock(obj, key, SNAPSHOT_KEY_SIZE, &snap, sizeof(snap));
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+    if (ret < 0)
+    {
+        LOG_ERROR("Insert snapshot failed. ct_name(%s) snapshot_no(%lld) ret(%d)\n",
+            ct->name, snap.snapshot_no, ret);
+        return ret;
+    }
+
+    // the blocks written from now on are not in the snapshot
+    ct->sb.snapshot_no++;
+    ct->last_snapshot = snap.snapshot_no;
+    ct->flags |= FLAG_DIRTY;
+
+    ret = commit_container_nolock(ct);
+    if (ret < 0)
+    {
+        LOG_ERROR("Commit the snapshot failed. ct_name(%s) snapshot_no(%lld) ret(%d)\n",
+            ct->name, snap.snapshot_no, ret);
+        return ret;
+    }
+
+    LOG_INFO("Create the snapshot success. ct_name(%s) snapshot_no(%lld) objid_inode_no(%lld)\n",
+        ct->name, snap.snapshot_no, snap.objid_inode_no);
+
+    *snapshot_no = snap.snapshot_no;
+
+    return 0;
+}
+
+// take the snapshot of the checkpoint, the writers wait until it finished
+int32_t ofs_create_snapshot(container_handle_t *ct, uint64_t *snapshot_no)
+{
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (snapshot_no == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) snapshot_no(%p)\n", ct, snapshot_no);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    OS_RWLOCK_WRLOCK(&ct->op_lock);
+    ret = create_snapshot_nolock(ct, snapshot_no);
+    OS_RWLOCK_WRUNLOCK(&ct->op_lock);
+
+    return ret;
+}
+
+static int32_t get_neighbors(void *para, const ofs_snapshot_record_t *snap)
+{
+    snapshot_neighbors_t *nb = para;
+
+    if (snap->snapshot_no < nb->snapshot_no)
+    {
+        nb->prev = snap->snapshot_no;
+        return 0;
+    }
+
+    if (snap->snapshot_no == nb->snapshot_no)
+    {
+        nb->found = TRUE;
+        return 0;
+    }
+
+    nb->next = snap->snapshot_no;
+
+    return 1;
+}
+
+/*
+ * walk the dead list of the epoch from, the blocks born after the snapshot
+ * prev are not referred by anyone and freed, the others are moved to the
+ * dead list of the epoch to
+ */
+static int32_t merge_deadlist(container_handle_t *ct, uint64_t from, uint64_t to, uint64_t prev)
+{
+    object_handle_t *obj = ct->snap_obj;
+    deadlist_entry_t *entries = NULL;
+    uint8_t key[DEADLIST_KEY_SIZE];
+    uint64_t vbn = 0;
+    uint32_t cnt = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    entries = OS_MALLOC(sizeof(deadlist_entry_t) * DEADLIST_BATCH);
+    if (entries == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)(sizeof(deadlist_entry_t) * DEADLIST_BATCH));
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    for (;;)
+    {
+        // the tree is modified below, collect a batch first
+        make_deadlist_key(key, from, vbn);
+        ret = index_search_key_nolock(obj, key, DEADLIST_KEY_SIZE, NULL, 0);
+        if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+        {
+            ret = walk_tree(obj, INDEX_GET_CURRENT);
+        }
+
+        cnt = 0;
+        while ((ret == 0) && (cnt < DEADLIST_BATCH) && is_deadlist_key(obj, from))
+        {
+            entries[cnt].vbn = get_be64(GET_IE_KEY(obj->ie) + 9);
+            memcpy(&entries[cnt].birth, GET_IE_VALUE(obj->ie), sizeof(uint64_t));
+            cnt++;
+            ret = walk_tree(obj, 0);
+        }
+
+        if ((ret < 0) && (ret != -INDEX_ERR_ROOT) && (ret != -INDEX_ERR_KEY_NOT_FOUND))
+        {
+            LOG_ERROR("Walk the dead list failed. ct_name(%s) epoch(%lld) ret(%d)\n", ct->name, from, ret);
+            break;
+        }
+
+        ret = 0;
+        if (cnt == 0)
+        {
+            break;
+        }
+
+        for (i = 0; i < cnt; i++)
+        {
+            if ((prev != OFS_SNAPSHOT_NONE) && (entries[i].birth <= prev) && (from == to))
+            { // still referred by the previous snapshot
+                continue;
+            }
+
+            make_deadlist_key(key, from, entries[i].vbn);
+            ret = index_remove_key_nolock(obj, key, DEADLIST_KEY_SIZE);
+            if (ret < 0)
+            {
+                LOG_ERROR("Remove dead block failed. ct_name(%s) vbn(%lld) ret(%d)\n", ct->name, entries[i].vbn, ret);
+                break;
+            }
+
+            if ((prev == OFS_SNAPSHOT_NONE) || (entries[i].birth > prev))
+            {
+                ret = ofs_free_block_later(ct, entries[i].vbn);
+            }
+            else
+            {
+                make_deadlist_key(key, to, entries[i].vbn);
+                ret = index_insert_key_nolock(obj, key, DEADLIST_KEY_SIZE, &entries[i].birth, sizeof(uint64_t));
+            }
+
+            if (ret < 0)
+            {
+                LOG_ERROR("Release dead block failed. ct_name(%s) vbn(%lld) ret(%d)\n", ct->name, entries[i].vbn, ret);
+                break;
+            }
+        }
+
+        if (ret < 0)
+        {
+            break;
+        }
+
+        vbn = entries[cnt - 1].vbn + 1;
+    }
+
+    OS_FREE(entries);
+
+    return ret;
+}
+
+// the caller holds the op_lock exclusively
+static int32_t delete_snapshot_nolock(container_handle_t *ct, uint64_t snapshot_no)
+{
+    char name[OFS_NAME_SIZE];
+    uint8_t key[SNAPSHOT_KEY_SIZE];
+    snapshot_neighbors_t nb;
+    object_handle_t *obj = NULL;
+    uint64_t next = 0;
+    int32_t ret = 0;
+
+    if (ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct_name(%s)\n", ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    obj = ct->snap_obj;
+    if (obj == NULL)
+    {
+        return -INDEX_ERR_KEY_NOT_FOUND;
+    }
+
+    if ((get_version_name(name, ct->name, '@', snapshot_no) == 0) && (ofs_get_container_handle(name) != NULL))
+    {
+        LOG_ERROR("The snapshot is opened. ct_name(%s)\n", name);
+        return -INDEX_ERR_IS_OPENED;
+    }
+
+    nb.snapshot_no = snapshot_no;
+    nb.prev = OFS_SNAPSHOT_NONE;
+    nb.next = OFS_SNAPSHOT_NONE;
+    nb.found = FALSE;
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    (void)walk_snapshots_nolock(obj, get_neighbors, &nb);
+    if (!nb.found)
+    {
+        OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+        return -INDEX_ERR_KEY_NOT_FOUND;
+    }
+
+    make_snapshot_key(key, snapshot_no);
+    ret = index_remove_key_nolock(obj, key, SNAPSHOT_KEY_SIZE);
+    if (ret < 0)
+    {
+        OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+        LOG_ERROR("Remove snapshot failed. ct_name(%s) snapshot_no(%lld) ret(%d)\n", ct->name, snapshot_no, ret);
+        return ret;
+    }
+
+    if (ct->last_snapshot == snapshot_no)
+    {
+        ct->last_snapshot = nb.prev;
+    }
+
+    // the next dead list is the container's if it is the newest
+    next = (nb.next == OFS_SNAPSHOT_NONE) ? ct->sb.snapshot_no : nb.next;
+    ret = merge_deadlist(ct, next, next, nb.prev);
+    if (ret >= 0)
+    {
+        ret = merge_deadlist(ct, snapshot_no, next, nb.prev);
+    }
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Merge the dead lists failed. ct_name(%s) snapshot_no(%lld) ret(%d)\n", ct->name, snapshot_no, ret);
+        return ret;
+    }
+
+    // the freed blocks must not be reused before the snapshot is gone on disk
+    ret = commit_container_nolock(ct);
+
+    LOG_INFO("Delete the snapshot. ct_name(%s) snapshot_no(%lld) ret(%d)\n", ct->name, snapshot_no, ret);
+
+    return ret;
+}
+
+// free the blocks only referred by the snapshot, the writers wait until it
+// finished
+int32_t ofs_delete_snapshot(container_handle_t *ct, uint64_t snapshot_no)
+{
+    int32_t ret = 0;
+
+    if (ct == NULL)
+    {
+        LOG_ERROR("Invalid parameter. ct(%p)\n", ct);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    OS_RWLOCK_WRLOCK(&ct->op_lock);
+    ret = delete_snapshot_nolock(ct, snapshot_no);
+    OS_RWLOCK_WRUNLOCK(&ct->op_lock);
+
+    return ret;
+}
+
+EXPORT_SYMBOL(ofs_create_snapshot);
+EXPORT_SYMBOL(ofs_delete_snapshot);
+EXPORT_SYMBOL(ofs_walk_snapshots);
+EXPORT_SYMBOL(ofs_get_snapshot);
@@ -0,0 +1,548 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SNAPSHOT_DIFF.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_SNAPSHOT);
+#include "log.h"
+
+/*
+ * the two trees are walked together in key order. every entry of a node
+ * block is a token, the child block it points to is a subtree token and
+ * its key is a key token. the subtree token is only read when it can not
+ * be skipped, so the blocks shared by the two trees are never read.
+ */
+typedef enum diff_token
+{
+    DIFF_TOKEN_END = 0,
+    DIFF_TOKEN_KEY,
+    DIFF_TOKEN_SUBTREE
+} diff_token_t;
+
+typedef struct diff_level
+{
+    ofs_block_cache_t *cache;
+    index_entry_t *ie;          // the current entry
+    index_entry_t *low;         // the keys in the block are larger, NULL: unknown
+    bool_t child_done;          // the child of ie had been walked or skipped
+} diff_level_t;
+
+typedef struct diff_iter
+{
+    object_handle_t *obj;
+    uint16_t cr;
+    bool_t bplus;
+    bool_t root_pending;        // the root is not read yet
+    int32_t depth;              // -1: the walk is finished
+    uint32_t height;            // the levels of the tree
+    diff_level_t levels[TREE_MAX_DEPTH];
+} diff_iter_t;
+
+static int32_t read_child(diff_iter_t *it, diff_level_t *parent, ofs_block_cache_t **cache)
+{
+    uint32_t pos = (uint32_t)((uint8_t *)parent->ie - (uint8_t *)parent->cache->ib);
+    uint64_t vbn = GET_IE_VBN(parent->ie);
+    ofs_block_cache_t *child = NULL;
+    int32_t ret = 0;
+
+    child = get_child_cache(parent->cache, pos, vbn);
+    if (child != NULL)
+    {
+        *cache = child;
+        return 0;
+    }
+
+    ret = index_block_read2(it->obj->obj_info, vbn, INDEX_MAGIC, &child);
+    if (ret < 0)
+    {
+        LOG_ERROR("Read block failed. objid(%lld) vbn(%lld) ret(%d)\n", it->obj->obj_info->objid, vbn, ret);
+        return ret;
+    }
+
+    link_child_cache(parent->cache, pos, child);
+    *cache = child;
+
+    return 0;
+}
+
+static void push_level(diff_iter_t *it, ofs_block_cache_t *cache, index_entry_t *low)
+{
+    diff_level_t *level = &it->levels[++it->depth];
+
+    level->cache = cache;
+    level->ie = GET_FIRST_IE(cache->ib);
+    level->low = low;
+    level->child_done = FALSE;
+}
+
+// the height is found by the leftmost path, all the leaves are at the same level
+static int32_t init_diff_iter(diff_iter_t *it, object_handle_t *obj)
+{
+    ofs_block_cache_t *cache = NULL;
+    int32_t ret = 0;
+
+    memset(it, 0, sizeof(diff_iter_t));
+    it->depth = -1;
+    if (obj == NULL)
+    { // the object does not exist in this snapshot
+        return 0;
+    }
+
+    it->obj = obj;
+    it->cr = obj->obj_info->attr_record->flags & CR_MASK;
+    it->bplus = (obj->obj_info->attr_record->flags & FLAG_BPLUS_TREE) ? TRUE : FALSE;
+    it->root_pending = TRUE;
+
+    push_level(it, &obj->obj_info->root_cache, NULL);
+    it->height = 1;
+    while (IB(it->levels[it->depth].cache->ib)->node_type & INDEX_BLOCK_LARGE)
+    {
+        if (it->depth + 1 >= TREE_MAX_DEPTH)
+        {
+            LOG_ERROR("The tree is too deep. objid(%lld)\n", obj->obj_info->objid);
+            return -INDEX_ERR_FORMAT;
+        }
+
+        ret = read_child(it, &it->levels[it->depth], &cache);
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        push_level(it, cache, NULL);
+        it->height++;
+    }
+
+    it->depth = 0;
+
+    return 0;
+}
+
+// move to the next token, but do not read any block
+static diff_token_t peek_token(diff_iter_t *it)
+{
+    diff_level_t *level = NULL;
+
+    if (it->root_pending)
+    {
+        return DIFF_TOKEN_SUBTREE;
+    }
+
+    while (it->depth >= 0)
+    {
+        level = &it->levels[it->depth];
+        if ((IB(level->cache->ib)->node_type & INDEX_BLOCK_LARGE) && !level->child_done)
+        {
+            return DIFF_TOKEN_SUBTREE;
+        }
+
+        if (level->ie->flags & INDEX_ENTRY_END)
+        { // back to the parent, whose child is done
+            it->depth--;
+            continue;
+        }
+
+        if (it->bplus && (IB(level->cache->ib)->node_type & INDEX_BLOCK_LARGE))
+        { // the separators of b+ tree are not the keys
+            level->ie = GET_NEXT_IE(level->ie);
+            level->child_done = FALSE;
+            continue;
+        }
+
+        return DIFF_TOKEN_KEY;
+    }
+
+    return DIFF_TOKEN_END;
+}
+
+static index_entry_t *get_token_ie(diff_iter_t *it)
+{
+    return it->levels[it->depth].ie;
+}
+
+static uint64_t get_subtree_vbn(diff_iter_t *it)
+{
+    if (it->root_pending)
+    {
+        return it->obj->obj_info->root_cache.vbn;
+    }
+
+    return GET_IE_VBN(get_token_ie(it));
+}
+
+// the height of the subtree token
+static uint32_t get_subtree_height(diff_iter_t *it)
+{
+    if (it->root_pending)
+    {
+        return it->height;
+    }
+
+    return it->height - (uint32_t)it->depth - 1;
+}
+
+// the keys in the subtree token are larger than it
+static index_entry_t *get_subtree_low(diff_iter_t *it)
+{
+    diff_level_t *level = NULL;
+
+    if (it->root_pending)
+    {
+        return NULL;
+    }
+
+    level = &it->levels[it->depth];
+    if (level->ie == GET_FIRST_IE(level->cache->ib))
+    {
+        return level->low;
+    }
+
+    return GET_PREV_IE(level->ie);
+}
+
+static void skip_subtree(diff_iter_t *it)
+{
+    if (it->root_pending)
+    {
+        it->root_pending = FALSE;
+        it->depth = -1;
+        return;
+    }
+
+    it->levels[it->depth].child_done = TRUE;
+}
+
+static int32_t expand_subtree(diff_iter_t *it)
+{
+    ofs_block_cache_t *cache = NULL;
+    diff_level_t *level = NULL;
+    index_entry_t *low = NULL;
+    int32_t ret = 0;
+
+    if (it->root_pending)
+    {
+        it->root_pending = FALSE;
+        it->depth = 0;
+        return 0;
+    }
+
+    level = &it->levels[it->depth];
+    low = get_subtree_low(it);
+    ret = read_child(it, level, &cache);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    level->child_done = TRUE;
+    push_level(it, cache, low);
+
+    return 0;
+}
+
+static void next_key(diff_iter_t *it)
+{
+    diff_level_t *level = &it->levels[it->depth];
+
+    level->ie = GET_NEXT_IE(level->ie);
+    level->child_done = FALSE;
+}
+
+static int32_t compare_ie(uint16_t cr, index_entry_t *ie1, index_entry_t *ie2)
+{
+    return collate_key(cr, ie1, GET_IE_KEY(ie2), ie2->key_len, NULL, 0);
+}
+
+static bool_t value_changed(index_entry_t *old_ie, index_entry_t *new_ie)
+{
+    return (old_ie->value_len != new_ie->value_len)
+        || (memcmp(GET_IE_VALUE(old_ie), GET_IE_VALUE(new_ie), old_ie->value_len) != 0);
+}
+
+// the key token of it is less than all the keys in the subtree token of other
+static bool_t key_before_subtree(diff_iter_t *it, diff_iter_t *other)
+{
+    index_entry_t *low = get_subtree_low(other);
+
+    return (low != NULL) && (compare_ie(it->cr, get_token_ie(it), low) < 0);
+}
+
+static int32_t diff_trees(container_handle_t *ct, diff_iter_t *old_it, diff_iter_t *new_it,
+    snapshot_diff_cb_t cb, void *para)
+{
+    diff_token_t old_token = DIFF_TOKEN_END;
+    diff_token_t new_token = DIFF_TOKEN_END;
+    uint32_t old_height = 0;
+    uint32_t new_height = 0;
+    int32_t ret = 0;
+
+    for (;;)
+    {
+        old_token = peek_token(old_it);
+        new_token = peek_token(new_it);
+        if ((old_token == DIFF_TOKEN_END) && (new_token == DIFF_TOKEN_END))
+        {
+            return 0;
+        }
+
+        if ((old_token == DIFF_TOKEN_SUBTREE) && (new_token == DIFF_TOKEN_SUBTREE))
+        {
+            if (get_subtree_vbn(old_it) == get_subtree_vbn(new_it))
+            { // the same block, nothing changed in it
+                skip_subtree(old_it);
+                skip_subtree(new_it);
+                OFS_COUNT(&ct->counters, OFS_CNT_DIFF_SKIP, 1);
+                continue;
+            }
+
+            // the higher one may have the other in it
+            old_height = get_subtree_height(old_it);
+            new_height = get_subtree_height(new_it);
+            ret = (old_height >= new_height) ? expand_subtree(old_it) : 0;
+            if ((ret >= 0) && (new_height >= old_height))
+            {
+                ret = expand_subtree(new_it);
+            }
+        }
+        else if (old_token == DIFF_TOKEN_SUBTREE)
+        {
+            if ((new_token == DIFF_TOKEN_KEY) && key_before_subtree(new_it, old_it))
+            {
+                ret = cb(para, OFS_DIFF_INSERT, NULL, get_token_ie(new_it));
+                next_key(new_it);
+            }
+            else
+            {
+                ret = expand_subtree(old_it);
+            }
+        }
+        else if (new_token == DIFF_TOKEN_SUBTREE)
+        {
+            if ((old_token == DIFF_TOKEN_KEY) && key_before_subtree(old_it, new_it))
+            {
+                ret = cb(para, OFS_DIFF_REMOVE, get_token_ie(old_it), NULL);
+                next_key(old_it);
+            }
+            else
+            {
+                ret = expand_subtree(new_it);
+            }
+        }
+        else if (old_token == DIFF_TOKEN_END)
+        {
+            ret = cb(para, OFS_DIFF_INSERT, NULL, get_token_ie(new_it));
+            next_key(new_it);
+        }
+        else if (new_token == DIFF_TOKEN_END)
+        {
+            ret = cb(para, OFS_DIFF_REMOVE, get_token_ie(old_it), NULL);
+            next_key(old_it);
+        }
+        else
+        {
+            ret = compare_ie(old_it->cr, get_token_ie(old_it), get_token_ie(new_it));
+            if (ret < 0)
+            {
+                ret = cb(para, OFS_DIFF_REMOVE, get_token_ie(old_it), NULL);
+                next_key(old_it);
+            }
+            else if (ret > 0)
+            {
+                ret = cb(para, OFS_DIFF_INSERT, NULL, get_token_ie(new_it));
+                next_key(new_it);
+            }
+            else
+            {
+                ret = 0;
+                if (value_changed(get_token_ie(old_it), get_token_ie(new_it)))
+                {
+                    ret = cb(para, OFS_DIFF_CHANGE, get_token_ie(old_it), get_token_ie(new_it));
+                }
+
+                next_key(old_it);
+                next_key(new_it);
+            }
+        }
+
+        if (ret != 0)
+        { // error, or the caller stops the diff
+            return (ret < 0) ? ret : 0;
+        }
+    }
+}
+
+// OFS_SNAPSHOT_NONE is the container itself, the caller must stop modifying it
+static int32_t open_diff_object(container_handle_t *ct, uint64_t snapshot_no, uint64_t objid,
+    container_handle_t **snap_ct, object_handle_t **obj)
+{
+    int32_t ret = 0;
+
+    *snap_ct = NULL;
+    *obj = NULL;
+
+    if (snapshot_no != OFS_SNAPSHOT_NONE)
+    {
+        ret = ofs_open_snapshot(ct, snapshot_no, snap_ct);
+        if (ret < 0)
+        {
+            LOG_ERROR("Open snapshot failed. ct_name(%s) snapshot_no(%lld) ret(%d)\n", ct->name, snapshot_no, ret);
+            return ret;
+        }
+
+        ct = *snap_ct;
+    }
+
+    ret = ofs_open_object(ct, objid, obj);
+    if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+    { // created after the snapshot, or deleted before it
+        *obj = NULL;
+        return 0;
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Open obj failed. ct_name(%s) objid(%lld) ret(%d)\n", ct->name, objid, ret);
+        if (*snap_ct != NULL)
+        {
+            (void)ofs_close_container(*snap_ct);
+            *snap_ct = NULL;
+        }
+    }
+
+    return ret;
+}
+
+static void close_diff_object(container_handle_t *snap_ct, object_handle_t *obj)
+{
+    if (obj != NULL)
+    {
+        (void)ofs_close_object(obj);
+    }
+
+    if (snap_ct != NULL)
+    {
+        (void)ofs_close_container(snap_ct);
+    }
+}
+
+// report the keys of the object inserted, removed or changed from the
+// snapshot old_no to new_no, in the key order
+int32_t ofs_diff_snapshots(container_handle_t *ct, uint64_t objid, uint64_t old_no, uint64_t new_no,
+    snapshot_diff_cb_t cb, void *para)
+{
+    container_handle_t *old_ct = NULL;
+    container_handle_t *new_ct = NULL;
+    object_handle_t *old_obj = NULL;
+    object_handle_t *new_obj = NULL;
+    diff_iter_t *its = NULL;
+    int32_t ret = 0;
+
+    if ((ct == NULL) || (cb == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) cb(%p)\n", ct, cb);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    its = OS_MALLOC(sizeof(diff_iter_t) * 2);
+    if (its == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)(sizeof(diff_iter_t) * 2));
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    ret = open_diff_object(ct, old_no, objid, &old_ct, &old_obj);
+    if (ret < 0)
+    {
+        OS_FREE(its);
+        return ret;
+    }
+
+    ret = open_diff_object(ct, new_no, objid, &new_ct, &new_obj);
+    if (ret < 0)
+    {
+        close_diff_object(old_ct, old_obj);
+        OS_FREE(its);
+        return ret;
+    }
+
+    if ((old_obj == NULL) && (new_obj == NULL))
+    {
+        LOG_ERROR("The obj not found. ct_name(%s) objid(%lld)\n", ct->name, objid);
+        close_diff_object(new_ct, new_obj);
+        close_diff_object(old_ct, old_obj);
+        OS_FREE(its);
+        return -INDEX_ERR_KEY_NOT_FOUND;
+    }
+
+    if (old_obj != NULL)
+    {
+        OS_RWLOCK_WRLOCK(&old_obj->obj_info->attr_lock);
+    }
+
+    if ((new_obj != NULL) && ((old_obj == NULL) || (new_obj->obj_info != old_obj->obj_info)))
+    {
+        OS_RWLOCK_WRLOCK(&new_obj->obj_info->attr_lock);
+    }
+
+    ret = init_diff_iter(&its[0], old_obj);
+    if (ret >= 0)
+    {
+        ret = init_diff_iter(&its[1], new_obj);
+    }
+
+    if (ret >= 0)
+    {
+        ret = diff_trees(ct, &its[0], &its[1], cb, para);
+    }
+
+    if ((new_obj != NULL) && ((old_obj == NULL) || (new_obj->obj_info != old_obj->obj_info)))
+    {
+        OS_RWLOCK_WRUNLOCK(&new_obj->obj_info->attr_lock);
+    }
+
+    if (old_obj != NULL)
+    {
+        OS_RWLOCK_WRUNLOCK(&old_obj->obj_info->attr_lock);
+    }
+
+    close_diff_object(new_ct, new_obj);
+    close_diff_object(old_ct, old_obj);
+    OS_FREE(its);
+
+    return ret;
+}
+
+EXPORT_SYMBOL(ofs_diff_snapshots);
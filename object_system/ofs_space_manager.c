@@ -95,13 +95,6 @@ int32_t alloc_space(object_handle_t *obj, uint64_t start_blk, uint32_t blk_cnt,
     
     ASSERT(len != 0);
 
-    ret = tree_remove_ie(obj);
-    if (ret < 0)
-    {
-        LOG_ERROR("remove entry failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
-        return ret;
-    }
-        
     if (start_blk <= addr)
     {
         start_blk = addr;  // allocate from addr
@@ -110,19 +103,26 @@ int32_t alloc_space(object_handle_t *obj, uint64_t start_blk, uint32_t blk_cnt,
         *real_start_blk = addr;
         
         if (end_blk < end)
-        {
+        { // cut the head of the extent, it keeps its place in the tree
             addr_size = os_u64_to_bstr(end_blk, addr_str);
             len_size = os_u64_to_bstr(end - end_blk, len_str);
-            ret = index_insert_key_nolock(obj, addr_str, addr_size, len_str, len_size);
+            ret = tree_update_ie(obj, addr_str, addr_size, len_str, len_size);
             if (ret < 0)
             {
-                LOG_ERROR("insert key failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
+                LOG_ERROR("update entry failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
                 return ret;
             }
             
             return (uint32_t)(end_blk - addr);
         }
 
+        ret = tree_remove_ie(obj);
+        if (ret < 0)
+        {
+            LOG_ERROR("remove entry failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
+            return ret;
+        }
+        
         return len;
     }
 
@@ -131,13 +131,14 @@ int32_t alloc_space(object_handle_t *obj, uint64_t start_blk, uint32_t blk_cnt,
     end_blk = start_blk + blk_cnt;
     ASSERT(start_blk < end);
     *real_start_blk = start_blk;
-    
+
+    // cut the tail of the extent
     addr_size = os_u64_to_bstr(addr, addr_str);
     len_size = os_u64_to_bstr(start_blk - addr, len_str);
-    ret = index_insert_key_nolock(obj, addr_str, addr_size, len_str, len_size);
+    ret = tree_update_ie(obj, addr_str, addr_size, len_str, len_size);
     if (ret < 0)
     {
-        LOG_ERROR("insert key failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
+        LOG_ERROR("update entry failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
         return ret;
     }
     
@@ -229,16 +230,10 @@ int32_t free_space(object_handle_t *obj, uint64_t start_blk, uint32_t blk_cnt)
             }
             
             if ((addr + len) == start_blk)
-            {
-                ret = tree_remove_ie(obj);
-                if (ret < 0)
-                {
-                    LOG_ERROR("remove entry failed. objid(0x%llx) ret(%d)\n", obj->obj_info->objid, ret);
-                    return ret;
-                }
-            
-                start_blk = addr;
-                blk_cnt += len;
+            { // extend the prev extent where it is
+                addr_size = os_u64_to_bstr(addr, addr_str);
+                len_size = os_u64_to_bstr(len + blk_cnt, len_str);
+                return tree_update_ie(obj, addr_str, addr_size, len_str, len_size);
             }
         }
 
@@ -292,6 +287,7 @@ void ofs_destroy_sm(space_manager_t *sm)
 int32_t sm_alloc_space(space_manager_t *sm, uint32_t blk_cnt, uint64_t *real_start_blk)
 {
     int32_t ret;
+    uint64_t start = OFS_STAT_START();
 
     OS_RWLOCK_WRLOCK(&sm->lock);
     if (sm->total_free_blocks == 0)
@@ -328,6 +324,8 @@ int32_t sm_alloc_space(space_manager_t *sm, uint32_t blk_cnt, uint64_t *real_sta
     }
     
     OS_RWLOCK_WRUNLOCK(&sm->lock);
+    OFS_STAT_END(OFS_STAT_ALLOC_SPACE, start);
+    OFS_COUNT(&sm->space_obj->ct->counters, OFS_CNT_ALLOC_BLOCKS, ret);
 
     LOG_DEBUG("alloc space, obj_id: %lld, start_blk: %lld, blk_cnt: %d\n",
         sm->space_obj->obj_info->objid, *real_start_blk, blk_cnt);
@@ -344,6 +342,7 @@ int32_t sm_free_space(space_manager_t *sm, uint64_t start_blk, uint32_t blk_cnt)
     if (ret >= 0)
     {
         sm->total_free_blocks += blk_cnt;
+        OFS_COUNT(&sm->space_obj->ct->counters, OFS_CNT_FREE_BLOCKS, blk_cnt);
     }
     OS_RWLOCK_WRUNLOCK(&sm->lock);
 
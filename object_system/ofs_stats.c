@@ -0,0 +1,313 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_STATS.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_STATS);
+#include "log.h"
+
+static const char *g_stat_names[OFS_STAT_NUM]
+= {
+    "search_key", "insert_key", "remove_key", "update_value",
+    "block_read_miss", "flush_cache", "alloc_space"
+};
+
+const char *ofs_stat_name(uint32_t id)
+{
+    ASSERT(id < OFS_STAT_NUM);
+
+    return g_stat_names[id];
+}
+
+static const char *g_counter_names[OFS_CNT_NUM]
+= {
+    "cache_hit", "cache_miss", "split_ib", "reparent_root", "cow_relocate", "lock_wait_ns",
+    "block_read", "block_read_bytes", "block_write", "block_write_bytes",
+    "alloc_blocks", "free_blocks", "checkpoint", "checkpoint_ns",
+    "log_append", "log_bytes", "log_sync", "defer_free", "diff_skip",
+    "txn_commit", "txn_abort", "pin_unshare"
+};
+
+const char *ofs_counter_name(uint32_t id)
+{
+    ASSERT(id < OFS_CNT_NUM);
+
+    return g_counter_names[id];
+}
+
+uint64_t ofs_counter_get(const ofs_counters_t *counters, uint32_t id)
+{
+    uint64_t sum = 0;
+    uint32_t i = 0;
+
+    ASSERT(counters != NULL);
+    ASSERT(id < OFS_CNT_NUM);
+
+    for (i = 0; i < OFS_COUNTER_SLOTS; i++)
+    {
+        sum += counters->slots[i][id];
+    }
+
+    return sum;
+}
+
+#ifdef __KERNEL__
+
+void ofs_stat_record(uint32_t id, uint64_t ns)
+{
+}
+
+void ofs_stat_get(uint32_t id, histogram_t *hist)
+{
+    hist_init(hist);
+}
+
+void ofs_stat_reset(void)
+{
+}
+
+uint32_t ofs_thread_slot(void)
+{
+    return 0;
+}
+
+#else
+
+// the histograms recorded by one thread, only the owner thread writes them
+typedef struct ofs_thread_stats
+{
+    volatile uint32_t gen;           // the reset generation of the histograms
+    uint32_t slot;                   // the counter slot of the thread
+    struct ofs_thread_stats *next;
+    histogram_t hists[OFS_STAT_NUM];
+} ofs_thread_stats_t;
+
+typedef struct ofs_stats
+{
+    os_once_t once;
+    os_tls_key_t key;                // the stats of current thread
+    os_mutex_t lock;                 // protect threads and retired
+    volatile uint32_t gen;           // increased on reset
+    uint32_t slots;                  // the counter slots given out
+    ofs_thread_stats_t *threads;
+    histogram_t retired[OFS_STAT_NUM]; // merged from the exited threads
+} ofs_stats_t;
+
+static ofs_stats_t g_stats = {OS_ONCE_INIT};
+
+static void thread_stats_exit(void *para)
+{
+    ofs_thread_stats_t *stats = (ofs_thread_stats_t *)para;
+    ofs_thread_stats_t **prev = NULL;
+    uint32_t i = 0;
+
+    OS_MUTEX_LOCK(&g_stats.lock);
+
+    for (prev = &g_stats.threads; *prev != NULL; prev = &(*prev)->next)
+    {
+        if (*prev == stats)
+        {
+            *prev = stats->next;
+            break;
+        }
+    }
+
+    if (stats->gen == g_stats.gen)
+    {
+        for (i = 0; i < OFS_STAT_NUM; i++)
+        {
+            hist_merge(&g_stats.retired[i], &stats->hists[i]);
+        }
+    }
+
+    OS_MUTEX_UNLOCK(&g_stats.lock);
+
+    OS_FREE(stats);
+}
+
+static void init_stats(void)
+{
+    uint32_t i = 0;
+
+    OS_MUTEX_INIT(&g_stats.lock);
+
+    for (i = 0; i < OFS_STAT_NUM; i++)
+    {
+        hist_init(&g_stats.retired[i]);
+    }
+
+    if (OS_TLS_CREATE(&g_stats.key, thread_stats_exit) != 0)
+    {
+        LOG_ERROR("Create the stats key failed.\n");
+    }
+}
+
+static void clean_thread_stats(ofs_thread_stats_t *stats, uint32_t gen)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < OFS_STAT_NUM; i++)
+    {
+        hist_init(&stats->hists[i]);
+    }
+
+    // the readers skip the histograms until they are cleaned
+    smp_wmb();
+    stats->gen = gen;
+}
+
+static ofs_thread_stats_t *get_thread_stats(void)
+{
+    ofs_thread_stats_t *stats = NULL;
+
+    (void)OS_ONCE(&g_stats.once, init_stats);
+
+    stats = (ofs_thread_stats_t *)OS_TLS_GET(g_stats.key);
+    if (stats)
+    {
+        return stats;
+    }
+
+    stats = (ofs_thread_stats_t *)OS_MALLOC(sizeof(ofs_thread_stats_t));
+    if (!stats)
+    {
+        return NULL;
+    }
+
+    OS_MUTEX_LOCK(&g_stats.lock);
+    clean_thread_stats(stats, g_stats.gen);
+    stats->slot = (g_stats.slots++) % OFS_COUNTER_SLOTS;
+    stats->next = g_stats.threads;
+    g_stats.threads = stats;
+    OS_MUTEX_UNLOCK(&g_stats.lock);
+
+    if (OS_TLS_SET(g_stats.key, stats) != 0)
+    {
+        thread_stats_exit(stats);
+        return NULL;
+    }
+
+    return stats;
+}
+
+// the threads are spread over the counter slots in turn
+uint32_t ofs_thread_slot(void)
+{
+    ofs_thread_stats_t *stats = get_thread_stats();
+
+    return stats ? stats->slot : 0;
+}
+
+void ofs_stat_record(uint32_t id, uint64_t ns)
+{
+    ofs_thread_stats_t *stats = NULL;
+    uint32_t gen = 0;
+
+    ASSERT(id < OFS_STAT_NUM);
+
+    stats = get_thread_stats();
+    if (!stats)
+    {
+        return;
+    }
+
+    gen = g_stats.gen;
+    if (stats->gen != gen)
+    { // reset after the last record
+        clean_thread_stats(stats, gen);
+    }
+
+    hist_record(&stats->hists[id], ns);
+}
+
+// merge the histograms of all the threads, the histograms being recorded may
+// be a little stale, it is fine for the statistics
+void ofs_stat_get(uint32_t id, histogram_t *hist)
+{
+    ofs_thread_stats_t *stats = NULL;
+
+    ASSERT(id < OFS_STAT_NUM);
+    ASSERT(hist != NULL);
+
+    hist_init(hist);
+
+    (void)OS_ONCE(&g_stats.once, init_stats);
+
+    OS_MUTEX_LOCK(&g_stats.lock);
+
+    hist_merge(hist, &g_stats.retired[id]);
+
+    for (stats = g_stats.threads; stats != NULL; stats = stats->next)
+    {
+        if (stats->gen == g_stats.gen)
+        {
+            smp_rmb();
+            hist_merge(hist, &stats->hists[id]);
+        }
+    }
+
+    OS_MUTEX_UNLOCK(&g_stats.lock);
+}
+
+// the threads clean their own histograms on the next record
+void ofs_stat_reset(void)
+{
+    uint32_t i = 0;
+
+    (void)OS_ONCE(&g_stats.once, init_stats);
+
+    OS_MUTEX_LOCK(&g_stats.lock);
+
+    for (i = 0; i < OFS_STAT_NUM; i++)
+    {
+        hist_init(&g_stats.retired[i]);
+    }
+
+    g_stats.gen++;
+
+    OS_MUTEX_UNLOCK(&g_stats.lock);
+}
+
+#endif
+
+EXPORT_SYMBOL(ofs_stat_record);
+EXPORT_SYMBOL(ofs_stat_name);
+EXPORT_SYMBOL(ofs_stat_get);
+EXPORT_SYMBOL(ofs_stat_reset);
+EXPORT_SYMBOL(ofs_thread_slot);
+EXPORT_SYMBOL(ofs_counter_name);
+EXPORT_SYMBOL(ofs_counter_get);
+
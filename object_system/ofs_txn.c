@@ -0,0 +1,556 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_TXN.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_TXN);
+#include "log.h"
+
+// the OFS_LOG_TXN_BEGIN record is before the records of the write set
+#define TXN_LOG_MAX_SIZE    (OFS_LOG_BUF_SIZE - OFS_LOG_RECORD_SIZE(0, sizeof(uint32_t)))
+
+static int32_t compare_txn_op(const ofs_txn_op_t *op, const ofs_txn_op_t *target)
+{
+    uint16_t cr = 0;
+    int32_t ret = 0;
+
+    if (op->obj->obj_info->objid != target->obj->obj_info->objid)
+    {
+        return (op->obj->obj_info->objid > target->obj->obj_info->objid) ? 1 : -1;
+    }
+
+    cr = op->obj->obj_info->attr_record->flags & CR_MASK;
+    ret = collate_key(cr, (index_entry_t *)&op->ie, GET_IE_KEY(&target->ie), target->ie.key_len, NULL, 0);
+
+    return (ret > 0) ? 1 : ((ret < 0) ? -1 : 0);
+}
+
+static uint32_t get_op_log_size(ofs_txn_op_t *op)
+{
+    return OFS_LOG_RECORD_SIZE(op->ie.key_len, op->ie.value_len);
+}
+
+static void free_txn_op(ofs_txn_op_t *op)
+{
+    if (op->old_ie != NULL)
+    {
+        OS_FREE(op->old_ie);
+    }
+
+    OS_FREE(op);
+}
+
+static void free_txn(ofs_txn_t *txn)
+{
+    ofs_txn_op_t *op = NULL;
+    void *cookie = NULL;
+
+    while ((op = avl_destroy_nodes(&txn->write_set, &cookie)) != NULL)
+    {
+        free_txn_op(op);
+    }
+
+    avl_destroy(&txn->write_set);
+    OS_FREE(txn);
+}
+
+int32_t ofs_txn_begin(container_handle_t *ct, ofs_txn_t **txn)
+{
+    ofs_txn_t *tmp_txn = NULL;
+
+    if ((ct == NULL) || (txn == NULL))
+    {
+        LOG_ERROR("Invalid parameter. ct(%p) txn(%p)\n", ct, txn);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    if (ct->flags & FLAG_READONLY)
+    {
+        LOG_ERROR("The ct is read only. ct(%s)\n", ct->name);
+        return -INDEX_ERR_READ_ONLY;
+    }
+
+    tmp_txn = OS_MALLOC(sizeof(ofs_txn_t));
+    if (tmp_txn == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_txn_t));
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    memset(tmp_txn, 0, sizeof(ofs_txn_t));
+    tmp_txn->ct = ct;
+    avl_create(&tmp_txn->write_set, (int (*)(const void *, const void*))compare_txn_op, sizeof(ofs_txn_op_t),
+        OS_OFFSET(ofs_txn_op_t, entry));
+
+    *txn = tmp_txn;
+
+    return 0;
+}
+
+/*
+ * add the modification to the write set, the later one on the same key
+ * replaces the former one, and keeps the state it requires before the
+ * transaction. the state changed by the former one is checked here.
+ */
+static int32_t add_txn_op(ofs_txn_t *txn, object_handle_t *obj, uint8_t type, uint8_t check,
+    const void *key, uint16_t key_len, const void *value, uint16_t value_len)
+{
+    ofs_txn_op_t *op = NULL;
+    ofs_txn_op_t *old_op = NULL;
+    avl_index_t where = 0;
+    uint32_t log_size = 0;
+    uint16_t cr = 0;
+
+    if ((txn == NULL) || (obj == NULL) || (key == NULL) || (key_len == 0)
+        || ((value == NULL) && (value_len != 0)))
+    {
+        LOG_ERROR("Invalid parameter. txn(%p) obj(%p) key(%p) key_len(%d) value(%p) value_len(%d)\n",
+            txn, obj, key, key_len, value, value_len);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    // the key collated with the value can not be replaced by the key only
+    cr = obj->obj_info->attr_record->flags & CR_MASK;
+    if ((obj->ct != txn->ct) || (obj->obj_info->objid < RESERVED_OBJ_ID)
+        || !(obj->obj_info->attr_record->flags & FLAG_TABLE) || (cr >= CR_EXTENT))
+    {
+        LOG_ERROR("The object can not be modified by the transaction. ct(%s) objid(%lld) flags(0x%x)\n",
+            txn->ct->name, obj->obj_info->objid, obj->obj_info->attr_record->flags);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    op = OS_MALLOC(sizeof(ofs_txn_op_t) + key_len + value_len);
+    if (op == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_txn_op_t) + key_len + value_len);
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    memset(op, 0, sizeof(ofs_txn_op_t));
+    op->obj = obj;
+    op->op = type;
+    op->check = check;
+    op->ie.len = sizeof(index_entry_t) + key_len + value_len;
+    op->ie.key_len = key_len;
+    op->ie.value_len = value_len;
+    memcpy(GET_IE_KEY(&op->ie), key, key_len);
+    if (value_len != 0)
+    {
+        memcpy(GET_IE_VALUE(&op->ie), value, value_len);
+    }
+
+    log_size = txn->log_size + get_op_log_size(op);
+    old_op = avl_find(&txn->write_set, NULL, op, &where);
+    if (old_op != NULL)
+    {
+        if ((check == OFS_TXN_CHECK_ABSENT) && (old_op->op == OFS_TXN_PUT))
+        {
+            OS_FREE(op);
+            return -INDEX_ERR_KEY_EXIST;
+        }
+
+        if ((check == OFS_TXN_CHECK_PRESENT) && (old_op->op == OFS_TXN_REMOVE))
+        {
+            OS_FREE(op);
+            return -INDEX_ERR_KEY_NOT_FOUND;
+        }
+
+        op->check = old_op->check;
+        log_size -= get_op_log_size(old_op);
+    }
+
+    if (log_size > TXN_LOG_MAX_SIZE)
+    {
+        LOG_ERROR("The transaction is too large. ct(%s) op_num(%d) log_size(%d)\n",
+            txn->ct->name, txn->op_num, log_size);
+        OS_FREE(op);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    if (old_op != NULL)
+    {
+        avl_remove(&txn->write_set, old_op);
+        free_txn_op(old_op);
+        txn->op_num--;
+    }
+
+    avl_add(&txn->write_set, op);
+    txn->op_num++;
+    txn->log_size = log_size;
+
+    return 0;
+}
+
+int32_t ofs_txn_insert(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len)
+{
+    return add_txn_op(txn, obj, OFS_TXN_PUT, OFS_TXN_CHECK_ABSENT, key, key_len, value, value_len);
+}
+
+// insert the key, or replace the value of the existing key
+int32_t ofs_txn_update(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len,
+    const void *value, uint16_t value_len)
+{
+    return add_txn_op(txn, obj, OFS_TXN_PUT, OFS_TXN_CHECK_NONE, key, key_len, value, value_len);
+}
+
+int32_t ofs_txn_remove(ofs_txn_t *txn, object_handle_t *obj, const void *key, uint16_t key_len)
+{
+    return add_txn_op(txn, obj, OFS_TXN_REMOVE, OFS_TXN_CHECK_PRESENT, key, key_len, NULL, 0);
+}
+
+void ofs_txn_abort(ofs_txn_t *txn)
+{
+    if (txn == NULL)
+    {
+        return;
+    }
+
+    OFS_COUNT(&txn->ct->counters, OFS_CNT_TXN_ABORT, 1);
+    free_txn(txn);
+}
+
+// lock the objects in objid order, the write set is ordered by objid
+static void lock_txn_objects(ofs_txn_t *txn)
+{
+    ofs_txn_op_t *op = NULL;
+    object_info_t *obj_info = NULL;
+
+    for (op = avl_first(&txn->write_set); op != NULL; op = AVL_NEXT(&txn->write_set, op))
+    {
+        if (op->obj->obj_info != obj_info)
+        {
+            obj_info = op->obj->obj_info;
+            OS_RWLOCK_WRLOCK(&obj_info->attr_lock);
+        }
+    }
+}
+
+static void unlock_txn_objects(ofs_txn_t *txn)
+{
+    ofs_txn_op_t *op = NULL;
+    object_info_t *obj_info = NULL;
+
+    for (op = avl_first(&txn->write_set); op != NULL; op = AVL_NEXT(&txn->write_set, op))
+    {
+        if (op->obj->obj_info != obj_info)
+        {
+            obj_info = op->obj->obj_info;
+            OS_RWLOCK_WRUNLOCK(&obj_info->attr_lock);
+        }
+    }
+}
+
+static int32_t apply_txn_op(ofs_txn_op_t *op)
+{
+    object_handle_t *obj = op->obj;
+    bool_t existed = FALSE;
+    int32_t ret = 0;
+
+    ret = search_key_internal(obj, GET_IE_KEY(&op->ie), op->ie.key_len, NULL, 0);
+    if ((ret < 0) && (ret != -INDEX_ERR_KEY_NOT_FOUND))
+    {
+        LOG_ERROR("Search key failed. objid(%lld) ret(%d)\n", obj->obj_info->objid, ret);
+        return ret;
+    }
+
+    existed = (ret >= 0);
+    if ((op->check == OFS_TXN_CHECK_ABSENT) && existed)
+    {
+        return -INDEX_ERR_KEY_EXIST;
+    }
+
+    if ((op->check == OFS_TXN_CHECK_PRESENT) && !existed)
+    {
+        return -INDEX_ERR_KEY_NOT_FOUND;
+    }
+
+    if (existed)
+    {
+        op->old_ie = OS_MALLOC(obj->ie->len);
+        if (op->old_ie == NULL)
+        {
+            LOG_ERROR("Allocate memory failed. size(%d)\n", obj->ie->len);
+            return -INDEX_ERR_ALLOCATE_MEMORY;
+        }
+
+        memcpy(op->old_ie, obj->ie, obj->ie->len);
+        op->applied = TRUE;
+        if (op->op == OFS_TXN_PUT)
+        { // overwrite it in its block
+            return tree_update_ie(obj, GET_IE_KEY(&op->ie), op->ie.key_len,
+                GET_IE_VALUE(&op->ie), op->ie.value_len);
+        }
+        
+        ret = tree_remove_ie(obj);
+        if (ret < 0)
+        {
+            LOG_ERROR("Remove key failed. objid(%lld) ret(%d)\n", obj->obj_info->objid, ret);
+            return ret;
+        }
+    }
+
+    if (op->op == OFS_TXN_PUT)
+    {
+        op->applied = TRUE;
+        ret = insert_key_internal(obj, GET_IE_KEY(&op->ie), op->ie.key_len,
+            GET_IE_VALUE(&op->ie), op->ie.value_len);
+    }
+
+    return ret;
+}
+
+// restore the key to the entry before the transaction
+static void undo_txn_op(ofs_txn_op_t *op)
+{
+    object_handle_t *obj = op->obj;
+    index_entry_t *ie = op->old_ie;
+    int32_t ret = 0;
+
+    ret = search_key_internal(obj, GET_IE_KEY(&op->ie), op->ie.key_len, NULL, 0);
+    if (ret >= 0)
+    {
+        ret = (ie != NULL) ? tree_update_ie(obj, GET_IE_KEY(ie), ie->key_len, GET_IE_VALUE(ie), ie->value_len)
+            : tree_remove_ie(obj);
+    }
+    else if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+    {
+        ret = (ie != NULL) ? insert_key_internal(obj, GET_IE_KEY(ie), ie->key_len, GET_IE_VALUE(ie), ie->value_len)
+            : 0;
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Undo the transaction failed. objid(%lld) ret(%d)\n", obj->obj_info->objid, ret);
+    }
+}
+
+static int32_t apply_write_set(ofs_txn_t *txn)
+{
+    ofs_txn_op_t *op = NULL;
+    int32_t ret = 0;
+
+    for (op = avl_first(&txn->write_set); op != NULL; op = AVL_NEXT(&txn->write_set, op))
+    {
+        ret = apply_txn_op(op);
+        if (ret < 0)
+        {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+static void undo_write_set(ofs_txn_t *txn)
+{
+    ofs_txn_op_t *op = NULL;
+
+    for (op = avl_last(&txn->write_set); op != NULL; op = AVL_PREV(&txn->write_set, op))
+    {
+        if (op->applied)
+        {
+            undo_txn_op(op);
+        }
+    }
+}
+
+static int32_t log_write_set(ofs_txn_t *txn)
+{
+    ofs_log_entry_t *entries = NULL;
+    ofs_txn_op_t *op = NULL;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    entries = OS_MALLOC(sizeof(ofs_log_entry_t) * txn->op_num);
+    if (entries == NULL)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_log_entry_t) * txn->op_num);
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    for (op = avl_first(&txn->write_set); op != NULL; op = AVL_NEXT(&txn->write_set, op), i++)
+    {
+        entries[i].op = (op->op == OFS_TXN_PUT) ? OFS_LOG_INSERT_KEY : OFS_LOG_REMOVE_KEY;
+        entries[i].objid = op->obj->obj_info->objid;
+        entries[i].key = GET_IE_KEY(&op->ie);
+        entries[i].key_len = op->ie.key_len;
+        entries[i].value = GET_IE_VALUE(&op->ie);
+        entries[i].value_len = op->ie.value_len;
+    }
+
+    ret = ofs_log_append_batch(txn->ct, entries, txn->op_num);
+    OS_FREE(entries);
+
+    return ret;
+}
+
+// wait for the checkpoint with the transaction seq in it, the first waiter
+// finding no checkpoint running writes it for all
+static int32_t wait_group_checkpoint(container_handle_t *ct, uint64_t seq)
+{
+    ofs_txn_group_t *group = &ct->txn_group;
+    uint64_t target = 0;
+    int32_t ret = 0;
+
+    OS_MUTEX_LOCK(&group->lock);
+
+    while (group->durable_seq < seq)
+    {
+        if (group->failed_seq >= seq)
+        {
+            ret = group->error;
+            break;
+        }
+
+        if (group->checkpointing)
+        {
+            OS_COND_WAIT(&group->cond, &group->lock);
+            continue;
+        }
+
+        group->checkpointing = TRUE;
+        target = group->applied_seq;
+        OS_MUTEX_UNLOCK(&group->lock);
+
+        ret = ofs_commit_container(ct);
+
+        OS_MUTEX_LOCK(&group->lock);
+        group->checkpointing = FALSE;
+        if (ret < 0)
+        {
+            LOG_ERROR("Checkpoint the transactions failed. ct(%s) seq(%lld) ret(%d)\n", ct->name, target, ret);
+            group->failed_seq = target;
+            group->error = ret;
+        }
+        else
+        {
+            group->durable_seq = target;
+        }
+
+        OS_COND_BROADCAST(&group->cond);
+    }
+
+    OS_MUTEX_UNLOCK(&group->lock);
+
+    return ret;
+}
+
+// apply the write set atomically and make it durable, the txn is freed
+int32_t ofs_txn_commit(ofs_txn_t *txn)
+{
+    container_handle_t *ct = NULL;
+    uint64_t seq = 0;
+    int32_t ret = 0;
+
+    if (txn == NULL)
+    {
+        LOG_ERROR("Invalid parameter. txn(%p)\n", txn);
+        return -INDEX_ERR_PARAMETER;
+    }
+
+    ct = txn->ct;
+    if (txn->op_num == 0)
+    {
+        free_txn(txn);
+        return 0;
+    }
+
+    // no checkpoint has a part of the transaction
+    OS_RWLOCK_RDLOCK(&ct->op_lock);
+    lock_txn_objects(txn);
+
+    ret = apply_write_set(txn);
+    if (ret >= 0)
+    {
+        ret = log_write_set(txn);
+    }
+
+    if (ret < 0)
+    {
+        undo_write_set(txn);
+    }
+    else
+    {
+        OS_MUTEX_LOCK(&ct->txn_group.lock);
+        seq = ++ct->txn_group.applied_seq;
+        OS_MUTEX_UNLOCK(&ct->txn_group.lock);
+    }
+
+    unlock_txn_objects(txn);
+    OS_RWLOCK_RDUNLOCK(&ct->op_lock);
+
+    if (ret < 0)
+    {
+        LOG_DEBUG("The transaction is aborted. ct(%s) op_num(%d) ret(%d)\n", ct->name, txn->op_num, ret);
+        ofs_txn_abort(txn);
+        return ret;
+    }
+
+    if (ct->durability == OFS_DURABILITY_COMMIT)
+    {
+        ret = ofs_log_sync(ct, ofs_log_last_lsn(ct));
+    }
+    else
+    {
+        ret = wait_group_checkpoint(ct, seq);
+    }
+
+    OFS_COUNT(&ct->counters, OFS_CNT_TXN_COMMIT, 1);
+    free_txn(txn);
+
+    return ret;
+}
+
+void init_txn_group(container_handle_t *ct)
+{
+    memset(&ct->txn_group, 0, sizeof(ofs_txn_group_t));
+    OS_MUTEX_INIT(&ct->txn_group.lock);
+    OS_COND_INIT(&ct->txn_group.cond);
+}
+
+void destroy_txn_group(container_handle_t *ct)
+{
+    OS_COND_DESTROY(&ct->txn_group.cond);
+    OS_MUTEX_DESTROY(&ct->txn_group.lock);
+}
+
+EXPORT_SYMBOL(ofs_txn_begin);
+EXPORT_SYMBOL(ofs_txn_insert);
+EXPORT_SYMBOL(ofs_txn_update);
+EXPORT_SYMBOL(ofs_txn_remove);
+EXPORT_SYMBOL(ofs_txn_commit);
+EXPORT_SYMBOL(ofs_txn_abort);
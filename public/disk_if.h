@@ -51,6 +51,8 @@ extern "C" {
 #define os_disk_open(hnd, path)    os_file_open(hnd, path)
 #define os_disk_create(hnd, path)  os_file_create(hnd, path)
 #define os_disk_close(hnd)            os_file_close(hnd)
+#define os_disk_flush(hnd)            os_file_flush(hnd)
+#define os_disk_sync(hnd)             os_file_sync(hnd)
 
 #define os_disk_pwrite(hnd, buf, size, start_lba) \
     os_file_pwrite(hnd, buf, size, (start_lba) << BYTES_PER_SECTOR_SHIFT)
@@ -250,6 +250,30 @@ void os_file_printf(void *hnd, const char *format, ...)
     return;
 }
 
+// vfs_write has no buffer in the caller
+int32_t os_file_flush(void *hnd)
+{
+    if (hnd == NULL)
+    {
+        return -FILE_IO_ERR_INVALID_PARA;
+    }
+
+    return 0;
+}
+
+// write the data of the file to the device
+int32_t os_file_sync(void *hnd)
+{
+    file_handle_t *tmp_hnd = hnd;
+
+    if (tmp_hnd == NULL)
+    {
+        return -FILE_IO_ERR_INVALID_PARA;
+    }
+
+    return (vfs_fsync(tmp_hnd->disk_hnd, 1) == 0) ? 0 : -FILE_IO_ERR_WRITE;
+}
+
 #include <linux/module.h>
 
 EXPORT_SYMBOL(os_file_open);
@@ -260,6 +284,8 @@ EXPORT_SYMBOL(os_file_read);
 EXPORT_SYMBOL(os_file_write);
 EXPORT_SYMBOL(os_file_seek);
 EXPORT_SYMBOL(os_file_close);
+EXPORT_SYMBOL(os_file_flush);
+EXPORT_SYMBOL(os_file_sync);
 
 #else
 
@@ -512,6 +538,51 @@ void os_file_set_buf(void *hnd, void *buf, uint32_t size)
 #endif
 }
 
+// write the data buffered by the stream to the system
+int32_t os_file_flush(void *hnd)
+{
+    file_handle_t *tmp_hnd = hnd;
+    int32_t ret = 0;
+
+    if (tmp_hnd == NULL)
+    {
+        return -FILE_IO_ERR_INVALID_PARA;
+    }
+
+    OS_RWLOCK_WRLOCK(&tmp_hnd->rwlock);
+    ret = fflush(tmp_hnd->disk_hnd);
+    OS_RWLOCK_WRUNLOCK(&tmp_hnd->rwlock);
+
+    return (ret == 0) ? 0 : -FILE_IO_ERR_WRITE;
+}
+
+// write the data of the file to the device, the metadata not needed to
+// read the data back (e.g. mtime) is not written
+int32_t os_file_sync(void *hnd)
+{
+    file_handle_t *tmp_hnd = hnd;
+    int32_t ret = 0;
+
+    if (tmp_hnd == NULL)
+    {
+        return -FILE_IO_ERR_INVALID_PARA;
+    }
+
+    OS_RWLOCK_WRLOCK(&tmp_hnd->rwlock);
+    ret = fflush(tmp_hnd->disk_hnd);
+    if (ret == 0)
+    {
+#ifdef WIN32
+        ret = _commit(_fileno(tmp_hnd->disk_hnd));
+#else
+        ret = fdatasync(fileno(tmp_hnd->disk_hnd));
+#endif
+    }
+    OS_RWLOCK_WRUNLOCK(&tmp_hnd->rwlock);
+
+    return (ret == 0) ? 0 : -FILE_IO_ERR_WRITE;
+}
+
 int32_t os_file_exist(const char *name)
 {
     if (!name)
@@ -526,6 +597,21 @@ int32_t os_file_exist(const char *name)
 #endif
 }
 
+// the file named new_name is replaced
+int32_t os_file_rename(const char *old_name, const char *new_name)
+{
+    if ((!old_name) || (!new_name))
+    {
+        return -FILE_IO_ERR_INVALID_PARA;
+    }
+
+#ifdef WIN32
+    (void)remove(new_name);
+#endif
+
+    return (rename(old_name, new_name) == 0) ? 0 : -FILE_IO_ERR_RENAME;
+}
+
 void os_file_printf(void *hnd, const char *format, ...)
 {
     file_handle_t *tmp_hnd = hnd;
@@ -53,11 +53,13 @@ enum file_io_error_code
     FILE_IO_ERR_WRITE,
     FILE_IO_ERR_CLOSE,
     FILE_IO_ERR_INVALID_PARA,
+    FILE_IO_ERR_RENAME,
 
     FILE_IO_ERR_BUTT
 };
 
 extern int32_t os_file_exist(const char *path);
+extern int32_t os_file_rename(const char *old_name, const char *new_name);
 extern int32_t os_file_open_or_create(void **hnd, const char *path);
 extern int32_t os_file_resize(void *f, uint64_t newSize);
 extern int64_t os_file_get_size(void *f);
@@ -66,6 +68,8 @@ extern void os_file_set_buf(void *f, void *buf, uint32_t size);
 extern int32_t os_file_seek(void *f, uint64_t offset);
 extern int32_t os_file_read(void *f, void *buf, uint32_t size);
 extern int32_t os_file_write(void *f, void *buf, uint32_t size);
+extern int32_t os_file_flush(void *f);
+extern int32_t os_file_sync(void *f);
 
 extern int32_t os_file_open(void **hnd, const char *name);
 extern int32_t os_file_create(void **hnd, const char *name);
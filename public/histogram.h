@@ -0,0 +1,226 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OS_HISTOGRAM.H
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description:
+Function List:
+    1. ...:
+History:
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+
+#ifndef __OS_HISTOGRAM_H__
+#define __OS_HISTOGRAM_H__
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * log-bucketed histogram:
+ * every power of 2 is split into HIST_SUB_BUCKETS linear buckets, so the
+ * value of a bucket is at most 1/HIST_SUB_BUCKETS away from the recorded
+ * value, and all the uint64_t values fit in HIST_BUCKETS counters.
+ * the histogram is not locked, keep one for each thread and merge them.
+ */
+#define HIST_SUB_BITS       4
+#define HIST_SUB_BUCKETS    (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS        ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+typedef struct histogram
+{
+    uint64_t total;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t counts[HIST_BUCKETS];
+} histogram_t;
+
+static inline void hist_init(histogram_t *h)
+{
+    memset(h, 0, sizeof(histogram_t));
+    h->min = (uint64_t)-1;
+}
+
+static inline uint32_t hist_msb(uint64_t value)
+{
+#ifdef __GNUC__
+    return 63 - (uint32_t)__builtin_clzll(value);
+#else
+    uint32_t msb = 0;
+
+    while (value >>= 1)
+    {
+        msb++;
+    }
+
+    return msb;
+#endif
+}
+
+static inline uint32_t hist_bucket(uint64_t value)
+{
+    uint32_t shift = 0;
+
+    if (value < HIST_SUB_BUCKETS)
+    {
+        return (uint32_t)value;
+    }
+
+    shift = hist_msb(value) - HIST_SUB_BITS;
+
+    return ((shift + 1) << HIST_SUB_BITS) + (uint32_t)((value >> shift) & (HIST_SUB_BUCKETS - 1));
+}
+
+// the smallest value in the bucket
+static inline uint64_t hist_bucket_low(uint32_t bucket)
+{
+    uint32_t shift = 0;
+
+    if (bucket < HIST_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    shift = (bucket >> HIST_SUB_BITS) - 1;
+
+    return ((uint64_t)(HIST_SUB_BUCKETS | (bucket & (HIST_SUB_BUCKETS - 1)))) << shift;
+}
+
+// the largest value in the bucket
+static inline uint64_t hist_bucket_high(uint32_t bucket)
+{
+    if (bucket < HIST_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    return hist_bucket_low(bucket) + (((uint64_t)1 << ((bucket >> HIST_SUB_BITS) - 1)) - 1);
+}
+
+static inline void hist_record(histogram_t *h, uint64_t value)
+{
+    h->counts[hist_bucket(value)]++;
+    h->total++;
+    h->sum += value;
+
+    if (value < h->min)
+    {
+        h->min = value;
+    }
+
+    if (value > h->max)
+    {
+        h->max = value;
+    }
+}
+
+static inline void hist_merge(histogram_t *dst, const histogram_t *src)
+{
+    uint32_t i = 0;
+
+    if (src->total == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+
+    dst->total += src->total;
+    dst->sum += src->sum;
+
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+static inline uint64_t hist_mean(const histogram_t *h)
+{
+    return (h->total != 0) ? (h->sum / h->total) : 0;
+}
+
+// the value below which the permille of the recorded values fall,
+// e.g. permille 500 is p50, 999 is p99.9
+static inline uint64_t hist_percentile(const histogram_t *h, uint32_t permille)
+{
+    uint64_t rank = 0;
+    uint64_t cnt = 0;
+    uint64_t value = 0;
+    uint32_t i = 0;
+
+    if (h->total == 0)
+    {
+        return 0;
+    }
+
+    rank = (h->total * permille + 999) / 1000;
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        cnt += h->counts[i];
+        if (cnt >= rank)
+        {
+            break;
+        }
+    }
+
+    // the exact values are known for the ends
+    value = hist_bucket_high(i);
+    if (value > h->max)
+    {
+        value = h->max;
+    }
+
+    if (value < h->min)
+    {
+        value = h->min;
+    }
+
+    return value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
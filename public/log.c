@@ -63,12 +63,15 @@ History:
 #include <sys/types.h>
 #include <unistd.h>
 #define MkDir(name)  mkdir(name, 0777)
+
+#define LOG_ASYNC    /* the log lines are written by the writer thread */
 #endif
 
 #include "os_adapter.h"
 #include "log.h"
 #include "file_if.h"
 #include "utils.h"
+#include "ring_buffer.h"
 
 #define DEFAULT_LEVEL   2
 #define MAX_FILE_LINES    200000
@@ -79,20 +82,55 @@ History:
 #define DATA_TIME_STR_LEN 40
 #define BUF_LEN           1024
 
+#ifdef LOG_ASYNC
+
+#define LOG_RING_SLOTS    128   /* lines can be buffered by one thread */
+#define LOG_IDLE_MS       1     /* the writer thread sleep time when no line */
+
+typedef struct log_slot
+{
+    time_t time;
+    char buf[BUF_LEN];
+} log_slot_t;
+
+typedef struct log_ring
+{
+    ring_buffer_t *free;        /* free slots, pushed by the writer thread */
+    ring_buffer_t *used;        /* filled slots, pushed by the owner thread */
+    volatile uint32_t closed;   /* the owner thread exited */
+    struct log_ring *next;
+    log_slot_t slots[LOG_RING_SLOTS];
+} log_ring_t;
+
+#endif
+
 typedef struct log
 {
+    uint32_t levels[PIDS_NUM];  /* must be the first, see log_head_t */
     char  dir[LOG_NAME_LEN];      
     char  name[LOG_NAME_LEN];      
     char  version[LOG_VERSION_LEN];    
     int32_t total_lines;             
     uint32_t mode;                 
-    uint32_t levels[PIDS_NUM]; 
     
     char date_time[DATA_TIME_STR_LEN];
     char buf[BUF_LEN];
     
     os_rwlock   rwlock;                  
     void *disk_hnd;  
+
+#ifdef LOG_ASYNC
+    volatile time_t now;        /* coarse clock, updated by the writer thread */
+    time_t date_time_sec;       /* the time of date_time string */
+    volatile uint32_t stop;
+    os_tls_key_t ring_key;      /* the ring of current thread */
+    os_mutex_t rings_lock;
+    log_ring_t *rings;
+    os_thread_t writer;
+    os_mutex_t write_lock;      /* the writer thread and the lines written directly */
+    atomic_t dropped;           /* lines dropped when no free slot */
+    uint32_t reported;          /* dropped lines reported by the writer thread */
+#endif
 } log_t; 
 
 static void *open_log(log_t *log)
@@ -200,6 +238,250 @@ static int32_t backup_log(log_t *log)
 
 #endif
 
+#ifdef LOG_ASYNC
+
+static void log_ring_exit(void *ring)
+{
+    smp_mb(); // all the lines pushed must be seen before closed
+    ((log_ring_t *)ring)->closed = 1;
+}
+
+static void destroy_log_ring(log_ring_t *ring)
+{
+    if (ring->free)
+    {
+        ring_buffer_destroy(ring->free);
+    }
+
+    if (ring->used)
+    {
+        ring_buffer_destroy(ring->used);
+    }
+
+    OS_FREE(ring);
+}
+
+static log_ring_t *create_log_ring(log_t *log)
+{
+    log_ring_t *ring = NULL;
+    uint64_t i = 0;
+
+    ring = (log_ring_t *)OS_MALLOC(sizeof(log_ring_t));
+    if (!ring)
+    {
+        return NULL;
+    }
+
+    memset(ring, 0, sizeof(log_ring_t));
+
+    ring->free = ring_buffer_create(LOG_RING_SLOTS);
+    ring->used = ring_buffer_create(LOG_RING_SLOTS);
+    if ((!ring->free) || (!ring->used))
+    {
+        destroy_log_ring(ring);
+        return NULL;
+    }
+
+    for (i = 0; i < LOG_RING_SLOTS; i++)
+    {
+        (void)ring_buffer_push(ring->free, i);
+    }
+
+    if (OS_TLS_SET(log->ring_key, ring) != 0)
+    {
+        destroy_log_ring(ring);
+        return NULL;
+    }
+
+    OS_MUTEX_LOCK(&log->rings_lock);
+    ring->next = log->rings;
+    log->rings = ring;
+    OS_MUTEX_UNLOCK(&log->rings_lock);
+
+    return ring;
+}
+
+static inline log_ring_t *get_log_ring(log_t *log)
+{
+    log_ring_t *ring = (log_ring_t *)OS_TLS_GET(log->ring_key);
+
+    if (ring)
+    {
+        return ring;
+    }
+
+    return create_log_ring(log);
+}
+
+static void write_log_line(log_t *log, time_t time, const char *buf)
+{
+    struct tm ts;
+    
+    if (!log->disk_hnd)
+    {
+        return;
+    }
+
+    if ((time != log->date_time_sec) || (log->date_time[0] == 0))
+    { // format the date time only when the second changed
+        if (localtime_r(&time, &ts))
+        {
+            OS_SNPRINTF(log->date_time, DATA_TIME_STR_LEN, "%04d-%02d-%02d %02d:%02d:%02d", 
+                ts.tm_year+1900, ts.tm_mon+1, ts.tm_mday, 
+                ts.tm_hour, ts.tm_min, ts.tm_sec);
+        }
+        
+        log->date_time_sec = time;
+    }
+
+    os_file_printf(log->disk_hnd, "%s %s", log->date_time, buf);
+    log->total_lines++;
+    
+    if (log->total_lines > MAX_FILE_LINES)
+    {
+        backup_log(log);
+    }
+}
+
+// write all the lines buffered, return the number of lines written
+static uint32_t drain_log_rings(log_t *log)
+{
+    log_ring_t *rings = NULL;
+    log_ring_t *kept = NULL;
+    log_ring_t **tail = &kept;
+    log_ring_t *ring = NULL;
+    uint32_t closed = 0;
+    uint32_t lines = 0;
+    uint64_t slot = 0;
+    uint32_t dropped = 0;
+
+    // take the rings away, the new threads are not blocked by the writing
+    OS_MUTEX_LOCK(&log->rings_lock);
+    rings = log->rings;
+    log->rings = NULL;
+    OS_MUTEX_UNLOCK(&log->rings_lock);
+
+    OS_MUTEX_LOCK(&log->write_lock);
+
+    while ((ring = rings) != NULL)
+    {
+        rings = ring->next;
+        closed = ring->closed;
+        smp_rmb();
+        
+        while (ring_buffer_pop(ring->used, &slot) == 0)
+        {
+            write_log_line(log, ring->slots[slot].time, ring->slots[slot].buf);
+            (void)ring_buffer_push(ring->free, slot);
+            lines++;
+        }
+
+        if (closed)
+        { // the owner thread exited, no more line in this ring
+            destroy_log_ring(ring);
+            continue;
+        }
+
+        ring->next = NULL;
+        *tail = ring;
+        tail = &ring->next;
+    }
+
+    dropped = atomic_read(&log->dropped);
+    if (dropped != log->reported)
+    {
+        OS_SNPRINTF(log->buf, BUF_LEN, "[WARN ] %u lines dropped, the log ring is full.\n",
+            dropped - log->reported);
+        write_log_line(log, log->now, log->buf);
+        log->reported = dropped;
+    }
+
+    OS_MUTEX_UNLOCK(&log->write_lock);
+
+    // put the rings back before the ones created meanwhile
+    if (kept)
+    {
+        OS_MUTEX_LOCK(&log->rings_lock);
+        *tail = log->rings;
+        log->rings = kept;
+        OS_MUTEX_UNLOCK(&log->rings_lock);
+    }
+
+    return lines;
+}
+
+static void *log_writer_thread(void *para)
+{
+    log_t *log = (log_t *)para;
+    uint32_t stop = 0;
+
+    for (;;)
+    {
+        stop = log->stop;
+        log->now = time(NULL);
+
+        // write all the lines left before stop
+        if ((drain_log_rings(log) == 0) && (!stop))
+        {
+            OS_SLEEP_MS(LOG_IDLE_MS);
+        }
+
+        if (stop)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t start_log_writer(log_t *log)
+{
+    OS_MUTEX_INIT(&log->rings_lock);
+    OS_MUTEX_INIT(&log->write_lock);
+    log->now = time(NULL);
+    
+    if (OS_TLS_CREATE(&log->ring_key, log_ring_exit) != 0)
+    {
+        OS_MUTEX_DESTROY(&log->write_lock);
+        OS_MUTEX_DESTROY(&log->rings_lock);
+        return -1;
+    }
+
+    log->writer = thread_create(log_writer_thread, log, "log_writer");
+    if (log->writer == INVALID_TID)
+    {
+        OS_TLS_DELETE(log->ring_key);
+        OS_MUTEX_DESTROY(&log->write_lock);
+        OS_MUTEX_DESTROY(&log->rings_lock);
+        return -2;
+    }
+
+    return 0;
+}
+
+static void stop_log_writer(log_t *log)
+{
+    log_ring_t *ring = NULL;
+    
+    log->stop = 1;
+    thread_destroy(log->writer, FALSE);
+
+    // the threads still alive will create new ring after reopen
+    OS_TLS_DELETE(log->ring_key);
+
+    while ((ring = log->rings) != NULL)
+    {
+        log->rings = ring->next;
+        destroy_log_ring(ring);
+    }
+    
+    OS_MUTEX_DESTROY(&log->write_lock);
+    OS_MUTEX_DESTROY(&log->rings_lock);
+}
+
+#endif
+
 void log_set_level(void *log, uint32_t pid, uint32_t level)
 {
     if ((!log) || (pid >= PIDS_NUM))
@@ -222,6 +504,21 @@ int32_t log_get_level(void *log, uint32_t pid)
     return ((log_t *)log)->levels[pid];
 }
 
+// the lines dropped because the writer thread could not keep up
+uint32_t log_get_dropped(void *log)
+{
+    if (!log)
+    {
+        return 0;
+    }
+
+#ifdef LOG_ASYNC
+    return atomic_read(&((log_t *)log)->dropped);
+#else
+    return 0;
+#endif
+}
+
 void *log_open(const char *file_name, const char *version, const char *dir, uint32_t mode)
 {
     log_t *log = NULL;
@@ -260,6 +557,19 @@ void *log_open(const char *file_name, const char *version, const char *dir, uint
         OS_FREE(log);
         return NULL;
     }
+
+#ifdef LOG_ASYNC
+    if (0 > start_log_writer(log))
+    {
+        if (log->disk_hnd)
+        {
+            os_file_close(log->disk_hnd);
+        }
+        
+        OS_FREE(log);
+        return NULL;
+    }
+#endif
     
     return log;
 }
@@ -273,6 +583,10 @@ void log_close(void *log)
         return;
     }
 
+#ifdef LOG_ASYNC
+    stop_log_writer(tmp_log);
+#endif
+
     if (tmp_log->disk_hnd)
     {
         char date_time[DATA_TIME_STR_LEN];
@@ -287,6 +601,60 @@ void log_close(void *log)
     OS_FREE(tmp_log);
 }
 
+#ifdef LOG_ASYNC
+
+void log_trace(void *log, uint32_t pid, uint32_t level, const char *format, ...)
+{
+    log_t *tmp_log = (log_t *)log;
+    log_ring_t *ring = NULL;
+    log_slot_t *slot = NULL;
+    uint64_t slot_id = 0;
+    char buf[BUF_LEN];
+    va_list ap;
+
+    if ((tmp_log == NULL) || (pid >= PIDS_NUM) || (level > tmp_log->levels[pid])
+        || ((tmp_log->mode & LOG_TO_FILE) == 0) || (tmp_log->disk_hnd == NULL))
+    {
+        return;
+    }
+
+    ring = get_log_ring(tmp_log);
+    if (!ring)
+    {
+        return;
+    }
+
+    if (ring_buffer_pop(ring->free, &slot_id) < 0)
+    {
+        if (level > LOG_LEVEL_ERROR)
+        { // never wait for the writer thread
+            atomic_inc(&tmp_log->dropped);
+            return;
+        }
+
+        // the errors are never dropped, they wait for the file instead
+        va_start(ap, format);
+        OS_VSNPRINTF(buf, BUF_LEN, format, ap);
+        va_end(ap);
+
+        OS_MUTEX_LOCK(&tmp_log->write_lock);
+        write_log_line(tmp_log, tmp_log->now, buf);
+        OS_MUTEX_UNLOCK(&tmp_log->write_lock);
+        return;
+    }
+
+    slot = &ring->slots[slot_id];
+    slot->time = tmp_log->now;
+
+    va_start(ap, format);
+    OS_VSNPRINTF(slot->buf, BUF_LEN, format, ap);
+    va_end(ap);
+
+    (void)ring_buffer_push(ring->used, slot_id);
+}
+
+#else
+
 void log_trace(void *log, uint32_t pid, uint32_t level, const char *format, ...)
 {
     log_t *tmp_log = (log_t *)log;
@@ -327,6 +695,8 @@ void log_trace(void *log, uint32_t pid, uint32_t level, const char *format, ...)
     }
 }
 
+#endif
+
 void *g_log_hnd = NULL;
 
 
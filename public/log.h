@@ -49,42 +49,65 @@ extern "C" {
 #define LOG_TO_SCREEN      0x02
 #define LOG_TO_SCNFILE     (LOG_TO_FILE | LOG_TO_SCREEN)
 
+#define LOG_LEVEL_EMERG    0
+#define LOG_LEVEL_ERROR    1
+#define LOG_LEVEL_WARN     2
+#define LOG_LEVEL_INFO     3
+#define LOG_LEVEL_DEBUG    4
+
+/* the lines above this level are not compiled, such as -DLOG_COMPILE_LEVEL=2 */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL  LOG_LEVEL_DEBUG
+#endif
+
+#ifdef __GNUC__
+#define LOG_UNLIKELY(x)    __builtin_expect(!!(x), 0)
+#else
+#define LOG_UNLIKELY(x)    (x)
+#endif
+
+/* the head of the log handle, checked before calling log_trace */
+typedef struct log_head
+{
+    uint32_t levels[PIDS_NUM]; 
+} log_head_t;
+
 extern void *log_open(const char *file_name, const char *version, const char *dir, uint32_t mode);
 extern void log_close(void *log);
 extern void log_set_level(void *log, uint32_t pid, uint32_t level);
 extern int32_t log_get_level(void *log, uint32_t pid);
+extern uint32_t log_get_dropped(void *log);
 extern void log_trace(void *log, uint32_t pid, uint32_t level, const char *format, ...);
 
 extern void *g_log_hnd;
 
+static inline int32_t log_level_enabled(void *log, uint32_t pid, uint32_t level)
+{
+    return ((log != NULL) && (pid < PIDS_NUM) && (level <= ((log_head_t *)log)->levels[pid]));
+}
+
 #define LOG_SYSTEM_INIT(dir, name) g_log_hnd = log_open(name, "V100R001C01", dir, LOG_TO_FILE)
 #define LOG_SYSTEM_EXIT()          log_close(g_log_hnd);
 #define LOG_SET_LEVEL(level)       log_set_level(g_log_hnd, g_pid, level)
 #define LOG_GET_LEVEL()            log_get_level(g_log_hnd, g_pid)
 
-#define LOG_DEBUG(fmt, ...)    \
-    log_trace(g_log_hnd, g_pid, 4, "[DEBUG][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-
-#define LOG_INFO(fmt, ...)       \
-    log_trace(g_log_hnd, g_pid, 3, "[INFO ][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-   
-#define LOG_WARN(fmt, ...)         \
-    log_trace(g_log_hnd, g_pid, 2, "[WARN ][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-   
-#define LOG_ERROR(fmt, ...)        \
-    log_trace(g_log_hnd, g_pid, 1, "[ERROR][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-   
-#define LOG_EMERG(fmt, ...)        \
-    log_trace(g_log_hnd, g_pid, 0, "[EMERG][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-
-#define LOG_EVENT(fmt, ...)        \
-    log_trace(g_log_hnd, g_pid, 0, "[EVENT][%lld][%s:%s:%d]: "fmt, \
-        (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+/* the arguments are not evaluated when the level is disabled */
+#define LOG_TRACE(level, tag, fmt, ...) \
+    do \
+    { \
+        if (((level) <= LOG_COMPILE_LEVEL) && LOG_UNLIKELY(log_level_enabled(g_log_hnd, g_pid, level))) \
+        { \
+            log_trace(g_log_hnd, g_pid, level, "["tag"][%lld][%s:%s:%d]: "fmt, \
+                (uint64_t)OS_GET_THREAD_ID(),  __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...)    LOG_TRACE(LOG_LEVEL_DEBUG, "DEBUG", fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)     LOG_TRACE(LOG_LEVEL_INFO,  "INFO ", fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)     LOG_TRACE(LOG_LEVEL_WARN,  "WARN ", fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...)    LOG_TRACE(LOG_LEVEL_ERROR, "ERROR", fmt, ##__VA_ARGS__)
+#define LOG_EMERG(fmt, ...)    LOG_TRACE(LOG_LEVEL_EMERG, "EMERG", fmt, ##__VA_ARGS__)
+#define LOG_EVENT(fmt, ...)    LOG_TRACE(LOG_LEVEL_EMERG, "EVENT", fmt, ##__VA_ARGS__)
        
 #ifdef __cplusplus
 }
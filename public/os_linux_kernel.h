@@ -82,12 +82,35 @@ typedef struct task_struct *        os_thread_t;
 #define OS_MUTEX_UNLOCK(v_pMutex)  up(v_pMutex)
 #define OS_MUTEX_DESTROY(v_pMutex) 
 
+// the waiters sleep until the sequence moves, they may wake up spuriously
+typedef struct os_cond
+{
+    wait_queue_head_t wq;
+    volatile uint32_t seq;
+} os_cond_t;
+
+static inline void os_cond_wait(os_cond_t *cond, os_mutex_t *mutex)
+{
+    uint32_t seq = cond->seq;
+
+    up(mutex);
+    wait_event(cond->wq, cond->seq != seq);
+    down(mutex);
+}
+
+#define OS_COND_INIT(v_pCond)       do { init_waitqueue_head(&(v_pCond)->wq); (v_pCond)->seq = 0; } while (0)
+#define OS_COND_WAIT(v_pCond, v_pMutex)  os_cond_wait(v_pCond, v_pMutex)
+#define OS_COND_SIGNAL(v_pCond)     do { (v_pCond)->seq++; wake_up(&(v_pCond)->wq); } while (0)
+#define OS_COND_BROADCAST(v_pCond)  do { (v_pCond)->seq++; wake_up_all(&(v_pCond)->wq); } while (0)
+#define OS_COND_DESTROY(v_pCond)
+
 #define OS_RWLOCK_INIT(v_pMutex)      rwlock_init(v_pMutex)
 #define OS_RWLOCK_RDLOCK(v_pMutex)    read_lock(v_pMutex)
 #define OS_RWLOCK_RDUNLOCK(v_pMutex)  read_unlock(v_pMutex)
 #define OS_RWLOCK_WRLOCK(v_pMutex)    write_lock(v_pMutex)
 #define OS_RWLOCK_WRUNLOCK(v_pMutex)  write_unlock(v_pMutex)
 #define OS_RWLOCK_DESTROY(v_pMutex)
+#define OS_RWLOCK_INIT_WRITER_FIRST(v_pMutex)  OS_RWLOCK_INIT(v_pMutex)
 
 #define ASSERT(x) assert(x)
 
@@ -64,7 +64,9 @@ extern "C" {
 #define OS_THREAD_EXIT()                  pthread_exit(NULL)
 
 typedef pthread_mutex_t             os_mutex_t;
+#ifndef OS_LOCK_PROFILE
 typedef pthread_rwlock_t            os_rwlock;
+#endif
 typedef pthread_t                   os_thread_id_t;
 typedef pthread_t                   os_thread_t;
 
@@ -77,6 +79,29 @@ typedef pthread_t                   os_thread_t;
 #define OS_MUTEX_UNLOCK(v_pMutex)  pthread_mutex_unlock(v_pMutex)
 #define OS_MUTEX_DESTROY(v_pMutex) pthread_mutex_destroy(v_pMutex)
 
+typedef pthread_cond_t              os_cond_t;
+
+// the condition is waited with the os_mutex_t held
+#define OS_COND_INIT(v_pCond)               pthread_cond_init(v_pCond, NULL)
+#define OS_COND_WAIT(v_pCond, v_pMutex)     pthread_cond_wait(v_pCond, v_pMutex)
+#define OS_COND_SIGNAL(v_pCond)             pthread_cond_signal(v_pCond)
+#define OS_COND_BROADCAST(v_pCond)          pthread_cond_broadcast(v_pCond)
+#define OS_COND_DESTROY(v_pCond)            pthread_cond_destroy(v_pCond)
+
+typedef pthread_once_t              os_once_t;
+typedef pthread_key_t               os_tls_key_t;
+
+#define OS_ONCE_INIT                PTHREAD_ONCE_INIT
+#define OS_ONCE(v_pOnce, func)      pthread_once(v_pOnce, func)
+
+// the destructor is called with the value when the thread exits
+#define OS_TLS_CREATE(v_pKey, destructor)  pthread_key_create(v_pKey, destructor)
+#define OS_TLS_DELETE(key)                 pthread_key_delete(key)
+#define OS_TLS_GET(key)                    pthread_getspecific(key)
+#define OS_TLS_SET(key, value)             pthread_setspecific(key, value)
+
+#ifndef OS_LOCK_PROFILE
+
 #define OS_RWLOCK_INIT(v_pMutex)      pthread_rwlock_init(v_pMutex, NULL)
 #define OS_RWLOCK_RDLOCK(v_pMutex)    pthread_rwlock_rdlock(v_pMutex)
 #define OS_RWLOCK_RDUNLOCK(v_pMutex)  pthread_rwlock_unlock(v_pMutex)
@@ -84,6 +109,54 @@ typedef pthread_t                   os_thread_t;
 #define OS_RWLOCK_WRUNLOCK(v_pMutex)  pthread_rwlock_unlock(v_pMutex)
 #define OS_RWLOCK_DESTROY(v_pMutex)   pthread_rwlock_destroy(v_pMutex)
 
+#else
+
+/*
+ * lock profiling, build with -DOS_LOCK_PROFILE (make LOCK_PROFILE=1):
+ * every place locking a rwlock is a lock site, the acquisitions, the
+ * contended acquisitions, the wait time and the hold time of the lock are
+ * recorded on the site where it is locked
+ */
+typedef struct os_lock_site
+{
+    const char *file;
+    uint32_t line;
+    uint32_t write;                     // locked for write
+    volatile uint32_t registered;       // linked in the site list
+    volatile uint64_t acquired;
+    volatile uint64_t contended;        // the lock was busy
+    volatile uint64_t wait_ns;
+    volatile uint64_t max_wait_ns;
+    volatile uint64_t hold_ns;
+    volatile uint64_t max_hold_ns;
+    struct os_lock_site *next;
+} os_lock_site_t;
+
+typedef struct os_rwlock
+{
+    pthread_rwlock_t lock;
+} os_rwlock;
+
+extern int os_rwlock_prof_lock(os_rwlock *lock, os_lock_site_t *site);
+extern int os_rwlock_prof_unlock(os_rwlock *lock);
+extern os_lock_site_t *os_lock_prof_sites(void);
+extern void os_lock_prof_reset(void);
+
+#define OS_LOCK_SITE(write)  ({ static os_lock_site_t site_ = {__FILE__, __LINE__, write}; &site_; })
+
+#define OS_RWLOCK_INIT(v_pMutex)      pthread_rwlock_init(&(v_pMutex)->lock, NULL)
+#define OS_RWLOCK_RDLOCK(v_pMutex)    os_rwlock_prof_lock(v_pMutex, OS_LOCK_SITE(0))
+#define OS_RWLOCK_RDUNLOCK(v_pMutex)  os_rwlock_prof_unlock(v_pMutex)
+#define OS_RWLOCK_WRLOCK(v_pMutex)    os_rwlock_prof_lock(v_pMutex, OS_LOCK_SITE(1))
+#define OS_RWLOCK_WRUNLOCK(v_pMutex)  os_rwlock_prof_unlock(v_pMutex)
+#define OS_RWLOCK_DESTROY(v_pMutex)   pthread_rwlock_destroy(&(v_pMutex)->lock)
+
+#endif
+
+// the writer is not starved by the readers coming one after another
+extern int os_rwlock_init_writer_first(os_rwlock *lock);
+#define OS_RWLOCK_INIT_WRITER_FIRST(v_pMutex)  os_rwlock_init_writer_first(v_pMutex)
+
 #define OS_SNPRINTF    (void)snprintf
 
 #define ASSERT(x) assert(x)
@@ -102,6 +175,10 @@ typedef uint32_t atomic_t;
 #define atomic_set(x, n)  (*(x)) = n
 #define atomic_read(x)    (*(x))
 
+#define smp_mb()          __sync_synchronize()
+#define smp_rmb()         __sync_synchronize()
+#define smp_wmb()         __sync_synchronize()
+
 static inline os_thread_t thread_create(void *(*func)(void *), void *para, char *thread_name)
 {
     int32_t ret = 0;
@@ -82,6 +82,34 @@ typedef HANDLE                      os_thread_t;
 #define OS_MUTEX_UNLOCK(v_pMutex)  LeaveCriticalSection(v_pMutex)
 #define OS_MUTEX_DESTROY(v_pMutex) DeleteCriticalSection(v_pMutex)
 
+typedef CONDITION_VARIABLE          os_cond_t;
+
+// the condition is waited with the os_mutex_t held
+#define OS_COND_INIT(v_pCond)               InitializeConditionVariable(v_pCond)
+#define OS_COND_WAIT(v_pCond, v_pMutex)     SleepConditionVariableCS(v_pCond, v_pMutex, INFINITE)
+#define OS_COND_SIGNAL(v_pCond)             WakeConditionVariable(v_pCond)
+#define OS_COND_BROADCAST(v_pCond)          WakeAllConditionVariable(v_pCond)
+#define OS_COND_DESTROY(v_pCond)
+
+typedef INIT_ONCE                   os_once_t;
+typedef DWORD                       os_tls_key_t;
+
+static inline BOOL CALLBACK os_once_call(PINIT_ONCE once, PVOID func, PVOID *ctx)
+{
+    ((void (*)(void))func)();
+    return TRUE;
+}
+
+#define OS_ONCE_INIT                INIT_ONCE_STATIC_INIT
+#define OS_ONCE(v_pOnce, func)      (InitOnceExecuteOnce(v_pOnce, os_once_call, (PVOID)(func), NULL) ? 0 : -1)
+
+// the fiber local storage calls the destructor when the thread exits
+#define OS_TLS_CREATE(v_pKey, destructor) \
+    (((*(v_pKey) = FlsAlloc((PFLS_CALLBACK_FUNCTION)(destructor))) == FLS_OUT_OF_INDEXES) ? -1 : 0)
+#define OS_TLS_DELETE(key)                 (void)FlsFree(key)
+#define OS_TLS_GET(key)                    FlsGetValue(key)
+#define OS_TLS_SET(key, value)             (FlsSetValue(key, value) ? 0 : -1)
+
 #define OS_RWLOCK_INIT(v_pMutex)      InitializeCriticalSection(v_pMutex)
 #define OS_RWLOCK_RDLOCK(v_pMutex)    EnterCriticalSection(v_pMutex)
 #define OS_RWLOCK_RDUNLOCK(v_pMutex)  LeaveCriticalSection(v_pMutex)
@@ -89,6 +117,9 @@ typedef HANDLE                      os_thread_t;
 #define OS_RWLOCK_WRUNLOCK(v_pMutex)  LeaveCriticalSection(v_pMutex)
 #define OS_RWLOCK_DESTROY(v_pMutex)   DeleteCriticalSection(v_pMutex)
 
+// the critical section has no readers to starve the writer
+#define OS_RWLOCK_INIT_WRITER_FIRST(v_pMutex)  OS_RWLOCK_INIT(v_pMutex)
+
 #define OS_SNPRINTF(buf, size, fmt, ...) \
 do { \
     (void)_snprintf(buf, size, fmt, ##__VA_ARGS__); \
@@ -115,6 +146,10 @@ do { \
 #define atomic_add(x, n)  InterlockedExchangeAdd(x, n)
 #define atomic_sub(x, n)  InterlockedExchangeAdd(x, -(n))
 
+#define smp_mb()          MemoryBarrier()
+#define smp_rmb()         MemoryBarrier()
+#define smp_wmb()         MemoryBarrier()
+
 static inline os_thread_t thread_create(void *(*func)(void *), void *para, char *thread_name)
 {
     return CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)func, para, 0, NULL);
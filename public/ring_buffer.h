@@ -54,12 +54,17 @@ typedef enum tagQUEUE_ERROR_CODE_E
     ERR_QUEUE_MEMB_NOT_FOUND,
 } QUEUE_ERROR_CODE_E;
 
+/*
+ * single producer single consumer queue, no lock is needed:
+ * only the producer changes the tail, only the consumer changes the head,
+ * and one member is always kept empty to tell full from empty
+ */
 typedef struct ring_buffer
 {
     uint64_t *member;
-    uint32_t head;  
-    uint32_t tail;
-    uint32_t num; 
+    volatile uint32_t head;  
+    volatile uint32_t tail;
+    uint32_t size; 
     uint32_t max_num; 
 } ring_buffer_t;
 
@@ -79,7 +84,7 @@ static inline ring_buffer_t *ring_buffer_create(int32_t max_num)
         return NULL;
     }
 
-    q->member = OS_MALLOC(sizeof(uint64_t) * (uint32_t)max_num);
+    q->member = OS_MALLOC(sizeof(uint64_t) * ((uint32_t)max_num + 1));
     if (q->member == NULL)
     {
         OS_FREE(q);
@@ -88,7 +93,7 @@ static inline ring_buffer_t *ring_buffer_create(int32_t max_num)
 
     q->head = 0;
     q->tail = 0;
-    q->num = 0;
+    q->size = (uint32_t)max_num + 1;
     q->max_num = (uint32_t)max_num;
 
     return q;
@@ -96,51 +101,72 @@ static inline ring_buffer_t *ring_buffer_create(int32_t max_num)
 
 static inline int32_t ring_buffer_push(ring_buffer_t *q, uint64_t member)
 {
+    uint32_t tail = 0;
+    
     ASSERT(q != NULL);
 
-    if (q->num >= q->max_num)
+    tail = q->tail + 1;
+    if (tail >= q->size)
+    {
+        tail = 0;
+    }
+
+    if (tail == q->head)
     {
         return -ERR_QUEUE_FULL;
     }
 
     q->member[q->tail] = member;
 
-    //smp_wmb(); // SPSC queue should enable
+    smp_wmb(); // the member must be seen before the tail
 
-    if (++q->tail >= q->max_num)
-    {
-        q->tail = 0;
-    }
-
-    q->num++;
+    q->tail = tail;
 
     return 0;
 }
 
 static inline int32_t ring_buffer_pop(ring_buffer_t *q, uint64_t *member)
 {
+    uint32_t head = 0;
+    
     ASSERT(q != NULL);
     ASSERT(member != NULL);
 
-    if (q->num == 0)
+    head = q->head;
+    if (head == q->tail)
     {
         return -ERR_QUEUE_EMPTY;
     }
 
-    *member = q->member[q->head];
+    smp_rmb(); // the member must be read after the tail
+
+    *member = q->member[head];
     
-    //smp_mb(); // SPSC queue should enable
+    smp_mb(); // the member must be read before the head released
 
-    if (++q->head >= q->max_num)
+    if (++head >= q->size)
     {
-        q->head = 0;
+        head = 0;
     }
 
-    q->num--;
+    q->head = head;
 
     return 0;
 }
 
+static inline int32_t ring_buffer_get_size(ring_buffer_t *q)
+{
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    
+    ASSERT(q != NULL);
+
+    head = q->head;
+    tail = q->tail;
+
+    return (int32_t)((tail >= head) ? (tail - head) : (tail + q->size - head));
+}
+
 static inline int32_t ring_buffer_walk_all(ring_buffer_t *q, int32_t (*func)(uint64_t, void *), void *para)
 {
     int32_t ret = 0;
@@ -150,13 +176,13 @@ static inline int32_t ring_buffer_walk_all(ring_buffer_t *q, int32_t (*func)(uin
     
     ASSERT(q != NULL);
 
-    if (q->num == 0)
+    num = (uint32_t)ring_buffer_get_size(q);
+    if (num == 0)
     {
         return -ERR_QUEUE_EMPTY;
     }
 
     head = q->head;
-    num = q->num;
     
     while (num--)
     {
@@ -167,7 +193,7 @@ static inline int32_t ring_buffer_walk_all(ring_buffer_t *q, int32_t (*func)(uin
             break;
         }
 
-        if (++head >= q->max_num)
+        if (++head >= q->size)
         {
             head = 0;
         }
@@ -176,13 +202,6 @@ static inline int32_t ring_buffer_walk_all(ring_buffer_t *q, int32_t (*func)(uin
     return ret;
 }
 
-static inline int32_t ring_buffer_get_size(ring_buffer_t *q)
-{
-    ASSERT(q != NULL);
-
-    return (int32_t)q->num;
-}
-
 static inline int32_t ring_buffer_get_max_size(ring_buffer_t *q)
 {
     ASSERT(q != NULL);
@@ -196,7 +215,6 @@ static inline void ring_buffer_reset(ring_buffer_t *q)
 
     q->head = 0;
     q->tail = 0;
-    q->num = 0;
 
     return;
 }
@@ -0,0 +1,79 @@
+#include <stdio.h>
+
+#include "../os_adapter.h"
+#include "../histogram.h"
+
+void test_case0(void)
+{
+    histogram_t h;
+    uint64_t v = 0;
+    uint32_t b = 0;
+
+    // every value is in its bucket, and the buckets are in order
+    for (v = 0; v < 100000; v++)
+    {
+        b = hist_bucket(v);
+        ASSERT(b < HIST_BUCKETS);
+        ASSERT(hist_bucket_low(b) <= v);
+        ASSERT(hist_bucket_high(b) >= v);
+    }
+
+    for (b = 1; b < HIST_BUCKETS; b++)
+    {
+        ASSERT(hist_bucket_low(b) == hist_bucket_high(b - 1) + 1);
+    }
+
+    ASSERT(hist_bucket((uint64_t)-1) == HIST_BUCKETS - 1);
+    ASSERT(hist_bucket_high(HIST_BUCKETS - 1) == (uint64_t)-1);
+
+    hist_init(&h);
+    ASSERT(hist_percentile(&h, 500) == 0);
+
+    for (v = 1; v <= 1000; v++)
+    {
+        hist_record(&h, v);
+    }
+
+    ASSERT(h.total == 1000);
+    ASSERT(h.min == 1);
+    ASSERT(h.max == 1000);
+    ASSERT(hist_mean(&h) == 500);
+    ASSERT(hist_percentile(&h, 0) == 1);
+    ASSERT(hist_percentile(&h, 1000) == 1000);
+
+    // the error is less than 1/HIST_SUB_BUCKETS
+    v = hist_percentile(&h, 500);
+    ASSERT((v >= 500) && (v <= 500 + 500 / HIST_SUB_BUCKETS));
+    v = hist_percentile(&h, 990);
+    ASSERT((v >= 990) && (v <= 1000));
+}
+
+void test_case1(void)
+{
+    histogram_t h1;
+    histogram_t h2;
+
+    hist_init(&h1);
+    hist_init(&h2);
+
+    hist_record(&h1, 10);
+    hist_record(&h2, 1000000);
+    hist_record(&h2, 5);
+    hist_merge(&h1, &h2);
+
+    ASSERT(h1.total == 3);
+    ASSERT(h1.min == 5);
+    ASSERT(h1.max == 1000000);
+    ASSERT(hist_percentile(&h1, 500) == 10);
+    ASSERT(hist_percentile(&h1, 999) == 1000000);
+}
+
+int main(int argc, char *argv[])
+{
+    test_case0();
+    test_case1();
+
+    printf("test histogram finished.\n");
+    
+    return 0;
+}
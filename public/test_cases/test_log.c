@@ -4,10 +4,61 @@
 
 MODULE(10);
 
+#define TEST_THREADS_NUM   4
+#define TEST_LINES_NUM     10000
+#define TEST_ERRORS_STEP   10     /* one error line every 10 lines */
+
+void *log_thread(void *para)
+{
+    int i;
+
+    for (i = 0; i < TEST_LINES_NUM; i++)
+    {
+        LOG_WARN("Thread %ld line %d\n", (long)para, i);
+        if ((i % TEST_ERRORS_STEP) == 0)
+        {
+            LOG_ERROR("Thread %ld error %d\n", (long)para, i);
+        }
+    }
+
+    return NULL;
+}
+
+// count the lines of the threads in the log file
+void count_thread_lines(const char *name, int *lines, int *errors)
+{
+    char buf[1024];
+    FILE *f;
+
+    *lines = 0;
+    *errors = 0;
+
+    f = fopen(name, "r");
+    ASSERT(f != NULL);
+
+    while (fgets(buf, sizeof(buf), f))
+    {
+        if (strstr(buf, "[WARN ]") && strstr(buf, " line "))
+        {
+            (*lines)++;
+        }
+        else if (strstr(buf, "[ERROR]") && strstr(buf, " error "))
+        {
+            (*errors)++;
+        }
+    }
+
+    fclose(f);
+}
+
 
 int main(int argc, char *argv[])
 {
     int i;
+    int lines;
+    int errors;
+    uint32_t dropped;
+    os_thread_t tids[TEST_THREADS_NUM];
 
     LOG_SYSTEM_INIT("./log", "test");
     
@@ -36,8 +87,28 @@ int main(int argc, char *argv[])
     LOG_SET_LEVEL(3);
     ASSERT(LOG_GET_LEVEL() == 3);
 
+    // the lines are written by the writer thread, the threads never wait
+    for (i = 0; i < TEST_THREADS_NUM; i++)
+    {
+        tids[i] = thread_create(log_thread, (void *)(long)i, "log_test");
+        ASSERT(tids[i] != INVALID_TID);
+    }
+
+    for (i = 0; i < TEST_THREADS_NUM; i++)
+    {
+        thread_destroy(tids[i], FALSE);
+    }
+
+    // the lines left are written when closed
+    dropped = log_get_dropped(g_log_hnd);
     LOG_SYSTEM_EXIT();
 
+    // the lines are either written or counted, and the errors are never dropped
+    count_thread_lines("./log/test.log", &lines, &errors);
+    printf("lines(%d) dropped(%u) errors(%d)\n", lines, dropped, errors);
+    ASSERT(lines + dropped == TEST_THREADS_NUM * TEST_LINES_NUM);
+    ASSERT(errors == TEST_THREADS_NUM * TEST_LINES_NUM / TEST_ERRORS_STEP);
+
     sleep(1);
 
     return 0;
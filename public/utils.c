@@ -37,6 +37,10 @@ History:
 
 #ifndef __KERNEL__
 
+#ifndef WIN32
+#define _GNU_SOURCE   /* pthread_rwlockattr_setkind_np */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -83,6 +87,32 @@ uint64_t os_get_ms_count(void)
 #endif
 }
 
+// monotonic time for measuring the latency
+uint64_t os_get_ns_count(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER cnt;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&cnt);
+    
+    return (uint64_t)((double)cnt.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#elif defined(__KERNEL__)
+    struct timeval tv;
+
+    do_gettimeofday(&tv);
+    
+    return ((((uint64_t)tv.tv_sec) * 1000000000) + (((uint64_t)tv.tv_usec) * 1000));
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return ((((uint64_t)ts.tv_sec) * 1000000000) + ((uint64_t)ts.tv_nsec));
+#endif
+}
+
 uint64_t os_get_second_count(void)
 {
 #ifdef __KERNEL__
@@ -222,6 +252,25 @@ uint64_t os_convert_u64(const uint64_t src)
     return dst;
 }
 
+// crc32 (ieee 802.3, reflected), pass the returned crc to continue on next buffer
+uint32_t os_crc32(uint32_t crc, const void *buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t i = 0;
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
 #ifdef __KERNEL__
 
 int32_t os_get_date_time_string(char *str, int32_t str_size)
@@ -271,6 +320,166 @@ int32_t os_get_date_time_string(char *str, int32_t str_size)
 
 #endif
 
+#if !defined(__KERNEL__) && !defined(WIN32)
 
+int os_rwlock_init_writer_first(os_rwlock *lock)
+{
+    pthread_rwlockattr_t attr;
+    int ret = 0;
 
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+#ifdef OS_LOCK_PROFILE
+    ret = pthread_rwlock_init(&lock->lock, &attr);
+#else
+    ret = pthread_rwlock_init(lock, &attr);
+#endif
+    pthread_rwlockattr_destroy(&attr);
 
+    return ret;
+}
+
+#endif
+
+#ifdef OS_LOCK_PROFILE
+
+#define OS_LOCK_HELD_MAX   32
+
+// the locks held by current thread, for the hold time
+typedef struct os_lock_held
+{
+    os_rwlock *lock;
+    os_lock_site_t *site;
+    uint64_t start;
+} os_lock_held_t;
+
+static os_lock_site_t *volatile g_lock_sites = NULL;
+static __thread os_lock_held_t g_locks_held[OS_LOCK_HELD_MAX];
+static __thread uint32_t g_locks_held_num = 0;
+
+static void lock_site_register(os_lock_site_t *site)
+{
+    if (site->registered || !__sync_bool_compare_and_swap(&site->registered, 0, 1))
+    {
+        return;
+    }
+
+    do
+    {
+        site->next = g_lock_sites;
+    } while (!__sync_bool_compare_and_swap(&g_lock_sites, site->next, site));
+}
+
+static void lock_update_max(volatile uint64_t *max, uint64_t value)
+{
+    uint64_t old = 0;
+
+    while (value > (old = *max))
+    {
+        if (__sync_bool_compare_and_swap(max, old, value))
+        {
+            break;
+        }
+    }
+}
+
+int os_rwlock_prof_lock(os_rwlock *lock, os_lock_site_t *site)
+{
+    uint64_t start = 0;
+    uint64_t now = 0;
+    int ret = 0;
+
+    lock_site_register(site);
+
+    ret = site->write ? pthread_rwlock_trywrlock(&lock->lock) : pthread_rwlock_tryrdlock(&lock->lock);
+    if (ret == EBUSY)
+    {
+        start = os_get_ns_count();
+        ret = site->write ? pthread_rwlock_wrlock(&lock->lock) : pthread_rwlock_rdlock(&lock->lock);
+        now = os_get_ns_count();
+
+        (void)__sync_fetch_and_add(&site->contended, 1);
+        (void)__sync_fetch_and_add(&site->wait_ns, now - start);
+        lock_update_max(&site->max_wait_ns, now - start);
+    }
+    else
+    {
+        now = os_get_ns_count();
+    }
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    (void)__sync_fetch_and_add(&site->acquired, 1);
+
+    if (g_locks_held_num < OS_LOCK_HELD_MAX)
+    {
+        g_locks_held[g_locks_held_num].lock = lock;
+        g_locks_held[g_locks_held_num].site = site;
+        g_locks_held[g_locks_held_num].start = now;
+    }
+
+    g_locks_held_num++;
+
+    return 0;
+}
+
+int os_rwlock_prof_unlock(os_rwlock *lock)
+{
+    os_lock_site_t *site = NULL;
+    uint64_t hold = 0;
+    uint32_t i = 0;
+
+    if (g_locks_held_num > 0)
+    {
+        // the latest one locked, the locks are not always released in order
+        i = (g_locks_held_num < OS_LOCK_HELD_MAX) ? g_locks_held_num : OS_LOCK_HELD_MAX;
+        while ((i > 0) && (g_locks_held[i - 1].lock != lock))
+        {
+            i--;
+        }
+
+        if (i > 0)
+        {
+            site = g_locks_held[i - 1].site;
+            hold = os_get_ns_count() - g_locks_held[i - 1].start;
+            (void)__sync_fetch_and_add(&site->hold_ns, hold);
+            lock_update_max(&site->max_hold_ns, hold);
+
+            for (; (i < g_locks_held_num) && (i < OS_LOCK_HELD_MAX); i++)
+            {
+                g_locks_held[i - 1] = g_locks_held[i];
+            }
+        }
+
+        g_locks_held_num--;
+    }
+
+    return pthread_rwlock_unlock(&lock->lock);
+}
+
+os_lock_site_t *os_lock_prof_sites(void)
+{
+    return g_lock_sites;
+}
+
+void os_lock_prof_reset(void)
+{
+    os_lock_site_t *site = NULL;
+
+    for (site = g_lock_sites; site != NULL; site = site->next)
+    {
+        site->acquired = 0;
+        site->contended = 0;
+        site->wait_ns = 0;
+        site->max_wait_ns = 0;
+        site->hold_ns = 0;
+        site->max_hold_ns = 0;
+    }
+}
+
+#endif
@@ -44,11 +44,13 @@ extern "C" {
 
 extern uint64_t os_get_cycle_count(void);
 extern uint64_t os_get_ms_count(void);
+extern uint64_t os_get_ns_count(void);
 extern uint64_t os_get_second_count(void);
 extern int32_t os_str_to_u64(const char *str, uint64_t *value, uint32_t base);
 extern char os_char_to_hex(char c);
 extern int32_t os_str_to_hex(char *str, uint8_t *hex, uint32_t hex_len);
 extern uint64_t os_convert_u64(const uint64_t src);
+extern uint32_t os_crc32(uint32_t crc, const void *buf, uint32_t len);
 extern int32_t os_get_date_time_string(char *str, int32_t str_size);
 
 #ifdef __cplusplus
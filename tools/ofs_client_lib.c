@@ -0,0 +1,561 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_CLIENT_LIB.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "os_adapter.h"
+#include "ofs_client.h"
+
+#define CLIENT_BUF_SIZE   (64 * 1024)
+
+struct ofs_client
+{
+    int fd;
+    uint64_t seq;             // seq of the next frame
+    uint64_t acked;           // seq of the last reply received
+    
+    uint8_t *buf;             // the frame being built
+    uint32_t buf_size;
+    uint32_t buf_len;
+    uint16_t ops_num;
+
+    uint8_t *reply;           // the reply frame received
+    uint32_t reply_size;
+};
+
+static int32_t send_all(int fd, const uint8_t *buf, uint32_t len)
+{
+    ssize_t n = 0;
+
+    while (len > 0)
+    {
+        n = send(fd, buf, len, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            
+            return -OFS_PROTO_ERR_SEND;
+        }
+
+        buf += n;
+        len -= (uint32_t)n;
+    }
+
+    return 0;
+}
+
+static int32_t recv_all(int fd, uint8_t *buf, uint32_t len)
+{
+    ssize_t n = 0;
+
+    while (len > 0)
+    {
+        n = recv(fd, buf, len, 0);
+        if (n <= 0)
+        {
+            if ((n < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            
+            return -OFS_PROTO_ERR_RECV;
+        }
+
+        buf += n;
+        len -= (uint32_t)n;
+    }
+
+    return 0;
+}
+
+static int32_t reserve_buf(uint8_t **buf, uint32_t *size, uint32_t len)
+{
+    uint8_t *new_buf = NULL;
+    uint32_t new_size = *size;
+
+    if (len <= *size)
+    {
+        return 0;
+    }
+
+    while (new_size < len)
+    {
+        new_size <<= 1;
+    }
+
+    new_buf = realloc(*buf, new_size);
+    if (!new_buf)
+    {
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    *buf = new_buf;
+    *size = new_size;
+
+    return 0;
+}
+
+int32_t ofs_client_connect(const char *host, uint16_t port, ofs_client_t **client)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    struct addrinfo *ai = NULL;
+    ofs_client_t *c = NULL;
+    char service[16];
+    int on = 1;
+
+    if ((!host) || (!client))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    c = OS_MALLOC(sizeof(ofs_client_t));
+    if (!c)
+    {
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    memset(c, 0, sizeof(ofs_client_t));
+    c->fd = -1;
+    c->seq = 1;
+    c->buf_size = CLIENT_BUF_SIZE;
+    c->reply_size = CLIENT_BUF_SIZE;
+    c->buf = OS_MALLOC(c->buf_size);
+    c->reply = OS_MALLOC(c->reply_size);
+    if ((!c->buf) || (!c->reply))
+    {
+        ofs_client_disconnect(c);
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    c->buf_len = sizeof(ofs_proto_head_t);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", port);
+    
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+    {
+        ofs_client_disconnect(c);
+        return -OFS_PROTO_ERR_CONNECT;
+    }
+
+    for (ai = res; ai != NULL; ai = ai->ai_next)
+    {
+        c->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (c->fd < 0)
+        {
+            continue;
+        }
+
+        if (connect(c->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            break;
+        }
+
+        close(c->fd);
+        c->fd = -1;
+    }
+    
+    freeaddrinfo(res);
+
+    if (c->fd < 0)
+    {
+        ofs_client_disconnect(c);
+        return -OFS_PROTO_ERR_CONNECT;
+    }
+
+    // the small frames should not wait
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    *client = c;
+
+    return 0;
+}
+
+void ofs_client_disconnect(ofs_client_t *client)
+{
+    if (!client)
+    {
+        return;
+    }
+
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+    }
+
+    if (client->buf)
+    {
+        OS_FREE(client->buf);
+    }
+
+    if (client->reply)
+    {
+        OS_FREE(client->reply);
+    }
+
+    OS_FREE(client);
+}
+
+int32_t ofs_client_add_op(ofs_client_t *client, uint8_t opcode, uint8_t flags,
+    uint64_t handle, const void *key, uint16_t key_len, const void *value, uint32_t value_len)
+{
+    ofs_proto_op_t op;
+    uint32_t data_len = (opcode == OFS_OP_SCAN) ? 0 : value_len;
+    int32_t ret = 0;
+
+    if ((!client) || (client->ops_num >= OFS_PROTO_MAX_OPS)
+        || (client->buf_len + sizeof(op) + key_len + data_len > OFS_PROTO_MAX_FRAME))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    ret = reserve_buf(&client->buf, &client->buf_size,
+        client->buf_len + (uint32_t)sizeof(op) + key_len + data_len);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    op.opcode = opcode;
+    op.flags = flags;
+    op.key_len = key_len;
+    op.value_len = value_len;
+    op.handle = handle;
+
+    memcpy(client->buf + client->buf_len, &op, sizeof(op));
+    client->buf_len += sizeof(op);
+    
+    if (key_len)
+    {
+        memcpy(client->buf + client->buf_len, key, key_len);
+        client->buf_len += key_len;
+    }
+
+    if (data_len)
+    {
+        memcpy(client->buf + client->buf_len, value, data_len);
+        client->buf_len += data_len;
+    }
+
+    client->ops_num++;
+
+    return 0;
+}
+
+int32_t ofs_client_flush(ofs_client_t *client, uint64_t *seq)
+{
+    ofs_proto_head_t head;
+    int32_t ret = 0;
+
+    if ((!client) || (client->ops_num == 0))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    head.magic = OFS_PROTO_MAGIC;
+    head.ops_num = client->ops_num;
+    head.len = client->buf_len - (uint32_t)sizeof(head);
+    head.seq = client->seq;
+    memcpy(client->buf, &head, sizeof(head));
+
+    ret = send_all(client->fd, client->buf, client->buf_len);
+
+    client->buf_len = sizeof(ofs_proto_head_t);
+    client->ops_num = 0;
+    
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (seq)
+    {
+        *seq = client->seq;
+    }
+    
+    client->seq++;
+
+    return 0;
+}
+
+// get the replies until the frame of seq
+int32_t ofs_client_wait(ofs_client_t *client, uint64_t seq, ofs_client_cb_t cb, void *para)
+{
+    ofs_proto_head_t head;
+    ofs_proto_result_t result;
+    uint32_t pos = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    if (!client)
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    // the replies are received already
+    if (seq <= client->acked)
+    {
+        return 0;
+    }
+
+    do
+    {
+        ret = recv_all(client->fd, (uint8_t *)&head, sizeof(head));
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        if ((head.magic != OFS_PROTO_MAGIC) || (head.len > OFS_PROTO_MAX_FRAME))
+        {
+            return -OFS_PROTO_ERR_FRAME;
+        }
+
+        ret = reserve_buf(&client->reply, &client->reply_size, head.len);
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        ret = recv_all(client->fd, client->reply, head.len);
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        for (i = 0, pos = 0; i < head.ops_num; i++)
+        {
+            if (pos + sizeof(result) > head.len)
+            {
+                return -OFS_PROTO_ERR_FRAME;
+            }
+
+            memcpy(&result, client->reply + pos, sizeof(result));
+            pos += sizeof(result);
+            if (pos + result.len > head.len)
+            {
+                return -OFS_PROTO_ERR_FRAME;
+            }
+
+            if (cb)
+            {
+                cb(para, head.seq, i, result.ret, client->reply + pos, result.len);
+            }
+
+            pos += result.len;
+        }
+
+        client->acked = head.seq;
+    } while (head.seq < seq);
+
+    return 0;
+}
+
+typedef struct client_result
+{
+    int32_t ret;
+    uint8_t *buf;
+    uint32_t size;
+    ofs_scan_cb_t scan_cb;
+    void *para;
+} client_result_t;
+
+static void copy_result(void *para, uint64_t seq, uint32_t index,
+    int32_t ret, const uint8_t *data, uint32_t len)
+{
+    client_result_t *res = (client_result_t *)para;
+    
+    res->ret = ret;
+    if ((ret >= 0) && res->buf)
+    {
+        memcpy(res->buf, data, (len < res->size) ? len : res->size);
+        res->ret = (int32_t)len;
+    }
+}
+
+static void walk_scan_result(void *para, uint64_t seq, uint32_t index,
+    int32_t ret, const uint8_t *data, uint32_t len)
+{
+    client_result_t *res = (client_result_t *)para;
+    ofs_proto_kv_t kv;
+    uint32_t pos = 0;
+    int32_t i = 0;
+    
+    res->ret = ret;
+    for (i = 0; i < ret; i++)
+    {
+        if (pos + sizeof(kv) > len)
+        {
+            break;
+        }
+        
+        memcpy(&kv, data + pos, sizeof(kv));
+        pos += sizeof(kv);
+        if (pos + kv.key_len + kv.value_len > len)
+        {
+            break;
+        }
+
+        if (res->scan_cb(res->para, data + pos, kv.key_len, data + pos + kv.key_len, kv.value_len) < 0)
+        {
+            break;
+        }
+
+        pos += kv.key_len + kv.value_len;
+    }
+}
+
+static int32_t exec_one_op(ofs_client_t *client, uint8_t opcode, uint8_t flags,
+    uint64_t handle, const void *key, uint16_t key_len, const void *value, uint32_t value_len,
+    ofs_client_cb_t cb, client_result_t *res)
+{
+    uint64_t seq = 0;
+    int32_t ret = 0;
+
+    ret = ofs_client_add_op(client, opcode, flags, handle, key, key_len, value, value_len);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    
+    ret = ofs_client_flush(client, &seq);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ret = ofs_client_wait(client, seq, cb, res);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    return res->ret;
+}
+
+int32_t ofs_client_open(ofs_client_t *client, const char *ct_name, uint64_t objid,
+    uint8_t flags, uint64_t *handle)
+{
+    client_result_t res;
+    
+    if ((!ct_name) || (!handle))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    memset(&res, 0, sizeof(res));
+    res.buf = (uint8_t *)handle;
+    res.size = sizeof(uint64_t);
+    
+    return exec_one_op(client, OFS_OP_OPEN, flags, 0, ct_name, (uint16_t)strlen(ct_name),
+        &objid, sizeof(objid), copy_result, &res);
+}
+
+int32_t ofs_client_close(ofs_client_t *client, uint64_t handle)
+{
+    client_result_t res;
+    
+    memset(&res, 0, sizeof(res));
+    
+    return exec_one_op(client, OFS_OP_CLOSE, 0, handle, NULL, 0, NULL, 0, copy_result, &res);
+}
+
+// return the length of the value
+int32_t ofs_client_get(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, void *value, uint32_t value_size)
+{
+    client_result_t res;
+    
+    memset(&res, 0, sizeof(res));
+    res.buf = (uint8_t *)value;
+    res.size = value_size;
+    
+    return exec_one_op(client, OFS_OP_GET, 0, handle, key, key_len, NULL, 0, copy_result, &res);
+}
+
+int32_t ofs_client_put(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, const void *value, uint16_t value_len)
+{
+    client_result_t res;
+    
+    memset(&res, 0, sizeof(res));
+    
+    return exec_one_op(client, OFS_OP_PUT, 0, handle, key, key_len, value, value_len, copy_result, &res);
+}
+
+int32_t ofs_client_del(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len)
+{
+    client_result_t res;
+    
+    memset(&res, 0, sizeof(res));
+    
+    return exec_one_op(client, OFS_OP_DEL, 0, handle, key, key_len, NULL, 0, copy_result, &res);
+}
+
+// return the number of pairs
+int32_t ofs_client_scan(ofs_client_t *client, uint64_t handle, const void *key,
+    uint16_t key_len, uint32_t max_pairs, ofs_scan_cb_t cb, void *para)
+{
+    client_result_t res;
+
+    if (!cb)
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+    
+    memset(&res, 0, sizeof(res));
+    res.scan_cb = cb;
+    res.para = para;
+    
+    return exec_one_op(client, OFS_OP_SCAN, 0, handle, key, key_len, NULL, max_pairs,
+        walk_scan_result, &res);
+}
+
@@ -1,98 +1,229 @@
-#include <sys/socket.h>   
-#include <arpa/inet.h> 
-#include <string.h>    
-#include <errno.h>    
-#include <stdlib.h>    
-#include <unistd.h>    
-#include <netdb.h>  
-  
-#include <event.h>    
-#include <event2/event.h>    
-  
-//     
-void error_quit(const char *str)    
-{    
-    perror(str);    
-    exit(1);     
-}    
-  
-// call back when connection state changed    
-void eventcb(struct bufferevent *bev, short events, void *ptr)    
-{    
-    struct event_base *tbase = (struct event_base*)ptr;    
-
-    if ( !(events & BEV_EVENT_CONNECTED) )     
-    {    
-        bufferevent_free(bev);    
-        event_base_loopbreak(tbase);    
-        printf("The connect have been shutdown: %X\n", events);    
-    }     
-}    
-  
-// server info comes    
-void sockreadcb(struct bufferevent *bev, void *ptr)    
-{    
-    struct evbuffer *input = bufferevent_get_input(bev);    
-    evbuffer_write(input, STDOUT_FILENO);    
-}    
-  
-// keyboard info comes   
-void stdreadcb(struct bufferevent *bev, void *ptr)    
-{    
-    struct bufferevent *sockbev = (struct bufferevent*)ptr;     
-    struct evbuffer *input = bufferevent_get_input(bev);    
-    bufferevent_write_buffer(sockbev, input);    
-}    
-  
-int main(int argc, char **argv)    
-{    
-    struct sockaddr_in servaddr;    
-    struct event *shellev;    
-    char *res;    
-    int ret;    
-    struct event_base *base;    
-    struct bufferevent *sockbev;    
-    struct bufferevent *stdbev;    
-  
-    if(argc != 3)    
-        error_quit("Using: mytelnet <Address> <Port>");    
-  
-    char address[32] = {0};  
-  
-    // DNS parse
-    struct hostent *host = gethostbyname(argv[1]);  
-    memset(&servaddr, 0, sizeof(servaddr));        
-    servaddr.sin_family = AF_INET;        
-    servaddr.sin_port = htons(atoi(argv[2]));  
-  
-    res = inet_ntop(host->h_addrtype, host->h_addr, address, sizeof(address));  
-    if(res == NULL)    
-        error_quit("inet_ntop error");       
-    ret = inet_pton(AF_INET, address, &servaddr.sin_addr);      
-    if(ret != 1)    
-        error_quit("inet_pton error");       
-  
-    base = event_base_new();    
-  
-    // connect to the server and listen   
-    sockbev = bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE);    
-    ret = bufferevent_socket_connect(sockbev,    
-        (struct sockaddr *)&servaddr, sizeof(servaddr));    
-    if ( ret < 0 )     
-        error_quit("connect error");    
-  
-    bufferevent_setcb(sockbev, sockreadcb, NULL, eventcb, (void*)base);    
-    bufferevent_enable(sockbev, EV_READ);    
-    bufferevent_enable(sockbev, EV_WRITE);    
-  
-    // listen to keyboard   
-    stdbev = bufferevent_socket_new(base, STDIN_FILENO, BEV_OPT_CLOSE_ON_FREE);    
-    bufferevent_setcb(stdbev, stdreadcb, NULL, NULL, (void*)sockbev);    
-    bufferevent_enable(stdbev, EV_READ);    
-    bufferevent_enable(stdbev, EV_WRITE);    
-  
-    // loop    
-    event_base_dispatch(base);    
-  
-    return 0;    
-}  
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_CLIENT_MAIN.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "os_adapter.h"
+#include "ofs_client.h"
+
+#define LINE_SIZE       1024
+#define BENCH_BATCH     64      /* ops in one frame */
+#define BENCH_PIPELINE  16      /* frames sent before waiting for the reply */
+
+static int32_t print_pair(void *para, const uint8_t *key, uint16_t key_len,
+    const uint8_t *value, uint16_t value_len)
+{
+    printf("key: %.*s, value: %.*s\n", key_len, key, value_len, value);
+    return 0;
+}
+
+static void count_failed(void *para, uint64_t seq, uint32_t index,
+    int32_t ret, const uint8_t *data, uint32_t len)
+{
+    if (ret < 0)
+    {
+        (*(uint64_t *)para)++;
+    }
+}
+
+static uint64_t get_time_us(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// insert and search keys_num keys by batched and pipelined frames
+static void bench(ofs_client_t *client, uint64_t handle, uint8_t opcode, uint64_t keys_num)
+{
+    char key[32];
+    uint64_t i = 0;
+    uint64_t seq = 0;
+    uint64_t failed = 0;
+    uint64_t start = get_time_us();
+    uint64_t cost = 0;
+    int32_t ret = 0;
+    uint16_t key_len = 0;
+
+    for (i = 0; i < keys_num; i++)
+    {
+        key_len = (uint16_t)snprintf(key, sizeof(key), "bench%016llu", (unsigned long long)i);
+        ret = ofs_client_add_op(client, opcode, 0, handle, key, key_len, key, key_len);
+        if (ret < 0)
+        {
+            break;
+        }
+
+        if (((i + 1) % BENCH_BATCH) && (i + 1 < keys_num))
+        {
+            continue;
+        }
+        
+        ret = ofs_client_flush(client, &seq);
+        if (ret < 0)
+        {
+            break;
+        }
+
+        // keep BENCH_PIPELINE frames on the way
+        if (seq > BENCH_PIPELINE)
+        {
+            ret = ofs_client_wait(client, seq - BENCH_PIPELINE, count_failed, &failed);
+            if (ret < 0)
+            {
+                break;
+            }
+        }
+    }
+
+    if (ret >= 0)
+    {
+        ret = ofs_client_wait(client, seq, count_failed, &failed);
+    }
+
+    cost = get_time_us() - start;
+    printf("ops: %llu, failed: %llu, cost: %llu us, ops/s: %llu, ret: %d\n",
+        (unsigned long long)keys_num, (unsigned long long)failed, (unsigned long long)cost,
+        (unsigned long long)(cost ? keys_num * 1000000 / cost : 0), ret);
+}
+
+static void exec_line(ofs_client_t *client, uint64_t handle, char *line)
+{
+    char value[LINE_SIZE];
+    char *cmd = strtok(line, " \t\r\n");
+    char *key = strtok(NULL, " \t\r\n");
+    char *para = strtok(NULL, " \t\r\n");
+    int32_t ret = 0;
+
+    if (!cmd)
+    {
+        return;
+    }
+
+    if ((strcmp(cmd, "put") == 0) && key && para)
+    {
+        ret = ofs_client_put(client, handle, key, (uint16_t)strlen(key), para, (uint16_t)strlen(para));
+        printf("put ret: %d\n", ret);
+    }
+    else if ((strcmp(cmd, "get") == 0) && key)
+    {
+        ret = ofs_client_get(client, handle, key, (uint16_t)strlen(key), value, sizeof(value));
+        if (ret >= 0)
+        {
+            printf("value: %.*s\n", (ret < (int32_t)sizeof(value)) ? ret : (int32_t)sizeof(value), value);
+        }
+        else
+        {
+            printf("get ret: %d\n", ret);
+        }
+    }
+    else if ((strcmp(cmd, "del") == 0) && key)
+    {
+        ret = ofs_client_del(client, handle, key, (uint16_t)strlen(key));
+        printf("del ret: %d\n", ret);
+    }
+    else if (strcmp(cmd, "scan") == 0)
+    { // scan [start_key|-] [max_pairs]
+        if (key && (strcmp(key, "-") == 0))
+        {
+            key = NULL;
+        }
+        
+        ret = ofs_client_scan(client, handle, key, key ? (uint16_t)strlen(key) : 0,
+            para ? (uint32_t)strtoul(para, NULL, 0) : 10, print_pair, NULL);
+        printf("scan ret: %d\n", ret);
+    }
+    else if ((strcmp(cmd, "bench") == 0) && key)
+    { // bench <put|get|del> [keys_num]
+        uint8_t opcode = (strcmp(key, "get") == 0) ? OFS_OP_GET
+            : ((strcmp(key, "del") == 0) ? OFS_OP_DEL : OFS_OP_PUT);
+        
+        bench(client, handle, opcode, para ? strtoull(para, NULL, 0) : 100000);
+    }
+    else
+    {
+        printf("put <key> <value>\nget <key>\ndel <key>\nscan [start_key|-] [max_pairs]\n"
+            "bench <put|get|del> [keys_num]\nquit\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ofs_client_t *client = NULL;
+    uint64_t handle = 0;
+    char line[LINE_SIZE];
+    int32_t ret = 0;
+
+    if (argc != 5)
+    {
+        printf("Usage: %s <address> <port> <ct_name> <objid>\n", argv[0]);
+        return 1;
+    }
+
+    ret = ofs_client_connect(argv[1], (uint16_t)atoi(argv[2]), &client);
+    if (ret < 0)
+    {
+        printf("Connect failed. address(%s) port(%s) ret(%d)\n", argv[1], argv[2], ret);
+        return 1;
+    }
+
+    ret = ofs_client_open(client, argv[3], strtoull(argv[4], NULL, 0), OFS_OPEN_CREATE, &handle);
+    if (ret < 0)
+    {
+        printf("Open object failed. ct(%s) objid(%s) ret(%d)\n", argv[3], argv[4], ret);
+        ofs_client_disconnect(client);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), stdin))
+    {
+        if (strncmp(line, "quit", 4) == 0)
+        {
+            break;
+        }
+        
+        exec_line(client, handle, line);
+    }
+
+    (void)ofs_client_close(client, handle);
+    ofs_client_disconnect(client);
+
+    return 0;
+}
@@ -39,17 +39,80 @@ History:
 #include <errno.h>
 #include <assert.h>
 
+#include <sys/socket.h>
+#include <netinet/in.h>
+
 #include <event2/event.h>
 #include <event2/bufferevent.h>
+#include <event2/buffer.h>
+#include <event2/thread.h>
 
 #include <stdarg.h>
 #include "ofs_if.h"
+#include "ofs_server.h"
 
 MODULE(PID_SERVER);
-#include "os_log.h"
+#include "log.h"
 
 extern os_cmd_list_t ifs_cmd_list[];
 
+#define LISTEN_PORT      9999
+#define LISTEN_BACKLOG   32
+#define MAX_LINE         256
+
+#define DEFAULT_LOOPS    1    /* event loops, each has its own listener */
+#define DEFAULT_WORKERS  4    /* threads to execute the commands */
+
+// one command line or binary frame received
+typedef struct server_request
+{
+    list_head_t entry;
+    bool_t binary;
+    uint32_t len;
+    char data[0];
+} server_request_t;
+
+/* protocol of the connection, decided by the first byte */
+#define PROTO_UNKNOWN   0
+#define PROTO_TEXT      1
+#define PROTO_BINARY    2
+
+// the requests of one connection are executed one by one in order
+typedef struct server_conn
+{
+    struct bufferevent *bev;
+    list_head_t requests;      // requests waiting for execution
+    list_head_t entry;         // in the run queue of worker pool
+    bool_t running;            // in the run queue or being executed
+    bool_t closed;             // the connection closed by peer
+    uint32_t proto;
+    proto_handles_t handles;   // the objects opened by binary protocol
+} server_conn_t;
+
+typedef struct worker_pool
+{
+    pthread_mutex_t lock;      // protect the pool and all connections state
+    pthread_cond_t cond;
+    list_head_t run_queue;     // connections have requests to execute
+    bool_t stop;
+    uint32_t workers_num;
+    pthread_t *workers;
+} worker_pool_t;
+
+typedef struct event_loop
+{
+    struct event_base *base;
+    struct event *listen_event;
+    evutil_socket_t listener;
+    pthread_t tid;
+} event_loop_t;
+
+static worker_pool_t g_pool;
+
+void do_accept(evutil_socket_t listener, short event, void *arg);
+void read_cb(struct bufferevent *bev, void *arg);
+void error_cb(struct bufferevent *bev, short event, void *arg);
+
 int net_print(void *net, const char *format, ...)
 {
     #define BUF_LEN  1024
@@ -61,53 +124,283 @@ int net_print(void *net, const char *format, ...)
     cnt = vsnprintf(buf, BUF_LEN, format, ap);
     va_end(ap);
 
+    if (cnt >= BUF_LEN)
+    {
+        cnt = BUF_LEN - 1;
+    }
+
     bufferevent_write(net, buf, cnt);
     //printf("%s", buf);
 
     return cnt;
 }
 
+// called without the pool lock, closing the handles may commit the containers
+static void free_conn(server_conn_t *conn)
+{
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
 
-#define LISTEN_PORT 9999
-#define LISTEN_BACKLOG 32
+    list_for_each_safe(pos, n, &conn->requests)
+    {
+        list_del(pos);
+        OS_FREE(list_entry(pos, server_request_t, entry));
+    }
 
-void do_accept(evutil_socket_t listener, short event, void *arg);
-void read_cb(struct bufferevent *bev, void *arg);
-void error_cb(struct bufferevent *bev, short event, void *arg);
-void write_cb(struct bufferevent *bev, void *arg);
+    proto_close_handles(&conn->handles);
+    bufferevent_free(conn->bev);
+    OS_FREE(conn);
+}
 
-int main(int argc, char *argv[])
+// must be called with the pool lock
+static void schedule_conn(server_conn_t *conn)
 {
-    int ret;
-    evutil_socket_t listener;
-    listener = socket(AF_INET, SOCK_STREAM, 0);
-    assert(listener > 0);
-    evutil_make_listen_socket_reuseable(listener);
+    if (conn->running || (conn->requests.next == &conn->requests))
+    {
+        return;
+    }
+
+    conn->running = TRUE;
+    list_add_tail(&g_pool.run_queue, &conn->entry);
+    pthread_cond_signal(&g_pool.cond);
+}
+
+static void exec_request(server_conn_t *conn, server_request_t *req)
+{
+    net_para_t net;
+    struct evbuffer *out;
+
+    if (req->binary)
+    { // all the replies of the frame are sent together
+        out = evbuffer_new();
+        if (out)
+        {
+            (void)proto_exec_frame(&conn->handles, (uint8_t *)req->data, req->len, out);
+            bufferevent_write_buffer(conn->bev, out);
+            evbuffer_free(out);
+        }
+        
+        return;
+    }
+    
+    net.net = conn->bev;
+    net.print = net_print;
+    parse_and_exec_cmd(req->data, ifs_cmd_list, &net);
+
+    bufferevent_write(conn->bev, ">", 2);
+}
+
+static void *worker_thread(void *arg)
+{
+    server_conn_t *conn = NULL;
+    server_request_t *req = NULL;
+    list_head_t *entry = NULL;
+
+    pthread_mutex_lock(&g_pool.lock);
+    
+    for (;;)
+    {
+        while ((!g_pool.stop) && (g_pool.run_queue.next == &g_pool.run_queue))
+        {
+            pthread_cond_wait(&g_pool.cond, &g_pool.lock);
+        }
+
+        if (g_pool.stop)
+        {
+            break;
+        }
+
+        entry = g_pool.run_queue.next;
+        list_del(entry);
+        conn = list_entry(entry, server_conn_t, entry);
+        
+        entry = conn->requests.next;
+        list_del(entry);
+        req = list_entry(entry, server_request_t, entry);
+        
+        pthread_mutex_unlock(&g_pool.lock);
+
+        if (!conn->closed)
+        {
+            exec_request(conn, req);
+        }
+        
+        OS_FREE(req);
+        
+        pthread_mutex_lock(&g_pool.lock);
+        
+        conn->running = FALSE;
+        if (conn->closed)
+        { // nobody else can reach the connection now
+            pthread_mutex_unlock(&g_pool.lock);
+            free_conn(conn);
+            pthread_mutex_lock(&g_pool.lock);
+            continue;
+        }
+
+        // the next request of this connection is queued behind others
+        schedule_conn(conn);
+    }
+    
+    pthread_mutex_unlock(&g_pool.lock);
+
+    return NULL;
+}
+
+static int start_worker_pool(uint32_t workers_num)
+{
+    uint32_t i = 0;
+    
+    pthread_mutex_init(&g_pool.lock, NULL);
+    pthread_cond_init(&g_pool.cond, NULL);
+    INIT_LIST_HEAD(&g_pool.run_queue);
+    g_pool.stop = FALSE;
+    
+    g_pool.workers = OS_MALLOC(sizeof(pthread_t) * workers_num);
+    if (!g_pool.workers)
+    {
+        return -1;
+    }
 
+    for (i = 0; i < workers_num; i++)
+    {
+        if (pthread_create(&g_pool.workers[i], NULL, worker_thread, NULL) != 0)
+        {
+            break;
+        }
+    }
+
+    g_pool.workers_num = i;
+    
+    return (i > 0) ? 0 : -2;
+}
+
+static void stop_worker_pool(void)
+{
+    uint32_t i = 0;
+    
+    pthread_mutex_lock(&g_pool.lock);
+    g_pool.stop = TRUE;
+    pthread_cond_broadcast(&g_pool.cond);
+    pthread_mutex_unlock(&g_pool.lock);
+
+    for (i = 0; i < g_pool.workers_num; i++)
+    {
+        pthread_join(g_pool.workers[i], NULL);
+    }
+
+    OS_FREE(g_pool.workers);
+    pthread_cond_destroy(&g_pool.cond);
+    pthread_mutex_destroy(&g_pool.lock);
+}
+
+// every loop listens on the same port, the kernel balances the connections
+static int init_event_loop(event_loop_t *loop, uint16_t port)
+{
     struct sockaddr_in sin;
+    int on = 1;
+    
+    loop->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (loop->listener < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    
+    evutil_make_listen_socket_reuseable(loop->listener);
+#ifdef SO_REUSEPORT
+    setsockopt(loop->listener, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+
+    memset(&sin, 0, sizeof(sin));
     sin.sin_family = AF_INET;
     sin.sin_addr.s_addr = 0;
-    sin.sin_port = htons(LISTEN_PORT);
+    sin.sin_port = htons(port);
 
-    if (bind(listener, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+    if (bind(loop->listener, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
         perror("bind");
-        return 1;
+        evutil_closesocket(loop->listener);
+        return -2;
     }
 
-    if (listen(listener, LISTEN_BACKLOG) < 0) {
+    if (listen(loop->listener, LISTEN_BACKLOG) < 0) {
         perror("listen");
+        evutil_closesocket(loop->listener);
+        return -3;
+    }
+
+    evutil_make_socket_nonblocking(loop->listener);
+
+    loop->base = event_base_new();
+    if (!loop->base)
+    {
+        evutil_closesocket(loop->listener);
+        return -4;
+    }
+    
+    loop->listen_event = event_new(loop->base, loop->listener, EV_READ|EV_PERSIST,
+        do_accept, (void*)loop->base);
+    event_add(loop->listen_event, NULL);
+
+    return 0;
+}
+
+static void *event_loop_thread(void *arg)
+{
+    event_loop_t *loop = (event_loop_t *)arg;
+    
+    event_base_dispatch(loop->base);
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret;
+    uint32_t i;
+    uint16_t port = LISTEN_PORT;
+    uint32_t loops_num = DEFAULT_LOOPS;
+    uint32_t workers_num = DEFAULT_WORKERS;
+    event_loop_t *loops;
+
+    // ofs_server [port] [event loops] [workers]
+    if (argc > 1)
+    {
+        port = (uint16_t)atoi(argv[1]);
+    }
+
+    if (argc > 2)
+    {
+        loops_num = (uint32_t)atoi(argv[2]);
+    }
+
+    if (argc > 3)
+    {
+        workers_num = (uint32_t)atoi(argv[3]);
+    }
+
+    if ((loops_num == 0) || (workers_num == 0))
+    {
+        printf("Usage: %s [port] [event loops] [workers]\n", argv[0]);
         return 1;
     }
 
-    printf ("Listening...\n");
+    // the bufferevents are written by the worker threads
+    evthread_use_pthreads();
 
-    evutil_make_socket_nonblocking(listener);
+    loops = OS_MALLOC(sizeof(event_loop_t) * loops_num);
+    assert(loops != NULL);
+    memset(loops, 0, sizeof(event_loop_t) * loops_num);
 
-    struct event_base *base = event_base_new();
-    assert(base != NULL);
-    struct event *listen_event;
-    listen_event = event_new(base, listener, EV_READ|EV_PERSIST, do_accept, (void*)base);
-    event_add(listen_event, NULL);
+    for (i = 0; i < loops_num; i++)
+    {
+        if (init_event_loop(&loops[i], port) < 0)
+        {
+            return 1;
+        }
+    }
+
+    printf ("Listening... port(%d) loops(%d) workers(%d)\n", port, loops_num, workers_num);
     
     LOG_SYSTEM_INIT("./log", "log");
     ret = ofs_init_system();
@@ -115,9 +408,33 @@ int main(int argc, char *argv[])
     {
         printf("Index system init failed.\n");
     }
+    else if (session_init(SESSION_IDLE_MS, SESSION_COMMIT_MS) < 0)
+    {
+        printf("Start session thread failed.\n");
+        ofs_exit_system();
+    }
+    else if (start_worker_pool(workers_num) < 0)
+    {
+        printf("Start worker threads failed.\n");
+        session_exit();
+        ofs_exit_system();
+    }
     else
     {
-        event_base_dispatch(base);
+        for (i = 1; i < loops_num; i++)
+        {
+            pthread_create(&loops[i].tid, NULL, event_loop_thread, &loops[i]);
+        }
+        
+        event_loop_thread(&loops[0]);
+        
+        for (i = 1; i < loops_num; i++)
+        {
+            pthread_join(loops[i].tid, NULL);
+        }
+        
+        stop_worker_pool();
+        session_exit();
         ofs_exit_system();
     }
 
@@ -134,50 +451,145 @@ void do_accept(evutil_socket_t listener, short event, void *arg)
     evutil_socket_t fd;
     struct sockaddr_in sin;
     socklen_t slen = sizeof(sin);
+    server_conn_t *conn;
+    
     fd = accept(listener, (struct sockaddr *)&sin, &slen);
     if (fd < 0) {
-        perror("accept");
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+            perror("accept");
+        }
         return;
     }
-    if (fd > FD_SETSIZE) {
-        perror("fd > FD_SETSIZE\n");
+
+    printf("ACCEPT: fd = %u\n", fd);
+
+    conn = OS_MALLOC(sizeof(server_conn_t));
+    if (!conn) {
+        evutil_closesocket(fd);
         return;
     }
 
-    printf("ACCEPT: fd = %u\n", fd);
+    memset(conn, 0, sizeof(server_conn_t));
+    INIT_LIST_HEAD(&conn->requests);
+    
+    evutil_make_socket_nonblocking(fd);
+    conn->bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE);
+    if (!conn->bev) {
+        evutil_closesocket(fd);
+        OS_FREE(conn);
+        return;
+    }
+    
+    bufferevent_setcb(conn->bev, read_cb, NULL, error_cb, conn);
+    bufferevent_enable(conn->bev, EV_READ|EV_WRITE|EV_PERSIST);
+}
 
-    struct bufferevent *bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
-    bufferevent_setcb(bev, read_cb, NULL, error_cb, arg);
-    bufferevent_enable(bev, EV_READ|EV_WRITE|EV_PERSIST);
+static void queue_request(server_conn_t *conn, server_request_t *req)
+{
+    pthread_mutex_lock(&g_pool.lock);
+    list_add_tail(&conn->requests, &req->entry);
+    schedule_conn(conn);
+    pthread_mutex_unlock(&g_pool.lock);
+}
+
+// get the text command lines
+static int read_text(server_conn_t *conn, struct evbuffer *input)
+{
+    server_request_t *req;
+    char *line;
+    size_t n;
+
+    while ((line = evbuffer_readln(input, &n, EVBUFFER_EOL_ANY)) != NULL) {
+        if (n == 0) {
+            free(line);
+            continue;
+        }
+        
+        if (n > MAX_LINE) {
+            n = MAX_LINE;
+        }
+        
+        req = OS_MALLOC(sizeof(server_request_t) + n + 1);
+        if (!req) {
+            free(line);
+            return -1;
+        }
+
+        req->binary = FALSE;
+        req->len = (uint32_t)n;
+        memcpy(req->data, line, n);
+        req->data[n] = '\0';
+        free(line);
+
+        queue_request(conn, req);
+    }
+
+    return 0;
+}
+
+// get the whole binary frames
+static int read_binary(server_conn_t *conn, struct evbuffer *input)
+{
+    server_request_t *req;
+    ofs_proto_head_t head;
+    uint32_t len;
+
+    while (evbuffer_get_length(input) >= sizeof(head)) {
+        evbuffer_copyout(input, &head, sizeof(head));
+        if ((head.magic != OFS_PROTO_MAGIC) || (head.len > OFS_PROTO_MAX_FRAME)
+            || (head.ops_num > OFS_PROTO_MAX_OPS)) {
+            printf("fd = %u, invalid frame. magic(%x) len(%u)\n",
+                bufferevent_getfd(conn->bev), head.magic, head.len);
+            return -1;
+        }
+
+        len = (uint32_t)sizeof(head) + head.len;
+        if (evbuffer_get_length(input) < len) {
+            break;
+        }
+
+        req = OS_MALLOC(sizeof(server_request_t) + len);
+        if (!req) {
+            return -1;
+        }
+
+        req->binary = TRUE;
+        req->len = len;
+        evbuffer_remove(input, req->data, len);
+
+        queue_request(conn, req);
+    }
+
+    return 0;
 }
 
 void read_cb(struct bufferevent *bev, void *arg)
 {
-#define MAX_LINE    256
-    char line[MAX_LINE+1];
-    int n;
-    evutil_socket_t fd = bufferevent_getfd(bev);
-    net_para_t net;
+    server_conn_t *conn = (server_conn_t *)arg;
+    struct evbuffer *input = bufferevent_get_input(bev);
+    uint8_t first;
+    int ret;
 
-    while (n = bufferevent_read(bev, line, MAX_LINE), n > 0) {
-        line[n] = '\0';
-        printf("fd=%u, read line: %s\n", fd, line);
+    if (conn->proto == PROTO_UNKNOWN) {
+        if (evbuffer_copyout(input, &first, 1) != 1) {
+            return;
+        }
 
-        net.net = bev;
-        net.print = net_print;
-        parse_and_exec_cmd(line, ifs_cmd_list, &net);
+        conn->proto = (first == (OFS_PROTO_MAGIC & 0xFF)) ? PROTO_BINARY : PROTO_TEXT;
+    }
 
-        line[0] = '>';
-        line[1] = 0;
-        bufferevent_write(bev, line, 2);
+    ret = (conn->proto == PROTO_BINARY) ? read_binary(conn, input) : read_text(conn, input);
+    if (ret < 0) {
+        error_cb(bev, BEV_EVENT_ERROR, arg);
     }
 }
 
-void write_cb(struct bufferevent *bev, void *arg) {}
-
 void error_cb(struct bufferevent *bev, short event, void *arg)
 {
+    server_conn_t *conn = (server_conn_t *)arg;
     evutil_socket_t fd = bufferevent_getfd(bev);
+    bool_t idle = FALSE;
+    
     printf("fd = %u, ", fd);
     if (event & BEV_EVENT_TIMEOUT) {
         printf("Timed out\n"); //if bufferevent_set_timeouts() called
@@ -188,9 +600,16 @@ void error_cb(struct bufferevent *bev, short event, void *arg)
     else if (event & BEV_EVENT_ERROR) {
         printf("some other error\n");
     }
-    bufferevent_free(bev);
-}
-
 
+    // the worker running the request frees the connection
+    bufferevent_disable(bev, EV_READ|EV_WRITE);
+    pthread_mutex_lock(&g_pool.lock);
+    conn->closed = TRUE;
+    idle = !conn->running;
+    pthread_mutex_unlock(&g_pool.lock);
 
+    if (idle) {
+        free_conn(conn);
+    }
+}
 
@@ -0,0 +1,389 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SERVER_PROTO.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+#include "ofs_server.h"
+
+MODULE(PID_SERVER);
+#include "log.h"
+
+static proto_handle_t *get_proto_handle(proto_handles_t *handles, uint64_t handle)
+{
+    if ((handle == 0) || (handle > PROTO_MAX_HANDLES) || (handles->hnds[handle - 1].obj == NULL))
+    {
+        return NULL;
+    }
+
+    return &handles->hnds[handle - 1];
+}
+
+static int32_t proto_open(proto_handles_t *handles, ofs_proto_op_t *op,
+    const uint8_t *key, const uint8_t *value, uint64_t *handle)
+{
+    char ct_name[OFS_NAME_SIZE];
+    object_handle_t *obj = NULL;
+    uint64_t objid = 0;
+    uint16_t flags = OFS_PROTO_DEFAULT_FLAGS;
+    uint64_t sectors = (op->handle != 0) ? op->handle : OFS_PROTO_DEFAULT_SECTORS;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    if ((op->key_len == 0) || (op->key_len >= OFS_NAME_SIZE)
+        || ((op->value_len != sizeof(uint64_t)) && (op->value_len != sizeof(uint64_t) + sizeof(uint16_t))))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    for (i = 0; i < PROTO_MAX_HANDLES; i++)
+    {
+        if (handles->hnds[i].obj == NULL)
+        {
+            break;
+        }
+    }
+
+    if (i == PROTO_MAX_HANDLES)
+    {
+        return -OFS_PROTO_ERR_HANDLE_FULL;
+    }
+
+    memcpy(ct_name, key, op->key_len);
+    ct_name[op->key_len] = 0;
+    memcpy(&objid, value, sizeof(uint64_t));
+    if (op->value_len > sizeof(uint64_t))
+    {
+        memcpy(&flags, value + sizeof(uint64_t), sizeof(uint16_t));
+    }
+
+    ret = session_open(ct_name, objid, op->flags, sectors, flags | FLAG_TABLE, &obj);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    handles->hnds[i].obj = obj;
+    *handle = i + 1;
+
+    return 0;
+}
+
+static int32_t proto_close(proto_handles_t *handles, uint64_t handle)
+{
+    proto_handle_t *hnd = get_proto_handle(handles, handle);
+
+    if (!hnd)
+    {
+        return -OFS_PROTO_ERR_HANDLE;
+    }
+
+    session_close(hnd->obj);
+    hnd->obj = NULL;
+
+    return 0;
+}
+
+void proto_close_handles(proto_handles_t *handles)
+{
+    uint64_t i = 0;
+    
+    for (i = 0; i < PROTO_MAX_HANDLES; i++)
+    {
+        if (handles->hnds[i].obj)
+        {
+            (void)proto_close(handles, i + 1);
+        }
+    }
+}
+
+static void release_pinned_value(const void *value, size_t len, void *pinned)
+{
+    index_release_pinned((ofs_pinned_value_t *)pinned);
+    OS_FREE(pinned);
+}
+
+// the value is sent from the cached block, it is pinned until it is sent
+static int32_t proto_get(object_handle_t *obj, const uint8_t *key, uint16_t key_len,
+    uint32_t budget, struct evbuffer *data)
+{
+    ofs_pinned_value_t *pinned = NULL;
+    int32_t ret = 0;
+
+    pinned = OS_MALLOC(sizeof(ofs_pinned_value_t));
+    if (!pinned)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(ofs_pinned_value_t));
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+    
+    ret = index_get_pinned(obj, key, key_len, pinned);
+    if (ret < 0)
+    {
+        OS_FREE(pinned);
+        return ret;
+    }
+
+    if (pinned->value_len > budget)
+    {
+        release_pinned_value(pinned->value, pinned->value_len, pinned);
+        return -OFS_PROTO_ERR_REPLY_FULL;
+    }
+
+    if (pinned->value_len != 0)
+    {
+        if (evbuffer_add_reference(data, pinned->value, pinned->value_len, release_pinned_value, pinned) == 0)
+        { // released by the buffer after it is sent
+            return ret;
+        }
+
+        if (evbuffer_add(data, pinned->value, pinned->value_len) != 0)
+        {
+            LOG_ERROR("Add the value failed. len(%d)\n", pinned->value_len);
+            ret = -OFS_PROTO_ERR_MALLOC;
+        }
+    }
+
+    release_pinned_value(pinned->value, pinned->value_len, pinned);
+
+    return ret;
+}
+
+static int32_t proto_put(object_handle_t *obj, const uint8_t *key, uint16_t key_len,
+    const uint8_t *value, uint16_t value_len)
+{
+    // replace the old value
+    return index_upsert_key(obj, key, key_len, value, value_len);
+}
+
+// the pairs are added until max_pairs or the budget bytes of the reply are used
+static int32_t proto_scan(object_handle_t *obj, const uint8_t *key, uint16_t key_len,
+    uint32_t max_pairs, uint32_t budget, struct evbuffer *data)
+{
+    ofs_proto_kv_t kv;
+    uint32_t pairs = 0;
+    int32_t ret = 0;
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+
+    if (key_len == 0)
+    {
+        ret = walk_tree(obj, INDEX_GET_FIRST);
+    }
+    else
+    { // start from the key, or the next key larger than it
+        ret = index_search_key_nolock(obj, key, key_len, NULL, 0);
+        if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+        {
+            ret = (obj->ie->flags & INDEX_ENTRY_END) ? ret : 0;
+        }
+    }
+
+    while ((ret >= 0) && (pairs < max_pairs))
+    {
+        kv.key_len = obj->ie->key_len;
+        kv.value_len = obj->ie->value_len;
+        if (evbuffer_get_length(data) + sizeof(kv) + kv.key_len + kv.value_len > budget)
+        { // no pair means the end of the tree, so it is an error
+            ret = (pairs == 0) ? -OFS_PROTO_ERR_REPLY_FULL : 0;
+            break;
+        }
+
+        evbuffer_add(data, &kv, sizeof(kv));
+        evbuffer_add(data, GET_IE_KEY(obj->ie), kv.key_len);
+        evbuffer_add(data, GET_IE_VALUE(obj->ie), kv.value_len);
+        pairs++;
+
+        ret = walk_tree(obj, 0);
+    }
+    
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    if (ret == -OFS_PROTO_ERR_REPLY_FULL)
+    {
+        return ret;
+    }
+
+    return (int32_t)pairs;
+}
+
+// budget is the bytes of the reply data this op can use
+static int32_t proto_exec_op(proto_handles_t *handles, ofs_proto_op_t *op,
+    const uint8_t *key, const uint8_t *value, uint32_t budget, struct evbuffer *data)
+{
+    proto_handle_t *hnd = NULL;
+    uint64_t handle = 0;
+    int32_t ret = 0;
+
+    if (op->opcode == OFS_OP_OPEN)
+    {
+        if (budget < sizeof(handle))
+        {
+            return -OFS_PROTO_ERR_REPLY_FULL;
+        }
+
+        ret = proto_open(handles, op, key, value, &handle);
+        if (ret >= 0)
+        {
+            evbuffer_add(data, &handle, sizeof(handle));
+        }
+
+        return ret;
+    }
+
+    hnd = get_proto_handle(handles, op->handle);
+    if (!hnd)
+    {
+        return -OFS_PROTO_ERR_HANDLE;
+    }
+
+    if ((op->opcode != OFS_OP_CLOSE) && (op->opcode != OFS_OP_SCAN) && (op->key_len == 0))
+    {
+        return -OFS_PROTO_ERR_PARAMETER;
+    }
+
+    switch (op->opcode)
+    {
+        case OFS_OP_CLOSE:
+            return proto_close(handles, op->handle);
+            
+        case OFS_OP_GET:
+            return proto_get(hnd->obj, key, op->key_len, budget, data);
+            
+        case OFS_OP_PUT:
+            if ((op->value_len == 0) || (op->value_len > VALUE_MAX_SIZE))
+            {
+                return -OFS_PROTO_ERR_PARAMETER;
+            }
+            
+            return proto_put(hnd->obj, key, op->key_len, value, (uint16_t)op->value_len);
+            
+        case OFS_OP_DEL:
+            return index_remove_key(hnd->obj, key, op->key_len);
+            
+        case OFS_OP_SCAN:
+            return proto_scan(hnd->obj, key, op->key_len, op->value_len, budget, data);
+            
+        default:
+            break;
+    }
+
+    return -OFS_PROTO_ERR_OPCODE;
+}
+
+// execute all the operations in the frame, and add the reply frame to out
+int32_t proto_exec_frame(proto_handles_t *handles, const uint8_t *frame,
+    uint32_t len, struct evbuffer *out)
+{
+    ofs_proto_head_t head;
+    ofs_proto_result_t result;
+    ofs_proto_op_t op;
+    struct evbuffer *body = NULL;
+    struct evbuffer *data = NULL;
+    const uint8_t *pos = frame + sizeof(ofs_proto_head_t);
+    const uint8_t *end = frame + len;
+    uint64_t used = 0;
+    uint32_t budget = 0;
+    uint32_t i = 0;
+
+    ASSERT(len >= sizeof(ofs_proto_head_t));
+    memcpy(&head, frame, sizeof(ofs_proto_head_t));
+
+    body = evbuffer_new();
+    data = evbuffer_new();
+    if ((!body) || (!data))
+    {
+        LOG_ERROR("Allocate buffer failed.\n");
+        if (body)
+        {
+            evbuffer_free(body);
+        }
+        
+        if (data)
+        {
+            evbuffer_free(data);
+        }
+        
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    for (i = 0; i < head.ops_num; i++)
+    {
+        if (pos + sizeof(ofs_proto_op_t) > end)
+        { // the ops left are not executed
+            result.ret = -OFS_PROTO_ERR_FRAME;
+            result.len = 0;
+            evbuffer_add(body, &result, sizeof(result));
+            continue;
+        }
+        
+        memcpy(&op, pos, sizeof(ofs_proto_op_t));
+        pos += sizeof(ofs_proto_op_t);
+
+        if ((op.opcode == OFS_OP_SCAN) ? (pos + op.key_len > end)
+            : (pos + op.key_len + op.value_len > end))
+        {
+            pos = end;
+            result.ret = -OFS_PROTO_ERR_FRAME;
+            result.len = 0;
+            evbuffer_add(body, &result, sizeof(result));
+            continue;
+        }
+
+        // the results of this op and the ops left are reserved
+        used = evbuffer_get_length(body) + (uint64_t)(head.ops_num - i) * sizeof(result);
+        budget = (used < OFS_PROTO_MAX_FRAME) ? (uint32_t)(OFS_PROTO_MAX_FRAME - used) : 0;
+
+        result.ret = proto_exec_op(handles, &op, pos, pos + op.key_len, budget, data);
+        result.len = (uint32_t)evbuffer_get_length(data);
+        evbuffer_add(body, &result, sizeof(result));
+        evbuffer_add_buffer(body, data);
+
+        pos += op.key_len;
+        if (op.opcode != OFS_OP_SCAN)
+        {
+            pos += op.value_len;
+        }
+    }
+
+    head.len = (uint32_t)evbuffer_get_length(body);
+    evbuffer_add(out, &head, sizeof(head));
+    evbuffer_add_buffer(out, body);
+
+    evbuffer_free(data);
+    evbuffer_free(body);
+
+    return 0;
+}
+
@@ -0,0 +1,465 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_SERVER_SESSION.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description:
+Function List:
+    1. ...:
+History:
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include <pthread.h>
+#include <time.h>
+
+#include "ofs_if.h"
+#include "ofs_server.h"
+
+MODULE(PID_SERVER);
+#include "log.h"
+
+// one object kept opened by the server
+typedef struct server_session
+{
+    list_head_t entry;
+    list_head_t commit_entry;  // in the commit list of the session thread
+    char ct_name[OFS_NAME_SIZE];
+    uint64_t objid;
+    container_handle_t *ct;
+    object_handle_t *obj;      // keep the object and container opened
+    uint32_t ref_cnt;          // the handles opened by the commands
+    uint64_t last_used;        // ms
+} server_session_t;
+
+typedef struct session_table
+{
+    pthread_mutex_t lock;      // protect the session list
+    pthread_cond_t cond;
+    list_head_t sessions;
+    uint32_t idle_ms;
+    uint32_t commit_ms;
+    bool_t stop;
+    pthread_t tid;
+} session_table_t;
+
+static session_table_t g_sessions;
+
+static uint64_t get_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static server_session_t *find_session(const char *ct_name, uint64_t objid)
+{
+    server_session_t *s = NULL;
+    list_head_t *pos = NULL;
+
+    list_for_each(pos, &g_sessions.sessions)
+    {
+        s = list_entry(pos, server_session_t, entry);
+        if ((s->objid == objid) && (strcmp(s->ct_name, ct_name) == 0))
+        {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+static server_session_t *find_session_by_obj(object_handle_t *obj)
+{
+    server_session_t *s = NULL;
+    list_head_t *pos = NULL;
+
+    list_for_each(pos, &g_sessions.sessions)
+    {
+        s = list_entry(pos, server_session_t, entry);
+        if ((s->ct == obj->ct) && (s->objid == obj->obj_info->objid))
+        {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t new_session(const char *ct_name, uint64_t objid, uint8_t open_flags,
+    uint64_t sectors, uint16_t obj_flags, server_session_t **session)
+{
+    server_session_t *s = NULL;
+    bool_t created = FALSE;
+    int32_t ret = 0;
+
+    s = OS_MALLOC(sizeof(server_session_t));
+    if (!s)
+    {
+        LOG_ERROR("Allocate memory failed. size(%d)\n", (uint32_t)sizeof(server_session_t));
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    memset(s, 0, sizeof(server_session_t));
+    strncpy(s->ct_name, ct_name, OFS_NAME_SIZE - 1);
+    s->objid = objid;
+
+    ret = ofs_open_container(ct_name, &s->ct);
+    if ((ret < 0) && (open_flags & OFS_OPEN_CREATE))
+    {
+        ret = ofs_create_container(ct_name, sectors, &s->ct);
+        created = (ret >= 0);
+        if (ret < 0)
+        {
+            // another thread may create it at the same time
+            ret = ofs_open_container(ct_name, &s->ct);
+        }
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Open container failed. ct(%s) ret(%d)\n", ct_name, ret);
+        OS_FREE(s);
+        return ret;
+    }
+
+    ret = ofs_open_object(s->ct, objid, &s->obj);
+    if ((ret < 0) && (open_flags & OFS_OPEN_CREATE))
+    {
+        ret = ofs_create_object(s->ct, objid, obj_flags, &s->obj);
+        if (ret < 0)
+        {
+            // another thread may create it at the same time
+            ret = ofs_open_object(s->ct, objid, &s->obj);
+        }
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Open object failed. ct(%s) objid(%lld) ret(%d)\n", ct_name, objid, ret);
+        (void)ofs_close_container(s->ct);
+        OS_FREE(s);
+        return ret;
+    }
+
+    // commit the new container before the first background commit so that
+    // it can be opened after a crash
+    if (created)
+    {
+        (void)ofs_commit_container(s->ct);
+    }
+
+    *session = s;
+
+    return 0;
+}
+
+// the session must have been removed from the session table
+static void free_session(server_session_t *s)
+{
+    LOG_INFO("Close the session. ct(%s) objid(%lld) ref_cnt(%d)\n",
+        s->ct_name, s->objid, s->ref_cnt);
+
+    (void)ofs_close_object(s->obj);
+    (void)ofs_close_container(s->ct);
+    OS_FREE(s);
+}
+
+// open a handle of the object, the object is opened if not in the session table
+int32_t session_open(const char *ct_name, uint64_t objid, uint8_t open_flags,
+    uint64_t sectors, uint16_t obj_flags, object_handle_t **obj)
+{
+    server_session_t *s = NULL;
+    server_session_t *new_s = NULL;
+    int32_t ret = 0;
+
+    pthread_mutex_lock(&g_sessions.lock);
+    s = find_session(ct_name, objid);
+    pthread_mutex_unlock(&g_sessions.lock);
+
+    if (!s)
+    {
+        // opening or replaying the container takes long, do it without the lock
+        ret = new_session(ct_name, objid, open_flags, sectors, obj_flags, &new_s);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    pthread_mutex_lock(&g_sessions.lock);
+
+    // the session may be opened or closed by another thread in the meantime
+    s = find_session(ct_name, objid);
+    if (!s && new_s)
+    {
+        list_add_tail(&g_sessions.sessions, &new_s->entry);
+        LOG_INFO("Open the session. ct(%s) objid(%lld)\n", ct_name, objid);
+        s = new_s;
+        new_s = NULL;
+    }
+
+    if (!s)
+    {
+        pthread_mutex_unlock(&g_sessions.lock);
+        return session_open(ct_name, objid, open_flags, sectors, obj_flags, obj);
+    }
+
+    ret = ofs_open_object(s->ct, objid, obj);
+    if (ret >= 0)
+    {
+        s->ref_cnt++;
+        s->last_used = get_ms();
+    }
+
+    pthread_mutex_unlock(&g_sessions.lock);
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Open object failed. ct(%s) objid(%lld) ret(%d)\n", ct_name, objid, ret);
+    }
+
+    // another thread has inserted the same session
+    if (new_s)
+    {
+        free_session(new_s);
+    }
+
+    return ret;
+}
+
+// close the handle, the object is kept opened until idle for a while
+void session_close(object_handle_t *obj)
+{
+    server_session_t *s = NULL;
+
+    pthread_mutex_lock(&g_sessions.lock);
+
+    s = find_session_by_obj(obj);
+    ASSERT(s != NULL);
+    ASSERT(s->ref_cnt != 0);
+
+    (void)ofs_close_object(obj);
+    s->ref_cnt--;
+    s->last_used = get_ms();
+
+    pthread_mutex_unlock(&g_sessions.lock);
+}
+
+// the container is committed by its first session
+static bool_t first_session_of_ct(server_session_t *session)
+{
+    server_session_t *s = NULL;
+    list_head_t *pos = NULL;
+
+    list_for_each(pos, &g_sessions.sessions)
+    {
+        s = list_entry(pos, server_session_t, entry);
+        if (s == session)
+        {
+            return TRUE;
+        }
+
+        if (s->ct == session->ct)
+        {
+            return FALSE;
+        }
+    }
+
+    return FALSE;
+}
+
+// close the idle sessions and commit the modification of the others, the
+// commit itself waits for the running modifications of the container
+static void commit_sessions(void)
+{
+    server_session_t *s = NULL;
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
+    list_head_t idle_list;
+    list_head_t commit_list;
+    uint64_t now = 0;
+    int32_t ret = 0;
+
+    INIT_LIST_HEAD(&idle_list);
+    INIT_LIST_HEAD(&commit_list);
+
+    // only pick the sessions under the lock, closing and committing take long
+    pthread_mutex_lock(&g_sessions.lock);
+
+    now = get_ms();
+    list_for_each_safe(pos, n, &g_sessions.sessions)
+    {
+        s = list_entry(pos, server_session_t, entry);
+        if ((s->ref_cnt == 0) && (now - s->last_used >= g_sessions.idle_ms))
+        {
+            list_del(&s->entry);
+            list_add_tail(&idle_list, &s->entry);
+        }
+    }
+
+    list_for_each(pos, &g_sessions.sessions)
+    {
+        s = list_entry(pos, server_session_t, entry);
+        if (first_session_of_ct(s))
+        {
+            s->ref_cnt++; // not closed as idle until committed
+            list_add_tail(&commit_list, &s->commit_entry);
+        }
+    }
+
+    pthread_mutex_unlock(&g_sessions.lock);
+
+    list_for_each_safe(pos, n, &idle_list)
+    {
+        list_del(pos);
+        free_session(list_entry(pos, server_session_t, entry));
+    }
+
+    list_for_each(pos, &commit_list)
+    {
+        s = list_entry(pos, server_session_t, commit_entry);
+        ret = ofs_commit_container(s->ct);
+        if (ret < 0)
+        {
+            LOG_ERROR("Commit container failed. ct(%s) ret(%d)\n", s->ct_name, ret);
+        }
+    }
+
+    pthread_mutex_lock(&g_sessions.lock);
+
+    list_for_each_safe(pos, n, &commit_list)
+    {
+        s = list_entry(pos, server_session_t, commit_entry);
+        list_del(&s->commit_entry);
+        s->ref_cnt--;
+    }
+
+    pthread_mutex_unlock(&g_sessions.lock);
+}
+
+static void *session_thread(void *arg)
+{
+    struct timespec ts;
+
+    pthread_mutex_lock(&g_sessions.lock);
+
+    while (!g_sessions.stop)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += g_sessions.commit_ms / 1000;
+        ts.tv_nsec += (long)(g_sessions.commit_ms % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        (void)pthread_cond_timedwait(&g_sessions.cond, &g_sessions.lock, &ts);
+        if (g_sessions.stop)
+        {
+            break;
+        }
+
+        pthread_mutex_unlock(&g_sessions.lock);
+        commit_sessions();
+        pthread_mutex_lock(&g_sessions.lock);
+    }
+
+    pthread_mutex_unlock(&g_sessions.lock);
+
+    return NULL;
+}
+
+// the text commands use the objects in session table too
+static int32_t tools_open_session(ifs_tools_para_t *para, object_handle_t **obj)
+{
+    int32_t ret = 0;
+
+    ret = session_open(para->ct_name, para->objid, 0, 0, 0, obj);
+    if (ret < 0)
+    {
+        OS_PRINT(para->net, "Open obj failed. ct(%s) objid(%lld) ret(%d)\n",
+            para->ct_name, para->objid, ret);
+    }
+
+    return ret;
+}
+
+static void tools_close_session(ifs_tools_para_t *para, object_handle_t *obj)
+{
+    session_close(obj);
+}
+
+int32_t session_init(uint32_t idle_ms, uint32_t commit_ms)
+{
+    tools_object_ops_t ops = {tools_open_session, tools_close_session};
+
+    memset(&g_sessions, 0, sizeof(g_sessions));
+    INIT_LIST_HEAD(&g_sessions.sessions);
+    g_sessions.idle_ms = idle_ms;
+    g_sessions.commit_ms = (commit_ms != 0) ? commit_ms : SESSION_COMMIT_MS;
+
+    pthread_mutex_init(&g_sessions.lock, NULL);
+    pthread_cond_init(&g_sessions.cond, NULL);
+
+    if (pthread_create(&g_sessions.tid, NULL, session_thread, NULL) != 0)
+    {
+        LOG_ERROR("Create session thread failed.\n");
+        pthread_cond_destroy(&g_sessions.cond);
+        pthread_mutex_destroy(&g_sessions.lock);
+        return -OFS_PROTO_ERR_MALLOC;
+    }
+
+    tools_set_object_ops(&ops);
+
+    return 0;
+}
+
+// close all the sessions, the containers are committed when closed
+void session_exit(void)
+{
+    list_head_t *pos = NULL;
+    list_head_t *n = NULL;
+
+    pthread_mutex_lock(&g_sessions.lock);
+    g_sessions.stop = TRUE;
+    pthread_cond_signal(&g_sessions.cond);
+    pthread_mutex_unlock(&g_sessions.lock);
+
+    pthread_join(g_sessions.tid, NULL);
+
+    list_for_each_safe(pos, n, &g_sessions.sessions)
+    {
+        list_del(pos);
+        free_session(list_entry(pos, server_session_t, entry));
+    }
+
+    pthread_cond_destroy(&g_sessions.cond);
+    pthread_mutex_destroy(&g_sessions.lock);
+}
@@ -0,0 +1,538 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_TOOLS_ANALYZE.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_TOOLS);
+#include "log.h"
+
+#define ANALYZE_DEFAULT_THREADS  4
+
+// the device models for the full scan cost
+#define HDD_SEEK_US              8000
+#define HDD_MB_PER_SEC           150
+#define SSD_SEEK_US              100
+#define SSD_MB_PER_SEC           500
+
+typedef struct analyze_level
+{
+    uint64_t blocks;
+    uint64_t entries;           // the END entries are not counted
+    uint64_t used_bytes;
+    uint64_t alloc_bytes;
+} analyze_level_t;
+
+// the statistics of one subtree
+typedef struct analyze_result
+{
+    analyze_level_t levels[TREE_MAX_DEPTH];
+    uint32_t depth;
+    uint64_t keys;
+    uint64_t key_bytes;
+    uint64_t value_bytes;
+    uint64_t leaves;
+    uint64_t first_leaf;        // the vbn of the first leaf in key order
+    uint64_t last_leaf;         // the vbn of the last leaf in key order
+    uint64_t leaf_jumps;        // the leaves not next to the previous leaf on disk
+    uint64_t leaf_distance;     // the sum of the vbn distance between the neighbor leaves
+    int32_t ret;
+} analyze_result_t;
+
+typedef struct analyze_ctx
+{
+    object_info_t *obj_info;
+    bool_t bplus;
+    uint32_t children_num;      // the subtrees of the root
+    uint64_t *children;         // the vbn of the subtrees
+    analyze_result_t *results;  // one for each subtree
+    volatile uint32_t next;     // the next subtree to analyze
+} analyze_ctx_t;
+
+static uint64_t vbn_distance(uint64_t a, uint64_t b)
+{
+    return (a > b) ? (a - b) : (b - a);
+}
+
+static void analyze_add_leaf(analyze_result_t *result, uint64_t vbn)
+{
+    if (result->leaves == 0)
+    {
+        result->first_leaf = vbn;
+    }
+    else
+    {
+        if (vbn != result->last_leaf + 1)
+        {
+            result->leaf_jumps++;
+        }
+
+        result->leaf_distance += vbn_distance(vbn, result->last_leaf);
+    }
+
+    result->last_leaf = vbn;
+    result->leaves++;
+}
+
+// walk the block and its children in key order
+static int32_t analyze_block(analyze_ctx_t *ctx, ofs_block_cache_t *cache, uint32_t level,
+    analyze_result_t *result)
+{
+    index_block_t *ib = IB(cache->ib);
+    index_entry_t *ie = NULL;
+    ofs_block_cache_t *child = NULL;
+    bool_t leaf = FALSE;
+    int32_t ret = 0;
+
+    if (level >= TREE_MAX_DEPTH)
+    {
+        LOG_ERROR("Depth get to MAX. vbn(%lld) level(%d)\n", cache->vbn, level);
+        return -INDEX_ERR_MAX_DEPTH;
+    }
+
+    leaf = (ib->node_type & INDEX_BLOCK_LARGE) ? FALSE : TRUE;
+
+    result->levels[level].blocks++;
+    result->levels[level].used_bytes += ib->head.real_size;
+    result->levels[level].alloc_bytes += ib->head.alloc_size;
+    if (result->depth < level + 1)
+    {
+        result->depth = level + 1;
+    }
+
+    if (leaf)
+    {
+        analyze_add_leaf(result, cache->vbn);
+    }
+
+    for (ie = GET_FIRST_IE(ib); ; ie = GET_NEXT_IE(ie))
+    {
+        if (((uint8_t *)ie >= GET_END_IE(ib)) || (ie->len == 0))
+        {
+            LOG_ERROR("The ie is invalid. vbn(%lld) len(%d) real_size(%d)\n",
+                cache->vbn, ie->len, ib->head.real_size);
+            return -INDEX_ERR_FORMAT;
+        }
+
+        if (ie->flags & INDEX_ENTRY_NODE)
+        {
+            ret = index_block_read2(ctx->obj_info, GET_IE_VBN(ie), INDEX_MAGIC, &child);
+            if (ret < 0)
+            {
+                LOG_ERROR("Read block failed. vbn(%lld) ret(%d)\n", GET_IE_VBN(ie), ret);
+                return ret;
+            }
+
+            ret = analyze_block(ctx, child, level + 1, result);
+            if (ret < 0)
+            {
+                return ret;
+            }
+        }
+
+        if (ie->flags & INDEX_ENTRY_END)
+        {
+            break;
+        }
+
+        result->levels[level].entries++;
+
+        // the node entries in b+ tree are separators only
+        if (leaf || !ctx->bplus)
+        {
+            result->keys++;
+            result->key_bytes += ie->key_len;
+            result->value_bytes += ie->value_len;
+        }
+    }
+
+    return 0;
+}
+
+static void *analyze_worker(void *para)
+{
+    analyze_ctx_t *ctx = (analyze_ctx_t *)para;
+    analyze_result_t *result = NULL;
+    ofs_block_cache_t *cache = NULL;
+    uint32_t i = 0;
+
+    // atomic_add returns the old value everywhere, atomic_inc does not on windows
+    while ((i = atomic_add(&ctx->next, 1)) < ctx->children_num)
+    {
+        result = &ctx->results[i];
+        result->ret = index_block_read2(ctx->obj_info, ctx->children[i], INDEX_MAGIC, &cache);
+        if (result->ret < 0)
+        {
+            LOG_ERROR("Read block failed. vbn(%lld) ret(%d)\n", ctx->children[i], result->ret);
+            continue;
+        }
+
+        // the subtree starts from level 1
+        result->ret = analyze_block(ctx, cache, 1, result);
+    }
+
+    return NULL;
+}
+
+// merge the subtrees in key order, the leaves of neighbor subtrees are neighbors too
+static void analyze_merge(analyze_result_t *dst, const analyze_result_t *src)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < TREE_MAX_DEPTH; i++)
+    {
+        dst->levels[i].blocks += src->levels[i].blocks;
+        dst->levels[i].entries += src->levels[i].entries;
+        dst->levels[i].used_bytes += src->levels[i].used_bytes;
+        dst->levels[i].alloc_bytes += src->levels[i].alloc_bytes;
+    }
+
+    if (dst->depth < src->depth)
+    {
+        dst->depth = src->depth;
+    }
+
+    dst->keys += src->keys;
+    dst->key_bytes += src->key_bytes;
+    dst->value_bytes += src->value_bytes;
+
+    if (src->leaves == 0)
+    {
+        return;
+    }
+
+    if (dst->leaves == 0)
+    {
+        dst->first_leaf = src->first_leaf;
+    }
+    else
+    {
+        if (src->first_leaf != dst->last_leaf + 1)
+        {
+            dst->leaf_jumps++;
+        }
+
+        dst->leaf_distance += vbn_distance(src->first_leaf, dst->last_leaf);
+    }
+
+    dst->leaves += src->leaves;
+    dst->last_leaf = src->last_leaf;
+    dst->leaf_jumps += src->leaf_jumps;
+    dst->leaf_distance += src->leaf_distance;
+}
+
+// the root entries with child are the subtrees walked in parallel
+static int32_t analyze_subtrees(analyze_ctx_t *ctx, uint32_t threads_num, analyze_result_t *result)
+{
+    index_block_t *ib = IB(ctx->obj_info->root_cache.ib);
+    index_entry_t *ie = NULL;
+    os_thread_t *tid = NULL;
+    uint32_t started = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    for (ie = GET_FIRST_IE(ib); ; ie = GET_NEXT_IE(ie))
+    {
+        if (((uint8_t *)ie >= GET_END_IE(ib)) || (ie->len == 0))
+        {
+            LOG_ERROR("The ie is invalid. len(%d) real_size(%d)\n", ie->len, ib->head.real_size);
+            return -INDEX_ERR_FORMAT;
+        }
+
+        ctx->children_num++;
+        if (ie->flags & INDEX_ENTRY_END)
+        {
+            break;
+        }
+    }
+
+    ctx->children = OS_MALLOC(sizeof(uint64_t) * ctx->children_num);
+    ctx->results = OS_MALLOC(sizeof(analyze_result_t) * ctx->children_num);
+    tid = OS_MALLOC(sizeof(os_thread_t) * threads_num);
+    if (!ctx->children || !ctx->results || !tid)
+    {
+        LOG_ERROR("Allocate memory failed. children_num(%d)\n", ctx->children_num);
+        ret = -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+    else
+    {
+        memset(ctx->results, 0, sizeof(analyze_result_t) * ctx->children_num);
+        for (ie = GET_FIRST_IE(ib), i = 0; i < ctx->children_num; ie = GET_NEXT_IE(ie), i++)
+        {
+            ctx->children[i] = GET_IE_VBN(ie);
+        }
+
+        for (started = 0; started < threads_num; started++)
+        {
+            tid[started] = thread_create(analyze_worker, ctx, "analyze");
+            if (tid[started] == INVALID_TID)
+            {
+                break;
+            }
+        }
+
+        if (started == 0)
+        { // analyze by myself
+            (void)analyze_worker(ctx);
+        }
+
+        for (i = 0; i < started; i++)
+        {
+            thread_destroy(tid[i], FALSE);
+        }
+
+        for (ie = GET_FIRST_IE(ib), i = 0; i < ctx->children_num; ie = GET_NEXT_IE(ie), i++)
+        {
+            if (ctx->results[i].ret < 0)
+            {
+                ret = ctx->results[i].ret;
+                break;
+            }
+
+            analyze_merge(result, &ctx->results[i]);
+            if (ie->flags & INDEX_ENTRY_END)
+            {
+                break;
+            }
+
+            result->levels[0].entries++;
+            if (!ctx->bplus)
+            {
+                result->keys++;
+                result->key_bytes += ie->key_len;
+                result->value_bytes += ie->value_len;
+            }
+        }
+    }
+
+    if (tid)
+    {
+        OS_FREE(tid);
+    }
+
+    if (ctx->results)
+    {
+        OS_FREE(ctx->results);
+    }
+
+    if (ctx->children)
+    {
+        OS_FREE(ctx->children);
+    }
+
+    return ret;
+}
+
+// walk the tree of the object, the caller makes sure it is not modified
+static int32_t analyze_tree(object_info_t *obj_info, uint32_t threads_num, analyze_result_t *result)
+{
+    analyze_ctx_t ctx;
+    index_block_t *root = NULL;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.obj_info = obj_info;
+    ctx.bplus = (obj_info->attr_record->flags & FLAG_BPLUS_TREE) ? TRUE : FALSE;
+
+    root = IB(obj_info->root_cache.ib);
+    if (!(root->node_type & INDEX_BLOCK_LARGE))
+    { // only one block
+        return analyze_block(&ctx, &obj_info->root_cache, 0, result);
+    }
+
+    result->levels[0].blocks = 1;
+    result->levels[0].used_bytes = root->head.real_size;
+    result->levels[0].alloc_bytes = root->head.alloc_size;
+    result->depth = 1;
+
+    return analyze_subtrees(&ctx, threads_num, result);
+}
+
+// the writers of the object wait until the walk finished
+static int32_t analyze_locked_tree(object_handle_t *obj, uint32_t threads_num, analyze_result_t *result)
+{
+    int32_t ret = 0;
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+    ret = analyze_tree(obj->obj_info, threads_num, result);
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    return ret;
+}
+
+// walk the last checkpoint of the object in a read view, the writers are not blocked
+static int32_t analyze_object(object_handle_t *obj, uint32_t threads_num, analyze_result_t *result)
+{
+    container_handle_t *view = NULL;
+    object_handle_t *view_obj = NULL;
+    int32_t ret = 0;
+
+    if (obj->ct->flags & FLAG_READONLY)
+    { // the snapshots and the read views are never modified
+        return analyze_tree(obj->obj_info, threads_num, result);
+    }
+
+    ret = ofs_begin_read_view(obj->ct, &view);
+    if (ret == -INDEX_ERR_NO_CONTENT)
+    { // not committed yet
+        return analyze_locked_tree(obj, threads_num, result);
+    }
+
+    if (ret < 0)
+    {
+        LOG_ERROR("Begin read view failed. ct(%s) ret(%d)\n", obj->ct->name, ret);
+        return ret;
+    }
+
+    ret = ofs_open_object(view, obj->obj_info->objid, &view_obj);
+    if (ret < 0)
+    { // created after the last checkpoint
+        (void)ofs_end_read_view(view);
+        return analyze_locked_tree(obj, threads_num, result);
+    }
+
+    ret = analyze_tree(view_obj->obj_info, threads_num, result);
+
+    (void)ofs_close_object(view_obj);
+    (void)ofs_end_read_view(view);
+
+    return ret;
+}
+
+static uint64_t scan_cost_us(uint64_t seeks, uint64_t bytes, uint64_t seek_us, uint64_t mb_per_sec)
+{
+    return seeks * seek_us + bytes / mb_per_sec;
+}
+
+static void print_analyze_result(net_para_t *net, object_handle_t *obj, analyze_result_t *result)
+{
+    uint32_t block_size = obj->ct->sb.block_size;
+    uint64_t blocks = 0;
+    uint64_t seeks = 0;
+    uint64_t bytes = 0;
+    uint32_t i = 0;
+
+    OS_PRINT(net, "objid         : %lld\n", obj->obj_info->objid);
+    OS_PRINT(net, "type          : %s\n", (obj->obj_info->attr_record->flags & FLAG_BPLUS_TREE) ? "b+ tree" : "b tree");
+    OS_PRINT(net, "depth         : %u\n", result->depth);
+    OS_PRINT(net, "keys          : %llu\n", (unsigned long long)result->keys);
+    OS_PRINT(net, "avg key size  : %.1f\n", result->keys ? ((double)result->key_bytes / result->keys) : 0.0);
+    OS_PRINT(net, "avg value size: %.1f\n", result->keys ? ((double)result->value_bytes / result->keys) : 0.0);
+
+    OS_PRINT(net, "\n%-6s %12s %12s %14s %10s\n", "level", "blocks", "entries", "entries/block", "fill(%)");
+    OS_PRINT(net, "----------------------------------------------------------\n");
+    for (i = 0; i < result->depth; i++)
+    {
+        analyze_level_t *level = &result->levels[i];
+
+        OS_PRINT(net, "%-6u %12llu %12llu %14.1f %10.1f\n", i, (unsigned long long)level->blocks,
+            (unsigned long long)level->entries,
+            level->blocks ? ((double)level->entries / level->blocks) : 0.0,
+            level->alloc_bytes ? ((double)level->used_bytes * 100 / level->alloc_bytes) : 0.0);
+        blocks += level->blocks;
+    }
+
+    OS_PRINT(net, "\nleaves        : %llu\n", (unsigned long long)result->leaves);
+    OS_PRINT(net, "leaf jumps    : %llu (%.1f%% of the leaves are not next to the previous one)\n",
+        (unsigned long long)result->leaf_jumps,
+        (result->leaves > 1) ? ((double)result->leaf_jumps * 100 / (result->leaves - 1)) : 0.0);
+    OS_PRINT(net, "avg distance  : %.1f blocks\n",
+        (result->leaves > 1) ? ((double)result->leaf_distance / (result->leaves - 1)) : 0.0);
+
+    // the leaves are read in key order, every jump and every node block is a seek
+    seeks = (blocks - result->leaves) + result->leaf_jumps + ((result->leaves != 0) ? 1 : 0);
+    bytes = blocks * block_size;
+    OS_PRINT(net, "\nfull scan     : %llu blocks, %llu bytes, %llu seeks\n", (unsigned long long)blocks,
+        (unsigned long long)bytes, (unsigned long long)seeks);
+    OS_PRINT(net, "scan cost hdd : %.1f ms\n", (double)scan_cost_us(seeks, bytes, HDD_SEEK_US, HDD_MB_PER_SEC) / 1000);
+    OS_PRINT(net, "scan cost ssd : %.1f ms\n", (double)scan_cost_us(seeks, bytes, SSD_SEEK_US, SSD_MB_PER_SEC) / 1000);
+}
+
+int do_analyze_cmd(int argc, char *argv[], net_para_t *net)
+{
+    ifs_tools_para_t *para = NULL;
+    analyze_result_t *result = NULL;
+    object_handle_t *obj = NULL;
+    uint32_t threads_num = 0;
+    int32_t ret = 0;
+
+    para = OS_MALLOC(sizeof(ifs_tools_para_t));
+    result = OS_MALLOC(sizeof(analyze_result_t));
+    if ((para == NULL) || (result == NULL))
+    {
+        OS_PRINT(net, "Allocate memory failed.\n");
+        if (para)
+        {
+            OS_FREE(para);
+        }
+
+        return -1;
+    }
+
+    memset(result, 0, sizeof(analyze_result_t));
+    parse_all_para(argc, argv, para);
+    para->net = net;
+
+    if ((strlen(para->ct_name) == 0) || OBJID_IS_INVALID(para->objid))
+    {
+        OS_PRINT(net, "ct name or objid not specified.\n");
+        OS_FREE(result);
+        OS_FREE(para);
+        return -2;
+    }
+
+    threads_num = para->threads_num ? para->threads_num : ANALYZE_DEFAULT_THREADS;
+
+    ret = tools_open_object(para, &obj);
+    if (ret >= 0)
+    {
+        ret = analyze_object(obj, threads_num, result);
+        if (ret < 0)
+        {
+            OS_PRINT(net, "Analyze obj failed. ct(%s) objid(%lld) ret(%d)\n", para->ct_name, para->objid, ret);
+        }
+        else
+        {
+            print_analyze_result(net, obj, result);
+        }
+
+        tools_close_object(para, obj);
+    }
+
+    OS_FREE(result);
+    OS_FREE(para);
+
+    return 0;
+}
+
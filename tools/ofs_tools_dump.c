@@ -140,7 +140,6 @@ static int32_t dump_key(object_handle_t *tree, const bool_t reverse, net_para_t
 
 void dump_cmd(ifs_tools_para_t *para)
 {
-    container_handle_t *ct = NULL;
     object_handle_t *obj = NULL;
     int32_t ret = 0;
     
@@ -152,31 +151,20 @@ void dump_cmd(ifs_tools_para_t *para)
         return;
     }
     
-    ret = ofs_open_container(para->ct_name, &ct);
-    if (ret < 0)
-    {
-        OS_PRINT(para->net, "Open ct failed. ct_name(%s) ret(%d)\n",
-            para->ct_name, ret);
-        return;
-    }
-
     if (OBJID_IS_INVALID(para->objid)) // obj id not specified
     {
         para->objid = OBJID_OBJ_ID;
     }
     
-    ret = ofs_open_object(ct, para->objid, &obj);
+    ret = tools_open_object(para, &obj);
     if (ret < 0)
     {
-        OS_PRINT(para->net, "Open obj failed. ct_name(%s) objid(%lld) ret(%d)\n", para->ct_name, para->objid, ret);
-        (void)ofs_close_container(ct);
 		return;
     }
 
     ret = dump_key(obj, para->flags & TOOLS_FLAGS_REVERSE, para->net);
 
-    (void)ofs_close_object(obj);
-	(void)ofs_close_container(ct);
+    tools_close_object(para, obj);
 	
 	return;
 }
@@ -123,6 +123,55 @@ void parse_all_para(int argc, char *argv[], ifs_tools_para_t *para)
     return;
 }
 
+static int32_t open_object_default(ifs_tools_para_t *para, object_handle_t **obj)
+{
+    container_handle_t *ct = NULL;
+    int32_t ret = 0;
+
+    ret = ofs_open_container(para->ct_name, &ct);
+    if (ret < 0)
+    {
+        OS_PRINT(para->net, "Open ct failed. ct(%s) ret(%d)\n", para->ct_name, ret);
+        return ret;
+    }
+
+    ret = ofs_open_object(ct, para->objid, obj);
+    if (ret < 0)
+    {
+        OS_PRINT(para->net, "Open obj failed. ct(%s) objid(%lld) ret(%d)\n",
+            para->ct_name, para->objid, ret);
+        (void)ofs_close_container(ct);
+        return ret;
+    }
+
+    return 0;
+}
+
+static void close_object_default(ifs_tools_para_t *para, object_handle_t *obj)
+{
+    container_handle_t *ct = obj->ct;
+
+    (void)ofs_close_object(obj);
+    (void)ofs_close_container(ct);
+}
+
+static tools_object_ops_t g_object_ops = {open_object_default, close_object_default};
+
+void tools_set_object_ops(const tools_object_ops_t *ops)
+{
+    g_object_ops = *ops;
+}
+
+int32_t tools_open_object(ifs_tools_para_t *para, object_handle_t **obj)
+{
+    return g_object_ops.open(para, obj);
+}
+
+void tools_close_object(ifs_tools_para_t *para, object_handle_t *obj)
+{
+    g_object_ops.close(para, obj);
+}
+
 os_cmd_list_t ifs_cmd_list[]
 = {
     {do_create_cmd,   {"create",   NULL, NULL}, "<-ct ct_name> [-o obj_id] [-s total_sectors]"},
@@ -139,7 +188,14 @@ os_cmd_list_t ifs_cmd_list[]
 	{do_insert_key_cmd,   {"insert",   NULL, NULL}, "<-ct ct_name> [-o obj_id] [-k key] [-v value]"},
     {do_remove_key_cmd,   {"remove",   NULL, NULL}, "<-ct ct_name> [-o obj_id] [-k key]"},
                 
-	{do_performance_cmd, {"perf", NULL, NULL}, "<-ct ct_name> <-o obj_id> [-n threads_num] [-kn keys_num]"},
+	{do_performance_cmd, {"perf", NULL, NULL}, "<-ct ct_name> <-o obj_id> [-n threads_num] [-kn records_num] [-w a|b|c|d|e|f]\n"
+	    "      [-mix read:update:insert:scan:rmw] [-dist uniform|zipfian|latest] [-vs size|min-max]\n"
+	    "      [-cn containers_num] [-on objects_num] [-ops ops_num] [-wu warmup_ops] [-nl]\n"
+	    "      [-dur none|checkpoint|commit] [-json file]"},
+	{do_stats_cmd,    {"stats",    NULL, NULL}, "[-prom] [-reset]"},
+	{do_lockstat_cmd, {"lockstat", NULL, NULL}, "[-reset]"},
+	{do_analyze_cmd,  {"analyze",  NULL, NULL}, "<-ct ct_name> <-o obj_id> [-n threads_num]"},
+	{do_snapshot_cmd, {"snapshot", NULL, NULL}, "<-ct ct_name> [-c] [-d snapshot_no]"},
 	{NULL, {NULL, NULL, NULL}, NULL}
 };
 
@@ -34,175 +34,1098 @@ History:
 --------------------------------------------------------------------------------
     1. Primary version
 *******************************************************************************/
+#include <math.h>
+#include <stdarg.h>
+
 #include "ofs_if.h"
+#include "histogram.h"
+
+/*
+ * YCSB style workload:
+ * the records are loaded into the objects first, then every thread runs
+ * the mix of operations on the keys picked by the distribution. the first
+ * warmup ops of every thread are not measured. the result is printed as
+ * JSON, and written to the file too if -json is specified.
+ * the containers run in the durability mode of -dur, the redo log traffic and
+ * the time of the final checkpoint are reported for the mode.
+ */
 
-#define TEST_KEY_LEN   8
-#define TEST_VALUE_LEN 20
+#define PERF_KEY_LEN            8
+#define PERF_DEFAULT_SECTORS    (4 * 1024 * 1024)  /* 2GB, the file is sparse */
+#define PERF_DEFAULT_VALUE      100
+#define PERF_MAX_SCAN           100
+#define PERF_MAX_OBJECTS        64
+#define PERF_ZIPF_THETA         0.99
+#define PERF_JSON_SIZE          8192
+#define PERF_PATH_SIZE          256
+#define PERF_CT_NAME_SIZE       (OFS_NAME_SIZE - 10) // room for the container no suffix
+#define PERF_NOT_INSERTING      ((uint64_t)-1)
 
-int32_t test_insert_key_performance(char *ct_name, uint64_t objid, uint64_t keys_num, net_para_t *net)
+enum perf_op
 {
-    int32_t ret;
-    container_handle_t *ct;
-    object_handle_t *obj;
-    uint64_t key;
-    uint8_t value[TEST_VALUE_LEN];
-    uint64_t time;
+    PERF_OP_READ,
+    PERF_OP_UPDATE,
+    PERF_OP_INSERT,
+    PERF_OP_SCAN,
+    PERF_OP_RMW,
 
-    ret = ofs_open_container(ct_name, &ct);
-    if (ret < 0)
+    PERF_OP_NUM
+};
+
+enum perf_dist
+{
+    PERF_DIST_UNIFORM,
+    PERF_DIST_ZIPFIAN,
+    PERF_DIST_LATEST,
+
+    PERF_DIST_NUM
+};
+
+static const char *g_op_name[PERF_OP_NUM] = {"read", "update", "insert", "scan", "rmw"};
+static const char *g_dist_name[PERF_DIST_NUM] = {"uniform", "zipfian", "latest"};
+static const char *g_dur_name[OFS_DURABILITY_BUTT] = {"none", "checkpoint", "commit"};
+static const uint32_t g_log_cnt[] = {OFS_CNT_LOG_APPEND, OFS_CNT_LOG_SYNC, OFS_CNT_LOG_BYTES};
+
+#define PERF_LOG_CNT_NUM    (sizeof(g_log_cnt) / sizeof(g_log_cnt[0]))
+
+typedef struct perf_workload
+{
+    const char *name;
+    uint32_t mix[PERF_OP_NUM];      // percentage of every operation
+    uint32_t dist;
+} perf_workload_t;
+
+static const perf_workload_t g_workloads[] =
+{
+    //        read update insert scan rmw
+    {"a",    {50,  50,    0,     0,   0},  PERF_DIST_ZIPFIAN},  // update heavy
+    {"b",    {95,  5,     0,     0,   0},  PERF_DIST_ZIPFIAN},  // read mostly
+    {"c",    {100, 0,     0,     0,   0},  PERF_DIST_ZIPFIAN},  // read only
+    {"d",    {95,  0,     5,     0,   0},  PERF_DIST_LATEST},   // read latest
+    {"e",    {0,   0,     5,     95,  0},  PERF_DIST_ZIPFIAN},  // short ranges
+    {"f",    {50,  0,     0,     0,   50}, PERF_DIST_ZIPFIAN},  // read-modify-write
+};
+
+// the zipfian generator of Gray et al., used by YCSB
+typedef struct perf_zipf
+{
+    uint64_t items;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+} perf_zipf_t;
+
+typedef struct perf_config
+{
+    char ct_name[PERF_CT_NAME_SIZE];
+    uint64_t objid;                 // the first object of every container
+    uint64_t total_sectors;         // for the containers created
+    uint32_t containers_num;
+    uint32_t objects_num;           // objects of every container
+    uint32_t threads_num;
+    uint64_t records_num;           // keys loaded before the run
+    uint64_t warmup_ops;            // ops of every thread not measured
+    uint64_t ops_num;               // ops of every thread measured
+    perf_workload_t workload;
+    char mix_name[PERF_PATH_SIZE];
+    uint32_t value_min;
+    uint32_t value_max;
+    uint32_t scan_max;
+    bool_t load;
+    uint32_t durability;
+    char json_file[PERF_PATH_SIZE];
+} perf_config_t;
+
+typedef struct perf_ctx
+{
+    perf_config_t *cfg;
+    net_para_t *net;
+    container_handle_t *cts[PERF_MAX_OBJECTS];
+    object_handle_t *objs[PERF_MAX_OBJECTS];  // kept opened during the test
+    uint32_t objs_num;
+    volatile uint64_t records;                // the keys taken by the inserts
+    struct perf_thread *thds;
+    perf_zipf_t zipf;
+    uint64_t log_cnt[PERF_LOG_CNT_NUM];       // the counters before the test
+} perf_ctx_t;
+
+typedef struct perf_thread
+{
+    perf_ctx_t *ctx;
+    uint32_t no;
+    bool_t load;
+    object_handle_t *objs[PERF_MAX_OBJECTS];  // handles of this thread
+    uint64_t rand;
+    uint64_t start;                           // ns
+    uint64_t end;
+    volatile uint64_t inserting;              // not above the record being inserted
+    uint64_t errors[PERF_OP_NUM];
+    histogram_t hist[PERF_OP_NUM];
+    uint8_t value[VALUE_MAX_SIZE];
+    uint8_t read_buf[VALUE_MAX_SIZE];         // the values read
+} perf_thread_t;
+
+typedef struct perf_json
+{
+    char *buf;
+    uint32_t size;
+    uint32_t len;
+} perf_json_t;
+
+// spread the keys of record numbers over the key space
+static uint64_t perf_hash(uint64_t v)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    uint32_t i = 0;
+
+    for (i = 0; i < 8; i++)
     {
-        OS_PRINT(net, "Open ct failed. name(%s) ret(%d)\n", ct_name, ret);
-        return ret;
+        h ^= v & 0xFF;
+        h *= 0x100000001B3ULL;
+        v >>= 8;
     }
 
-    ret = ofs_create_object(ct, objid, FLAG_TABLE | CR_BINARY | (CR_ANSI_STRING << 4), &obj);
-    if (ret < 0)
+    return h;
+}
+
+// xorshift64*
+static uint64_t perf_rand(perf_thread_t *thd)
+{
+    thd->rand ^= thd->rand >> 12;
+    thd->rand ^= thd->rand << 25;
+    thd->rand ^= thd->rand >> 27;
+
+    return thd->rand * 0x2545F4914F6CDD1DULL;
+}
+
+// [0, 1)
+static double perf_rand_double(perf_thread_t *thd)
+{
+    return (double)(perf_rand(thd) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void perf_zipf_init(perf_zipf_t *zipf, uint64_t items, double theta)
+{
+    double zeta2 = 0.0;
+    uint64_t i = 0;
+
+    zipf->items = (items != 0) ? items : 1;
+    zipf->theta = theta;
+    zipf->zetan = 0.0;
+
+    for (i = 1; i <= zipf->items; i++)
     {
-        OS_PRINT(net, "Create obj failed. objid(%lld) ret(%d)\n", objid, ret);
-        (void)ofs_close_container(ct);
-        return ret;
+        zipf->zetan += 1.0 / pow((double)i, theta);
     }
 
-    memset(value, 0x88, sizeof(value));
+    zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+    zipf->alpha = 1.0 / (1.0 - theta);
+    zipf->eta = (1.0 - pow(2.0 / (double)zipf->items, 1.0 - theta)) / (1.0 - zeta2 / zipf->zetan);
+}
 
-    OS_PRINT(net, "Start insert key. objid(%lld) total(%lld)\n", objid, keys_num);
-    time = os_get_ms_count();
+// [0, items), the small numbers are the hot ones
+static uint64_t perf_zipf_next(perf_zipf_t *zipf, double u)
+{
+    double uz = u * zipf->zetan;
+    uint64_t v = 0;
 
-    for (key = 0; key < keys_num; key++)
+    if (uz < 1.0)
     {
-        ret = index_insert_key(obj, &key, TEST_KEY_LEN, value, TEST_VALUE_LEN);
-        if (ret < 0)
+        return 0;
+    }
+
+    if (uz < 1.0 + pow(0.5, zipf->theta))
+    {
+        return 1;
+    }
+
+    v = (uint64_t)((double)zipf->items * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+
+    return (v < zipf->items) ? v : zipf->items - 1;
+}
+
+// the records below are all inserted, the ones still being inserted are not
+static uint64_t perf_inserted_records(perf_ctx_t *ctx)
+{
+    uint64_t records = ctx->records;
+    uint64_t inserting = 0;
+    uint32_t i = 0;
+
+    smp_rmb(); // a record taken before is seen in the inserting of its thread
+    for (i = 0; i < ctx->cfg->threads_num; i++)
+    {
+        inserting = ctx->thds[i].inserting;
+        if (inserting < records)
+        {
+            records = inserting;
+        }
+    }
+
+    return records;
+}
+
+// pick a record already inserted
+static uint64_t perf_next_record(perf_thread_t *thd)
+{
+    perf_ctx_t *ctx = thd->ctx;
+    uint64_t records = ctx->records;
+    uint64_t v = 0;
+
+    if (ctx->cfg->workload.mix[PERF_OP_INSERT] != 0)
+    {
+        records = perf_inserted_records(ctx);
+    }
+
+    switch (ctx->cfg->workload.dist)
+    {
+        case PERF_DIST_ZIPFIAN:
+            // scrambled, the hot keys are not neighbors
+            v = perf_zipf_next(&ctx->zipf, perf_rand_double(thd));
+            return perf_hash(v) % records;
+
+        case PERF_DIST_LATEST:
+            v = perf_zipf_next(&ctx->zipf, perf_rand_double(thd));
+            return (v < records) ? (records - 1 - v) : 0;
+
+        default:
+            break;
+    }
+
+    return perf_rand(thd) % records;
+}
+
+static uint16_t perf_next_value_len(perf_thread_t *thd)
+{
+    perf_config_t *cfg = thd->ctx->cfg;
+
+    return (uint16_t)(cfg->value_min + perf_rand(thd) % (cfg->value_max - cfg->value_min + 1));
+}
+
+static uint32_t perf_next_op(perf_thread_t *thd)
+{
+    uint32_t *mix = thd->ctx->cfg->workload.mix;
+    uint32_t v = (uint32_t)(perf_rand(thd) % 100);
+    uint32_t op = 0;
+
+    for (op = 0; op < PERF_OP_NUM - 1; op++)
+    {
+        if (v < mix[op])
         {
-            OS_PRINT(net, "Insert key failed. objid(%lld) key(%lld) ret(%d)\n", objid, key, ret);
             break;
         }
+
+        v -= mix[op];
     }
 
-    OS_PRINT(net, "Finished insert key. objid(%lld) total(%lld) time(%lld ms)\n",
-        objid, keys_num, os_get_ms_count() - time);
+    return op;
+}
 
-    (void)ofs_close_object(obj);
-    (void)ofs_close_container(ct);
-    
-    return 0;
+static void perf_make_key(uint64_t record, uint8_t *key)
+{
+    uint64_t v = perf_hash(record);
+    int32_t i = 0;
+
+    // big endian, the binary collation sorts them as numbers
+    for (i = PERF_KEY_LEN - 1; i >= 0; i--)
+    {
+        key[i] = (uint8_t)v;
+        v >>= 8;
+    }
 }
 
-int32_t test_remove_key_performance(char *ct_name, uint64_t objid, uint64_t keys_num, net_para_t *net)
+static int32_t perf_scan(object_handle_t *obj, const uint8_t *key, uint32_t len)
 {
+    uint32_t cnt = 0;
     int32_t ret = 0;
-    container_handle_t *ct = NULL;
+
+    OS_RWLOCK_WRLOCK(&obj->obj_info->attr_lock);
+
+    // start from the key, or the next key larger than it
+    ret = index_search_key_nolock(obj, key, PERF_KEY_LEN, NULL, 0);
+    if (ret == -INDEX_ERR_KEY_NOT_FOUND)
+    {
+        // the end of a leaf goes up to the next key in the parent
+        ret = walk_tree(obj, INDEX_GET_CURRENT);
+    }
+
+    while ((ret >= 0) && (++cnt < len))
+    {
+        ret = walk_tree(obj, 0);
+    }
+
+    OS_RWLOCK_WRUNLOCK(&obj->obj_info->attr_lock);
+
+    // the end of the object is reached
+    return (ret == -INDEX_ERR_ROOT) ? 0 : ret;
+}
+
+static int32_t perf_exec_op(perf_thread_t *thd, uint32_t op)
+{
+    perf_ctx_t *ctx = thd->ctx;
+    uint8_t key[PERF_KEY_LEN];
     object_handle_t *obj = NULL;
-    uint64_t key = 0;
-    uint64_t time = 0;
+    uint64_t record = 0;
+    int32_t ret = 0;
 
-    ret = ofs_open_container(ct_name, &ct);
-    if (ret < 0)
+    if (op == PERF_OP_INSERT)
+    { // published before the record is taken, see perf_inserted_records
+        thd->inserting = ctx->records;
+        smp_mb();
+        record = atomic_add(&ctx->records, 1);
+    }
+    else
     {
-        OS_PRINT(net, "Open ct failed. name(%s) ret(%d)\n", ct_name, ret);
-        return ret;
+        record = perf_next_record(thd);
+    }
+
+    perf_make_key(record, key);
+    obj = thd->objs[record % ctx->objs_num];
+
+    switch (op)
+    {
+        case PERF_OP_READ:
+            ret = index_get_into(obj, key, PERF_KEY_LEN, thd->read_buf, VALUE_MAX_SIZE);
+            return (ret < 0) ? ret : 0;
+
+        case PERF_OP_UPDATE:
+            return index_update_value(obj, key, PERF_KEY_LEN, thd->value, perf_next_value_len(thd));
+
+        case PERF_OP_INSERT:
+            ret = index_insert_key(obj, key, PERF_KEY_LEN, thd->value, perf_next_value_len(thd));
+            smp_wmb();
+            thd->inserting = PERF_NOT_INSERTING;
+            return ret;
+
+        case PERF_OP_SCAN:
+            return perf_scan(obj, key, 1 + (uint32_t)(perf_rand(thd) % ctx->cfg->scan_max));
+
+        case PERF_OP_RMW:
+            ret = index_get_into(obj, key, PERF_KEY_LEN, thd->read_buf, VALUE_MAX_SIZE);
+            if (ret < 0)
+            {
+                return ret;
+            }
+
+            return index_update_value(obj, key, PERF_KEY_LEN, thd->value, perf_next_value_len(thd));
+
+        default:
+            break;
     }
 
-    ret = ofs_open_object(ct, objid, &obj);
+    return -INDEX_ERR_PARAMETER;
+}
+
+static void perf_exec_timed(perf_thread_t *thd, uint32_t op, bool_t measured)
+{
+    uint64_t start = os_get_ns_count();
+    int32_t ret = 0;
+
+    ret = perf_exec_op(thd, op);
+    if (!measured)
+    {
+        return;
+    }
+
+    hist_record(&thd->hist[op], os_get_ns_count() - start);
     if (ret < 0)
     {
-        OS_PRINT(net, "Open tree failed. objid(%lld) ret(%d)\n", objid, ret);
-        (void)ofs_close_container(ct);
-        return ret;
+        thd->errors[op]++;
     }
+}
+
+static void perf_load(perf_thread_t *thd)
+{
+    perf_ctx_t *ctx = thd->ctx;
+    perf_config_t *cfg = ctx->cfg;
+    uint8_t key[PERF_KEY_LEN];
+    uint64_t record = 0;
+    uint64_t start = 0;
+    int32_t ret = 0;
 
-    OS_PRINT(net, "Start remove key. objid(%lld) total(%lld)\n", objid, keys_num);
-    time = os_get_ms_count();
+    thd->start = os_get_ns_count();
 
-    for (key = 0; key < keys_num; key++)
+    for (record = thd->no; record < cfg->records_num; record += cfg->threads_num)
     {
-        ret = index_remove_key(obj, &key, TEST_KEY_LEN);
+        perf_make_key(record, key);
+        start = os_get_ns_count();
+        ret = index_insert_key(thd->objs[record % ctx->objs_num], key, PERF_KEY_LEN,
+            thd->value, perf_next_value_len(thd));
+        hist_record(&thd->hist[PERF_OP_INSERT], os_get_ns_count() - start);
         if (ret < 0)
         {
-            OS_PRINT(net, "Remove key failed. objid(%lld) key(%lld) ret(%d)\n", objid, key, ret);
-            break;
+            thd->errors[PERF_OP_INSERT]++;
         }
     }
 
-    OS_PRINT(net, "Finished remove key. objid(%lld) total(%lld) time(%lld ms)\n",
-        objid, keys_num, os_get_ms_count() - time);
+    thd->end = os_get_ns_count();
+}
 
-    (void)ofs_close_object(obj);
-    (void)ofs_close_container(ct);
-    
-    return 0;
+static void perf_run(perf_thread_t *thd)
+{
+    perf_config_t *cfg = thd->ctx->cfg;
+    uint64_t i = 0;
+
+    for (i = 0; i < cfg->warmup_ops; i++)
+    {
+        perf_exec_timed(thd, perf_next_op(thd), FALSE);
+    }
+
+    thd->start = os_get_ns_count();
+
+    for (i = 0; i < cfg->ops_num; i++)
+    {
+        perf_exec_timed(thd, perf_next_op(thd), TRUE);
+    }
+
+    thd->end = os_get_ns_count();
 }
 
-void *test_performance_thread(void *para)
+static void *perf_worker(void *para)
 {
-    ifs_tools_para_t *tmp_para = para;
+    perf_thread_t *thd = para;
 
-    if (tmp_para->insert)
+    if (thd->load)
     {
-        (void)test_insert_key_performance(tmp_para->ct_name, tmp_para->objid, tmp_para->keys_num, tmp_para->net);
+        perf_load(thd);
     }
     else
     {
-        (void)test_remove_key_performance(tmp_para->ct_name, tmp_para->objid, tmp_para->keys_num, tmp_para->net);
+        perf_run(thd);
     }
 
-    OS_RWLOCK_WRLOCK(&tmp_para->rwlock);
-    tmp_para->threads_cnt--;
-    OS_RWLOCK_WRUNLOCK(&tmp_para->rwlock);
-
     OS_THREAD_EXIT();
-    
+
     return NULL;
 }
 
-int32_t test_performance(ifs_tools_para_t *para, bool_t insert)
+static void json_add(perf_json_t *json, const char *format, ...)
 {
-    void *threads_group = NULL;
-    uint32_t i;
-    os_thread_t *tid;
+    va_list ap;
+    int32_t n = 0;
 
-    para->insert = insert;
-    para->threads_cnt = 0;
-    para->no = 0;
+    if (json->len >= json->size)
+    {
+        return;
+    }
 
-    tid = OS_MALLOC(sizeof(os_thread_t) * para->threads_num);
+    va_start(ap, format);
+    n = OS_VSNPRINTF(json->buf + json->len, json->size - json->len, format, ap);
+    va_end(ap);
+
+    if (n > 0)
+    {
+        json->len += (uint32_t)n;
+    }
+
+    if (json->len >= json->size)
+    {
+        json->len = json->size - 1;
+    }
+}
+
+// the latency in us
+static void json_add_hist(perf_json_t *json, const char *name, histogram_t *hist,
+    uint64_t errors, bool_t last)
+{
+    json_add(json, "      \"%s\": {\"ops\": %llu, \"errors\": %llu, \"mean_us\": %.2f, "
+        "\"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"p999_us\": %.2f, \"max_us\": %.2f}%s\n",
+        name, (unsigned long long)hist->total, (unsigned long long)errors, hist_mean(hist) / 1000.0,
+        hist_percentile(hist, 500) / 1000.0, hist_percentile(hist, 900) / 1000.0,
+        hist_percentile(hist, 990) / 1000.0, hist_percentile(hist, 999) / 1000.0,
+        hist->max / 1000.0, last ? "" : ",");
+}
+
+// merge the results of all the threads into the phase
+static void json_add_phase(perf_json_t *json, const char *phase, perf_thread_t *thds,
+    uint32_t threads_num)
+{
+    histogram_t *hist = NULL;
+    uint64_t errors[PERF_OP_NUM];
+    uint64_t start = (uint64_t)-1;
+    uint64_t end = 0;
+    uint64_t total = 0;
+    uint64_t total_errors = 0;
+    uint32_t i = 0;
+    uint32_t op = 0;
+    uint32_t ops_num = 0;
+    uint32_t cnt = 0;
+
+    hist = OS_MALLOC(sizeof(histogram_t) * PERF_OP_NUM);
+    if (hist == NULL)
+    {
+        return;
+    }
+
+    memset(errors, 0, sizeof(errors));
+
+    for (op = 0; op < PERF_OP_NUM; op++)
+    {
+        hist_init(&hist[op]);
+        for (i = 0; i < threads_num; i++)
+        {
+            hist_merge(&hist[op], &thds[i].hist[op]);
+            errors[op] += thds[i].errors[op];
+        }
+
+        total += hist[op].total;
+        total_errors += errors[op];
+        if (hist[op].total != 0)
+        {
+            ops_num++;
+        }
+    }
+
+    for (i = 0; i < threads_num; i++)
+    {
+        start = (thds[i].start < start) ? thds[i].start : start;
+        end = (thds[i].end > end) ? thds[i].end : end;
+    }
+
+    if (end < start)
+    {
+        end = start;
+    }
+
+    json_add(json, "  \"%s\": {\n", phase);
+    json_add(json, "    \"ops\": %llu, \"errors\": %llu, \"ms\": %.3f, \"ops_per_sec\": %.1f,\n",
+        (unsigned long long)total, (unsigned long long)total_errors, (end - start) / 1000000.0,
+        (end > start) ? (double)total * 1000000000.0 / (double)(end - start) : 0.0);
+    json_add(json, "    \"latency\": {\n");
+
+    for (op = 0; op < PERF_OP_NUM; op++)
+    {
+        if (hist[op].total != 0)
+        {
+            json_add_hist(json, g_op_name[op], &hist[op], errors[op], ++cnt == ops_num);
+        }
+    }
+
+    json_add(json, "    }\n  },\n");
+
+    OS_FREE(hist);
+}
+
+static int32_t perf_start_threads(perf_ctx_t *ctx, perf_thread_t *thds, bool_t load)
+{
+    perf_config_t *cfg = ctx->cfg;
+    os_thread_t *tid = NULL;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint32_t started = 0;
+
+    tid = OS_MALLOC(sizeof(os_thread_t) * cfg->threads_num);
     if (tid == NULL)
     {
-        return -1;
+        OS_PRINT(ctx->net, "Allocate memory failed. size(%d)\n",
+            (uint32_t)(sizeof(os_thread_t) * cfg->threads_num));
+        return -INDEX_ERR_ALLOCATE_MEMORY;
     }
 
-    memset(tid, 0, sizeof(os_thread_t) * para->threads_num);
+    for (i = 0; i < cfg->threads_num; i++)
+    {
+        thds[i].load = load;
+        thds[i].start = 0;
+        thds[i].end = 0;
+        memset(thds[i].errors, 0, sizeof(thds[i].errors));
+        for (j = 0; j < PERF_OP_NUM; j++)
+        {
+            hist_init(&thds[i].hist[j]);
+        }
+    }
 
-    for (i = 0; i < para->threads_num; i++)
+    for (i = 0; i < cfg->threads_num; i++)
     {
-        tid[i] = thread_create(test_performance_thread, para, "perf");
+        tid[i] = thread_create(perf_worker, &thds[i], "perf");
         if (tid[i] == INVALID_TID)
         {
-            OS_PRINT(para->net, "Create thread %d failed.\n", i);
+            OS_PRINT(ctx->net, "Create thread %d failed.\n", i);
             break;
         }
+    }
 
-        OS_RWLOCK_WRLOCK(&para->rwlock);
-        para->threads_cnt++;
-        OS_RWLOCK_WRUNLOCK(&para->rwlock);
-        
-        OS_PRINT(para->net, "Create thread %d success.\n", i);
+    started = i;
+
+    for (i = 0; i < started; i++)
+    {
+        thread_destroy(tid[i], FALSE);
     }
 
-    while (para->threads_cnt)
+    OS_FREE(tid);
+
+    return (started == cfg->threads_num) ? 0 : -INDEX_ERR_PARAMETER;
+}
+
+static void perf_close_objects(perf_ctx_t *ctx, perf_thread_t *thds)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (i = 0; i < ctx->cfg->threads_num; i++)
     {
-        OS_SLEEP_SECOND(1);
+        for (j = 0; j < ctx->objs_num; j++)
+        {
+            if (thds[i].objs[j])
+            {
+                (void)ofs_close_object(thds[i].objs[j]);
+                thds[i].objs[j] = NULL;
+            }
+        }
     }
 
-    for (i = 0; i < para->threads_num; i++)
+    for (j = 0; j < ctx->objs_num; j++)
     {
-        if (tid[i] != INVALID_TID)
+        if (ctx->objs[j])
         {
-            thread_destroy(tid[i], TRUE);
-            OS_PRINT(para->net, "Destroy thread %d finished.\n", i);
+            (void)ofs_close_object(ctx->objs[j]);
+            ctx->objs[j] = NULL;
+        }
+
+        if (ctx->cts[j])
+        {
+            (void)ofs_close_container(ctx->cts[j]);
+            ctx->cts[j] = NULL;
         }
     }
+}
 
-    OS_FREE(tid);
+// object i is the (i / containers_num)th object in the container (i % containers_num)
+static int32_t perf_open_objects(perf_ctx_t *ctx, perf_thread_t *thds)
+{
+    perf_config_t *cfg = ctx->cfg;
+    char ct_name[OFS_NAME_SIZE];
+    uint64_t objid = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    int32_t ret = 0;
+
+    ctx->objs_num = cfg->containers_num * cfg->objects_num;
+
+    for (i = 0; i < ctx->objs_num; i++)
+    {
+        if (i % cfg->containers_num)
+        {
+            OS_SNPRINTF(ct_name, OFS_NAME_SIZE, "%s%u", cfg->ct_name, i % cfg->containers_num);
+        }
+        else
+        {
+            OS_SNPRINTF(ct_name, OFS_NAME_SIZE, "%s", cfg->ct_name);
+        }
+
+        objid = cfg->objid + i / cfg->containers_num;
+
+        ret = ofs_open_container(ct_name, &ctx->cts[i]);
+        if (ret < 0)
+        {
+            ret = ofs_create_container(ct_name, cfg->total_sectors, &ctx->cts[i]);
+        }
+
+        if (ret < 0)
+        {
+            OS_PRINT(ctx->net, "Open ct failed. name(%s) ret(%d)\n", ct_name, ret);
+            return ret;
+        }
+
+        (void)ofs_set_durability(ctx->cts[i], cfg->durability);
+
+        ret = ofs_open_object(ctx->cts[i], objid, &ctx->objs[i]);
+        if (ret < 0)
+        {
+            ret = ofs_create_object(ctx->cts[i], objid, FLAG_TABLE | CR_BINARY | (CR_BINARY << 4), &ctx->objs[i]);
+        }
+
+        if (ret < 0)
+        {
+            OS_PRINT(ctx->net, "Open obj failed. name(%s) objid(%lld) ret(%d)\n", ct_name, objid, ret);
+            return ret;
+        }
+
+        // the threads do not share the search path of the handle
+        for (j = 0; j < cfg->threads_num; j++)
+        {
+            ret = ofs_open_object(ctx->cts[i], objid, &thds[j].objs[i]);
+            if (ret < 0)
+            {
+                OS_PRINT(ctx->net, "Open obj failed. name(%s) objid(%lld) ret(%d)\n", ct_name, objid, ret);
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// the log counters of all the containers, the first containers_num handles are of different containers
+static void perf_get_log_counters(perf_ctx_t *ctx, uint64_t *cnt)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    memset(cnt, 0, sizeof(uint64_t) * PERF_LOG_CNT_NUM);
+
+    for (i = 0; i < ctx->cfg->containers_num; i++)
+    {
+        for (j = 0; j < PERF_LOG_CNT_NUM; j++)
+        {
+            cnt[j] += ofs_counter_get(&ctx->cts[i]->counters, g_log_cnt[j]);
+        }
+    }
+}
+
+// the cost of the mode: the log traffic of the test, and the checkpoint at the end
+static int32_t json_add_durability(perf_ctx_t *ctx, perf_json_t *json)
+{
+    uint64_t cnt[PERF_LOG_CNT_NUM];
+    uint64_t start = 0;
+    uint64_t commit_ns = 0;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    perf_get_log_counters(ctx, cnt);
+
+    start = os_get_ns_count();
+    for (i = 0; i < ctx->cfg->containers_num; i++)
+    {
+        ret = ofs_commit_container(ctx->cts[i]);
+        if (ret < 0)
+        {
+            OS_PRINT(ctx->net, "Commit ct failed. name(%s) ret(%d)\n", ctx->cts[i]->name, ret);
+            return ret;
+        }
+    }
+
+    commit_ns = os_get_ns_count() - start;
+
+    json_add(json, "  \"durability\": {\"mode\": \"%s\", \"log_appends\": %llu, \"log_syncs\": %llu, "
+        "\"log_bytes\": %llu, \"commit_ms\": %.3f}\n",
+        g_dur_name[ctx->cfg->durability],
+        (unsigned long long)(cnt[0] - ctx->log_cnt[0]), (unsigned long long)(cnt[1] - ctx->log_cnt[1]),
+        (unsigned long long)(cnt[2] - ctx->log_cnt[2]), commit_ns / 1000000.0);
+
+    return 0;
+}
+
+static void perf_output(perf_ctx_t *ctx, perf_json_t *json)
+{
+    perf_config_t *cfg = ctx->cfg;
+    void *file = NULL;
+    char *line = json->buf;
+    char *end = NULL;
+    int32_t ret = 0;
+
+    // print line by line, the net buffer is small
+    while ((end = strchr(line, '\n')) != NULL)
+    {
+        *end = 0;
+        OS_PRINT(ctx->net, "%s\n", line);
+        *end = '\n';
+        line = end + 1;
+    }
+
+    if (cfg->json_file[0] == 0)
+    {
+        return;
+    }
+
+    ret = os_file_create(&file, cfg->json_file);
+    if (ret < 0)
+    {
+        OS_PRINT(ctx->net, "Create file failed. name(%s) ret(%d)\n", cfg->json_file, ret);
+        return;
+    }
+
+    (void)os_file_write(file, json->buf, json->len);
+    (void)os_file_close(file);
+}
+
+int32_t test_performance(perf_config_t *cfg, net_para_t *net)
+{
+    perf_ctx_t *ctx = NULL;
+    perf_thread_t *thds = NULL;
+    perf_json_t json;
+    uint32_t i = 0;
+    int32_t ret = 0;
+
+    ctx = OS_MALLOC(sizeof(perf_ctx_t));
+    thds = OS_MALLOC(sizeof(perf_thread_t) * cfg->threads_num);
+    json.buf = OS_MALLOC(PERF_JSON_SIZE);
+    if ((ctx == NULL) || (thds == NULL) || (json.buf == NULL))
+    {
+        OS_PRINT(net, "Allocate memory failed.\n");
+        OS_FREE(ctx);
+        OS_FREE(thds);
+        OS_FREE(json.buf);
+        return -INDEX_ERR_ALLOCATE_MEMORY;
+    }
+
+    memset(ctx, 0, sizeof(perf_ctx_t));
+    memset(thds, 0, sizeof(perf_thread_t) * cfg->threads_num);
+    json.size = PERF_JSON_SIZE;
+    json.len = 0;
+    json.buf[0] = 0;
+
+    ctx->cfg = cfg;
+    ctx->net = net;
+    ctx->thds = thds;
+
+    for (i = 0; i < cfg->threads_num; i++)
+    {
+        thds[i].ctx = ctx;
+        thds[i].no = i;
+        thds[i].inserting = PERF_NOT_INSERTING;
+        thds[i].rand = 0x9E3779B97F4A7C15ULL * (i + 1);
+        memset(thds[i].value, 0x88, VALUE_MAX_SIZE);
+    }
+
+    ret = perf_open_objects(ctx, thds);
+    if (ret < 0)
+    {
+        perf_close_objects(ctx, thds);
+        OS_FREE(json.buf);
+        OS_FREE(thds);
+        OS_FREE(ctx);
+        return ret;
+    }
+
+    json_add(&json, "{\n");
+    json_add(&json, "  \"workload\": \"%s\", \"distribution\": \"%s\", "
+        "\"mix\": {\"read\": %u, \"update\": %u, \"insert\": %u, \"scan\": %u, \"rmw\": %u},\n",
+        cfg->mix_name, g_dist_name[cfg->workload.dist],
+        cfg->workload.mix[PERF_OP_READ], cfg->workload.mix[PERF_OP_UPDATE],
+        cfg->workload.mix[PERF_OP_INSERT], cfg->workload.mix[PERF_OP_SCAN],
+        cfg->workload.mix[PERF_OP_RMW]);
+    json_add(&json, "  \"threads\": %u, \"containers\": %u, \"objects\": %u, \"records\": %llu, "
+        "\"warmup_ops\": %llu, \"ops\": %llu, \"value_min\": %u, \"value_max\": %u, \"scan_max\": %u,\n",
+        cfg->threads_num, cfg->containers_num, ctx->objs_num, (unsigned long long)cfg->records_num,
+        (unsigned long long)(cfg->warmup_ops * cfg->threads_num),
+        (unsigned long long)(cfg->ops_num * cfg->threads_num),
+        cfg->value_min, cfg->value_max, cfg->scan_max);
+
+    perf_get_log_counters(ctx, ctx->log_cnt);
+
+    if (cfg->load && (cfg->records_num != 0))
+    {
+        OS_PRINT(net, "Start load. records(%lld) threads(%d)\n", cfg->records_num, cfg->threads_num);
+        ret = perf_start_threads(ctx, thds, TRUE);
+        if (ret >= 0)
+        {
+            json_add_phase(&json, "load", thds, cfg->threads_num);
+        }
+    }
+
+    ctx->records = cfg->records_num;
+    if ((ret >= 0) && (cfg->ops_num != 0))
+    {
+        perf_zipf_init(&ctx->zipf, cfg->records_num, PERF_ZIPF_THETA);
+        OS_PRINT(net, "Start run. workload(%s) ops(%lld) threads(%d)\n",
+            cfg->mix_name, cfg->ops_num * cfg->threads_num, cfg->threads_num);
+        ret = perf_start_threads(ctx, thds, FALSE);
+        if (ret >= 0)
+        {
+            json_add_phase(&json, "run", thds, cfg->threads_num);
+        }
+    }
+
+    if (ret >= 0)
+    {
+        ret = json_add_durability(ctx, &json);
+    }
+
+    json_add(&json, "}\n");
+
+    if (ret >= 0)
+    {
+        perf_output(ctx, &json);
+    }
+
+    perf_close_objects(ctx, thds);
+    OS_FREE(json.buf);
+    OS_FREE(thds);
+    OS_FREE(ctx);
+
+    return ret;
+}
+
+// read:update:insert:scan:rmw, e.g. 90:0:10:0:0
+static int32_t parse_mix(const char *str, perf_workload_t *workload)
+{
+    char *end = NULL;
+    uint32_t total = 0;
+    uint32_t op = 0;
+
+    for (op = 0; op < PERF_OP_NUM; op++)
+    {
+        workload->mix[op] = (uint32_t)strtoul(str, &end, 10);
+        total += workload->mix[op];
+        if (*end != ':')
+        {
+            op++;
+            break;
+        }
+
+        str = end + 1;
+    }
+
+    for (; op < PERF_OP_NUM; op++)
+    {
+        workload->mix[op] = 0;
+    }
+
+    return (total == 100) ? 0 : -1;
+}
+
+static int32_t parse_perf_para(int argc, char *argv[], ifs_tools_para_t *para,
+    perf_config_t *cfg)
+{
+    char tmp[PERF_PATH_SIZE];
+    char *end = NULL;
+    uint32_t i = 0;
+
+    memset(cfg, 0, sizeof(perf_config_t));
+    if (strlen(para->ct_name) >= PERF_CT_NAME_SIZE)
+    {
+        return -8;
+    }
+
+    strncpy(cfg->ct_name, para->ct_name, PERF_CT_NAME_SIZE - 1);
+    cfg->objid = para->objid;
+    cfg->threads_num = (para->threads_num != 0) ? para->threads_num : 1;
+    cfg->records_num = para->keys_num;
+    cfg->containers_num = 1;
+    cfg->objects_num = 1;
+    cfg->ops_num = para->keys_num;
+    cfg->value_min = PERF_DEFAULT_VALUE;
+    cfg->value_max = PERF_DEFAULT_VALUE;
+    cfg->scan_max = PERF_MAX_SCAN;
+    cfg->load = TRUE;
+    cfg->workload = g_workloads[0];
+    cfg->durability = OFS_DURABILITY_CHECKPOINT;
+    cfg->total_sectors = os_parse_para(argc, argv, "-s", NULL, 0) ? PERF_DEFAULT_SECTORS : para->total_sectors;
+
+    if (os_parse_para(argc, argv, "-w", tmp, sizeof(tmp)) == 0)
+    {
+        for (i = 0; i < sizeof(g_workloads) / sizeof(g_workloads[0]); i++)
+        {
+            if (strcmp(tmp, g_workloads[i].name) == 0)
+            {
+                break;
+            }
+        }
+
+        if (i == sizeof(g_workloads) / sizeof(g_workloads[0]))
+        {
+            return -1;
+        }
+
+        cfg->workload = g_workloads[i];
+    }
+
+    OS_SNPRINTF(cfg->mix_name, sizeof(cfg->mix_name), "%s", cfg->workload.name);
+
+    if (os_parse_para(argc, argv, "-mix", tmp, sizeof(tmp)) == 0)
+    {
+        if (parse_mix(tmp, &cfg->workload) < 0)
+        {
+            return -2;
+        }
+
+        OS_SNPRINTF(cfg->mix_name, sizeof(cfg->mix_name), "%s", tmp);
+    }
+
+    if (os_parse_para(argc, argv, "-dist", tmp, sizeof(tmp)) == 0)
+    {
+        for (i = 0; i < PERF_DIST_NUM; i++)
+        {
+            if (strcmp(tmp, g_dist_name[i]) == 0)
+            {
+                break;
+            }
+        }
+
+        if (i == PERF_DIST_NUM)
+        {
+            return -3;
+        }
+
+        cfg->workload.dist = i;
+    }
+
+    // fixed size, or min-max
+    if (os_parse_para(argc, argv, "-vs", tmp, sizeof(tmp)) == 0)
+    {
+        cfg->value_min = (uint32_t)strtoul(tmp, &end, 0);
+        cfg->value_max = (*end == '-') ? (uint32_t)strtoul(end + 1, NULL, 0) : cfg->value_min;
+        if ((cfg->value_min == 0) || (cfg->value_min > cfg->value_max)
+            || (cfg->value_max > VALUE_MAX_SIZE))
+        {
+            return -4;
+        }
+    }
+
+    if (os_parse_para(argc, argv, "-cn", tmp, sizeof(tmp)) == 0)
+    {
+        cfg->containers_num = (uint32_t)strtoul(tmp, NULL, 0);
+    }
+
+    if (os_parse_para(argc, argv, "-on", tmp, sizeof(tmp)) == 0)
+    {
+        cfg->objects_num = (uint32_t)strtoul(tmp, NULL, 0);
+    }
+
+    if ((cfg->containers_num == 0) || (cfg->objects_num == 0)
+        || (cfg->containers_num * cfg->objects_num > PERF_MAX_OBJECTS))
+    {
+        return -5;
+    }
+
+    if (os_parse_para(argc, argv, "-ops", tmp, sizeof(tmp)) == 0)
+    {
+        cfg->ops_num = OS_STR2ULL(tmp, NULL, 0);
+    }
+
+    if (os_parse_para(argc, argv, "-wu", tmp, sizeof(tmp)) == 0)
+    {
+        cfg->warmup_ops = OS_STR2ULL(tmp, NULL, 0);
+    }
+
+    if (os_parse_para(argc, argv, "-nl", NULL, 0) == 0)
+    {
+        cfg->load = FALSE;
+    }
+
+    if (os_parse_para(argc, argv, "-dur", tmp, sizeof(tmp)) == 0)
+    {
+        for (i = 0; i < OFS_DURABILITY_BUTT; i++)
+        {
+            if (strcmp(tmp, g_dur_name[i]) == 0)
+            {
+                break;
+            }
+        }
+
+        if (i == OFS_DURABILITY_BUTT)
+        {
+            return -7;
+        }
+
+        cfg->durability = i;
+    }
+
+    if (os_parse_para(argc, argv, "-json", cfg->json_file, PERF_PATH_SIZE) != 0)
+    {
+        cfg->json_file[0] = 0;
+    }
+
+    // the ops of every thread
+    cfg->ops_num /= cfg->threads_num;
+    cfg->warmup_ops /= cfg->threads_num;
+
+    // nothing to load, only the insert-only run can start from empty objects
+    if ((cfg->records_num == 0)
+        && ((cfg->ops_num == 0) || (cfg->workload.mix[PERF_OP_INSERT] != 100)))
+    {
+        return -6;
+    }
 
     return 0;
 }
@@ -210,12 +1133,16 @@ int32_t test_performance(ifs_tools_para_t *para, bool_t insert)
 int do_performance_cmd(int argc, char *argv[], net_para_t *net)
 {
     ifs_tools_para_t *para = NULL;
+    perf_config_t *cfg = NULL;
 
     para = OS_MALLOC(sizeof(ifs_tools_para_t));
-    if (para == NULL)
+    cfg = OS_MALLOC(sizeof(perf_config_t));
+    if ((para == NULL) || (cfg == NULL))
     {
         OS_PRINT(net, "Allocate memory failed. size(%d)\n",
-            sizeof(ifs_tools_para_t));
+            (uint32_t)(sizeof(ifs_tools_para_t) + sizeof(perf_config_t)));
+        OS_FREE(para);
+        OS_FREE(cfg);
         return -1;
     }
 
@@ -225,23 +1152,23 @@ int do_performance_cmd(int argc, char *argv[], net_para_t *net)
     if ((strlen(para->ct_name) == 0) || OBJID_IS_INVALID(para->objid))
     {
         OS_PRINT(net, "invalid ct name(%s) or objid(%lld).\n", para->ct_name, para->objid);
+        OS_FREE(cfg);
         OS_FREE(para);
         return -2;
     }
-    
-    if (para->threads_num == 0)
+
+    if (parse_perf_para(argc, argv, para, cfg) < 0)
     {
-        para->threads_num = 1;
+        OS_PRINT(net, "invalid workload parameter.\n");
+        OS_FREE(cfg);
+        OS_FREE(para);
+        return -3;
     }
 
-    (void)test_performance(para, TRUE);
-    (void)test_performance(para, FALSE);
+    (void)test_performance(cfg, net);
 
+    OS_FREE(cfg);
     OS_FREE(para);
 
     return 0;
 }
-
-
-
-
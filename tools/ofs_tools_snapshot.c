@@ -0,0 +1,115 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_TOOLS_SNAPSHOT.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+MODULE(PID_TOOLS);
+#include "log.h"
+
+static int32_t print_snapshot(void *para, const ofs_snapshot_record_t *snap)
+{
+    OS_PRINT((net_para_t *)para, "%-16llu %-16llu %-16llu\n", (unsigned long long)snap->snapshot_no,
+        (unsigned long long)snap->objid_inode_no, (unsigned long long)snap->log_lsn);
+
+    return 0;
+}
+
+int do_snapshot_cmd(int argc, char *argv[], net_para_t *net)
+{
+    ifs_tools_para_t *para = NULL;
+    container_handle_t *ct = NULL;
+    uint64_t snapshot_no = 0;
+    int32_t ret = 0;
+
+    para = OS_MALLOC(sizeof(ifs_tools_para_t));
+    if (para == NULL)
+    {
+        OS_PRINT(net, "Allocate memory failed.\n");
+        return -1;
+    }
+
+    parse_all_para(argc, argv, para);
+    para->net = net;
+
+    if (strlen(para->ct_name) == 0)
+    {
+        OS_PRINT(net, "ct name not specified.\n");
+        OS_FREE(para);
+        return -2;
+    }
+
+    ret = ofs_open_container(para->ct_name, &ct);
+    if (ret < 0)
+    {
+        OS_PRINT(net, "Open ct failed. ct(%s) ret(%d)\n", para->ct_name, ret);
+        OS_FREE(para);
+        return ret;
+    }
+
+    if (os_parse_para(argc, argv, "-c", NULL, 0) == 0)
+    {
+        ret = ofs_create_snapshot(ct, &snapshot_no);
+        if (ret < 0)
+        {
+            OS_PRINT(net, "Create snapshot failed. ct(%s) ret(%d)\n", para->ct_name, ret);
+        }
+        else
+        {
+            OS_PRINT(net, "Create snapshot success. ct(%s) snapshot_no(%llu)\n",
+                para->ct_name, (unsigned long long)snapshot_no);
+        }
+    }
+    else if (os_parse_para(argc, argv, "-d", para->tmp, TMP_BUF_SIZE) == 0)
+    {
+        snapshot_no = OS_STR2ULL(para->tmp, NULL, 0);
+        ret = ofs_delete_snapshot(ct, snapshot_no);
+        if (ret < 0)
+        {
+            OS_PRINT(net, "Delete snapshot failed. ct(%s) snapshot_no(%llu) ret(%d)\n",
+                para->ct_name, (unsigned long long)snapshot_no, ret);
+        }
+    }
+    else
+    {
+        OS_PRINT(net, "%-16s %-16s %-16s\n", "snapshot_no", "objid_inode_no", "log_lsn");
+        (void)ofs_walk_snapshots(ct, print_snapshot, net);
+    }
+
+    (void)ofs_close_container(ct);
+    OS_FREE(para);
+
+    return 0;
+}
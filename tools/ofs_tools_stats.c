@@ -0,0 +1,335 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*******************************************************************************
+
+            Copyright(C), 2016~2019, axen.hook@foxmail.com
+********************************************************************************
+File Name: OFS_TOOLS_STATS.C
+Author   : axen.hook
+Version  : 1.00
+Date     : 02/Mar/2016
+Description: 
+Function List: 
+    1. ...: 
+History: 
+    Version: 1.00  Author: axen.hook  Date: 02/Mar/2016
+--------------------------------------------------------------------------------
+    1. Primary version
+*******************************************************************************/
+#include "ofs_if.h"
+
+#define NS_TO_US(ns)   ((double)(ns) / 1000)
+#define NS_TO_SEC(ns)  ((double)(ns) / 1000000000)
+
+typedef struct stats_walk_para
+{
+    net_para_t *net;
+    uint32_t id;                // the counter printed in prometheus format
+    container_handle_t *ct;
+} stats_walk_para_t;
+
+static histogram_t *get_one_stat(net_para_t *net, uint32_t id)
+{
+    histogram_t *hist = NULL;
+
+    hist = (histogram_t *)OS_MALLOC(sizeof(histogram_t));
+    if (!hist)
+    {
+        OS_PRINT(net, "Allocate memory failed. size(%d)\n", (uint32_t)sizeof(histogram_t));
+        return NULL;
+    }
+
+    ofs_stat_get(id, hist);
+
+    return hist;
+}
+
+static void print_one_stat(net_para_t *net, uint32_t id)
+{
+    histogram_t *hist = get_one_stat(net, id);
+
+    if (!hist)
+    {
+        return;
+    }
+
+    OS_PRINT(net, "%-16s %12llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", ofs_stat_name(id),
+        (unsigned long long)hist->total, NS_TO_US(hist_mean(hist)),
+        NS_TO_US(hist_percentile(hist, 500)), NS_TO_US(hist_percentile(hist, 990)),
+        NS_TO_US(hist_percentile(hist, 999)), NS_TO_US(hist->max));
+
+    OS_FREE(hist);
+}
+
+static int32_t print_obj_counters(stats_walk_para_t *para, object_info_t *obj_info)
+{
+    char line[256];
+    int32_t len = 0;
+    uint32_t id = 0;
+
+    len = snprintf(line, sizeof(line), "%-12llu", (unsigned long long)obj_info->objid);
+    for (id = 0; (id < OFS_CNT_OBJ_NUM) && (len < (int32_t)sizeof(line)); id++)
+    {
+        len += snprintf(line + len, sizeof(line) - len, " %14llu",
+            (unsigned long long)ofs_counter_get(&obj_info->counters, id));
+    }
+
+    OS_PRINT(para->net, "%s\n", line);
+
+    return 0;
+}
+
+static int32_t print_ct_counters(stats_walk_para_t *para, container_handle_t *ct)
+{
+    uint32_t id = 0;
+
+    OS_PRINT(para->net, "\nCounters of ct(%s):\n", ct->name);
+    OS_PRINT(para->net, "-----------------------------------------\n");
+    for (id = 0; id < OFS_CNT_NUM; id++)
+    {
+        OS_PRINT(para->net, "%-18s: %llu\n", ofs_counter_name(id),
+            (unsigned long long)ofs_counter_get(&ct->counters, id));
+    }
+
+    OS_PRINT(para->net, "\n%-12s", "objid");
+    for (id = 0; id < OFS_CNT_OBJ_NUM; id++)
+    {
+        OS_PRINT(para->net, " %14s", ofs_counter_name(id));
+    }
+    OS_PRINT(para->net, "\n");
+
+    OS_RWLOCK_RDLOCK(&ct->ct_lock);
+    avl_walk_all(&ct->obj_info_list, (avl_walk_cb_t)print_obj_counters, para);
+    OS_RWLOCK_RDUNLOCK(&ct->ct_lock);
+
+    return 0;
+}
+
+static void print_text(net_para_t *net)
+{
+    stats_walk_para_t para;
+    uint32_t id = 0;
+
+    OS_PRINT(net, "%-16s %12s %10s %10s %10s %10s %10s\n", "latency(us)",
+        "count", "mean", "p50", "p99", "p999", "max");
+    OS_PRINT(net, "-----------------------------------------------------------------------------------\n");
+
+    for (id = 0; id < OFS_STAT_NUM; id++)
+    {
+        print_one_stat(net, id);
+    }
+
+    memset(&para, 0, sizeof(para));
+    para.net = net;
+    (void)ofs_walk_all_opened_container((container_cb_t)print_ct_counters, &para);
+}
+
+static void print_prom_latency(net_para_t *net)
+{
+    static const uint32_t permilles[] = {500, 990, 999};
+    histogram_t *hist = NULL;
+    uint32_t id = 0;
+    uint32_t i = 0;
+
+    OS_PRINT(net, "# HELP ofs_latency_seconds The latency of the APIs and the I/Os.\n");
+    OS_PRINT(net, "# TYPE ofs_latency_seconds summary\n");
+
+    for (id = 0; id < OFS_STAT_NUM; id++)
+    {
+        hist = get_one_stat(net, id);
+        if (!hist)
+        {
+            return;
+        }
+
+        for (i = 0; i < sizeof(permilles) / sizeof(permilles[0]); i++)
+        {
+            OS_PRINT(net, "ofs_latency_seconds{op=\"%s\",quantile=\"%g\"} %.9f\n", ofs_stat_name(id),
+                (double)permilles[i] / 1000, NS_TO_SEC(hist_percentile(hist, permilles[i])));
+        }
+
+        OS_PRINT(net, "ofs_latency_seconds_sum{op=\"%s\"} %.9f\n", ofs_stat_name(id), NS_TO_SEC(hist->sum));
+        OS_PRINT(net, "ofs_latency_seconds_count{op=\"%s\"} %llu\n", ofs_stat_name(id),
+            (unsigned long long)hist->total);
+
+        OS_FREE(hist);
+    }
+}
+
+static int32_t print_prom_obj_counter(stats_walk_para_t *para, object_info_t *obj_info)
+{
+    OS_PRINT(para->net, "ofs_object_%s_total{container=\"%s\",objid=\"%llu\"} %llu\n",
+        ofs_counter_name(para->id), para->ct->name, (unsigned long long)obj_info->objid,
+        (unsigned long long)ofs_counter_get(&obj_info->counters, para->id));
+
+    return 0;
+}
+
+static int32_t print_prom_ct_counter(stats_walk_para_t *para, container_handle_t *ct)
+{
+    OS_PRINT(para->net, "ofs_container_%s_total{container=\"%s\"} %llu\n",
+        ofs_counter_name(para->id), ct->name,
+        (unsigned long long)ofs_counter_get(&ct->counters, para->id));
+
+    return 0;
+}
+
+static int32_t print_prom_obj_counters(stats_walk_para_t *para, container_handle_t *ct)
+{
+    para->ct = ct;
+
+    OS_RWLOCK_RDLOCK(&ct->ct_lock);
+    avl_walk_all(&ct->obj_info_list, (avl_walk_cb_t)print_prom_obj_counter, para);
+    OS_RWLOCK_RDUNLOCK(&ct->ct_lock);
+
+    return 0;
+}
+
+// the samples of one metric must be together, so walk the containers for every counter
+static void print_prom(net_para_t *net)
+{
+    stats_walk_para_t para;
+
+    print_prom_latency(net);
+
+    memset(&para, 0, sizeof(para));
+    para.net = net;
+
+    for (para.id = 0; para.id < OFS_CNT_NUM; para.id++)
+    {
+        OS_PRINT(net, "# TYPE ofs_container_%s_total counter\n", ofs_counter_name(para.id));
+        (void)ofs_walk_all_opened_container((container_cb_t)print_prom_ct_counter, &para);
+    }
+
+    for (para.id = 0; para.id < OFS_CNT_OBJ_NUM; para.id++)
+    {
+        OS_PRINT(net, "# TYPE ofs_object_%s_total counter\n", ofs_counter_name(para.id));
+        (void)ofs_walk_all_opened_container((container_cb_t)print_prom_obj_counters, &para);
+    }
+}
+
+int do_stats_cmd(int argc, char *argv[], net_para_t *net)
+{
+    if (os_parse_para(argc, argv, "-prom", NULL, 0) == 0)
+    {
+        print_prom(net);
+    }
+    else
+    {
+        print_text(net);
+    }
+
+    if (os_parse_para(argc, argv, "-reset", NULL, 0) == 0)
+    {
+        ofs_stat_reset();
+        OS_PRINT(net, "The latency statistics are reset.\n");
+    }
+
+    return 0;
+}
+
+#ifdef OS_LOCK_PROFILE
+
+static int compare_lock_site(const void *a, const void *b)
+{
+    const os_lock_site_t *site_a = *(const os_lock_site_t **)a;
+    const os_lock_site_t *site_b = *(const os_lock_site_t **)b;
+
+    if (site_a->wait_ns != site_b->wait_ns)
+    {
+        return (site_a->wait_ns < site_b->wait_ns) ? 1 : -1;
+    }
+
+    return (site_a->hold_ns < site_b->hold_ns) ? 1 : ((site_a->hold_ns > site_b->hold_ns) ? -1 : 0);
+}
+
+// the sites waited most are printed first
+int do_lockstat_cmd(int argc, char *argv[], net_para_t *net)
+{
+    os_lock_site_t **sites = NULL;
+    os_lock_site_t *site = NULL;
+    const char *file = NULL;
+    uint32_t num = 0;
+    uint32_t i = 0;
+
+    for (site = os_lock_prof_sites(); site != NULL; site = site->next)
+    {
+        num++;
+    }
+
+    if (num != 0)
+    {
+        sites = (os_lock_site_t **)OS_MALLOC(sizeof(os_lock_site_t *) * num);
+        if (!sites)
+        {
+            OS_PRINT(net, "Allocate memory failed. size(%d)\n", (uint32_t)(sizeof(os_lock_site_t *) * num));
+            return -1;
+        }
+
+        // the sites registered after the count are not printed
+        for (site = os_lock_prof_sites(), i = 0; (site != NULL) && (i < num); site = site->next, i++)
+        {
+            sites[i] = site;
+        }
+
+        qsort(sites, num, sizeof(os_lock_site_t *), compare_lock_site);
+    }
+
+    OS_PRINT(net, "%-32s %-2s %12s %12s %12s %12s %12s %12s\n", "lock site", "rw",
+        "acquired", "contended", "wait(us)", "max_wait", "hold(us)", "max_hold");
+    OS_PRINT(net, "---------------------------------------------------------------------------------------------------------------\n");
+
+    for (i = 0; i < num; i++)
+    {
+        site = sites[i];
+        file = strrchr(site->file, '/');
+        file = file ? (file + 1) : site->file;
+
+        OS_PRINT(net, "%24s:%-7u %-2s %12llu %12llu %12.1f %12.1f %12.1f %12.1f\n", file, site->line,
+            site->write ? "w" : "r", (unsigned long long)site->acquired,
+            (unsigned long long)site->contended, NS_TO_US(site->wait_ns), NS_TO_US(site->max_wait_ns),
+            NS_TO_US(site->hold_ns), NS_TO_US(site->max_hold_ns));
+    }
+
+    if (sites)
+    {
+        OS_FREE(sites);
+    }
+
+    if (os_parse_para(argc, argv, "-reset", NULL, 0) == 0)
+    {
+        os_lock_prof_reset();
+        OS_PRINT(net, "The lock statistics are reset.\n");
+    }
+
+    return 0;
+}
+
+#else
+
+int do_lockstat_cmd(int argc, char *argv[], net_para_t *net)
+{
+    OS_PRINT(net, "The lock profiling is not compiled in, build with LOCK_PROFILE=1.\n");
+
+    return 0;
+}
+
+#endif
@@ -39,7 +39,6 @@ History:
 static int32_t cmd_insert_key(ifs_tools_para_t *para)
 {
     int32_t ret = 0;
-    container_handle_t *ct = NULL;
     object_handle_t *obj = NULL;
 
     ASSERT(para);
@@ -59,19 +58,9 @@ static int32_t cmd_insert_key(ifs_tools_para_t *para)
         return -1;
     }
 
-    ret = ofs_open_container(para->ct_name, &ct);
+    ret = tools_open_object(para, &obj);
     if (ret < 0)
     {
-        OS_PRINT(para->net, "Open ct failed. ct(%s) ret(%d)\n", para->ct_name, ret);
-        return ret;
-    }
-
-    ret = ofs_open_object(ct, para->objid, &obj);
-    if (ret < 0)
-    {
-        OS_PRINT(para->net, "Create obj failed. objid(%lld) ret(%d)\n",
-            para->objid, ret);
-        (void)ofs_close_container(ct);
         return ret;
     }
 
@@ -83,8 +72,7 @@ static int32_t cmd_insert_key(ifs_tools_para_t *para)
             para->key, para->value, ret);
     }
 
-    (void)ofs_close_object(obj);
-    (void)ofs_close_container(ct);
+    tools_close_object(para, obj);
     
     return ret;
 }
@@ -92,7 +80,6 @@ static int32_t cmd_insert_key(ifs_tools_para_t *para)
 static int32_t cmd_remove_key(ifs_tools_para_t *para)
 {
     int32_t ret = 0;
-    container_handle_t *ct = NULL;
     object_handle_t *obj = NULL;
 
     ASSERT(para);
@@ -110,19 +97,9 @@ static int32_t cmd_remove_key(ifs_tools_para_t *para)
         return -1;
     }
 
-    ret = ofs_open_container(para->ct_name, &ct);
-    if (ret < 0)
-    {
-        OS_PRINT(para->net, "Open ct failed. ct(%s) ret(%d)\n", para->ct_name, ret);
-        return ret;
-    }
-
-    ret = ofs_open_object(ct, para->objid, &obj);
+    ret = tools_open_object(para, &obj);
     if (ret < 0)
     {
-        OS_PRINT(para->net, "Open tree failed. objid(%lld) ret(%d)\n",
-            para->objid, ret);
-        (void)ofs_close_container(ct);
         return ret;
     }
 
@@ -133,8 +110,7 @@ static int32_t cmd_remove_key(ifs_tools_para_t *para)
             para->key, ret);
     }
 
-    (void)ofs_close_object(obj);
-    (void)ofs_close_container(ct);
+    tools_close_object(para, obj);
     
     return ret;
 }
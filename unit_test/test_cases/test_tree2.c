@@ -252,6 +252,2059 @@ void test_kv_4(void)
     CU_ASSERT(ofs_close_container(ct) == 0);
 }
 
+void test_kv_5(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     20000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t key;
+    uint64_t i;
+    uint64_t free_blocks;
+    uint64_t used_blocks;
+    uint64_t data_blocks;
+    
+    CU_ASSERT(ofs_create_container("kv5", 100000, &ct) == 0);
+
+    // insert in ascending order, the leaves should be nearly full
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_ANSI_STRING << 4), &obj) == 0);
+    free_blocks = ct->sm.total_free_blocks;
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V1, strlen(TEST_V1)) == 0);
+    }
+
+    used_blocks = free_blocks - ct->sm.total_free_blocks;
+    data_blocks = TEST_KEY_NUM * (sizeof(index_entry_t) + U64_MAX_SIZE + strlen(TEST_V1)) / ct->sb.block_size;
+    CU_ASSERT(used_blocks * 80 <= data_blocks * 100);
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, U64_MAX_SIZE) == 0);
+    }
+
+    key = TEST_KEY_NUM - 1;
+    CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V1, strlen(TEST_V1)) == -INDEX_ERR_KEY_EXIST);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+
+    // insert the even keys, then the odd keys between them
+    CU_ASSERT(ofs_create_object(ct, 501, FLAG_TABLE | CR_U64 | (CR_ANSI_STRING << 4), &obj) == 0);
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key += 2)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V2, strlen(TEST_V2)) == 0);
+    }
+
+    for (i = 0, key = 1; i < TEST_KEY_NUM; i++, key += 2)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V2, strlen(TEST_V2)) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM * 2);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    // check the keys after reopen
+    CU_ASSERT(ofs_open_container("kv5", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 501, &obj) == 0);
+
+    for (i = 0, key = TEST_KEY_NUM * 2; i < TEST_KEY_NUM * 2; i++)
+    {
+        key--;
+        CU_ASSERT(index_search_key(obj, &key, U64_MAX_SIZE) == 0);
+        CU_ASSERT(index_remove_key(obj, &key, U64_MAX_SIZE) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+void test_kv_6(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     20000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t key;
+    uint64_t i;
+    uint64_t free_blocks;
+    uint64_t used_blocks;
+    
+    CU_ASSERT(ofs_create_container("kv6", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_ANSI_STRING << 4), &obj) == 0);
+    free_blocks = ct->sm.total_free_blocks;
+
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key = (i * 7919) % TEST_KEY_NUM;
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V1, strlen(TEST_V1)) == 0);
+    }
+
+    used_blocks = free_blocks - ct->sm.total_free_blocks;
+
+    // remove 9/10 keys, the blocks should be merged
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        if (key % 10)
+        {
+            CU_ASSERT(index_remove_key(obj, &key, U64_MAX_SIZE) == 0);
+        }
+    }
+
+    CU_ASSERT((free_blocks - ct->sm.total_free_blocks) * 100 <= used_blocks * 30);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM / 10);
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, U64_MAX_SIZE) == ((key % 10) ? -INDEX_ERR_KEY_NOT_FOUND : 0));
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    // remove the left keys after reopen, the root should hold all
+    CU_ASSERT(ofs_open_container("kv6", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 500, &obj) == 0);
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i += 10, key += 10)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, U64_MAX_SIZE) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == 0);
+
+    // the committed blocks are released by the next checkpoint
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(free_blocks == ct->sm.total_free_blocks);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+typedef struct walk_order_para
+{
+    uint64_t cnt;
+    uint64_t last_key;
+    bool_t reverse;
+    bool_t ordered;
+} walk_order_para_t;
+
+static int32_t walk_order_cb(object_handle_t *obj, walk_order_para_t *para)
+{
+    uint64_t key = os_bstr_to_u64(GET_IE_KEY(obj->ie), obj->ie->key_len);
+
+    if (para->cnt && ((para->reverse) ? (key >= para->last_key) : (key <= para->last_key)))
+    {
+        para->ordered = FALSE;
+    }
+
+    if (obj->ie->flags & INDEX_ENTRY_NODE)
+    { // b+ tree only returns the leaf entries
+        para->ordered = FALSE;
+    }
+
+    para->last_key = key;
+    para->cnt++;
+
+    return 0;
+}
+
+void test_kv_7(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     20000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t key;
+    uint64_t i;
+    uint64_t free_blocks;
+    walk_order_para_t para;
+    
+    CU_ASSERT(ofs_create_container("kv7", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | FLAG_BPLUS_TREE | CR_U64 | (CR_ANSI_STRING << 4), &obj) == 0);
+    free_blocks = ct->sm.total_free_blocks;
+
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key = (i * 7919) % TEST_KEY_NUM;
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V1, strlen(TEST_V1)) == 0);
+    }
+
+    // the separator keys in the node blocks are not user keys
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, U64_MAX_SIZE) == 0);
+        CU_ASSERT(index_insert_key(obj, &key, U64_MAX_SIZE, TEST_V2, strlen(TEST_V2)) == -INDEX_ERR_KEY_EXIST);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM);
+
+    memset(&para, 0, sizeof(para));
+    para.ordered = TRUE;
+    CU_ASSERT(index_walk_all(obj, FALSE, 0, &para, (tree_walk_cb_t)walk_order_cb) == 0);
+    CU_ASSERT(para.cnt == TEST_KEY_NUM);
+    CU_ASSERT(para.ordered == TRUE);
+
+    memset(&para, 0, sizeof(para));
+    para.ordered = TRUE;
+    para.reverse = TRUE;
+    CU_ASSERT(index_walk_all(obj, TRUE, 0, &para, (tree_walk_cb_t)walk_order_cb) == 0);
+    CU_ASSERT(para.cnt == TEST_KEY_NUM);
+    CU_ASSERT(para.ordered == TRUE);
+
+    // remove 9/10 keys, the separators should be removed with the leaves
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        if (key % 10)
+        {
+            CU_ASSERT(index_remove_key(obj, &key, U64_MAX_SIZE) == 0);
+        }
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM / 10);
+
+    for (i = 0, key = 0; i < TEST_KEY_NUM; i++, key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, U64_MAX_SIZE) == ((key % 10) ? -INDEX_ERR_KEY_NOT_FOUND : 0));
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    // remove the left keys after reopen
+    CU_ASSERT(ofs_open_container("kv7", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 500, &obj) == 0);
+
+    memset(&para, 0, sizeof(para));
+    para.ordered = TRUE;
+    CU_ASSERT(index_walk_all(obj, FALSE, 0, &para, (tree_walk_cb_t)walk_order_cb) == 0);
+    CU_ASSERT(para.cnt == TEST_KEY_NUM / 10);
+    CU_ASSERT(para.ordered == TRUE);
+
+    for (i = 0, key = TEST_KEY_NUM; i < TEST_KEY_NUM; i += 10)
+    {
+        key -= 10;
+        CU_ASSERT(index_remove_key(obj, &key, U64_MAX_SIZE) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == 0);
+
+    // the committed blocks are released by the next checkpoint
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(free_blocks == ct->sm.total_free_blocks);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static int32_t walk_leaf_cb(object_handle_t *obj, walk_order_para_t *para)
+{
+    if (obj->ie->flags & INDEX_ENTRY_NODE)
+    {
+        para->ordered = FALSE;
+    }
+
+    para->cnt++;
+
+    return 0;
+}
+
+void test_kv_8(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     20000
+#define TEST_KEY_PAD     200
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    char key[32 + TEST_KEY_PAD];
+    uint16_t key_len;
+    uint64_t i;
+    uint64_t free_blocks;
+    walk_order_para_t para;
+    
+    CU_ASSERT(ofs_create_container("kv8", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | FLAG_BPLUS_TREE | CR_ANSI_STRING | (CR_ANSI_STRING << 4), &obj) == 0);
+    free_blocks = ct->sm.total_free_blocks;
+
+    // long keys with the same tail, the separators only need the head
+    memset(key, 'x', sizeof(key));
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key_len = (uint16_t)sprintf(key, "%08lld", (i * 7919) % TEST_KEY_NUM);
+        key[key_len] = 'x';
+        CU_ASSERT(index_insert_key(obj, key, key_len + TEST_KEY_PAD, TEST_V1, strlen(TEST_V1)) == 0);
+    }
+
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key_len = (uint16_t)sprintf(key, "%08lld", i);
+        key[key_len] = 'x';
+        CU_ASSERT(index_search_key(obj, key, key_len + TEST_KEY_PAD) == 0);
+        CU_ASSERT(obj->depth <= 2);
+        CU_ASSERT(index_search_key(obj, key, key_len) == -INDEX_ERR_KEY_NOT_FOUND);
+    }
+
+    memset(&para, 0, sizeof(para));
+    para.ordered = TRUE;
+    CU_ASSERT(index_walk_all(obj, FALSE, 0, &para, (tree_walk_cb_t)walk_leaf_cb) == 0);
+    CU_ASSERT(para.cnt == TEST_KEY_NUM);
+    CU_ASSERT(para.ordered == TRUE);
+
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key_len = (uint16_t)sprintf(key, "%08lld", i);
+        key[key_len] = 'x';
+        CU_ASSERT(index_remove_key(obj, key, key_len + TEST_KEY_PAD) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == 0);
+    CU_ASSERT(free_blocks == ct->sm.total_free_blocks);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+// the latency histograms count every call
+void test_kv_9(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     1000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    histogram_t hist;
+    uint64_t key;
+    
+    CU_ASSERT(ofs_create_container("kv9", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+
+    ofs_stat_reset();
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    ofs_stat_get(OFS_STAT_INSERT_KEY, &hist);
+    CU_ASSERT(hist.total == TEST_KEY_NUM);
+    CU_ASSERT(hist.min <= hist_percentile(&hist, 500));
+    CU_ASSERT(hist_percentile(&hist, 500) <= hist_percentile(&hist, 999));
+    CU_ASSERT(hist_percentile(&hist, 999) <= hist.max);
+    ofs_stat_get(OFS_STAT_SEARCH_KEY, &hist);
+    CU_ASSERT(hist.total == TEST_KEY_NUM);
+    ofs_stat_get(OFS_STAT_ALLOC_SPACE, &hist);
+    CU_ASSERT(hist.total != 0);
+
+    ofs_stat_reset();
+    ofs_stat_get(OFS_STAT_INSERT_KEY, &hist);
+    CU_ASSERT(hist.total == 0);
+
+    // the histograms are cleaned on the next record after reset
+    key = TEST_KEY_NUM;
+    CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    ofs_stat_get(OFS_STAT_INSERT_KEY, &hist);
+    CU_ASSERT(hist.total == 1);
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+    ofs_stat_get(OFS_STAT_FLUSH_CACHE, &hist);
+    CU_ASSERT(hist.total != 0);
+}
+
+// the counters of the object are also counted on the container
+void test_kv_10(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     5000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t key;
+    uint32_t id;
+    uint64_t checkpoints;
+    
+    CU_ASSERT(ofs_create_container("kv10", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    checkpoints = ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT);
+
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_counter_get(&obj->obj_info->counters, OFS_CNT_SPLIT_IB) != 0);
+    CU_ASSERT(ofs_counter_get(&obj->obj_info->counters, OFS_CNT_REPARENT_ROOT) != 0);
+    CU_ASSERT(ofs_counter_get(&obj->obj_info->counters, OFS_CNT_CACHE_HIT) >= TEST_KEY_NUM);
+    for (id = 0; id < OFS_CNT_OBJ_NUM; id++)
+    {
+        CU_ASSERT(ofs_counter_get(&ct->counters, id) >= ofs_counter_get(&obj->obj_info->counters, id));
+    }
+
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_ALLOC_BLOCKS) != 0);
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT) == checkpoints + 1);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_BLOCK_WRITE) != 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_BLOCK_WRITE_BYTES)
+        >= ofs_counter_get(&ct->counters, OFS_CNT_BLOCK_WRITE) * BYTES_PER_SECTOR);
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static void copy_file(const char *src, const char *dst)
+{
+    char buf[4096];
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    size_t len = 0;
+
+    CU_ASSERT_FATAL((in != NULL) && (out != NULL));
+    while ((len = fread(buf, 1, sizeof(buf), in)) != 0)
+    {
+        CU_ASSERT(fwrite(buf, 1, len, out) == len);
+    }
+
+    fclose(in);
+    fclose(out);
+}
+
+static void check_kv_11_value(object_handle_t *obj, uint64_t key, uint64_t value)
+{
+    uint64_t found = 0;
+
+    CU_ASSERT_FATAL(index_search_key_nolock(obj, &key, sizeof(key), NULL, 0) == 0);
+    CU_ASSERT(obj->ie->value_len == sizeof(found));
+    memcpy(&found, GET_IE_VALUE(obj->ie), sizeof(found));
+    CU_ASSERT(found == value);
+}
+
+// the modifications synced to the redo log survive a crash after the checkpoint
+void test_kv_11(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     4000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    object_handle_t *obj2;
+    uint64_t key;
+    uint64_t value;
+    FILE *f;
+    
+    CU_ASSERT(ofs_create_container("kv11", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    for (key = 0; key < TEST_KEY_NUM / 2; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->sb.log_lsn == ofs_log_last_lsn(ct));
+
+    // after the checkpoint
+    for (key = TEST_KEY_NUM / 2; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    for (key = 0; key < TEST_KEY_NUM / 4; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    for (key = TEST_KEY_NUM / 4; key < TEST_KEY_NUM / 2; key++)
+    {
+        value = key + TEST_KEY_NUM;
+        CU_ASSERT(index_update_value(obj, &key, sizeof(key), &value, sizeof(value)) == 0);
+    }
+
+    CU_ASSERT(ofs_create_object(ct, 501, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj2) == 0);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj2, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_sync_container(ct) == 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC) != 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_APPEND) >= TEST_KEY_NUM * 2);
+
+    // crash: take the files as they are now, with a torn record at the end
+    copy_file("kv11", "kv11c");
+    copy_file("kv11" OFS_LOG_SUFFIX, "kv11c" OFS_LOG_SUFFIX);
+    f = fopen("kv11c" OFS_LOG_SUFFIX, "ab");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT(fwrite(TEST_V1, 1, sizeof(ofs_log_record_t) / 2, f) == sizeof(ofs_log_record_t) / 2);
+    fclose(f);
+
+    CU_ASSERT(ofs_close_object(obj2) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv11c", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 500, &obj) == 0);
+    CU_ASSERT(ofs_open_object(ct, 501, &obj2) == 0);
+    for (key = 0; key < TEST_KEY_NUM / 4; key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+    }
+
+    for (key = TEST_KEY_NUM / 4; key < TEST_KEY_NUM / 2; key++)
+    {
+        check_kv_11_value(obj, key, key + TEST_KEY_NUM);
+    }
+
+    for (key = TEST_KEY_NUM / 2; key < TEST_KEY_NUM; key++)
+    {
+        check_kv_11_value(obj, key, key);
+        check_kv_11_value(obj2, key, key);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM * 3 / 4);
+    CU_ASSERT(index_get_total_key(obj2) == TEST_KEY_NUM);
+
+    // the replayed modifications are checkpointed, and the log is dropped
+    CU_ASSERT(ct->sb.log_lsn == ofs_log_last_lsn(ct));
+    f = fopen("kv11c" OFS_LOG_SUFFIX, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT(fseek(f, 0, SEEK_END) == 0);
+    CU_ASSERT(ftell(f) == 0);
+    fclose(f);
+
+    CU_ASSERT(ofs_close_object(obj2) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+void test_kv_12(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     100
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t key;
+    uint64_t syncs;
+    
+    CU_ASSERT(ofs_create_container("kv12", 100000, &ct) == 0);
+    CU_ASSERT(ct->durability == OFS_DURABILITY_CHECKPOINT);
+    CU_ASSERT(ofs_set_durability(ct, OFS_DURABILITY_BUTT) == -INDEX_ERR_PARAMETER);
+    CU_ASSERT(ofs_set_durability(NULL, OFS_DURABILITY_NONE) == -INDEX_ERR_PARAMETER);
+    CU_ASSERT(ct->durability == OFS_DURABILITY_CHECKPOINT);
+
+    // the modifications wait for the log only in commit mode
+    CU_ASSERT(ofs_create_object(ct, 500, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    syncs = ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC) == syncs);
+
+    CU_ASSERT(ofs_set_durability(ct, OFS_DURABILITY_COMMIT) == 0);
+    for (key = TEST_KEY_NUM; key < TEST_KEY_NUM * 2; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+        CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC) == ++syncs);
+    }
+
+    // the record synced by the previous commit does not need another sync
+    CU_ASSERT(ofs_log_commit(ct) == 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC) == syncs);
+
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+        CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_LOG_SYNC) == ++syncs);
+    }
+
+    CU_ASSERT(ofs_set_durability(ct, OFS_DURABILITY_NONE) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv12", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 500, &obj) == 0);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static int32_t count_snapshot(void *para, const ofs_snapshot_record_t *snap)
+{
+    (*(uint32_t *)para)++;
+    return 0;
+}
+
+static uint32_t get_snapshot_cnt(container_handle_t *ct)
+{
+    uint32_t cnt = 0;
+
+    CU_ASSERT(ofs_walk_snapshots(ct, count_snapshot, &cnt) == 0);
+
+    return cnt;
+}
+
+static void check_values(container_handle_t *ct, uint64_t start, uint64_t end, uint64_t delta)
+{
+    object_handle_t *obj;
+    uint64_t key;
+    uint64_t value;
+
+    CU_ASSERT(ofs_open_object(ct, 600, &obj) == 0);
+    CU_ASSERT(index_get_total_key(obj) == (int64_t)(end - start));
+    for (key = start; key < end; key++)
+    {
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == 0);
+        memcpy(&value, GET_IE_VALUE(obj->ie), sizeof(value));
+        CU_ASSERT(value == key + delta);
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+}
+
+void test_kv_13(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     3000
+
+    container_handle_t *ct;
+    container_handle_t *snap_ct;
+    object_handle_t *obj;
+    ofs_snapshot_record_t snap;
+    uint64_t snap1;
+    uint64_t snap2;
+    uint64_t free_blocks;
+    uint64_t key;
+    uint64_t value;
+    
+    CU_ASSERT(ofs_create_container("kv13", 100000, &ct) == 0);
+    CU_ASSERT(get_snapshot_cnt(ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 600, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_create_snapshot(ct, &snap1) == 0);
+    free_blocks = ct->sm.total_free_blocks;
+
+    // the blocks of the snapshot are kept when they are modified
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        value = key + 1;
+        CU_ASSERT(index_update_value(obj, &key, sizeof(key), &value, sizeof(value)) == 0);
+    }
+
+    for (key = 0; key < TEST_KEY_NUM / 2; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_DEFER_FREE) > 0);
+    CU_ASSERT(ct->sm.total_free_blocks < free_blocks);
+
+    CU_ASSERT(ofs_open_snapshot(ct, snap1, &snap_ct) == 0);
+    CU_ASSERT(snap_ct->flags & FLAG_READONLY);
+    check_values(snap_ct, 0, TEST_KEY_NUM, 0);
+    check_values(ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_create_object(snap_ct, 601, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == -INDEX_ERR_READ_ONLY);
+    CU_ASSERT(ofs_open_object(snap_ct, 600, &obj) == 0);
+    CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == -INDEX_ERR_READ_ONLY);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+
+    // the snapshot can not be deleted while it is opened
+    CU_ASSERT(ofs_delete_snapshot(ct, snap1) == -INDEX_ERR_IS_OPENED);
+    CU_ASSERT(ofs_close_container(snap_ct) == 0);
+
+    CU_ASSERT(ofs_create_snapshot(ct, &snap2) == 0);
+    CU_ASSERT(snap2 > snap1);
+    CU_ASSERT(get_snapshot_cnt(ct) == 2);
+    CU_ASSERT(ofs_open_object(ct, 600, &obj) == 0);
+    for (key = TEST_KEY_NUM / 2; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    // the snapshots survive the reopen
+    CU_ASSERT(ofs_open_container("kv13", &ct) == 0);
+    CU_ASSERT(get_snapshot_cnt(ct) == 2);
+    CU_ASSERT(ofs_get_snapshot(ct, snap2, &snap) == 0);
+    CU_ASSERT(snap.snapshot_no == snap2);
+    CU_ASSERT(ofs_open_snapshot(ct, snap1, &snap_ct) == 0);
+    check_values(snap_ct, 0, TEST_KEY_NUM, 0);
+    CU_ASSERT(ofs_close_container(snap_ct) == 0);
+    CU_ASSERT(ofs_open_snapshot(ct, snap2, &snap_ct) == 0);
+    check_values(snap_ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_close_container(snap_ct) == 0);
+    check_values(ct, 0, 0, 0);
+
+    // deleting the older one keeps the blocks the newer one refers
+    free_blocks = ct->sm.total_free_blocks;
+    CU_ASSERT(ofs_delete_snapshot(ct, snap1) == 0);
+    CU_ASSERT(ofs_delete_snapshot(ct, snap1) == -INDEX_ERR_KEY_NOT_FOUND);
+    CU_ASSERT(ofs_get_snapshot(ct, snap1, &snap) == -INDEX_ERR_KEY_NOT_FOUND);
+    CU_ASSERT(ct->sm.total_free_blocks > free_blocks);
+    CU_ASSERT(ofs_open_snapshot(ct, snap2, &snap_ct) == 0);
+    check_values(snap_ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_close_container(snap_ct) == 0);
+
+    // no dead block is left after all the snapshots are deleted
+    free_blocks = ct->sm.total_free_blocks;
+    CU_ASSERT(ofs_delete_snapshot(ct, snap2) == 0);
+    CU_ASSERT(get_snapshot_cnt(ct) == 0);
+    CU_ASSERT(ct->sm.total_free_blocks > free_blocks);
+    CU_ASSERT(index_get_total_key(ct->snap_obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+typedef struct diff_result
+{
+    uint64_t cnt[OFS_DIFF_BUTT];
+    uint64_t bad;
+} diff_result_t;
+
+static int32_t count_diff(void *para, uint32_t type, index_entry_t *old_ie, index_entry_t *new_ie)
+{
+    diff_result_t *result = para;
+    uint64_t key;
+    uint64_t old_value;
+    uint64_t new_value;
+
+    result->cnt[type]++;
+    if (type == OFS_DIFF_CHANGE)
+    {
+        memcpy(&key, GET_IE_KEY(new_ie), sizeof(key));
+        memcpy(&old_value, GET_IE_VALUE(old_ie), sizeof(old_value));
+        memcpy(&new_value, GET_IE_VALUE(new_ie), sizeof(new_value));
+        if ((old_value == new_value) || ((new_value != key + 1) && (old_value != key + 1)))
+        {
+            result->bad++;
+        }
+    }
+
+    return 0;
+}
+
+static void check_diff(container_handle_t *ct, uint64_t objid, uint64_t old_no, uint64_t new_no,
+    uint64_t inserted, uint64_t removed, uint64_t changed)
+{
+    diff_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    CU_ASSERT(ofs_diff_snapshots(ct, objid, old_no, new_no, count_diff, &result) == 0);
+    CU_ASSERT(result.cnt[OFS_DIFF_INSERT] == inserted);
+    CU_ASSERT(result.cnt[OFS_DIFF_REMOVE] == removed);
+    CU_ASSERT(result.cnt[OFS_DIFF_CHANGE] == changed);
+    CU_ASSERT(result.bad == 0);
+}
+
+void test_kv_14(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     100000
+#define TEST_CHANGE_NUM  20
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    histogram_t hist;
+    uint64_t snap1;
+    uint64_t snap2;
+    uint64_t reads;
+    uint64_t objid;
+    uint64_t i;
+    uint64_t key;
+    uint64_t value;
+    
+    CU_ASSERT(ofs_create_container("kv14", 1000000, &ct) == 0);
+
+    // b tree and b+ tree
+    for (objid = 700; objid < 702; objid++)
+    {
+        CU_ASSERT(ofs_create_object(ct, objid, FLAG_TABLE | CR_U64 | (CR_BINARY << 4)
+            | ((objid == 701) ? FLAG_BPLUS_TREE : 0), &obj) == 0);
+        for (key = 0; key < TEST_KEY_NUM; key++)
+        {
+            CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+        }
+
+        CU_ASSERT(ofs_close_object(obj) == 0);
+    }
+
+    CU_ASSERT(ofs_create_snapshot(ct, &snap1) == 0);
+    check_diff(ct, 700, snap1, snap1, 0, 0, 0);
+
+    for (objid = 700; objid < 702; objid++)
+    {
+        CU_ASSERT(ofs_open_object(ct, objid, &obj) == 0);
+        for (i = 0; i < TEST_CHANGE_NUM; i++)
+        { // spread over the tree
+            key = i * (TEST_KEY_NUM / TEST_CHANGE_NUM);
+            CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+            key++;
+            value = key + 1;
+            CU_ASSERT(index_update_value(obj, &key, sizeof(key), &value, sizeof(value)) == 0);
+            key = TEST_KEY_NUM + i;
+            CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+        }
+
+        CU_ASSERT(ofs_close_object(obj) == 0);
+    }
+
+    CU_ASSERT(ofs_create_snapshot(ct, &snap2) == 0);
+
+    // only the changed part of the trees is read
+    for (objid = 700; objid < 702; objid++)
+    {
+        ofs_stat_get(OFS_STAT_BLOCK_READ_MISS, &hist);
+        reads = hist.total;
+        check_diff(ct, objid, snap1, snap2, TEST_CHANGE_NUM, TEST_CHANGE_NUM, TEST_CHANGE_NUM);
+        ofs_stat_get(OFS_STAT_BLOCK_READ_MISS, &hist);
+        CU_ASSERT(hist.total - reads < 200);
+        check_diff(ct, objid, snap2, snap1, TEST_CHANGE_NUM, TEST_CHANGE_NUM, TEST_CHANGE_NUM);
+    }
+
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_DIFF_SKIP) > 0);
+
+    // the object created after the snapshot, and the container itself
+    CU_ASSERT(ofs_create_object(ct, 702, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    for (key = 0; key < TEST_CHANGE_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    check_diff(ct, 702, snap2, OFS_SNAPSHOT_NONE, TEST_CHANGE_NUM, 0, 0);
+    check_diff(ct, 702, OFS_SNAPSHOT_NONE, snap1, 0, TEST_CHANGE_NUM, 0);
+    check_diff(ct, 700, snap2, OFS_SNAPSHOT_NONE, 0, 0, 0);
+    CU_ASSERT(ofs_diff_snapshots(ct, 703, snap1, snap2, count_diff, NULL) == -INDEX_ERR_KEY_NOT_FOUND);
+
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+void test_kv_15(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     3000
+
+    container_handle_t *ct;
+    container_handle_t *view;
+    container_handle_t *view2;
+    object_handle_t *obj;
+    uint64_t free_blocks;
+    uint64_t key;
+    uint64_t value;
+    
+    CU_ASSERT(ofs_create_container("kv15", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 600, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+
+    // the view on the same checkpoint is shared
+    CU_ASSERT(ofs_begin_read_view(ct, &view) == 0);
+    CU_ASSERT(ofs_begin_read_view(ct, &view2) == 0);
+    CU_ASSERT(view == view2);
+    CU_ASSERT(ofs_end_read_view(view2) == 0);
+    CU_ASSERT(view->flags & FLAG_READONLY);
+    CU_ASSERT(ofs_begin_read_view(view, &view2) == -INDEX_ERR_READ_ONLY);
+
+    // the blocks the view refers are kept over the checkpoints
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        value = key + 1;
+        CU_ASSERT(index_update_value(obj, &key, sizeof(key), &value, sizeof(value)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    for (key = 0; key < TEST_KEY_NUM / 2; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->pending_num > 0);
+
+    check_values(view, 0, TEST_KEY_NUM, 0);
+    check_values(ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+
+    // the new view sees the last checkpoint only
+    key = TEST_KEY_NUM;
+    CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    CU_ASSERT(ofs_begin_read_view(ct, &view2) == 0);
+    CU_ASSERT(view != view2);
+    check_values(view2, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_end_read_view(view2) == 0);
+    CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+
+    CU_ASSERT(ofs_open_object(view, 600, &obj) == 0);
+    CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == -INDEX_ERR_READ_ONLY);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+
+    // the blocks are released after the view is ended
+    free_blocks = ct->sm.total_free_blocks;
+    CU_ASSERT(ofs_end_read_view(view) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->pending_num == 0);
+    CU_ASSERT(ct->sm.total_free_blocks > free_blocks);
+    check_values(ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv15", &ct) == 0);
+    check_values(ct, TEST_KEY_NUM / 2, TEST_KEY_NUM, 1);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static void check_kv_16_key(object_handle_t *obj, uint64_t key, uint64_t value)
+{
+    uint64_t found = 0;
+
+    if (value == (uint64_t)-1)
+    {
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+        return;
+    }
+
+    CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+    memcpy(&found, GET_IE_VALUE(obj->ie), sizeof(found));
+    CU_ASSERT(found == value);
+}
+
+// drop the tail of the file, as the crash in the middle of writing it
+static void cut_file_tail(const char *path, long len)
+{
+    char *buf;
+    FILE *f;
+    long size;
+
+    f = fopen(path, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT(fseek(f, 0, SEEK_END) == 0);
+    size = ftell(f);
+    CU_ASSERT_FATAL(size > len);
+    buf = malloc(size);
+    CU_ASSERT_FATAL(buf != NULL);
+    CU_ASSERT(fseek(f, 0, SEEK_SET) == 0);
+    CU_ASSERT(fread(buf, 1, size, f) == (size_t)size);
+    fclose(f);
+
+    f = fopen(path, "wb");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT(fwrite(buf, 1, size - len, f) == (size_t)(size - len));
+    fclose(f);
+    free(buf);
+}
+
+typedef struct kv_16_para
+{
+    object_handle_t *obj[2];
+    uint64_t base;
+} kv_16_para_t;
+
+static void *kv_16_thread(void *arg)
+{
+    kv_16_para_t *para = arg;
+    ofs_txn_t *txn;
+    uint64_t key;
+    uint64_t i;
+
+    for (i = 0; i < 20; i++)
+    {
+        key = para->base + i;
+        CU_ASSERT(ofs_txn_begin(para->obj[0]->ct, &txn) == 0);
+        CU_ASSERT(ofs_txn_insert(txn, para->obj[0], &key, sizeof(key), &key, sizeof(key)) == 0);
+        CU_ASSERT(ofs_txn_insert(txn, para->obj[1], &key, sizeof(key), &key, sizeof(key)) == 0);
+        CU_ASSERT(ofs_txn_commit(txn) == 0);
+    }
+
+    return NULL;
+}
+
+void test_kv_16(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     100
+#define TEST_THREAD_NUM  4
+
+    container_handle_t *ct;
+    object_handle_t *obj[2];
+    ofs_txn_t *txn;
+    pthread_t threads[TEST_THREAD_NUM];
+    kv_16_para_t paras[TEST_THREAD_NUM];
+    uint64_t checkpoints;
+    uint64_t key;
+    uint64_t value;
+    uint32_t i;
+    
+    CU_ASSERT(ofs_create_container("kv16", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 900, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj[0]) == 0);
+    CU_ASSERT(ofs_create_object(ct, 901, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj[1]) == 0);
+
+    // nothing is seen before the commit, and the commit checkpoints all
+    checkpoints = ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT);
+    CU_ASSERT(ofs_txn_begin(ct, &txn) == 0);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(ofs_txn_insert(txn, obj[0], &key, sizeof(key), &key, sizeof(key)) == 0);
+        CU_ASSERT(ofs_txn_insert(txn, obj[1], &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj[0]) == 0);
+    CU_ASSERT(ofs_txn_commit(txn) == 0);
+    CU_ASSERT(index_get_total_key(obj[0]) == TEST_KEY_NUM);
+    CU_ASSERT(index_get_total_key(obj[1]) == TEST_KEY_NUM);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT) == checkpoints + 1);
+    CU_ASSERT(ct->sb.log_lsn == ofs_log_last_lsn(ct));
+
+    // the later modification on the key replaces the former one
+    CU_ASSERT(ofs_txn_begin(ct, &txn) == 0);
+    key = 0;
+    value = 1000;
+    CU_ASSERT(ofs_txn_insert(txn, obj[0], &key, sizeof(key), &key, sizeof(key)) == 0);
+    CU_ASSERT(ofs_txn_insert(txn, obj[0], &key, sizeof(key), &key, sizeof(key)) == -INDEX_ERR_KEY_EXIST);
+    CU_ASSERT(ofs_txn_remove(txn, obj[0], &key, sizeof(key)) == 0);
+    CU_ASSERT(ofs_txn_remove(txn, obj[0], &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+    CU_ASSERT(ofs_txn_update(txn, obj[0], &key, sizeof(key), &value, sizeof(value)) == 0);
+    CU_ASSERT(txn->op_num == 1);
+    ofs_txn_abort(txn);
+    check_kv_16_key(obj[0], 0, 0);
+
+    // the keys applied are restored when one fails
+    CU_ASSERT(ofs_txn_begin(ct, &txn) == 0);
+    key = TEST_KEY_NUM;
+    CU_ASSERT(ofs_txn_insert(txn, obj[0], &key, sizeof(key), &key, sizeof(key)) == 0);
+    key = 1;
+    CU_ASSERT(ofs_txn_update(txn, obj[0], &key, sizeof(key), &value, sizeof(value)) == 0);
+    key = 2;
+    CU_ASSERT(ofs_txn_remove(txn, obj[1], &key, sizeof(key)) == 0);
+    key = 3;
+    CU_ASSERT(ofs_txn_insert(txn, obj[1], &key, sizeof(key), &key, sizeof(key)) == 0);
+    CU_ASSERT(ofs_txn_commit(txn) == -INDEX_ERR_KEY_EXIST);
+    check_kv_16_key(obj[0], TEST_KEY_NUM, (uint64_t)-1);
+    check_kv_16_key(obj[0], 1, 1);
+    check_kv_16_key(obj[1], 2, 2);
+    CU_ASSERT(index_get_total_key(obj[0]) == TEST_KEY_NUM);
+    CU_ASSERT(index_get_total_key(obj[1]) == TEST_KEY_NUM);
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_TXN_ABORT) == 2);
+
+    // the transactions on the different keys share the checkpoints
+    checkpoints = ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT);
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        paras[i].obj[0] = obj[0];
+        paras[i].obj[1] = obj[1];
+        paras[i].base = TEST_KEY_NUM * (i + 1);
+        CU_ASSERT(pthread_create(&threads[i], NULL, kv_16_thread, &paras[i]) == 0);
+    }
+
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        CU_ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_CHECKPOINT) - checkpoints <= TEST_THREAD_NUM * 20);
+    CU_ASSERT(index_get_total_key(obj[0]) == TEST_KEY_NUM + TEST_THREAD_NUM * 20);
+    CU_ASSERT(index_get_total_key(obj[1]) == TEST_KEY_NUM + TEST_THREAD_NUM * 20);
+
+    // in commit mode, the transaction torn in the redo log is dropped by the replay
+    CU_ASSERT(ofs_set_durability(ct, OFS_DURABILITY_COMMIT) == 0);
+    for (i = 0; i < 2; i++)
+    {
+        CU_ASSERT(ofs_txn_begin(ct, &txn) == 0);
+        key = i;
+        CU_ASSERT(ofs_txn_remove(txn, obj[0], &key, sizeof(key)) == 0);
+        value = key + 1000;
+        CU_ASSERT(ofs_txn_update(txn, obj[1], &key, sizeof(key), &value, sizeof(value)) == 0);
+        CU_ASSERT(ofs_txn_commit(txn) == 0);
+    }
+
+    copy_file("kv16", "kv16c");
+    copy_file("kv16" OFS_LOG_SUFFIX, "kv16c" OFS_LOG_SUFFIX);
+    cut_file_tail("kv16c" OFS_LOG_SUFFIX, 1);
+
+    CU_ASSERT(ofs_close_object(obj[0]) == 0);
+    CU_ASSERT(ofs_close_object(obj[1]) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv16c", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 900, &obj[0]) == 0);
+    CU_ASSERT(ofs_open_object(ct, 901, &obj[1]) == 0);
+    check_kv_16_key(obj[0], 0, (uint64_t)-1);
+    check_kv_16_key(obj[1], 0, 1000);
+    check_kv_16_key(obj[0], 1, 1);
+    check_kv_16_key(obj[1], 1, 1);
+    CU_ASSERT(ofs_close_object(obj[0]) == 0);
+    CU_ASSERT(ofs_close_object(obj[1]) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+void test_kv_17(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     200
+#define TEST_OBJ_NUM     50
+
+    container_handle_t *ct;
+    object_handle_t *obj[TEST_OBJ_NUM];
+    uint64_t key;
+    uint64_t value;
+    uint32_t i;
+    
+    CU_ASSERT(ofs_create_container("kv17", 100000, &ct) == 0);
+    for (i = 0; i < TEST_OBJ_NUM; i++)
+    {
+        CU_ASSERT_FATAL(ofs_create_object(ct, 1000 + i, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj[i]) == 0);
+        for (key = 0; key < TEST_KEY_NUM; key++)
+        {
+            CU_ASSERT(index_insert_key(obj[i], &key, sizeof(key), &key, sizeof(key)) == 0);
+        }
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->dirty_obj_num == 0);
+    CU_ASSERT(ct->dirty_cache_num == 0);
+
+    // the checkpoint visits the modified object only, not all the open ones
+    key = TEST_KEY_NUM / 2;
+    value = key + 1;
+    CU_ASSERT(index_update_value(obj[7], &key, sizeof(key), &value, sizeof(value)) == 0);
+    CU_ASSERT(ct->dirty_obj_num >= 1);
+    CU_ASSERT(ct->dirty_obj_num <= 3);
+    CU_ASSERT(ct->dirty_cache_num < 8);
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->dirty_obj_num == 0);
+    CU_ASSERT(ct->dirty_cache_num == 0);
+
+    // the moved inodes are recorded in place in $OBJID
+    for (i = 0; i < TEST_OBJ_NUM; i++)
+    {
+        key = 0;
+        value = 1;
+        CU_ASSERT(index_update_value(obj[i], &key, sizeof(key), &value, sizeof(value)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    for (i = 0; i < TEST_OBJ_NUM; i++)
+    {
+        key = 1000 + i;
+        CU_ASSERT_FATAL(index_search_key(ct->id_obj, &key, os_u64_size(key)) == 0);
+        CU_ASSERT(ct->id_obj->ie->value_len == sizeof(uint64_t));
+        CU_ASSERT(os_bstr_to_u64(GET_IE_VALUE(ct->id_obj->ie), ct->id_obj->ie->value_len)
+            == obj[i]->obj_info->inode_no);
+    }
+
+    for (i = 0; i < TEST_OBJ_NUM; i++)
+    {
+        CU_ASSERT(ofs_close_object(obj[i]) == 0);
+    }
+    
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv17", &ct) == 0);
+    for (i = 0; i < TEST_OBJ_NUM; i++)
+    {
+        CU_ASSERT_FATAL(ofs_open_object(ct, 1000 + i, &obj[i]) == 0);
+        for (key = 0; key < TEST_KEY_NUM; key++)
+        {
+            if (key == 0)
+            {
+                check_kv_16_key(obj[i], key, 1);
+                continue;
+            }
+            
+            check_kv_16_key(obj[i], key, ((i == 7) && (key == TEST_KEY_NUM / 2)) ? (key + 1) : key);
+        }
+        
+        CU_ASSERT(ofs_close_object(obj[i]) == 0);
+    }
+    
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static uint16_t make_kv_18_value(uint64_t key, uint32_t round, uint8_t *value)
+{
+    uint16_t len = (uint16_t)(1 + (key * 7 + round * 13) % (32 << round));
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        value[i] = (uint8_t)(key + round + i);
+    }
+
+    return len;
+}
+
+static void check_kv_18_values(object_handle_t *obj, uint64_t key_num, uint32_t round)
+{
+    uint8_t value[1024];
+    uint16_t len;
+    uint64_t key;
+
+    CU_ASSERT(index_get_total_key(obj) == (int64_t)key_num);
+    for (key = 0; key < key_num; key++)
+    {
+        len = make_kv_18_value(key, round, value);
+        CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+        CU_ASSERT(obj->ie->value_len == len);
+        CU_ASSERT(memcmp(GET_IE_VALUE(obj->ie), value, len) == 0);
+    }
+}
+
+void test_kv_18(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     3000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint8_t value[1024];
+    uint16_t len;
+    uint64_t key;
+    uint64_t free_blocks;
+    uint32_t round;
+    
+    CU_ASSERT(ofs_create_container("kv18", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 1800, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    
+    // the upsert inserts the missing keys
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        len = make_kv_18_value(key, 0, value);
+        CU_ASSERT(index_upsert_key(obj, &key, sizeof(key), value, len) == 0);
+    }
+
+    check_kv_18_values(obj, TEST_KEY_NUM, 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+
+    // the values grow, shrink or keep their size, in place or by splitting
+    for (round = 1; round < 6; round++)
+    {
+        for (key = 0; key < TEST_KEY_NUM; key++)
+        {
+            len = make_kv_18_value(key, round, value);
+            if (key & 1)
+            {
+                CU_ASSERT(index_update_value(obj, &key, sizeof(key), value, len) == 0);
+            }
+            else
+            {
+                CU_ASSERT(index_upsert_key(obj, &key, sizeof(key), value, len) == 0);
+            }
+        }
+
+        check_kv_18_values(obj, TEST_KEY_NUM, round);
+        CU_ASSERT(ofs_commit_container(ct) == 0);
+    }
+
+    // the space is given back whatever the updates did
+    free_blocks = ct->sm.total_free_blocks;
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->sm.total_free_blocks > free_blocks);
+    
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        len = make_kv_18_value(key, 2, value);
+        CU_ASSERT(index_upsert_key(obj, &key, sizeof(key), value, len) == 0);
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    // the upserts are replayed from the log
+    CU_ASSERT(ofs_open_container("kv18", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 1800, &obj) == 0);
+    check_kv_18_values(obj, TEST_KEY_NUM, 2);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+void test_kv_19(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     3000
+#define TEST_PIN_NUM     (TEST_KEY_NUM / 10)
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    ofs_pinned_value_t pins[TEST_PIN_NUM];
+    uint8_t value[1024];
+    uint8_t buf[1024];
+    uint16_t len;
+    uint64_t key;
+    uint32_t round;
+    uint32_t i;
+    
+    CU_ASSERT(ofs_create_container("kv19", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 1900, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        len = make_kv_18_value(key, 1, value);
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, len) == 0);
+    }
+
+    // the keys in the root and in the leaves are pinned
+    for (i = 0; i < TEST_PIN_NUM; i++)
+    {
+        key = i * 10;
+        len = make_kv_18_value(key, 1, value);
+        CU_ASSERT_FATAL(index_get_pinned(obj, &key, sizeof(key), &pins[i]) == 0);
+        CU_ASSERT(pins[i].value_len == len);
+        CU_ASSERT(memcmp(pins[i].value, value, len) == 0);
+    }
+
+    index_release_pinned(&pins[0]);
+    key = TEST_KEY_NUM;
+    CU_ASSERT(index_get_pinned(obj, &key, sizeof(key), &pins[0]) == -INDEX_ERR_KEY_NOT_FOUND);
+    CU_ASSERT(pins[0].pb == NULL);
+    key = 0;
+    CU_ASSERT_FATAL(index_get_pinned(obj, &key, sizeof(key), &pins[0]) == 0);
+
+    // the writers change copies of the pinned blocks
+    for (round = 2; round < 4; round++)
+    {
+        for (key = 0; key < TEST_KEY_NUM; key++)
+        {
+            len = make_kv_18_value(key, round, value);
+            CU_ASSERT(index_upsert_key(obj, &key, sizeof(key), value, len) == 0);
+        }
+
+        CU_ASSERT(ofs_commit_container(ct) == 0);
+    }
+
+    for (key = 1; key < TEST_KEY_NUM; key += 2)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_counter_get(&ct->counters, OFS_CNT_PIN_UNSHARE) != 0);
+    for (i = 0; i < TEST_PIN_NUM; i++)
+    {
+        key = i * 10;
+        len = make_kv_18_value(key, 1, value);
+        CU_ASSERT(pins[i].value_len == len);
+        CU_ASSERT(memcmp(pins[i].value, value, len) == 0);
+    }
+
+    // the value is copied once, and cut by the small buffer
+    for (key = 0; key < TEST_KEY_NUM; key += 2)
+    {
+        len = make_kv_18_value(key, 3, value);
+        CU_ASSERT(index_get_into(obj, &key, sizeof(key), buf, sizeof(buf)) == len);
+        CU_ASSERT(memcmp(buf, value, len) == 0);
+        CU_ASSERT(index_get_into(obj, &key, sizeof(key), buf, 1) == len);
+        CU_ASSERT(buf[0] == value[0]);
+    }
+
+    key = 1;
+    CU_ASSERT(index_get_into(obj, &key, sizeof(key), buf, sizeof(buf)) == -INDEX_ERR_KEY_NOT_FOUND);
+
+    for (i = 0; i < TEST_PIN_NUM / 2; i++)
+    {
+        index_release_pinned(&pins[i]);
+        CU_ASSERT(pins[i].pb == NULL);
+    }
+
+    // the pins live after the object and the container are closed
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ct->pinned_cache_num == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+    CU_ASSERT(ofs_get_container_handle("kv19") == ct);
+    for (i = TEST_PIN_NUM / 2; i < TEST_PIN_NUM; i++)
+    {
+        key = i * 10;
+        len = make_kv_18_value(key, 1, value);
+        CU_ASSERT(memcmp(pins[i].value, value, len) == 0);
+        index_release_pinned(&pins[i]);
+    }
+
+    // closed by the last pin
+    CU_ASSERT(ofs_get_container_handle("kv19") == NULL);
+}
+
+typedef struct kv_20_caches
+{
+    ofs_block_cache_t **caches;
+    uint32_t num;
+} kv_20_caches_t;
+
+static int32_t collect_kv_20_cache(kv_20_caches_t *set, ofs_block_cache_t *cache)
+{
+    set->caches[set->num++] = cache;
+    return 0;
+}
+
+static bool_t is_kv_20_cache_alive(kv_20_caches_t *set, ofs_block_cache_t *cache)
+{
+    uint32_t i;
+
+    for (i = 0; i < set->num; i++)
+    {
+        if (set->caches[i] == cache)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// every link points to a living cache, and the linked child got by the
+// entry is the block the entry refers
+static void check_kv_20_links(object_handle_t *obj)
+{
+    container_handle_t *ct = obj->ct;
+    kv_20_caches_t set;
+    ofs_block_cache_t *cache;
+    ofs_block_cache_t *child;
+    ofs_cache_link_t *link;
+    index_block_t *ib;
+    index_entry_t *ie;
+    uint32_t i;
+    uint32_t j;
+
+    set.num = 0;
+    set.caches = OS_MALLOC(sizeof(ofs_block_cache_t *) * (avl_numnodes(&ct->metadata_cache) + 1));
+    CU_ASSERT_FATAL(set.caches != NULL);
+    set.caches[set.num++] = &obj->obj_info->root_cache;
+    (void)avl_walk_all(&ct->metadata_cache, (avl_walk_cb_t)collect_kv_20_cache, &set);
+
+    for (i = 0; i < set.num; i++)
+    {
+        cache = set.caches[i];
+        if (cache->links == NULL)
+        {
+            continue;
+        }
+
+        for (j = 0; j < CACHE_LINK_NUM; j++)
+        {
+            link = &cache->links[j];
+            if (link->cache == NULL)
+            {
+                continue;
+            }
+
+            CU_ASSERT_FATAL(is_kv_20_cache_alive(&set, link->cache));
+            CU_ASSERT(link->cache->parent == cache);
+            CU_ASSERT(link->cache->parent_slot == j);
+            CU_ASSERT(CACHE_LINK_SLOT(link->pos) == j);
+        }
+
+        ib = IB(cache->ib);
+        if (!(ib->node_type & INDEX_BLOCK_LARGE))
+        {
+            continue;
+        }
+
+        for (ie = GET_FIRST_IE(ib); (uint8_t *)ie < GET_END_IE(ib); ie = GET_NEXT_IE(ie))
+        {
+            CU_ASSERT_FATAL(ie->len != 0);
+            if (ie->flags & INDEX_ENTRY_NODE)
+            {
+                child = get_child_cache(cache, (uint32_t)((uint8_t *)ie - (uint8_t *)ib), GET_IE_VBN(ie));
+                if (child != NULL)
+                {
+                    CU_ASSERT_FATAL(is_kv_20_cache_alive(&set, child));
+                    CU_ASSERT(child->vbn == GET_IE_VBN(ie));
+                }
+            }
+
+            if (ie->flags & INDEX_ENTRY_END)
+            {
+                break;
+            }
+        }
+    }
+
+    OS_FREE(set.caches);
+}
+
+static void check_kv_20_values(object_handle_t *obj, uint64_t start, uint64_t end, uint64_t step, uint64_t delta)
+{
+    uint64_t key;
+    uint64_t value;
+
+    for (key = start; key < end; key += step)
+    {
+        CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == 0);
+        memcpy(&value, GET_IE_VALUE(obj->ie), sizeof(value));
+        CU_ASSERT(value == key + delta);
+    }
+
+    check_kv_20_links(obj);
+}
+
+void test_kv_20(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     5000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint64_t snapshot_no;
+    uint8_t value[100];
+    uint64_t key;
+    uint64_t new_value;
+    uint64_t i;
+
+    memset(value, 0, sizeof(value));
+    CU_ASSERT(ofs_create_container("kv20", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 2000, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+
+    // the blocks are split while the links are used
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key = (i * 7919) % TEST_KEY_NUM;
+        memcpy(value, &key, sizeof(key));
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, sizeof(value)) == 0);
+        if ((i % 500) == 0)
+        {
+            check_kv_20_links(obj);
+        }
+    }
+
+    CU_ASSERT(obj->max_depth >= 2);
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 1, 0);
+
+    // the blocks shared with the snapshot are copied to the new places
+    CU_ASSERT(ofs_create_snapshot(ct, &snapshot_no) == 0);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        new_value = key + 1;
+        memcpy(value, &new_value, sizeof(new_value));
+        CU_ASSERT(index_update_value(obj, &key, sizeof(key), value, sizeof(value)) == 0);
+    }
+
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 1, 1);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 1, 1);
+
+    // the blocks are merged and freed
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        if ((key % 10) != 0)
+        {
+            CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+        }
+
+        if ((key % 500) == 0)
+        {
+            check_kv_20_links(obj);
+        }
+    }
+
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 10, 1);
+    key = 1;
+    CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+
+    // the root collapses to a leaf and grows again
+    for (key = 0; key < TEST_KEY_NUM; key += 10)
+    {
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(index_get_total_key(obj) == 0);
+    check_kv_20_links(obj);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        memcpy(value, &key, sizeof(key));
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, sizeof(value)) == 0);
+    }
+
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 1, 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+
+    CU_ASSERT(ofs_open_object(ct, 2000, &obj) == 0);
+    check_kv_20_values(obj, 0, TEST_KEY_NUM, 1, 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_delete_snapshot(ct, snapshot_no) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static long get_file_size(const char *path)
+{
+    FILE *f;
+    long size;
+
+    f = fopen(path, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT(fseek(f, 0, SEEK_END) == 0);
+    size = ftell(f);
+    fclose(f);
+
+    return size;
+}
+
+static void check_kv_21_values(object_handle_t *obj, uint64_t start, uint64_t end)
+{
+    uint8_t value[400];
+    uint64_t key;
+
+    for (key = start; key < end; key++)
+    {
+        memset(value, (uint8_t)key, sizeof(value));
+        CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+        CU_ASSERT(obj->ie->value_len == sizeof(value));
+        CU_ASSERT(memcmp(GET_IE_VALUE(obj->ie), value, sizeof(value)) == 0);
+    }
+}
+
+// the log is dropped up to the checkpoint while it is appended, and the
+// replay reads both the old and the current segments larger than the buffer
+void test_kv_21(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     4000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint8_t value[400];
+    uint64_t key;
+    long size;
+
+    CU_ASSERT(ofs_create_container("kv21", 100000, &ct) == 0);
+    CU_ASSERT(ofs_create_object(ct, 2100, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        memset(value, (uint8_t)key, sizeof(value));
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, sizeof(value)) == 0);
+    }
+
+    // crash: the container is taken before the checkpoint
+    copy_file("kv21", "kv21c");
+
+    // the records before the checkpoint are in the old segment
+    CU_ASSERT(commit_container_modification(ct) == 0);
+    CU_ASSERT(ct->sb.log_lsn == ofs_log_last_lsn(ct));
+    size = get_file_size("kv21" OFS_LOG_OLD_SUFFIX);
+    CU_ASSERT(size > OFS_LOG_BUF_SIZE);
+    CU_ASSERT(get_file_size("kv21" OFS_LOG_SUFFIX) == 0);
+
+    // the modifications go on before the checkpoint is on disk
+    for (key = TEST_KEY_NUM; key < TEST_KEY_NUM * 2; key++)
+    {
+        memset(value, (uint8_t)key, sizeof(value));
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, sizeof(value)) == 0);
+    }
+
+    CU_ASSERT(ofs_sync_container(ct) == 0);
+    copy_file("kv21" OFS_LOG_OLD_SUFFIX, "kv21c" OFS_LOG_OLD_SUFFIX);
+    copy_file("kv21" OFS_LOG_SUFFIX, "kv21c" OFS_LOG_SUFFIX);
+
+    // only the old segment is dropped
+    CU_ASSERT(ofs_flush_disk(ct) == 0);
+    CU_ASSERT(ofs_log_truncate(ct) == 0);
+    CU_ASSERT(get_file_size("kv21" OFS_LOG_OLD_SUFFIX) == 0);
+    CU_ASSERT(get_file_size("kv21" OFS_LOG_SUFFIX) > OFS_LOG_BUF_SIZE);
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv21c", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 2100, &obj) == 0);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM * 2);
+    check_kv_21_values(obj, 0, TEST_KEY_NUM * 2);
+    CU_ASSERT(get_file_size("kv21c" OFS_LOG_OLD_SUFFIX) == 0);
+    CU_ASSERT(get_file_size("kv21c" OFS_LOG_SUFFIX) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv21", &ct) == 0);
+    CU_ASSERT(ofs_open_object(ct, 2100, &obj) == 0);
+    check_kv_21_values(obj, 0, TEST_KEY_NUM * 2);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     3000
+#undef TEST_THREAD_NUM
+#define TEST_THREAD_NUM  4
+#define TEST_SNAP_NUM    3
+
+typedef struct kv_22_para
+{
+    object_handle_t *obj;
+    uint64_t base;
+} kv_22_para_t;
+
+static void *kv_22_thread(void *arg)
+{
+    kv_22_para_t *para = arg;
+    uint64_t key;
+    uint64_t i;
+
+    for (i = 0; i < TEST_KEY_NUM; i++)
+    {
+        key = para->base + i;
+        CU_ASSERT(index_insert_key(para->obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    return NULL;
+}
+
+// the object holds a prefix of the keys of its thread, as the inserts are ordered
+static void check_kv_22_keys(container_handle_t *ct, uint64_t objid, uint64_t base)
+{
+    object_handle_t *obj;
+    uint64_t total;
+    uint64_t key;
+
+    CU_ASSERT_FATAL(ofs_open_object(ct, objid, &obj) == 0);
+    total = index_get_total_key(obj);
+    CU_ASSERT(total <= TEST_KEY_NUM);
+    for (key = base; key < base + total; key++)
+    {
+        check_kv_16_key(obj, key, key);
+    }
+
+    key = base + total;
+    CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+}
+
+void test_kv_22(void)
+{
+    container_handle_t *ct;
+    container_handle_t *snap_ct;
+    object_handle_t *obj[TEST_THREAD_NUM];
+    pthread_t threads[TEST_THREAD_NUM];
+    kv_22_para_t paras[TEST_THREAD_NUM];
+    uint64_t snaps[TEST_SNAP_NUM];
+    uint32_t i;
+    uint32_t j;
+
+    CU_ASSERT(ofs_create_container("kv22", 100000, &ct) == 0);
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        CU_ASSERT_FATAL(ofs_create_object(ct, 2200 + i, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj[i]) == 0);
+        paras[i].obj = obj[i];
+        paras[i].base = (uint64_t)i * TEST_KEY_NUM * 10;
+    }
+
+    // the writers wait for the checkpoints, which never take a half insert
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        CU_ASSERT(pthread_create(&threads[i], NULL, kv_22_thread, &paras[i]) == 0);
+    }
+
+    for (i = 0; i < TEST_SNAP_NUM; i++)
+    {
+        for (j = 0; j < 10; j++)
+        {
+            CU_ASSERT(ofs_commit_container(ct) == 0);
+        }
+
+        CU_ASSERT(ofs_create_snapshot(ct, &snaps[i]) == 0);
+    }
+
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        CU_ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        CU_ASSERT(index_get_total_key(obj[i]) == TEST_KEY_NUM);
+        CU_ASSERT(ofs_close_object(obj[i]) == 0);
+    }
+
+    for (i = 0; i < TEST_SNAP_NUM; i++)
+    {
+        CU_ASSERT_FATAL(ofs_open_snapshot(ct, snaps[i], &snap_ct) == 0);
+        for (j = 0; j < TEST_THREAD_NUM; j++)
+        {
+            check_kv_22_keys(snap_ct, 2200 + j, paras[j].base);
+        }
+
+        CU_ASSERT(ofs_close_container(snap_ct) == 0);
+    }
+
+    CU_ASSERT(ofs_delete_snapshot(ct, snaps[0]) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv22", &ct) == 0);
+    for (i = 0; i < TEST_THREAD_NUM; i++)
+    {
+        check_kv_22_keys(ct, 2200 + i, paras[i].base);
+        CU_ASSERT(ofs_open_object(ct, 2200 + i, &obj[i]) == 0);
+        CU_ASSERT(index_get_total_key(obj[i]) == TEST_KEY_NUM);
+        CU_ASSERT(ofs_close_object(obj[i]) == 0);
+    }
+
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+typedef struct kv_23_para
+{
+    container_handle_t *ct;
+    volatile bool_t stop;
+    uint32_t views;
+} kv_23_para_t;
+
+static void *kv_23_thread(void *arg)
+{
+    kv_23_para_t *para = arg;
+    container_handle_t *view;
+    uint64_t seq;
+
+    while (!para->stop)
+    {
+        CU_ASSERT_FATAL(ofs_begin_read_view(para->ct, &view) == 0);
+        seq = view->view_seq;
+        check_kv_22_keys(view, 2300, 0);
+
+        // the blocks it reads are not reused by the later checkpoints
+        while (!para->stop && (para->ct->commit_seq < seq + 2))
+        {
+            OS_SLEEP_MS(1);
+        }
+
+        check_kv_22_keys(view, 2300, 0);
+        CU_ASSERT(ofs_end_read_view(view) == 0);
+        para->views++;
+    }
+
+    return NULL;
+}
+
+void test_kv_23(void)
+{
+    container_handle_t *ct;
+    object_handle_t *obj;
+    pthread_t writer;
+    pthread_t reader;
+    kv_22_para_t wpara;
+    kv_23_para_t rpara;
+    uint32_t i;
+
+    CU_ASSERT(ofs_create_container("kv23", 100000, &ct) == 0);
+    CU_ASSERT_FATAL(ofs_create_object(ct, 2300, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+
+    // the read views begin while the checkpoints release the blocks
+    wpara.obj = obj;
+    wpara.base = 0;
+    rpara.ct = ct;
+    rpara.stop = FALSE;
+    rpara.views = 0;
+    CU_ASSERT(pthread_create(&writer, NULL, kv_22_thread, &wpara) == 0);
+    CU_ASSERT(pthread_create(&reader, NULL, kv_23_thread, &rpara) == 0);
+
+    for (i = 0; i < 30; i++)
+    {
+        CU_ASSERT(ofs_commit_container(ct) == 0);
+    }
+
+    CU_ASSERT(pthread_join(writer, NULL) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    rpara.stop = TRUE;
+    CU_ASSERT(pthread_join(reader, NULL) == 0);
+    CU_ASSERT(rpara.views > 0);
+    CU_ASSERT(ct->view_cnt == 0);
+
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+extern int32_t file_open_or_create(void **hnd, const char *name, char *v_pcMethod);
+
+// the checkpoint failing to write keeps the redo log for the crash, and the
+// next checkpoint written drops it
+void test_kv_24(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     1000
+
+    container_handle_t *ct;
+    container_handle_t *view;
+    object_handle_t *obj;
+    object_handle_t *view_obj;
+    void *disk_hnd;
+    void *ro_hnd;
+    uint64_t commit_seq;
+    uint64_t key;
+
+    CU_ASSERT(ofs_create_container("kv24", 100000, &ct) == 0);
+    CU_ASSERT_FATAL(ofs_create_object(ct, 2400, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    // the blocks can not be written to the read only handle
+    CU_ASSERT_FATAL(file_open_or_create(&ro_hnd, "kv24", "rb") == 0);
+    disk_hnd = ct->disk_hnd;
+    ct->disk_hnd = ro_hnd;
+    commit_seq = ct->commit_seq;
+    CU_ASSERT(ofs_commit_container(ct) < 0);
+    CU_ASSERT(ct->commit_seq == commit_seq);
+    CU_ASSERT(ct->flags & FLAG_DIRTY);
+    CU_ASSERT(get_file_size("kv24" OFS_LOG_OLD_SUFFIX) > 0);
+
+    // the read view is on the last checkpoint written
+    CU_ASSERT_FATAL(ofs_begin_read_view(ct, &view) == 0);
+    CU_ASSERT(view->view_seq == commit_seq);
+    CU_ASSERT_FATAL(ofs_open_object(view, 2400, &view_obj) == 0);
+    CU_ASSERT(index_get_total_key(view_obj) == 0);
+    CU_ASSERT(ofs_close_object(view_obj) == 0);
+    CU_ASSERT(ofs_end_read_view(view) == 0);
+
+    // crash: the modifications are only in the redo log
+    copy_file("kv24", "kv24c");
+    copy_file("kv24" OFS_LOG_OLD_SUFFIX, "kv24c" OFS_LOG_OLD_SUFFIX);
+    copy_file("kv24" OFS_LOG_SUFFIX, "kv24c" OFS_LOG_SUFFIX);
+
+    ct->disk_hnd = disk_hnd;
+    CU_ASSERT(os_file_close(ro_hnd) == 0);
+    for (key = TEST_KEY_NUM; key < TEST_KEY_NUM * 2; key++)
+    {
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), &key, sizeof(key)) == 0);
+    }
+
+    CU_ASSERT(ofs_commit_container(ct) == 0);
+    CU_ASSERT(ct->commit_seq == commit_seq + 1);
+    CU_ASSERT(get_file_size("kv24" OFS_LOG_OLD_SUFFIX) == 0);
+    CU_ASSERT(get_file_size("kv24" OFS_LOG_SUFFIX) == 0);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv24c", &ct) == 0);
+    CU_ASSERT_FATAL(ofs_open_object(ct, 2400, &obj) == 0);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        check_kv_16_key(obj, key, key);
+    }
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+
+    CU_ASSERT(ofs_open_container("kv24", &ct) == 0);
+    CU_ASSERT_FATAL(ofs_open_object(ct, 2400, &obj) == 0);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM * 2);
+    check_kv_16_key(obj, TEST_KEY_NUM * 2 - 1, TEST_KEY_NUM * 2 - 1);
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+}
+
+static void make_kv_25_value(uint64_t key, uint16_t len, uint8_t *value)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        value[i] = (uint8_t)(key + i);
+    }
+}
+
+void test_kv_25(void)
+{
+#undef TEST_KEY_NUM
+#define TEST_KEY_NUM     20000
+
+    container_handle_t *ct;
+    object_handle_t *obj;
+    uint16_t *lens;
+    uint8_t value[VALUE_MAX_SIZE];
+    uint64_t key;
+    uint64_t succ;
+    uint32_t removed = 0;
+
+    lens = OS_MALLOC(sizeof(uint16_t) * TEST_KEY_NUM);
+    CU_ASSERT_FATAL(lens != NULL);
+
+    CU_ASSERT(ofs_create_container("kv25", 100000, &ct) == 0);
+    CU_ASSERT_FATAL(ofs_create_object(ct, 2500, FLAG_TABLE | CR_U64 | (CR_BINARY << 4), &obj) == 0);
+
+    // the appending splits leave the nodes full of small entries
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        lens[key] = 1;
+        make_kv_25_value(key, lens[key], value);
+        CU_ASSERT(index_insert_key(obj, &key, sizeof(key), value, lens[key]) == 0);
+    }
+
+    // the entry removed from a full node is replaced by a large successor,
+    // which splits the node
+    for (key = 0; key + 1 < TEST_KEY_NUM; key += 2)
+    {
+        CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+        if (!(obj->ie->flags & INDEX_ENTRY_NODE))
+        {
+            continue;
+        }
+
+        succ = key + 1;
+        lens[succ] = VALUE_MAX_SIZE;
+        make_kv_25_value(succ, lens[succ], value);
+        CU_ASSERT(index_update_value(obj, &succ, sizeof(succ), value, lens[succ]) == 0);
+
+        CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+        if (!(obj->ie->flags & INDEX_ENTRY_NODE)
+            || (obj->cache->ib->alloc_size - obj->cache->ib->real_size >= VALUE_MAX_SIZE))
+        {
+            continue;
+        }
+
+        CU_ASSERT(index_remove_key(obj, &key, sizeof(key)) == 0);
+        lens[key] = 0;
+        removed++;
+    }
+
+    CU_ASSERT(removed != 0);
+    CU_ASSERT(index_get_total_key(obj) == TEST_KEY_NUM - removed);
+    for (key = 0; key < TEST_KEY_NUM; key++)
+    {
+        if (lens[key] == 0)
+        {
+            CU_ASSERT(index_search_key(obj, &key, sizeof(key)) == -INDEX_ERR_KEY_NOT_FOUND);
+            continue;
+        }
+
+        make_kv_25_value(key, lens[key], value);
+        CU_ASSERT_FATAL(index_search_key(obj, &key, sizeof(key)) == 0);
+        CU_ASSERT(obj->ie->value_len == lens[key]);
+        CU_ASSERT(memcmp(GET_IE_VALUE(obj->ie), value, lens[key]) == 0);
+    }
+
+    CU_ASSERT(ofs_close_object(obj) == 0);
+    CU_ASSERT(ofs_close_container(ct) == 0);
+    OS_FREE(lens);
+}
+
 int add_kv_test_case2(void)
 {
     CU_pSuite pSuite = NULL;
@@ -276,6 +2329,111 @@ int add_kv_test_case2(void)
        return -2;
     }
 
+    if (!CU_add_test(pSuite, "test kv 5", test_kv_5))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 6", test_kv_6))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 7", test_kv_7))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 8", test_kv_8))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 9", test_kv_9))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 10", test_kv_10))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 11", test_kv_11))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 12", test_kv_12))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 13", test_kv_13))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 14", test_kv_14))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 15", test_kv_15))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 16", test_kv_16))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 17", test_kv_17))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 18", test_kv_18))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 19", test_kv_19))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 20", test_kv_20))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 21", test_kv_21))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 22", test_kv_22))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 23", test_kv_23))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 24", test_kv_24))
+    {
+       return -2;
+    }
+
+    if (!CU_add_test(pSuite, "test kv 25", test_kv_25))
+    {
+       return -2;
+    }
+
     return 0;
 }
 